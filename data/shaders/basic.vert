@@ -6,10 +6,17 @@ layout(location = 1) in vec3 vertexNormal_modelspace;
 layout(location = 2) in vec2 vertexUV_modelspace;
 
 // Uniforms
-uniform mat4 MVP;
-uniform mat4 MV;
 uniform mat4 M;
-uniform mat4 V;
+uniform mat3 N; // Inverse transpose of M, which may scale
+uniform vec3 scale; // Of the Mesh, the procedural textures are not scaled
+// Camera and light sources of the frame, see ShaderManager::UpdateFrameData
+layout(std140) uniform FrameData {
+  mat4 V;
+  mat4 P;
+  mat4 shadow_VP; // Of the light SHADOW_LIGHT, see ShadowMap
+  vec4 camera_data; // Far clipping distance in x
+  vec4 light_data[4 * N_LIGHTS]; // 16 floats for each light
+};
 
 uniform vec3 light_position_worldspace;
 
@@ -27,6 +34,7 @@ out vec3 view_direction_to_fragment_worldspace;
 //out vec3 light_direction_to_fragment_viewspace;
 
 void main(){
+  mat4 MV = V * M;
   
   uv = vertexUV_modelspace;
 
@@ -40,7 +48,7 @@ void main(){
           vec3(0,0,0) + vertex_position_viewspace;*/
   view_direction_to_fragment_worldspace = vec3(inverse(V) * (vec4(0.0,0.0,0.0,1.0) - vec4(vertex_position_viewspace, 1.0)));
 
-  position_modelspace = vertexPosition_modelspace;
+  position_modelspace = vertexPosition_modelspace * scale;
 
   position_viewspace = vec3(MV * vec4(vertexPosition_modelspace,1));
 
@@ -48,8 +56,8 @@ void main(){
 
 
   //normal_viewspace = vec3(MV * vec4(vertexNormal_modelspace,0));
-  normal_worldspace = vec3(M * vec4(vertexNormal_modelspace,0));
+  normal_worldspace = N * vertexNormal_modelspace;
 	
   // Output position of the vertex
-	gl_Position = MVP * vec4(vertexPosition_modelspace,1);
+	gl_Position = P * MV * vec4(vertexPosition_modelspace,1);
 }
\ No newline at end of file
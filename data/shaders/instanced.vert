@@ -0,0 +1,52 @@
+// All preprocessor code is in separate string
+
+// Input data, the vertices of the unit box
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec3 vertexNormal_modelspace;
+layout(location = 2) in vec2 vertexUV_modelspace;
+
+// Input data, one per instance. M takes the locations 3 to 6
+layout(location = 3) in mat4 M;
+layout(location = 7) in vec3 scale;
+// Index in the MaterialData block, see basic.frag
+layout(location = 8) in int instance_material_index;
+
+// Uniforms
+// Camera and light sources of the frame, see ShaderManager::UpdateFrameData
+layout(std140) uniform FrameData {
+  mat4 V;
+  mat4 P;
+  mat4 shadow_VP; // Of the light SHADOW_LIGHT, see ShadowMap
+  vec4 camera_data; // Far clipping distance in x
+  vec4 light_data[4 * N_LIGHTS]; // 16 floats for each light
+};
+
+// Output data
+out vec3 position_worldspace;
+out vec3 position_viewspace;
+out vec3 position_modelspace;
+out vec3 normal_worldspace;
+out vec2 uv;
+out vec3 view_direction_to_fragment_worldspace;
+flat out int material_index;
+
+void main(){
+
+  uv = vertexUV_modelspace;
+  material_index = instance_material_index;
+
+  // The box is scaled in model space, like the vertices of a Box
+  position_modelspace = vertexPosition_modelspace * scale;
+
+  vec4 vertex_position_worldspace = M * vec4(position_modelspace,1);
+  vec4 vertex_position_viewspace = V * vertex_position_worldspace;
+  position_worldspace = vec3(vertex_position_worldspace);
+  position_viewspace = vec3(vertex_position_viewspace);
+  view_direction_to_fragment_worldspace = vec3(inverse(V) * (vec4(0.0,0.0,0.0,1.0) - vertex_position_viewspace));
+
+  // M is a rigid transform so the normals need no inverse transpose
+  normal_worldspace = vec3(M * vec4(vertexNormal_modelspace,0));
+
+  // Output position of the vertex
+  gl_Position = P * vertex_position_viewspace;
+}
@@ -0,0 +1,5 @@
+// All preprocessor code is in separate string
+
+// Only the depth is written, see shadow.vert
+void main(){
+}
@@ -0,0 +1,31 @@
+// All preprocessor code is in separate string
+
+// Input data
+layout(location = 0) in vec3 vertexPosition_modelspace;
+#ifdef INSTANCED
+// One per instance, see instanced.vert. M takes the locations 3 to 6
+layout(location = 3) in mat4 M;
+layout(location = 7) in vec3 scale;
+#else
+uniform mat4 M;
+#endif
+
+// Uniforms
+// Camera and light sources of the frame, see ShaderManager::UpdateFrameData
+layout(std140) uniform FrameData {
+  mat4 V;
+  mat4 P;
+  mat4 shadow_VP; // Of the light SHADOW_LIGHT, see ShadowMap
+  vec4 camera_data; // Far clipping distance in x
+  vec4 light_data[4 * N_LIGHTS]; // 16 floats for each light
+};
+
+void main(){
+#ifdef INSTANCED
+  vec3 position_modelspace = vertexPosition_modelspace * scale;
+#else
+  vec3 position_modelspace = vertexPosition_modelspace;
+#endif
+  // Only the depth seen from the light is written
+  gl_Position = shadow_VP * M * vec4(position_modelspace,1);
+}
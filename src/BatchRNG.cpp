@@ -0,0 +1,113 @@
+#include "BatchRNG.h"
+
+const int BatchRNG::N_LANES;
+const int BatchRNG::BLOCK_SIZE;
+
+//! Internal function used for seeding. The splitmix64 generator.
+static uint64_t SplitMix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+//! Creates a generator seeded from the current time, just like AutoInitRNG.
+BatchRNG::BatchRNG() {
+  Seed(time(0));
+}
+
+//! Creates a generator for a specific seed and stream.
+/*!
+  \param seed is the seed of the generator.
+  \param stream is the index of the substream. Generators with the same seed
+  but different streams produce independent sequences.
+*/
+BatchRNG::BatchRNG(uint64_t seed, uint64_t stream) {
+  Seed(seed, stream);
+}
+
+//! Reseeds the generator.
+/*!
+  All lanes are initialized from splitmix64, which is the recommended way of
+  seeding xorshift generators.
+  \param seed is the seed of the generator.
+  \param stream is the index of the substream.
+*/
+void BatchRNG::Seed(uint64_t seed, uint64_t stream) {
+  uint64_t x = seed ^ SplitMix64(&stream);
+  for (int i = 0; i < N_LANES; ++i) {
+    s0_[i] = SplitMix64(&x);
+    s1_[i] = SplitMix64(&x);
+  }
+  block_pos_ = BLOCK_SIZE;
+}
+
+//! Fills a buffer with random 64 bit words.
+/*!
+  The inner loop over the lanes has no dependencies between iterations and
+  is vectorized.
+  \param out is the buffer to fill.
+  \param n is the number of words to write.
+*/
+void BatchRNG::Fill(uint64_t* out, int n) {
+  int i = 0;
+  for (; i + N_LANES <= n; i += N_LANES) {
+    for (int l = 0; l < N_LANES; ++l) {
+      uint64_t x = s0_[l];
+      const uint64_t y = s1_[l];
+      out[i + l] = x + y;
+      s0_[l] = y;
+      x ^= x << 23;
+      s1_[l] = x ^ y ^ (x >> 18) ^ (y >> 5);
+    }
+  }
+  for (; i < n; ++i)
+    out[i] = Next();
+}
+
+//! Fills a buffer with uniform floats in [0, 1).
+/*!
+  \param out is the buffer to fill.
+  \param n is the number of floats to write.
+*/
+void BatchRNG::FillUniform(float* out, int n) {
+  uint64_t words[BLOCK_SIZE];
+  while (n > 0) {
+    int count = n < BLOCK_SIZE ? n : BLOCK_SIZE;
+    Fill(words, count);
+    for (int i = 0; i < count; ++i) {
+      // The 24 highest bits fit exactly in the mantissa of a float
+      out[i] = static_cast<int32_t>(words[i] >> 40) * (1.0f / 16777216.0f);
+    }
+    out += count;
+    n -= count;
+  }
+}
+
+//! Draws a single random 64 bit word from the current block.
+uint64_t BatchRNG::Next() {
+  if (block_pos_ == BLOCK_SIZE)
+    Refill();
+  return block_[block_pos_++];
+}
+
+//! Draws a single uniform float in [0, 1).
+float BatchRNG::Uniform() {
+  return static_cast<int32_t>(Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+//! Draws a uniform integer in [0, n).
+/*!
+  Uses multiplication instead of modulo, which is both faster and has less
+  bias for small n.
+  \param n is the number of possible values, must be positive.
+*/
+int BatchRNG::UniformInt(int n) {
+  return static_cast<int>(((Next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+//! Internal function refilling the block used by the single draws.
+void BatchRNG::Refill() {
+  Fill(block_, BLOCK_SIZE);
+  block_pos_ = 0;
+}
@@ -1,189 +1,175 @@
 #include "Box.h"
 
-//! Constructor. All vertex data are set up.
+//! Constructor. Uses the unit Box of the GeometryCache.
 /*!
-  The default Box is of size 1,1,1 which means its dimenstions are 2,2,2.
-  Currently, the texture type is set in this constructor and can therefore
-  not be different for different boxes.
+  The Box is of size 1,1,1 which means its dimenstions are 2,2,2. Other
+  sizes are scaled by the model transform.
 */
-Box::Box(Material material) : Shape(material){
-  SetupVertexPositionData();
-  SetupVertexNormalData();
-  SetupVertexUVData();
-  SetupElementData();
+Box::Box(Material material) :
+        Shape(GeometryCache::Instance()->GetBox(), material) {
 }
 
-//! Constructor. All vertex data are set up.
+//! Fills in all vertex data of the unit Box, used by the GeometryCache.
 /*!
-  Currently, the texture type is set in this constructor and can therefore
-  not be different for different boxes.
-  \param scale_x is the scale along the x-axis.
-  \param scale_y is the scale along the y-axis.
-  \param scale_z is the scale along the z-axis.
+  \param data is set to the vertices and elements of the Box.
 */
-Box::Box(float scale_x, float scale_y, float scale_z, Material material)
-      : Shape(material) {
-  SetupVertexPositionData();
-  SetupVertexNormalData();
-  SetupVertexUVData();
-  SetupElementData();
-  for (int i = 0; i < vertex_position_data_.size(); ++i) {
-    vertex_position_data_[i].x = vertex_position_data_[i].x*scale_x;
-    vertex_position_data_[i].y = vertex_position_data_[i].y*scale_y;
-    vertex_position_data_[i].z = vertex_position_data_[i].z*scale_z;
-  }
+void Box::GetMeshData(MeshData* data) {
+  SetupVertexPositionData(data);
+  SetupVertexNormalData(data);
+  SetupVertexUVData(data);
+  SetupElementData(data);
 }
 
-void Box::SetupVertexPositionData() {
-  vertex_position_data_.resize(24);
-
-  vertex_position_data_[0] = glm::vec3(-1.0f, -1.0f, -1.0f);
-  vertex_position_data_[1] = glm::vec3(1.0f, -1.0f, -1.0f);
-  vertex_position_data_[2] = glm::vec3(-1.0f, 1.0f, -1.0f);
-  vertex_position_data_[3] = glm::vec3(1.0f, 1.0f, -1.0f);
-
-  vertex_position_data_[4] = glm::vec3(-1.0f, -1.0f, 1.0f);
-  vertex_position_data_[5] = glm::vec3(1.0f, -1.0f, 1.0f);
-  vertex_position_data_[6] = glm::vec3(-1.0f, 1.0f, 1.0f);
-  vertex_position_data_[7] = glm::vec3(1.0f, 1.0f, 1.0f);
-
-  vertex_position_data_[8] = glm::vec3(-1.0f, -1.0f, -1.0f);
-  vertex_position_data_[9] = glm::vec3(-1.0f, -1.0f, 1.0f);
-  vertex_position_data_[10] = glm::vec3(-1.0f, 1.0f, -1.0f);
-  vertex_position_data_[11] = glm::vec3(-1.0f, 1.0f, 1.0f);
-
-  vertex_position_data_[12] = glm::vec3(1.0f, -1.0f, -1.0f);
-  vertex_position_data_[13] = glm::vec3(1.0f, -1.0f, 1.0f);
-  vertex_position_data_[14] = glm::vec3(1.0f, 1.0f, -1.0f);
-  vertex_position_data_[15] = glm::vec3(1.0f, 1.0f, 1.0f);
-
-  vertex_position_data_[16] = glm::vec3(-1.0f, -1.0f, -1.0f);
-  vertex_position_data_[17] = glm::vec3(1.0f, -1.0f, -1.0f);
-  vertex_position_data_[18] = glm::vec3(-1.0f, -1.0f, 1.0f);
-  vertex_position_data_[19] = glm::vec3(1.0f, -1.0f, 1.0f);
-
-  vertex_position_data_[20] = glm::vec3(-1.0f, 1.0f, -1.0f);
-  vertex_position_data_[21] = glm::vec3(1.0f, 1.0f, -1.0f);
-  vertex_position_data_[22] = glm::vec3(-1.0f, 1.0f, 1.0f);
-  vertex_position_data_[23] = glm::vec3(1.0f, 1.0f, 1.0f);
+void Box::SetupVertexPositionData(MeshData* data) {
+  data->positions.resize(24);
+
+  data->positions[0] = glm::vec3(-1.0f, -1.0f, -1.0f);
+  data->positions[1] = glm::vec3(1.0f, -1.0f, -1.0f);
+  data->positions[2] = glm::vec3(-1.0f, 1.0f, -1.0f);
+  data->positions[3] = glm::vec3(1.0f, 1.0f, -1.0f);
+
+  data->positions[4] = glm::vec3(-1.0f, -1.0f, 1.0f);
+  data->positions[5] = glm::vec3(1.0f, -1.0f, 1.0f);
+  data->positions[6] = glm::vec3(-1.0f, 1.0f, 1.0f);
+  data->positions[7] = glm::vec3(1.0f, 1.0f, 1.0f);
+
+  data->positions[8] = glm::vec3(-1.0f, -1.0f, -1.0f);
+  data->positions[9] = glm::vec3(-1.0f, -1.0f, 1.0f);
+  data->positions[10] = glm::vec3(-1.0f, 1.0f, -1.0f);
+  data->positions[11] = glm::vec3(-1.0f, 1.0f, 1.0f);
+
+  data->positions[12] = glm::vec3(1.0f, -1.0f, -1.0f);
+  data->positions[13] = glm::vec3(1.0f, -1.0f, 1.0f);
+  data->positions[14] = glm::vec3(1.0f, 1.0f, -1.0f);
+  data->positions[15] = glm::vec3(1.0f, 1.0f, 1.0f);
+
+  data->positions[16] = glm::vec3(-1.0f, -1.0f, -1.0f);
+  data->positions[17] = glm::vec3(1.0f, -1.0f, -1.0f);
+  data->positions[18] = glm::vec3(-1.0f, -1.0f, 1.0f);
+  data->positions[19] = glm::vec3(1.0f, -1.0f, 1.0f);
+
+  data->positions[20] = glm::vec3(-1.0f, 1.0f, -1.0f);
+  data->positions[21] = glm::vec3(1.0f, 1.0f, -1.0f);
+  data->positions[22] = glm::vec3(-1.0f, 1.0f, 1.0f);
+  data->positions[23] = glm::vec3(1.0f, 1.0f, 1.0f);
 }
 
-void Box::SetupVertexNormalData() {
-  vertex_normal_data_.resize(24);
-
-  vertex_normal_data_[0] = glm::vec3(0.0f, 0.0f, -1.0f);
-  vertex_normal_data_[1] = glm::vec3(0.0f, 0.0f, -1.0f);
-  vertex_normal_data_[2] = glm::vec3(0.0f, 0.0f, -1.0f);
-  vertex_normal_data_[3] = glm::vec3(0.0f, 0.0f, -1.0f);
-
-  vertex_normal_data_[4] = glm::vec3(0.0f, 0.0f, 1.0f);
-  vertex_normal_data_[5] = glm::vec3(0.0f, 0.0f, 1.0f);
-  vertex_normal_data_[6] = glm::vec3(0.0f, 0.0f, 1.0f);
-  vertex_normal_data_[7] = glm::vec3(0.0f, 0.0f, 1.0f);
-
-  vertex_normal_data_[8] = glm::vec3(-1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[9] = glm::vec3(-1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[10] = glm::vec3(-1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[11] = glm::vec3(-1.0f, 0.0f, 0.0f);
-
-  vertex_normal_data_[12] = glm::vec3(1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[13] = glm::vec3(1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[14] = glm::vec3(1.0f, 0.0f, 0.0f);
-  vertex_normal_data_[15] = glm::vec3(1.0f, 0.0f, 0.0f);
-
-  vertex_normal_data_[16] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[17] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[18] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[19] = glm::vec3(0.0f, -1.0f, 0.0f);
-
-  vertex_normal_data_[20] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[21] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[22] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[23] = glm::vec3(0.0f, 1.0f, 0.0f);
+void Box::SetupVertexNormalData(MeshData* data) {
+  data->normals.resize(24);
+
+  data->normals[0] = glm::vec3(0.0f, 0.0f, -1.0f);
+  data->normals[1] = glm::vec3(0.0f, 0.0f, -1.0f);
+  data->normals[2] = glm::vec3(0.0f, 0.0f, -1.0f);
+  data->normals[3] = glm::vec3(0.0f, 0.0f, -1.0f);
+
+  data->normals[4] = glm::vec3(0.0f, 0.0f, 1.0f);
+  data->normals[5] = glm::vec3(0.0f, 0.0f, 1.0f);
+  data->normals[6] = glm::vec3(0.0f, 0.0f, 1.0f);
+  data->normals[7] = glm::vec3(0.0f, 0.0f, 1.0f);
+
+  data->normals[8] = glm::vec3(-1.0f, 0.0f, 0.0f);
+  data->normals[9] = glm::vec3(-1.0f, 0.0f, 0.0f);
+  data->normals[10] = glm::vec3(-1.0f, 0.0f, 0.0f);
+  data->normals[11] = glm::vec3(-1.0f, 0.0f, 0.0f);
+
+  data->normals[12] = glm::vec3(1.0f, 0.0f, 0.0f);
+  data->normals[13] = glm::vec3(1.0f, 0.0f, 0.0f);
+  data->normals[14] = glm::vec3(1.0f, 0.0f, 0.0f);
+  data->normals[15] = glm::vec3(1.0f, 0.0f, 0.0f);
+
+  data->normals[16] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[17] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[18] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[19] = glm::vec3(0.0f, -1.0f, 0.0f);
+
+  data->normals[20] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[21] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[22] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[23] = glm::vec3(0.0f, 1.0f, 0.0f);
 }
 
-void Box::SetupVertexUVData() {
-  vertex_uv_data_.resize(24);
-
-  vertex_uv_data_[0] = glm::vec2(1.0f, 1.0f);
-  vertex_uv_data_[1] = glm::vec2(1.0f, 2/3.0f);
-  vertex_uv_data_[2] = glm::vec2(2/3.0f, 1.0f);
-  vertex_uv_data_[3] = glm::vec2(2/3.0f, 2/3.0f);
-
-  vertex_uv_data_[4] = glm::vec2(0.0f, 1.0f);
-  vertex_uv_data_[5] = glm::vec2(0.0f, 2/3.0f);
-  vertex_uv_data_[6] = glm::vec2(1/3.0f, 1.0f);
-  vertex_uv_data_[7] = glm::vec2(1/3.0f, 2/3.0f);
-
-  vertex_uv_data_[8] = glm::vec2(1/3.0f, 1/3.0f);
-  vertex_uv_data_[9] = glm::vec2(1/3.0f, 2/3.0f);
-  vertex_uv_data_[10] = glm::vec2(0.0f, 1/3.0f);
-  vertex_uv_data_[11] = glm::vec2(0.0f, 2/3.0f);
-
-  vertex_uv_data_[12] = glm::vec2(2/3.0f, 1/3.0f);
-  vertex_uv_data_[13] = glm::vec2(2/3.0f, 2/3.0f);
-  vertex_uv_data_[14] = glm::vec2(1.0f, 1/3.0f);
-  vertex_uv_data_[15] = glm::vec2(1.0f, 2/3.0f);
-
-  vertex_uv_data_[16] = glm::vec2(1/3.0f, 1/3.0f);
-  vertex_uv_data_[17] = glm::vec2(2/3.0f, 1/3.0f);
-  vertex_uv_data_[18] = glm::vec2(1/3.0f, 2/3.0f);
-  vertex_uv_data_[19] = glm::vec2(2/3.0f, 2/3.0f);
-
-  vertex_uv_data_[20] = glm::vec2(2/3.0f, 1.0f);
-  vertex_uv_data_[21] = glm::vec2(2/3.0f, 2/3.0f);
-  vertex_uv_data_[22] = glm::vec2(1/3.0f, 1.0f);
-  vertex_uv_data_[23] = glm::vec2(1/3.0f, 2/3.0f);
+void Box::SetupVertexUVData(MeshData* data) {
+  data->uvs.resize(24);
+
+  data->uvs[0] = glm::vec2(1.0f, 1.0f);
+  data->uvs[1] = glm::vec2(1.0f, 2/3.0f);
+  data->uvs[2] = glm::vec2(2/3.0f, 1.0f);
+  data->uvs[3] = glm::vec2(2/3.0f, 2/3.0f);
+
+  data->uvs[4] = glm::vec2(0.0f, 1.0f);
+  data->uvs[5] = glm::vec2(0.0f, 2/3.0f);
+  data->uvs[6] = glm::vec2(1/3.0f, 1.0f);
+  data->uvs[7] = glm::vec2(1/3.0f, 2/3.0f);
+
+  data->uvs[8] = glm::vec2(1/3.0f, 1/3.0f);
+  data->uvs[9] = glm::vec2(1/3.0f, 2/3.0f);
+  data->uvs[10] = glm::vec2(0.0f, 1/3.0f);
+  data->uvs[11] = glm::vec2(0.0f, 2/3.0f);
+
+  data->uvs[12] = glm::vec2(2/3.0f, 1/3.0f);
+  data->uvs[13] = glm::vec2(2/3.0f, 2/3.0f);
+  data->uvs[14] = glm::vec2(1.0f, 1/3.0f);
+  data->uvs[15] = glm::vec2(1.0f, 2/3.0f);
+
+  data->uvs[16] = glm::vec2(1/3.0f, 1/3.0f);
+  data->uvs[17] = glm::vec2(2/3.0f, 1/3.0f);
+  data->uvs[18] = glm::vec2(1/3.0f, 2/3.0f);
+  data->uvs[19] = glm::vec2(2/3.0f, 2/3.0f);
+
+  data->uvs[20] = glm::vec2(2/3.0f, 1.0f);
+  data->uvs[21] = glm::vec2(2/3.0f, 2/3.0f);
+  data->uvs[22] = glm::vec2(1/3.0f, 1.0f);
+  data->uvs[23] = glm::vec2(1/3.0f, 2/3.0f);
 }
 
-void Box::SetupElementData() {
-  element_data_.resize(36);
+void Box::SetupElementData(MeshData* data) {
+  data->elements.resize(36);
 
-  element_data_[0] = 0;
-  element_data_[1] = 3;
-  element_data_[2] = 1;
+  data->elements[0] = 0;
+  data->elements[1] = 3;
+  data->elements[2] = 1;
 
-  element_data_[3] = 0;
-  element_data_[4] = 2;
-  element_data_[5] = 3;
+  data->elements[3] = 0;
+  data->elements[4] = 2;
+  data->elements[5] = 3;
 
-  element_data_[6] = 4;
-  element_data_[7] = 5;
-  element_data_[8] = 7;
+  data->elements[6] = 4;
+  data->elements[7] = 5;
+  data->elements[8] = 7;
 
-  element_data_[9] = 4;
-  element_data_[10] = 7;
-  element_data_[11] = 6;
+  data->elements[9] = 4;
+  data->elements[10] = 7;
+  data->elements[11] = 6;
 
-  element_data_[12] = 9;
-  element_data_[13] = 11;
-  element_data_[14] = 8;
+  data->elements[12] = 9;
+  data->elements[13] = 11;
+  data->elements[14] = 8;
 
-  element_data_[15] = 8;
-  element_data_[16] = 11;
-  element_data_[17] = 10;
+  data->elements[15] = 8;
+  data->elements[16] = 11;
+  data->elements[17] = 10;
 
-  element_data_[18] = 12;
-  element_data_[19] = 15;
-  element_data_[20] = 13;
+  data->elements[18] = 12;
+  data->elements[19] = 15;
+  data->elements[20] = 13;
 
-  element_data_[21] = 12;
-  element_data_[22] = 14;
-  element_data_[23] = 15;
+  data->elements[21] = 12;
+  data->elements[22] = 14;
+  data->elements[23] = 15;
 
-  element_data_[24] = 17;
-  element_data_[25] = 18;
-  element_data_[26] = 16;
+  data->elements[24] = 17;
+  data->elements[25] = 18;
+  data->elements[26] = 16;
 
-  element_data_[27] = 17;
-  element_data_[28] = 19;
-  element_data_[29] = 18;
+  data->elements[27] = 17;
+  data->elements[28] = 19;
+  data->elements[29] = 18;
 
-  element_data_[30] = 20;
-  element_data_[31] = 22;
-  element_data_[32] = 21;
+  data->elements[30] = 20;
+  data->elements[31] = 22;
+  data->elements[32] = 21;
 
-  element_data_[33] = 21;
-  element_data_[34] = 22;
-  element_data_[35] = 23;
+  data->elements[33] = 21;
+  data->elements[34] = 22;
+  data->elements[35] = 23;
 }
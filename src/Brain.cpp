@@ -6,7 +6,7 @@
 #define M_PI 3.14159265359
 #endif
 
-AutoInitRNG Brain::rng_;
+thread_local AutoInitRNG Brain::rng_;
 
 //! The constructor of the Brain creates a brain with number of inputs and number of outputs defined.
 /*!
@@ -18,20 +18,34 @@ AutoInitRNG Brain::rng_;
 number of Joints for the creatures body.)
 */
 Brain::Brain(int n_input, int n_output) {
-  std::uniform_real_distribution<float> r_w(-1.0f, 1.0f);
   int n_hidden = 5*n_input/n_output;
-  hidden_nodes_ = std::vector<f_vec>(n_hidden, f_vec(n_input));
-  output_nodes_ = std::vector<f_vec>(n_output, f_vec(n_hidden));
+  InitRandomWeights(n_input, n_hidden, n_output);
+}
+
+//! Creates a brain with a given number of hidden nodes.
+/*!
+\param n_input is the number of inputs to the network.
+\param n_hidden is the number of hidden nodes.
+\param n_output is the number of outputs from the network.
+*/
+Brain::Brain(int n_input, int n_hidden, int n_output) {
+  InitRandomWeights(n_input, n_hidden, n_output);
+}
+
+//! Internal function setting the size of the network and randomizing it.
+/*!
+  All weights gets random values between -1.0 and 1.0.
+*/
+void Brain::InitRandomWeights(int n_input, int n_hidden, int n_output) {
+  std::uniform_real_distribution<float> r_w(-1.0f, 1.0f);
+  n_input_ = n_input;
+  n_hidden_ = n_hidden;
+  n_output_ = n_output;
+  sigma_ = -1.0f;
+  weights_ = f_vec(n_hidden*n_input + n_output*n_hidden);
   //init random weights
-  for(f_vec& v : hidden_nodes_) {
-    for(float& w : v) {
-      w = r_w(rng_.mt_rng_);
-    }
-  }
-  for(f_vec& v : output_nodes_) {
-    for(float& w : v) {
-      w = r_w(rng_.mt_rng_);
-    }
+  for(float& w : weights_) {
+    w = r_w(rng_.mt_rng_);
   }
 }
 
@@ -43,114 +57,198 @@ Brain::Brain(int n_input, int n_output) {
   \return An std::vector of floats which corresponds to the output.
 */
 std::vector<float> Brain::CalculateOutput(const f_vec& input){
-  if(hidden_nodes_[0].size() != input.size()) { //reset brain with right size
-    std::uniform_real_distribution<float> r_w(-1.0f, 1.0f);
+  if(n_input_ != input.size()) { //reset brain with right size
     int n_input = input.size();
-    int n_output = output_nodes_.size();
+    int n_output = n_output_;
     int n_hidden = n_input+n_output; // Va??
-    hidden_nodes_ = std::vector<f_vec>(n_hidden, f_vec(n_input));
-    output_nodes_ = std::vector<f_vec>(n_output, f_vec(n_hidden));
-
-    //init random weights
-    for(f_vec& v : hidden_nodes_) {
-      for(float& w : v) {
-        w = r_w(rng_.mt_rng_);
-      }
-    }
-
-    for(f_vec& v : output_nodes_) {
-      for(float& w : v) {
-        w = r_w(rng_.mt_rng_);
-      }
-    }
+    InitRandomWeights(n_input, n_hidden, n_output);
     // What should be done about this?
     //std::cout << "WRONG INITAL INPUT SIZE TO BRAIN!";
   }
 
-  f_vec output(output_nodes_.size());
-  std::vector<float> hidden_output(hidden_nodes_.size());
+  f_vec output(n_output_);
+  std::vector<float> hidden_output(n_hidden_);
 
-  std::vector<f_vec>::const_iterator h_node_iter = hidden_nodes_.begin();
+  const float* node = &weights_[0];
   for(float& out : hidden_output) {
-    out = transfer(dot(input,(*h_node_iter)));
-    ++h_node_iter;
+    out = transfer(dot(&input[0], node, n_input_));
+    node += n_input_;
   }
 
-  std::vector<f_vec>::const_iterator o_node_iter = output_nodes_.begin();
   for(float& out : output) {
-    out = transfer(dot(hidden_output,(*o_node_iter)));
-    ++o_node_iter;
+    out = transfer(dot(&hidden_output[0], node, n_hidden_));
+    node += n_hidden_;
   }
   return output;
 }
 
 //! Brains own definition of mutation.
 /*!
-  This function uses mutation ratio and mutation strength defined in
-  SettingsManager. Mutation strength is used to define a uniform float
-  distribution with which to change the values of the weights in the neural
-  network of the Brain. The bigger value of mutation strength, the bigger the
-  span is for the values to be changed to. Mutation ratio is used to determine
-  the chance of a specific weight to mutate.
+  This function uses mutation type, ratio and strength from a snapshot of
+  the settings, captured once per generation. Mutation ratio is the chance of a
+  specific weight to mutate and mutation strength is the size of the
+  uniform perturbation or the sigma of the gaussian perturbation. For self
+  adaptive mutation the Brain carries its own strength which starts at the
+  mutation strength from the settings.
+  \param settings are the settings to use.
+  \param rng is the random number generator to draw from.
+*/
+void Brain::Mutate(const SettingsSnapshot& settings, BatchRNG& rng) {
+  if (weights_.empty())
+    return;
+  MutationType type = static_cast<MutationType>(settings.mutation_type);
+  float rate = settings.mutation_internal;
+  float strength = settings.mutation_sigma;
+
+  if (sigma_ <= 0.0f)
+    sigma_ = strength;
+
+  Mutation::Apply(
+          type, &weights_[0], weights_.size(), rate, strength, &sigma_, rng);
+}
+
+//! Recombines two Brains in to two children.
+/*!
+  The flat genomes of the parents are recombined with one of the operators
+  in Crossover. The children must already be Brains of the same size as
+  the parents, typically copies of them, so no memory is allocated. Parents
+  of different sizes can not be recombined and are copied to the children.
+  \param mom is the first parent.
+  \param dad is the second parent.
+  \param child0 is the first child, must not be one of the parents.
+  \param child1 is the second child, must not be one of the parents.
+  \param type is the crossover operator to use.
+  \param rng is the random number generator to draw from.
+*/
+void Brain::Crossover(
+        const Brain& mom,
+        const Brain& dad,
+        Brain* child0,
+        Brain* child1,
+        CrossoverType type,
+        BatchRNG& rng) {
+  if (mom.n_input_ != dad.n_input_ ||
+      mom.n_hidden_ != dad.n_hidden_ ||
+      mom.n_output_ != dad.n_output_ ||
+      mom.GetGenomeSize() == 0) {
+    *child0 = mom;
+    *child1 = dad;
+    return;
+  }
+  if (child0->weights_.size() != mom.weights_.size())
+    *child0 = mom;
+  if (child1->weights_.size() != dad.weights_.size())
+    *child1 = dad;
+
+  ::Crossover::Apply(
+          type,
+          &mom.weights_[0],
+          &dad.weights_[0],
+          &child0->weights_[0],
+          &child1->weights_[0],
+          mom.GetGenomeSize(),
+          mom.GetNeuronOffsets(),
+          rng);
+}
+
+//! Get function.
+/*!
+  \return The number of weights in the network.
+*/
+int Brain::GetGenomeSize() const {
+  return weights_.size();
+}
+
+//! Returns where the weights of every node start in the genome.
+/*!
+  \return The offset of every hidden node followed by the offset of every
+  output node and finally the size of the genome.
 */
-void Brain::Mutate() {
-  std::uniform_real_distribution<float> int_dist(0.0f,1.0f);
-
-  float mutationStrength = SettingsManager::Instance()->GetMutationSigma();
-  std::uniform_real_distribution<float> mut_val(-1.0f*mutationStrength, 1.0f*mutationStrength);
-
-  //mutate
-  for(f_vec& v : hidden_nodes_) {
-    for(float& w : v) {
-      float should_mutate = int_dist(rng_.mt_rng_);
-      if (SettingsManager::Instance()->GetMutationInternal() >= should_mutate){
-        w += mut_val(rng_.mt_rng_);
-      }
-    }
+std::vector<int> Brain::GetNeuronOffsets() const {
+  std::vector<int> offsets;
+  offsets.reserve(n_hidden_ + n_output_ + 1);
+  int offset = 0;
+  for (int i = 0; i < n_hidden_; ++i) {
+    offsets.push_back(offset);
+    offset += n_input_;
   }
+  for (int i = 0; i < n_output_; ++i) {
+    offsets.push_back(offset);
+    offset += n_hidden_;
+  }
+  offsets.push_back(offset);
+  return offsets;
+}
 
-  for(f_vec& v : output_nodes_) {
-    for(float& w : v) {
-      float should_mutate = int_dist(rng_.mt_rng_);
-      if (SettingsManager::Instance()->GetMutationInternal() >= should_mutate){
-        w += mut_val(rng_.mt_rng_);
-      }
-    }
+//! Get function.
+/*!
+  \return The flat genome with all weights of the network.
+*/
+const f_vec& Brain::GetGenome() const {
+  return weights_;
+}
+
+//! Replaces all weights of the network.
+/*!
+  \param genome are the new weights. Genomes of the wrong size are ignored.
+*/
+void Brain::SetGenome(const f_vec& genome) {
+  if (genome.size() == weights_.size())
+    weights_ = genome;
+}
+
+//! Writes the Brain in binary form.
+/*!
+  \param out is the stream to write to.
+*/
+void Brain::Write(std::ostream& out) const {
+  int sizes[3] = {n_input_, n_hidden_, n_output_};
+  out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+  out.write(reinterpret_cast<const char*>(&sigma_), sizeof(sigma_));
+  if (!weights_.empty()) {
+    out.write(reinterpret_cast<const char*>(&weights_[0]),
+            sizeof(float) * weights_.size());
   }
 }
 
-//! This function is currently not implemented for the NN-Brain
+//! Reads a Brain written by Write.
 /*!
-  Crossover should return two children from two parents. For the neural
-  network-Brain there is not necessarily a meaningful way to do this.
-  Currently this function returns back the two parents.
-  \param Another Brain with which to crossover this Brain.
-  \return An std::vector of two Brains. Currently these are the same as the
-  parents.
+  \param in is the stream to read from.
+  \return False if the stream ended or the sizes are invalid.
 */
-std::vector<Brain> Brain::Crossover(Brain mate){
-  std::vector<Brain> children;
-  children.resize(2);
-  children[0] = *this;
-  children[1] = mate;
-  return children;
+bool Brain::Read(std::istream& in) {
+  int sizes[3];
+  float sigma;
+  if (!in.read(reinterpret_cast<char*>(sizes), sizeof(sizes)) ||
+      !in.read(reinterpret_cast<char*>(&sigma), sizeof(sigma)))
+    return false;
+  if (sizes[0] < 0 || sizes[1] < 0 || sizes[2] < 0)
+    return false;
+  f_vec weights(sizes[1] * sizes[0] + sizes[2] * sizes[1]);
+  if (!weights.empty() && !in.read(reinterpret_cast<char*>(&weights[0]),
+          sizeof(float) * weights.size()))
+    return false;
+  n_input_ = sizes[0];
+  n_hidden_ = sizes[1];
+  n_output_ = sizes[2];
+  sigma_ = sigma;
+  weights_.swap(weights);
+  return true;
 }
 
 //! Internal function used for calculating the output of the Brain.
 /*!
   Normal dot product for multi-dimensional vectors. In this case the ones
-  that are used as connections between nodes (lists of weights). These vectors
-  should be of the same dimension.
+  that are used as connections between nodes (lists of weights).
   \param x is the first input vector.
   \param y is the second input vector.
+  \param n is the dimension of the vectors.
   \return The dot product between the two input vectors.
 */
-float Brain::dot(const f_vec& x, const f_vec& y) {
+float Brain::dot(const float* x, const float* y, int n) {
   float dot_product = 0;
-  f_vec::const_iterator x_iter = x.begin();
-  for(float y_el : y) {
-    dot_product += y_el*(*x_iter);
-    ++x_iter;
+  for(int i = 0; i < n; ++i) {
+    dot_product += y[i]*x[i];
   }
   return dot_product;
 }
@@ -1,4 +1,6 @@
 #include "BulletCreature.h"
+// C++
+#include <algorithm>
 #include "Box.h"
 #include "Scene.h"
 
@@ -255,8 +257,10 @@ void BulletCreature::SetDistanceToLight(float distance){
 //! Function for calculating all the simulation data based on the state of the BulletCreature. 
 /*!
   The Creature blueprint has the variable simdata which is updated here.
+  \param progress is the elapsed part of the simulation time, from 0 to 1.
+  It decides which sample of the head height profile is updated.
 */
-void BulletCreature::CollectData() {
+void BulletCreature::CollectData(float progress) {
   SimData data = blueprint_.simdata;
 
   data.distance_light += GetDistanceToLight();
@@ -267,5 +271,13 @@ void BulletCreature::CollectData() {
   data.deviation_x = abs(GetCenterOfMass().getX())+0.0001;
   data.accumulated_head_y += GetHeadPosition().getY();
 
+  btVector3 com = GetCenterOfMass();
+  data.final_x = com.getX();
+  data.final_y = com.getY();
+  data.final_z = com.getZ();
+  int sample = static_cast<int>(progress * SimData::N_HEAD_PROFILE);
+  sample = std::max(0, std::min(SimData::N_HEAD_PROFILE - 1, sample));
+  data.head_y_profile[sample] = GetHeadPosition().getY();
+
   blueprint_.simdata = data;
 }
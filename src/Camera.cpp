@@ -1,7 +1,62 @@
 #include "Camera.h"
 
+#include <algorithm>
 #include <iostream>
 
+/////////////
+// Frustum //
+/////////////
+
+//! Creates a Frustum that contains everything.
+Frustum::Frustum() {
+  for (int i = 0; i < 6; ++i)
+    planes_[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+//! Creates the Frustum of a projection and view matrix.
+/*!
+  The planes are the rows of the matrix added to and subtracted from its
+  last row, in the order left, right, bottom, top, near and far.
+  \param view_projection is the projection matrix times the view matrix.
+*/
+Frustum::Frustum(const glm::mat4& view_projection) {
+  const glm::mat4& m = view_projection;
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; ++i)
+    rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  for (int i = 0; i < 3; ++i) {
+    planes_[2 * i] = rows[3] + rows[i];
+    planes_[2 * i + 1] = rows[3] - rows[i];
+  }
+  for (int i = 0; i < 6; ++i)
+    planes_[i] /= glm::length(glm::vec3(planes_[i]));
+}
+
+//! Tests if an axis aligned box is at least partly inside the Frustum.
+/*!
+  Conservative, some boxes just outside of the corners are let through.
+  \param min is the corner of the box with the smallest coordinates.
+  \param max is the corner of the box with the largest coordinates.
+  \return False if the box is completely outside of the Frustum.
+*/
+bool Frustum::IntersectsBox(const glm::vec3& min, const glm::vec3& max) const {
+  for (int i = 0; i < 6; ++i) {
+    const glm::vec4& plane = planes_[i];
+    // The corner furthest along the normal of the plane
+    glm::vec3 corner(
+        plane.x > 0.0f ? max.x : min.x,
+        plane.y > 0.0f ? max.y : min.y,
+        plane.z > 0.0f ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+////////////
+// Camera //
+////////////
+
 //! Constructor, creates a default camera
 /*!
   The default camera is located at (-10,3,0) and looks at (0,1,0).
@@ -42,6 +97,8 @@ Camera::Camera() {
 Camera::Camera(glm::mat4 view, glm::mat4 projection) {
   view_ = view;
   projection_ = projection;
+  far_clipping_ = 200.0f;
+  near_clipping_ = 0.1f;
 }
 
 glm::mat4 Camera::GetViewMatrix(){
@@ -56,6 +113,23 @@ float Camera::GetFarClipping() {
   return far_clipping_;
 }
 
+//! Returns the Frustum of the current view and projection matrices.
+Frustum Camera::GetFrustum() {
+  return Frustum(projection_ * view_);
+}
+
+//! Returns the approximate height on screen of a sphere, in pixels.
+/*!
+  \param center is the center of the sphere.
+  \param radius is the radius of the sphere.
+*/
+float Camera::GetPixelSize(glm::vec3 center, float radius) {
+  glm::vec4 center_viewspace = view_ * glm::vec4(center, 1.0f);
+  float depth = std::max(near_clipping_, -center_viewspace.z);
+  int height = SettingsManager::Instance()->GetFrameHeight();
+  return radius * projection_[1][1] / depth * 0.5f * height;
+}
+
 glm::vec3 Camera::GetTarget(){
   return -target_;
 }
@@ -1,12 +1,15 @@
 #include "Creature.h"
 
-AutoInitRNG Creature::rng_;
+const int SimData::N_HEAD_PROFILE;
+const int SimData::BEHAVIOR_SIZE;
 
 //! Default constructor creates a random creature.
 Creature::Creature() {
 	fitness_ = -1.0f;
 	int n_joints = body_.GetTotalNumberOfJoints(); 
-    brain_ = Brain(n_joints + 4 + 3*(n_joints+1), n_joints);
+    // A bias, the light direction and the joint angles, see Simulation::Step
+    int n_input = 1 + 3 + n_joints;
+    brain_ = Brain(n_input, n_input + n_joints, n_joints);
 }
 
 //! Destructor. Deletes all rigid bodies etc
@@ -38,34 +41,77 @@ Body Creature::GetBody(){
     return body_;
 }
 
-/*! Simple mutation algorithm on creature.
- This should be extended to try more cases. */
-void Creature::Mutate() {
-	brain_.Mutate();
+//! Returns the flat weight genome of the Brain
+const f_vec& Creature::GetGenome() const {
+	return brain_.GetGenome();
 }
 
-std::vector<Creature> Creature::Crossover(Creature mate){
-	std::vector<Creature> children;
-	std::vector<Brain> childrens_brain;
-	children.resize(2);
-	childrens_brain.resize(2);
+//! Replaces the weights of the Brain, the genome must have the same size
+void Creature::SetGenome(const f_vec& genome) {
+	brain_.SetGenome(genome);
+}
 
-	std::uniform_real_distribution<float> int_dist(0.0f,1.0f);
+//! Returns the Trajectory recorded when the creature was last simulated
+/*!
+  \return The Trajectory or NULL if the creature was not recorded.
+*/
+std::shared_ptr<const Trajectory> Creature::GetTrajectory() const {
+	return trajectory_;
+}
 
-	double should_crossover = int_dist(rng_.mt_rng_);
-	SettingsManager::Instance()->GetCrossover();
+//! Sets the recorded Trajectory, NULL removes it
+void Creature::SetTrajectory(std::shared_ptr<const Trajectory> trajectory) {
+	trajectory_ = trajectory;
+}
 
-	if(SettingsManager::Instance()->GetCrossover() >= should_crossover) {
-	// TODO: if crossover should be done, else return the incomming creatures
-		childrens_brain = brain_.Crossover(mate.GetBrain());
-		children[0].brain_ = childrens_brain[0];
-		children[1].brain_ = childrens_brain[1];
-	}
-	else {
-		children[0].brain_ = brain_;
-		children[1].brain_ = mate.GetBrain();
-	}
+/*! Simple mutation algorithm on creature.
+ This should be extended to try more cases. */
+void Creature::Mutate(const SettingsSnapshot& settings, BatchRNG& rng) {
+	brain_.Mutate(settings, rng);
+}
 
-	return children;
+//! Recombines the Brains of two creatures.
+/*!
+  The children keep their own Bodies, they are typically copies of the
+  parents. Only the Brains are recombined.
+  \param mom is the first parent.
+  \param dad is the second parent.
+  \param child0 is the first child, must not be one of the parents.
+  \param child1 is the second child, must not be one of the parents.
+  \param type is the crossover operator to use.
+  \param rng is the random number generator to draw from.
+*/
+void Creature::Crossover(
+        const Creature& mom,
+        const Creature& dad,
+        Creature* child0,
+        Creature* child1,
+        CrossoverType type,
+        BatchRNG& rng) {
+	Brain::Crossover(
+		mom.brain_, dad.brain_, &child0->brain_, &child1->brain_, type, rng);
+}
+
+//! Writes the creature in binary form.
+/*!
+  The fitness, the simulation data and the Brain are written. The Body is
+  not, it is given by the creature type in SettingsManager.
+  \param out is the stream to write to.
+*/
+void Creature::Write(std::ostream& out) const {
+	out.write(reinterpret_cast<const char*>(&fitness_), sizeof(fitness_));
+	out.write(reinterpret_cast<const char*>(&simdata), sizeof(simdata));
+	brain_.Write(out);
+}
 
+//! Reads a creature written by Write.
+/*!
+  \param in is the stream to read from.
+  \return False if the stream ended or the data is invalid.
+*/
+bool Creature::Read(std::istream& in) {
+	if (!in.read(reinterpret_cast<char*>(&fitness_), sizeof(fitness_)) ||
+		!in.read(reinterpret_cast<char*>(&simdata), sizeof(simdata)))
+		return false;
+	return brain_.Read(in);
 }
@@ -0,0 +1,202 @@
+#include "Crossover.h"
+
+// C++
+#include <algorithm>
+#include <cstring>
+
+const int Crossover::N_POINTS;
+const float Crossover::BLX_ALPHA = 0.5f;
+
+//! Recombines two genomes with the given operator.
+/*!
+  \param type is the crossover operator to use.
+  \param mom is the first parent genome.
+  \param dad is the second parent genome.
+  \param child0 is where the first child is written.
+  \param child1 is where the second child is written.
+  \param n is the number of genes in all genomes.
+  \param neuron_offsets are the start offsets of every neuron in the genome,
+  followed by n. Only used by NEURON_CROSSOVER.
+  \param rng is the random number generator to draw from.
+*/
+void Crossover::Apply(
+        CrossoverType type,
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        int n,
+        const std::vector<int>& neuron_offsets,
+        BatchRNG& rng) {
+  switch (type) {
+  case UNIFORM_CROSSOVER:
+    Uniform(mom, dad, child0, child1, n, rng);
+    break;
+  case N_POINT_CROSSOVER:
+    NPoint(mom, dad, child0, child1, n, N_POINTS, rng);
+    break;
+  case ARITHMETIC_CROSSOVER:
+    Arithmetic(mom, dad, child0, child1, n, rng);
+    break;
+  case BLX_ALPHA_CROSSOVER:
+    BlendAlpha(mom, dad, child0, child1, n, BLX_ALPHA, rng);
+    break;
+  case NEURON_CROSSOVER:
+    PerNeuron(mom, dad, child0, child1, neuron_offsets, rng);
+    break;
+  default:
+    std::memcpy(child0, mom, sizeof(float) * n);
+    std::memcpy(child1, dad, sizeof(float) * n);
+    break;
+  }
+}
+
+//! Uniform crossover, every gene is taken from a random parent.
+/*!
+  One random 64 bit word gives the parent choice for 64 genes. The choice is
+  a select between the parents and not a branch, which lets the compiler
+  turn the inner loop into vector blends.
+*/
+void Crossover::Uniform(
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        int n,
+        BatchRNG& rng) {
+  uint64_t words[BatchRNG::BLOCK_SIZE];
+  const int genes_per_block = 64 * BatchRNG::BLOCK_SIZE;
+  for (int block = 0; block < n; block += genes_per_block) {
+    int block_end = std::min(n, block + genes_per_block);
+    rng.Fill(words, (block_end - block + 63) / 64);
+    for (int start = block; start < block_end; start += 64) {
+      const uint64_t word = words[(start - block) / 64];
+      const int count = std::min(64, block_end - start);
+      const float* a = mom + start;
+      const float* b = dad + start;
+      float* c0 = child0 + start;
+      float* c1 = child1 + start;
+      for (int i = 0; i < count; ++i) {
+        const bool from_mom = (word >> i) & 1;
+        c0[i] = from_mom ? a[i] : b[i];
+        c1[i] = from_mom ? b[i] : a[i];
+      }
+    }
+  }
+}
+
+//! N-point crossover, segments between random cut points are swapped.
+/*!
+  The genes between every second pair of cut points are swapped between the
+  children. Whole segments are copied with memcpy.
+  \param n_points is the number of cut points.
+*/
+void Crossover::NPoint(
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        int n,
+        int n_points,
+        BatchRNG& rng) {
+  std::vector<int> cuts(n_points + 1);
+  for (int i = 0; i < n_points; ++i)
+    cuts[i] = rng.UniformInt(n + 1);
+  cuts[n_points] = n;
+  std::sort(cuts.begin(), cuts.end() - 1);
+
+  int start = 0;
+  bool swap = false;
+  for (int i = 0; i <= n_points; ++i) {
+    int count = cuts[i] - start;
+    const float* a = swap ? dad : mom;
+    const float* b = swap ? mom : dad;
+    std::memcpy(child0 + start, a + start, sizeof(float) * count);
+    std::memcpy(child1 + start, b + start, sizeof(float) * count);
+    start = cuts[i];
+    swap = !swap;
+  }
+}
+
+//! Whole arithmetic crossover, the children are weighted averages.
+/*!
+  One random weight w is drawn per mating. The first child is
+  w * mom + (1 - w) * dad and the second is (1 - w) * mom + w * dad.
+*/
+void Crossover::Arithmetic(
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        int n,
+        BatchRNG& rng) {
+  const float w = rng.Uniform();
+  for (int i = 0; i < n; ++i) {
+    const float d = mom[i] - dad[i];
+    child0[i] = dad[i] + w * d;
+    child1[i] = mom[i] - w * d;
+  }
+}
+
+//! BLX-alpha crossover, genes are sampled around the parents.
+/*!
+  Every gene of a child is drawn uniformly from the interval spanned by the
+  parents, extended by alpha times the interval length in both directions.
+  The uniform numbers are drawn in blocks.
+  \param alpha is the extension of the interval. 0.5 is commonly used.
+*/
+void Crossover::BlendAlpha(
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        int n,
+        float alpha,
+        BatchRNG& rng) {
+  const int half_block = BatchRNG::BLOCK_SIZE;
+  float u[2 * half_block];
+  for (int block = 0; block < n; block += half_block) {
+    const int count = std::min(half_block, n - block);
+    rng.FillUniform(u, 2 * count);
+    const float* a = mom + block;
+    const float* b = dad + block;
+    float* c0 = child0 + block;
+    float* c1 = child1 + block;
+    for (int i = 0; i < count; ++i) {
+      const float lo = std::min(a[i], b[i]);
+      const float d = std::max(a[i], b[i]) - lo;
+      const float start = lo - alpha * d;
+      const float span = (1.0f + 2.0f * alpha) * d;
+      c0[i] = start + u[i] * span;
+      c1[i] = start + u[count + i] * span;
+    }
+  }
+}
+
+//! Neuron crossover, every neuron is taken from a random parent.
+/*!
+  All incoming weights of a neuron are kept together, which keeps the
+  features a neuron has learned intact.
+  \param neuron_offsets are the start offsets of every neuron in the genome,
+  followed by the length of the genome.
+*/
+void Crossover::PerNeuron(
+        const float* mom,
+        const float* dad,
+        float* child0,
+        float* child1,
+        const std::vector<int>& neuron_offsets,
+        BatchRNG& rng) {
+  uint64_t word = 0;
+  for (int i = 0; i + 1 < neuron_offsets.size(); ++i) {
+    if (i % 64 == 0)
+      word = rng.Next();
+    const bool from_mom = (word >> (i % 64)) & 1;
+    const int start = neuron_offsets[i];
+    const int count = neuron_offsets[i + 1] - start;
+    std::memcpy(child0 + start, (from_mom ? mom : dad) + start,
+            sizeof(float) * count);
+    std::memcpy(child1 + start, (from_mom ? dad : mom) + start,
+            sizeof(float) * count);
+  }
+}
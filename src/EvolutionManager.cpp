@@ -2,16 +2,30 @@
 #include "SettingsManager.h"
 #include "Simulation.h"
 #include <chrono>
+#include <algorithm>
 
 #include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
 AutoInitRNG EvolutionManager::rng_;
+const int EvolutionManager::OFFSPRING_BATCH_SIZE;
+const int EvolutionManager::MAX_PARETO_FRONT_SIZE;
+const int EvolutionManager::NOVELTY_BATCH_SIZE;
+const float EvolutionManager::NOVELTY_ARCHIVE_PROBABILITY = 0.05f;
+const int EvolutionManager::MAP_ELITES_CHECKPOINT_INTERVAL;
+const int EvolutionManager::ES_BATCH_SIZE;
+const int EvolutionManager::STEADY_STATE_BATCH_SIZE;
 
 //! Constructor
 /*! 
 */
 EvolutionManager::EvolutionManager(){
     end_now_request_ = false;
+    generation_ = 0;
     mutex_ = new QBasicMutex();
+    settings_ = SettingsManager::Instance()->GetSnapshot();
+    run_start_ = std::chrono::steady_clock::now();
+    novelty_archive_ = NoveltyArchive(SimData::BEHAVIOR_SIZE);
 }
 
 //! Destructor
@@ -24,16 +38,38 @@ EvolutionManager::~EvolutionManager(void){
 	the population to a new generation until max generation.
 */
 void EvolutionManager::startEvolutionProcess() {
-    CreateNewRandomPopulation();
-    RunEvolution();
+    settings_ = SettingsManager::Instance()->GetSnapshot();
+    progress_.clear();
+    run_start_ = std::chrono::steady_clock::now();
+    std::string trajectory_file = settings_->trajectory_file;
+    if (!trajectory_file.empty() && !trajectory_writer_.Open(trajectory_file))
+        std::cout << "WARNING: could not create " << trajectory_file << "!" << std::endl;
+    generation_ = 0;
+
+    int mode = settings_->evolution_mode;
+    if (mode == MAP_ELITES_EVOLUTION) {
+        RunMapElites();
+    }
+    else if (mode == ES_EVOLUTION) {
+        RunEvolutionStrategy();
+    }
+    else if (mode == STEADY_STATE_EVOLUTION) {
+        RunSteadyState();
+    }
+    else {
+        CreateNewRandomPopulation();
+        RunEvolution();
+    }
+    trajectory_writer_.Close();
 }
 
 //! Creates a new random population
 void EvolutionManager::CreateNewRandomPopulation(){
     current_population_.clear();
+    novelty_archive_.Clear();
 
     // Creates a new random population
-    int pop_size = SettingsManager::Instance()->GetPopulationSize();
+    int pop_size = settings_->population_size;
     current_population_ = CreateRandomPopulation(pop_size);
 }
 
@@ -42,20 +78,30 @@ void EvolutionManager::RunEvolution(){
     std::clock_t start_time;
     start_time = std::clock();
 
-    int max_gen = SettingsManager::Instance()->GetMaxGenerations();
+    int max_gen = settings_->max_generations;
 
     int i = 0;
     while(i < max_gen) {
         if(!NeedEndNow()) {
             std::cout << "Generation: " << i << std::endl <<
             "Simulating..." << std::endl;
+            generation_ = i;
+            settings_ = SettingsManager::Instance()->GetSnapshot();
             NextGeneration();
             SimulatePopulation();
             CalculateFitnessOnPopulation();
-            SortPopulation();
+            RankPopulation(MAX_PARETO_FRONT_SIZE);
             PrintBestFitnessValues();
+            RecordProgress(i, GetBestCreature().GetFitness());
             
-            emit NewCreature(GetBestCreature());
+            if (settings_->fitness_mode == PARETO_FITNESS)
+                emit NewParetoFront(GetParetoFront());
+            else
+                emit NewCreature(GetBestCreature());
+
+            // Only the sent creatures keep their recordings
+            for (int j = 0; j < current_population_.size(); ++j)
+                current_population_[j].SetTrajectory(NULL);
             
             NextGeneration();
             i++;
@@ -67,16 +113,316 @@ void EvolutionManager::RunEvolution(){
     std::cout << "Total simulation time: " << float(std::clock() - start_time) / CLOCKS_PER_SEC  << " s" << std::endl;
 }
 
+//! Runs MAP-Elites instead of the generational evolution
+/*!
+  The grid is resumed from the checkpoint file if there is one for the
+  current creature type, otherwise it is seeded with a random population.
+  Every generation is one batch of mutants, as many as the population size.
+  The whole grid is sent to the GUI after every batch and saved to the
+  checkpoint every MAP_ELITES_CHECKPOINT_INTERVAL batches.
+*/
+void EvolutionManager::RunMapElites() {
+    end_now_request_ = false;
+    std::clock_t start_time = std::clock();
+
+    int max_gen = settings_->max_generations;
+    int pop_size = settings_->population_size;
+    std::string checkpoint = settings_->map_elites_checkpoint;
+
+    map_elites_.Reset(settings_->map_elites_bins);
+    if (!checkpoint.empty() && map_elites_.Load(checkpoint)) {
+        std::cout << "Resumed MAP-Elites from " << checkpoint << std::endl;
+    }
+    else {
+        std::cout << "Seeding MAP-Elites..." << std::endl;
+        map_elites_.Seed(CreateRandomPopulation(pop_size), *settings_);
+    }
+
+    for (int i = 0; i < max_gen && !NeedEndNow(); ++i) {
+        std::cout << "Batch: " << i << std::endl;
+        settings_ = SettingsManager::Instance()->GetSnapshot();
+        map_elites_.Step(pop_size, *settings_);
+        std::cout << "Filled cells = " << map_elites_.GetFilledCells() <<
+            " / " << map_elites_.GetNumberOfCells() << std::endl;
+
+        Population elites = map_elites_.GetElites();
+        float best_fitness = elites.empty() ? 0.0f : elites[0].GetFitness();
+        for (int j = 1; j < elites.size(); ++j)
+            best_fitness = std::max(best_fitness, elites[j].GetFitness());
+        RecordProgress(i, best_fitness);
+        emit NewEliteGrid(elites);
+
+        if (!checkpoint.empty() && (i + 1) % MAP_ELITES_CHECKPOINT_INTERVAL == 0)
+            map_elites_.Save(checkpoint);
+    }
+    if (!checkpoint.empty() && !map_elites_.Save(checkpoint))
+        std::cout << "WARNING: could not write " << checkpoint << "!" << std::endl;
+
+    std::cout << "Total simulation time: " << float(std::clock() - start_time) / CLOCKS_PER_SEC  << " s" << std::endl;
+}
+
+//! Runs an evolution strategy on the Brain weights of one creature
+/*!
+  A random creature is simulated once on this thread, which fixes the size
+  of its Brain, and its weights become the mean genome. Every iteration
+  evaluates population size candidates in antithetic pairs. The workers
+  only get the noise table offset and sign of their candidates and rebuild
+  the genomes themselves. The mean genome is sent to the GUI after every
+  iteration with the mean fitness of the candidates.
+*/
+void EvolutionManager::RunEvolutionStrategy() {
+    end_now_request_ = false;
+    std::clock_t start_time = std::clock();
+
+    int max_gen = settings_->max_generations;
+    int n_pairs = std::max(1, settings_->population_size / 2);
+    int sim_time = settings_->simulation_time;
+
+    std::cout << "Seeding ES..." << std::endl;
+    current_population_ = CreateRandomPopulation(1);
+    SimulatePopulation();
+    es_base_ = current_population_[0];
+    evolution_strategy_.Reset(es_base_.GetGenome(),
+        settings_->es_sigma,
+        settings_->es_learning_rate);
+
+    double creature_seconds = 0.0;
+    for (int i = 0; i < max_gen && !NeedEndNow(); ++i) {
+        std::cout << "Iteration: " << i << std::endl;
+        generation_ = i;
+        settings_ = SettingsManager::Instance()->GetSnapshot();
+        std::copy(settings_->fitness_weights, settings_->fitness_weights + 7, weights_);
+        // Same range as the random light position of the Simulation
+        light_position_ = btVector3(
+            batch_rng_.UniformInt(41) - 20, 5, batch_rng_.UniformInt(41) - 20);
+        evolution_strategy_.Sample(n_pairs, &es_offsets_);
+
+        int n = 2 * n_pairs;
+        es_fitness_.assign(n, 0.0f);
+        std::vector<EsBatch> batches;
+        for (int begin = 0; begin < n; begin += ES_BATCH_SIZE) {
+            EsBatch batch;
+            batch.begin = begin;
+            batch.end = std::min(n, begin + ES_BATCH_SIZE);
+            batches.push_back(batch);
+        }
+        QtConcurrent::blockingMap(batches, EsFunctor(this));
+
+        evolution_strategy_.Update(es_offsets_, es_fitness_);
+        creature_seconds += n * sim_time;
+
+        float mean_fitness = 0.0f;
+        for (int j = 0; j < n; ++j)
+            mean_fitness += es_fitness_[j];
+        mean_fitness /= n;
+        std::cout << "Mean fitness = " << mean_fitness <<
+            ", creature seconds simulated = " << creature_seconds << std::endl;
+        RecordProgress(i, mean_fitness);
+
+        Creature mean_creature = es_base_;
+        mean_creature.SetGenome(evolution_strategy_.GetTheta());
+        mean_creature.SetFitness(mean_fitness);
+        emit NewCreature(mean_creature);
+    }
+
+    std::cout << "Total simulation time: " << float(std::clock() - start_time) / CLOCKS_PER_SEC  << " s" << std::endl;
+}
+
+//! Internal function simulating a range of ES candidates
+/*!
+  Candidate 2 * p is the positive and 2 * p + 1 the negative perturbation
+  of pair p.
+*/
+void EvolutionManager::EvaluateEsBatch(const EsBatch& batch) {
+    Population creatures(batch.end - batch.begin, es_base_);
+    f_vec genome(evolution_strategy_.GetGenomeSize());
+    for (int j = batch.begin; j < batch.end; ++j) {
+        if (!genome.empty())
+            evolution_strategy_.Perturbed(es_offsets_[j / 2], j % 2 == 1, &genome[0]);
+        creatures[j - batch.begin].SetGenome(genome);
+    }
+    EvaluateWithSharedLight(&creatures, generation_);
+    for (int j = batch.begin; j < batch.end; ++j)
+        es_fitness_[j] = creatures[j - batch.begin].GetFitness();
+}
+
+//! Runs a steady state evolution without generation boundaries
+/*!
+  The random population is evaluated once on this thread. Then one worker
+  per thread of the pool breeds a few children at a time from the
+  population, evaluates them in its own Simulation and inserts them as soon
+  as they are done, replacing the worst creature if they are better. No
+  worker waits for the slowest creature of a generation. The run ends after
+  population size times max generations evaluations. The fitness is the
+  weighted sum of the simulation data with one light position and one
+  simulation time for the whole run, so creatures evaluated at different
+  times can be compared. NewCreature is emitted for every new best creature.
+*/
+void EvolutionManager::RunSteadyState() {
+    end_now_request_ = false;
+    std::clock_t start_time = std::clock();
+
+    int max_gen = settings_->max_generations;
+    int pop_size = settings_->population_size;
+
+    std::copy(settings_->fitness_weights, settings_->fitness_weights + 7, weights_);
+    // Same range as the random light position of the Simulation
+    light_position_ = btVector3(
+        batch_rng_.UniformInt(41) - 20, 5, batch_rng_.UniformInt(41) - 20);
+
+    std::cout << "Seeding steady state..." << std::endl;
+    current_population_ = CreateRandomPopulation(pop_size);
+    EvaluateWithSharedLight(&current_population_, 0);
+    best_fitness_ = current_population_[0].GetFitness();
+    int best = 0;
+    for (int i = 1; i < pop_size; ++i) {
+        if (current_population_[i].GetFitness() > best_fitness_) {
+            best_fitness_ = current_population_[i].GetFitness();
+            best = i;
+        }
+    }
+    emit NewCreature(current_population_[best]);
+    RecordProgress(0, best_fitness_);
+
+    steady_state_budget_ = max_gen * pop_size;
+    steady_state_started_ = pop_size;
+    steady_state_completed_ = pop_size;
+
+    uint64_t seed = batch_rng_.Next();
+    std::vector<SteadyStateWorker> workers(
+        std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+    for (int i = 0; i < workers.size(); ++i)
+        workers[i].rng.Seed(seed, i);
+    QtConcurrent::blockingMap(workers, SteadyStateFunctor(this));
+
+    std::cout << "Total simulation time: " << float(std::clock() - start_time) / CLOCKS_PER_SEC  << " s" << std::endl;
+}
+
+//! Internal function run by every steady state worker until the budget is used
+void EvolutionManager::RunSteadyStateWorker(SteadyStateWorker& worker) {
+    BatchRNG& rng = worker.rng;
+    Population children;
+    int generation = 0;
+    while (!NeedEndNow()) {
+        // Changes made in the GUI apply from the next batch on
+        std::shared_ptr<const SettingsSnapshot> settings =
+            SettingsManager::Instance()->GetSnapshot();
+        CrossoverType crossover_type = static_cast<CrossoverType>(
+            settings->crossover_type);
+        {
+            QMutexLocker locker(&steady_state_mutex_);
+            int n = std::min(STEADY_STATE_BATCH_SIZE,
+                steady_state_budget_ - steady_state_started_);
+            if (n <= 0)
+                return;
+            generation = steady_state_started_ / current_population_.size();
+            steady_state_started_ += n;
+            children.resize(n);
+            int i = 0;
+            while (i < n) {
+                const Creature& mom = current_population_[SteadyStateTournament(settings->tournament_size, rng)];
+                children[i] = mom;
+                if (i + 1 < n && rng.Uniform() < settings->crossover) {
+                    const Creature& dad = current_population_[SteadyStateTournament(settings->tournament_size, rng)];
+                    children[i + 1] = dad;
+                    Creature::Crossover(mom, dad, &children[i], &children[i + 1],
+                        crossover_type, rng);
+                    children[i + 1].Mutate(*settings, rng);
+                    i++;
+                }
+                children[i].Mutate(*settings, rng);
+                i++;
+            }
+        }
+
+        EvaluateWithSharedLight(&children, generation);
+
+        QMutexLocker locker(&steady_state_mutex_);
+        for (int i = 0; i < children.size(); ++i)
+            SteadyStateInsert(children[i]);
+        int pop_size = current_population_.size();
+        int completed = steady_state_completed_;
+        steady_state_completed_ += children.size();
+        if (steady_state_completed_ / pop_size != completed / pop_size) {
+            std::cout << "Evaluations: " << steady_state_completed_ <<
+                ", best fitness = " << best_fitness_ << std::endl;
+            RecordProgress(steady_state_completed_ / pop_size - 1, best_fitness_);
+        }
+    }
+}
+
+//! Internal function selecting a creature by tournament in steady state
+/*!
+  Called with steady_state_mutex_ locked.
+  \param tournament_size is the number of creatures competing.
+  \param rng is the random number generator of the worker.
+  \return The index of the selected creature.
+*/
+int EvolutionManager::SteadyStateTournament(int tournament_size, BatchRNG& rng) {
+    int pop_size = current_population_.size();
+    int best = rng.UniformInt(pop_size);
+    for (int i = 1; i < tournament_size; ++i) {
+        int candidate = rng.UniformInt(pop_size);
+        if (current_population_[candidate].GetFitness() >
+                current_population_[best].GetFitness())
+            best = candidate;
+    }
+    return best;
+}
+
+//! Internal function replacing the worst creature if the creature is better
+/*!
+  Called with steady_state_mutex_ locked. Emits NewCreature if the creature
+  is the best so far.
+*/
+void EvolutionManager::SteadyStateInsert(const Creature& creature) {
+    int worst = 0;
+    for (int i = 1; i < current_population_.size(); ++i) {
+        if (current_population_[i].GetFitness() <
+                current_population_[worst].GetFitness())
+            worst = i;
+    }
+    if (creature.GetFitness() <= current_population_[worst].GetFitness())
+        return;
+    current_population_[worst] = creature;
+    if (creature.GetFitness() > best_fitness_) {
+        best_fitness_ = creature.GetFitness();
+        emit NewCreature(creature);
+    }
+}
+
+//! Internal function simulating creatures with light_position_ and weights_
+/*!
+  The fitness of the creatures is set to the weighted sum of their
+  simulation data. Can be called concurrently.
+  \param creatures are the creatures to simulate.
+  \param generation is written to the trajectory file with them.
+*/
+void EvolutionManager::EvaluateWithSharedLight(
+        Population* creatures,
+        int generation) {
+    {
+        Simulation sim_world(*settings_);
+        sim_world.SetLightPosition(light_position_);
+        sim_world.SetTrajectoryWriter(&trajectory_writer_, generation);
+        sim_world.AddPopulation(*creatures, false);
+        sim_world.SimulatePopulation(creatures);
+    }
+    for (int i = 0; i < creatures->size(); ++i)
+        (*creatures)[i].SetFitness((*creatures)[i].simdata.WeightedSum(weights_));
+}
+
 //! Prints the fitness value for the best creature in all different generations.
 void EvolutionManager::PrintBestFitnessValues(){
+    const SimData& best = current_population_[ranking_[0]].simdata;
     std::cout <<
-    "Distance to light = " << current_population_[0].simdata.distance_light << std::endl <<
-    "Distance z = " << current_population_[0].simdata.distance_z << std::endl <<
-    "Max y = " << current_population_[0].simdata.max_y << std::endl <<
-    "Accumulated y = " << current_population_[0].simdata.accumulated_y << std::endl <<
-    "Accumulated head y = " << current_population_[0].simdata.accumulated_head_y << std::endl <<
-    "Deviation x = " << current_population_[0].simdata.deviation_x << std::endl <<
-    "Energy waste = " << current_population_[0].simdata.energy_waste << std::endl;
+    "Distance to light = " << best.distance_light << std::endl <<
+    "Distance z = " << best.distance_z << std::endl <<
+    "Max y = " << best.max_y << std::endl <<
+    "Accumulated y = " << best.accumulated_y << std::endl <<
+    "Accumulated head y = " << best.accumulated_head_y << std::endl <<
+    "Deviation x = " << best.deviation_x << std::endl <<
+    "Energy waste = " << best.energy_waste << std::endl;
 }
 
 void EvolutionManager::PrintPopulation() {
@@ -86,8 +432,47 @@ void EvolutionManager::PrintPopulation() {
 }
 
 //! Returns the best creature as of when this method is called
+//! Returns the best fitness of every generation of the last run.
+/*!
+  For the evolution strategy it is the mean fitness of the candidates of
+  every iteration and for MAP-Elites the best elite after every batch. A
+  steady state run records one entry per population size evaluations.
+*/
+const std::vector<ProgressRecord>& EvolutionManager::GetProgress() const {
+    return progress_;
+}
+
+//! Internal function adding an entry to the progress of the run.
+void EvolutionManager::RecordProgress(int generation, float best_fitness) {
+    ProgressRecord record;
+    record.generation = generation;
+    record.best_fitness = best_fitness;
+    record.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - run_start_).count();
+    progress_.push_back(record);
+}
+
 Creature EvolutionManager::GetBestCreature() {
-    return current_population_[0];
+    if (ranking_.size() != current_population_.size())
+        return current_population_[0];
+    return current_population_[ranking_[0]];
+}
+
+//! Returns the Pareto front of the current population
+/*!
+  At most MAX_PARETO_FRONT_SIZE creatures are returned. They are ordered by
+  crowding distance, so the extremes of the front come first and the rest
+  are the creatures in the least crowded parts of the front. Only valid in
+  PARETO_FITNESS mode, after the population has been ranked.
+*/
+Population EvolutionManager::GetParetoFront() {
+    Population front;
+    int n = std::min<int>(MAX_PARETO_FRONT_SIZE, ranking_.size());
+    for (int i = 0; i < n; ++i) {
+        if (pareto_front_[ranking_[i]] == 0)
+            front.push_back(current_population_[ranking_[i]]);
+    }
+    return front;
 }
 
 //! Returns the best creature from the last generation
@@ -101,25 +486,35 @@ Population EvolutionManager::GetAllBestCreatures() {
 
 //! Simulates all creatures in population
 void EvolutionManager::SimulatePopulation() {
-    Simulation sim_world;
+    Simulation sim_world(*settings_);
+    sim_world.SetRecording(settings_->record_trajectories);
+    sim_world.SetTrajectoryWriter(&trajectory_writer_, generation_);
     
     sim_world.AddPopulation(current_population_, false);
-    current_population_ = sim_world.SimulatePopulation();
+    sim_world.SimulatePopulation(&current_population_);
 }
 
 //! Calculates fitness values for all creatures in population by 
 // looking at values stored during simulation
 void EvolutionManager::CalculateFitnessOnPopulation() {
+    if (settings_->fitness_mode == PARETO_FITNESS) {
+        CalculateParetoFitness();
+        return;
+    }
+    if (settings_->fitness_mode == NOVELTY_FITNESS) {
+        CalculateNoveltyFitness();
+        return;
+    }
 
     //how much each fitness function should contribute to the fitness value
     float weight1, weight2, weight3, weight4, weight5, weight6, weight7;
-    weight1 = SettingsManager::Instance()->GetFitnessDistanceLight();
-    weight2 = SettingsManager::Instance()->GetFitnessDistanceZ();
-    weight3 = SettingsManager::Instance()->GetFitnessMaxY();
-    weight4 = SettingsManager::Instance()->GetFitnessAccumY();
-    weight5 = SettingsManager::Instance()->GetFitnessAccumHeadY();
-    weight6 = SettingsManager::Instance()->GetFitnessDeviationX();
-    weight7 = SettingsManager::Instance()->GetFitnessEnergy();
+    weight1 = settings_->fitness_weights[0];
+    weight2 = settings_->fitness_weights[1];
+    weight3 = settings_->fitness_weights[2];
+    weight4 = settings_->fitness_weights[3];
+    weight5 = settings_->fitness_weights[4];
+    weight6 = settings_->fitness_weights[5];
+    weight7 = settings_->fitness_weights[6];
 
     // find the max value of each fitness-value to be able to normalize
     SimData data = current_population_[0].simdata;
@@ -173,61 +568,218 @@ void EvolutionManager::CalculateFitnessOnPopulation() {
     }
 }
 
-//! Sorts the current population based on fitness value. Should only be called once fitness
-// values have been obtained
-void EvolutionManager::SortPopulation() {
-	std::sort(current_population_.begin(), current_population_.end(), CreatureLargerThan());
-}
-
-
-//! Evolves the current population based on simple mutation and elitism
-void EvolutionManager::NextGeneration() {
-	float elitism = SettingsManager::Instance()->GetElitism();
-	float mutation = SettingsManager::Instance()->GetMutation();
+//! Calculates fitness values for all creatures with NSGA-II
+/*!
+  The objectives are the SimData values that have a non-zero weight in the
+  fitness settings. Only the sign of a weight is used, a positive weight
+  maximizes the value and a negative weight minimizes it. No normalization
+  is needed, so fitness values are comparable between generations as far
+  as the Pareto ranks are. The fitness of a creature is its crowded
+  comparison value, see MultiObjective::ScalarFitness.
+*/
+void EvolutionManager::CalculateParetoFitness() {
+    float weights[7];
+    std::copy(settings_->fitness_weights, settings_->fitness_weights + 7, weights);
+
+    int pop_size = current_population_.size();
+    int n_objectives = 0;
+    for (int k = 0; k < 7; ++k) {
+        if (weights[k] != 0.0f)
+            n_objectives++;
+    }
+    if (n_objectives == 0) {
+        std::cout << "WARNING: no objectives chosen, all fitness weights are 0!"
+            << std::endl;
+        pareto_front_.assign(pop_size, 0);
+        for (int i = 0; i < pop_size; ++i)
+            current_population_[i].SetFitness(0.0f);
+        return;
+    }
 
-	int elitism_pivot = static_cast<int>(current_population_.size() * elitism);
+    std::vector<float> objectives;
+    objectives.reserve(pop_size * n_objectives);
+    for (int i = 0; i < pop_size; ++i) {
+        const SimData& data = current_population_[i].simdata;
+        float values[7] = {
+            data.distance_light,
+            data.distance_z,
+            data.max_y,
+            data.accumulated_y,
+            data.accumulated_head_y,
+            data.deviation_x,
+            data.energy_waste};
+        for (int k = 0; k < 7; ++k) {
+            if (weights[k] != 0.0f)
+                objectives.push_back(weights[k] > 0.0f ? values[k] : -values[k]);
+        }
+    }
 
-	Population new_population (&current_population_[0],
-		 &current_population_[elitism_pivot]);
+    std::vector<float> crowding;
+    MultiObjective::NonDominatedSort(objectives, n_objectives, &pareto_front_);
+    MultiObjective::CrowdingDistance(
+        objectives, n_objectives, pareto_front_, &crowding);
+    MultiObjective::ScalarFitness(pareto_front_, crowding, &fitness_);
+    for (int i = 0; i < pop_size; ++i)
+        current_population_[i].SetFitness(fitness_[i]);
+}
 
-	new_population.resize(current_population_.size());
+//! Calculates fitness values for all creatures with novelty search
+/*!
+  The fitness of a creature is the novelty of its behavior, the mean
+  distance to the k nearest behaviors in the archive and the current
+  population. The fitness weights are not used. The novelty is calculated
+  in parallel on the global thread pool. Afterwards a random part of the
+  population, NOVELTY_ARCHIVE_PROBABILITY, is added to the archive, which
+  grows over the whole evolution.
+*/
+void EvolutionManager::CalculateNoveltyFitness() {
+    const int dimension = SimData::BEHAVIOR_SIZE;
+    int pop_size = current_population_.size();
+    behaviors_.resize(pop_size * dimension);
+    for (int i = 0; i < pop_size; ++i)
+        current_population_[i].simdata.GetBehavior(&behaviors_[i * dimension]);
+    novelty_archive_.SetPopulation(behaviors_);
+
+    fitness_.resize(pop_size);
+    std::vector<NoveltyBatch> batches;
+    for (int begin = 0; begin < pop_size; begin += NOVELTY_BATCH_SIZE) {
+        NoveltyBatch batch;
+        batch.begin = begin;
+        batch.end = std::min(pop_size, begin + NOVELTY_BATCH_SIZE);
+        batches.push_back(batch);
+    }
+    int k = settings_->novelty_neighbours;
+    QtConcurrent::blockingMap(batches, NoveltyFunctor(this, k));
 
-	std::uniform_int_distribution<int> int_elitism_index(0, elitism_pivot);
+    for (int i = 0; i < pop_size; ++i) {
+        current_population_[i].SetFitness(fitness_[i]);
+        if (batch_rng_.Uniform() < NOVELTY_ARCHIVE_PROBABILITY)
+            novelty_archive_.Add(&behaviors_[i * dimension]);
+    }
+    std::cout << "Novelty archive size = " << novelty_archive_.Size() <<
+        std::endl;
+}
 
-	//Creature new_creature;
-    for(int i = elitism_pivot; i < current_population_.size(); i++) {
-		int random_index = int_elitism_index(rng_.mt_rng_);
+//! Ranks the current population based on fitness value. Should only be called once fitness
+// values have been obtained
+/*!
+  Only the fitness values and indices are partitioned, the creatures are
+  never moved. Finding the elite is O(n) with nth_element.
+  \param n_elite is the number of best creatures that are ranked in order
+  at the front of ranking_. At least the best creature is always ranked.
+*/
+void EvolutionManager::RankPopulation(int n_elite) {
+	int pop_size = current_population_.size();
+	fitness_.resize(pop_size);
+	for (int i = 0; i < pop_size; ++i)
+		fitness_[i] = current_population_[i].GetFitness();
+	Selection::RankElite(fitness_, std::max(1, n_elite), &ranking_);
+}
 
-		Creature c = TournamentSelection();
 
-		c.Mutate();
-		
-        new_population[i] = c;
+//! Evolves the current population based on crossover, mutation and elitism
+/*!
+  The best creatures are copied to the new population. The rest of the
+  population is filled with children of parents chosen by the selection
+  operator given in the settings. All parents are selected up front, which
+  lets stochastic universal sampling spread its pointers over the whole
+  generation. With the probability given by the crossover ratio, two parents
+  are recombined in to two children, otherwise a parent is copied. All
+  children are mutated.
+  The children are written in place in to the second population buffer,
+  which is then swapped with the current population, so no memory is
+  reallocated between generations. The slots are split in to batches that
+  are bred in parallel on the global thread pool. Every batch draws from
+  its own substream of a seed drawn once per generation, so the result does
+  not depend on how the batches are scheduled.
+*/
+void EvolutionManager::NextGeneration() {
+	OffspringSettings settings;
+	settings.snapshot = settings_.get();
+	settings.crossover = settings_->crossover;
+	settings.crossover_type = static_cast<CrossoverType>(
+		settings_->crossover_type);
+	float elitism = settings_->elitism;
+
+	int pop_size = current_population_.size();
+	settings.elitism_pivot = static_cast<int>(pop_size * elitism);
+
+	RankPopulation(settings.elitism_pivot);
+	selection_.Prepare(
+		static_cast<SelectionType>(
+			settings_->selection_type),
+		fitness_,
+		settings_->tournament_size);
+	parents_.resize(2 * std::max(0, pop_size - settings.elitism_pivot));
+	selection_.SelectMany(parents_.size(), batch_rng_, parents_.data());
+
+	// Only grows the first time, or if the population size changed
+	if (next_population_.size() != pop_size)
+		next_population_ = current_population_;
+
+	uint64_t seed = batch_rng_.Next();
+	std::vector<OffspringBatch> batches;
+	for (int begin = 0; begin < pop_size; begin += OFFSPRING_BATCH_SIZE) {
+		OffspringBatch batch;
+		batch.begin = begin;
+		batch.end = std::min(pop_size, begin + OFFSPRING_BATCH_SIZE);
+		batch.rng.Seed(seed, batches.size());
+		batches.push_back(batch);
 	}
 
-	current_population_ = new_population;
-}
-
+	QtConcurrent::blockingMap(batches, BreedFunctor(this, settings));
 
+	current_population_.swap(next_population_);
 
-//! Select a creature from the population based on tournament selection.
-Creature EvolutionManager::TournamentSelection() {
-	int TOURNAMENT_SIZE = 3;
-	Creature c; 
+	// The elite is now at the front of the population, best first
+	for (int i = 0; i < pop_size; ++i)
+		ranking_[i] = i;
+}
 
-	std::uniform_int_distribution<int> int_dist_index_(0,
-						current_population_.size()-1);
+//! Breeds the slots of one batch in to the next population.
+/*!
+  Slots below the elitism pivot get a copy of the elite. The other slots
+  are filled pairwise with children of the parents selected for them. Only
+  the current population is read and only the slots of the batch are
+  written, so batches can be bred concurrently.
+  \param settings are the settings read once for the whole generation.
+  \param batch are the slots to fill and the random number generator to
+  use for them.
+*/
+void EvolutionManager::BreedBatch(
+		const OffspringSettings& settings,
+		OffspringBatch& batch) {
+	BatchRNG& rng = batch.rng;
+	int i = batch.begin;
+	while (i < batch.end) {
+		if (i < settings.elitism_pivot) {
+			next_population_[i] = current_population_[ranking_[i]];
+			i++;
+			continue;
+		}
 
-	c = current_population_[int_dist_index_(rng_.mt_rng_)];
-	for (int j = 0; j < TOURNAMENT_SIZE; ++j) {
-		int idx = int_dist_index_(rng_.mt_rng_);
-		if(current_population_[idx].GetFitness() > 
-									c.GetFitness()) {
-			c = current_population_[idx];
+		int mom = parents_[2 * (i - settings.elitism_pivot)];
+		if (i + 1 < batch.end && rng.Uniform() < settings.crossover) {
+			int dad = parents_[2 * (i - settings.elitism_pivot) + 1];
+			next_population_[i] = current_population_[mom];
+			next_population_[i + 1] = current_population_[dad];
+			Creature::Crossover(
+				current_population_[mom],
+				current_population_[dad],
+				&next_population_[i],
+				&next_population_[i + 1],
+				settings.crossover_type,
+				rng);
+			next_population_[i].Mutate(*settings.snapshot, rng);
+			next_population_[i + 1].Mutate(*settings.snapshot, rng);
+			i += 2;
+		}
+		else {
+			next_population_[i] = current_population_[mom];
+			next_population_[i].Mutate(*settings.snapshot, rng);
+			i++;
 		}
 	}
-
-	return c;
 }
 
 //! Create a population with random creatures
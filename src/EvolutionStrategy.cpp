@@ -0,0 +1,184 @@
+#include "EvolutionStrategy.h"
+#include "Mutation.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+const int NoiseTable::TABLE_SIZE;
+const float EvolutionStrategy::ADAM_BETA1 = 0.9f;
+const float EvolutionStrategy::ADAM_BETA2 = 0.999f;
+const float EvolutionStrategy::ADAM_EPSILON = 1e-8f;
+
+//! Returns the shared noise table, generated on first use.
+const NoiseTable& NoiseTable::Instance() {
+  static NoiseTable table; // Thread safe initialization in C++11
+  return table;
+}
+
+//! Internal constructor generating the table from a fixed seed.
+NoiseTable::NoiseTable() : noise_(TABLE_SIZE) {
+  BatchRNG rng(12345);
+  Mutation::FillGaussian(&noise_[0], TABLE_SIZE, rng);
+}
+
+//! Returns the perturbation starting at an offset.
+/*!
+  \param offset is the offset in the table, from SampleOffset.
+*/
+const float* NoiseTable::Get(int offset) const {
+  return &noise_[offset];
+}
+
+//! Draws a random offset of a perturbation.
+/*!
+  \param n is the number of genes in the perturbation.
+  \param rng is the random number generator to draw from.
+  \return An offset with at least n numbers after it.
+*/
+int NoiseTable::SampleOffset(int n, BatchRNG& rng) const {
+  return rng.UniformInt(std::max(1, TABLE_SIZE - n + 1));
+}
+
+//! Returns the number of floats in the table.
+int NoiseTable::Size() const {
+  return TABLE_SIZE;
+}
+
+//! Constructor, the mean genome is empty until Reset.
+EvolutionStrategy::EvolutionStrategy() {
+  iteration_ = 0;
+  sigma_ = 0.02f;
+  learning_rate_ = 0.01f;
+}
+
+//! Starts a new search.
+/*!
+  \param theta is the initial mean genome.
+  \param sigma is the standard deviation of the perturbations.
+  \param learning_rate is the step size of the Adam optimizer.
+*/
+void EvolutionStrategy::Reset(
+        const std::vector<float>& theta,
+        float sigma,
+        float learning_rate) {
+  theta_ = theta;
+  gradient_.assign(theta.size(), 0.0f);
+  adam_m_.assign(theta.size(), 0.0f);
+  adam_v_.assign(theta.size(), 0.0f);
+  iteration_ = 0;
+  sigma_ = sigma;
+  learning_rate_ = learning_rate;
+}
+
+//! Samples the perturbations of one iteration.
+/*!
+  \param n_pairs is the number of antithetic pairs.
+  \param offsets is where the offsets in the noise table are written, one
+  per pair.
+*/
+void EvolutionStrategy::Sample(int n_pairs, std::vector<int>* offsets) {
+  const NoiseTable& table = NoiseTable::Instance();
+  offsets->resize(n_pairs);
+  for (int i = 0; i < n_pairs; ++i)
+    (*offsets)[i] = table.SampleOffset(theta_.size(), rng_);
+}
+
+//! Builds a perturbed genome. Can be called concurrently.
+/*!
+  \param offset is the offset of the perturbation in the noise table.
+  \param negative tells if the perturbation is subtracted instead of added.
+  \param genome is where the genome is written, GetGenomeSize floats.
+*/
+void EvolutionStrategy::Perturbed(
+        int offset,
+        bool negative,
+        float* genome) const {
+  const float* eps = NoiseTable::Instance().Get(offset);
+  const float scale = negative ? -sigma_ : sigma_;
+  const int n = theta_.size();
+  for (int i = 0; i < n; ++i)
+    genome[i] = theta_[i] + scale * eps[i];
+}
+
+//! Moves the mean genome along the estimated gradient.
+/*!
+  The gradient is estimated from the centered ranks r of the fitness as
+  sum over pairs of (r+ - r-) * eps / (2 * n_pairs * sigma).
+  \param offsets are the offsets of the pairs from Sample.
+  \param fitness are the fitness values of the perturbed genomes. The
+  positive and negative genome of every pair follow each other, so there
+  are two values per offset.
+*/
+void EvolutionStrategy::Update(
+        const std::vector<int>& offsets,
+        const std::vector<float>& fitness) {
+  const int n = theta_.size();
+  const int n_pairs = offsets.size();
+  if (n == 0 || n_pairs == 0 || fitness.size() != 2 * n_pairs)
+    return;
+
+  std::vector<float> ranks;
+  CenteredRanks(fitness, &ranks);
+
+  const NoiseTable& table = NoiseTable::Instance();
+  std::fill(gradient_.begin(), gradient_.end(), 0.0f);
+  for (int p = 0; p < n_pairs; ++p) {
+    const float w = ranks[2 * p] - ranks[2 * p + 1];
+    const float* eps = table.Get(offsets[p]);
+    for (int i = 0; i < n; ++i)
+      gradient_[i] += w * eps[i];
+  }
+  const float scale = 1.0f / (2.0f * n_pairs * sigma_);
+
+  // Adam, ascending since the fitness is maximized
+  iteration_++;
+  const float correction1 = 1.0f - std::pow(ADAM_BETA1, iteration_);
+  const float correction2 = 1.0f - std::pow(ADAM_BETA2, iteration_);
+  const float step = learning_rate_ * std::sqrt(correction2) / correction1;
+  for (int i = 0; i < n; ++i) {
+    const float g = gradient_[i] * scale;
+    adam_m_[i] = ADAM_BETA1 * adam_m_[i] + (1.0f - ADAM_BETA1) * g;
+    adam_v_[i] = ADAM_BETA2 * adam_v_[i] + (1.0f - ADAM_BETA2) * g * g;
+    theta_[i] += step * adam_m_[i] / (std::sqrt(adam_v_[i]) + ADAM_EPSILON);
+  }
+}
+
+//! Get function.
+/*!
+  \return The current mean genome.
+*/
+const std::vector<float>& EvolutionStrategy::GetTheta() const {
+  return theta_;
+}
+
+//! Get function.
+/*!
+  \return The number of genes in the mean genome.
+*/
+int EvolutionStrategy::GetGenomeSize() const {
+  return theta_.size();
+}
+
+//! Replaces fitness values with their centered ranks.
+/*!
+  The worst value gets -0.5 and the best 0.5, evenly spaced in between.
+  \param fitness are the fitness values.
+  \param ranks is where the ranks are written.
+*/
+void EvolutionStrategy::CenteredRanks(
+        const std::vector<float>& fitness,
+        std::vector<float>* ranks) {
+  const int n = fitness.size();
+  ranks->resize(n);
+  if (n == 1)
+    (*ranks)[0] = 0.0f;
+  if (n <= 1)
+    return;
+  std::vector<std::pair<float, int> > order(n);
+  for (int i = 0; i < n; ++i)
+    order[i] = std::make_pair(fitness[i], i);
+  std::sort(order.begin(), order.end());
+  for (int i = 0; i < n; ++i)
+    (*ranks)[order[i].second] = static_cast<float>(i) / (n - 1) - 0.5f;
+}
@@ -3,6 +3,7 @@
 #include "TextureManager.h"
 #include "SettingsManager.h"
 #include "Scene.h"
+#include "RenderState.h"
 
 #ifndef GL_MULTISAMPLE
 #define GL_MULTISAMPLE  0x809D
@@ -12,6 +13,7 @@ GLWidget::GLWidget(QGLFormat format, QWidget *parent)
   : QGLWidget(format, parent)
 {
   enable_render_ = false;
+  frame_count_ = 0;
   QTimer *timer = new QTimer(this);
   connect(timer, SIGNAL(timeout()), this, SLOT(update()));
   timer->start(16);
@@ -41,17 +43,41 @@ void GLWidget::initializeGL(){
   // Accept fragment if it closer to the camera than the former one
   glDepthFunc(GL_LESS);
 
+  RenderState::Instance();
   ShaderManager::Instance();
   TextureManager::Instance();
+  if (SettingsManager::Instance()->GetShaderHotReload())
+    ShaderManager::Instance()->StartWatching();
 }
 
 void GLWidget::paintGL(){
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if (SettingsManager::Instance()->GetShaderHotReload())
+    ShaderManager::Instance()->ReloadChangedShaders();
+  TextureManager::Instance()->UpdateStreaming();
 
   //if(enable_render_) {
     Scene::Instance()->Update();
     Scene::Instance()->Render();
   //}
+
+  // The counts of a frame are complete when the next one begins
+  ++frame_count_;
+  if (SettingsManager::Instance()->GetPrintRenderStatistics() &&
+      frame_count_ % 60 == 0) {
+    RenderStatistics stats = RenderState::Instance()->GetFrameStatistics();
+    CullingStatistics culling = Scene::Instance()->GetCullingStatistics();
+    std::cout << "Frame " << frame_count_ << ": " <<
+        stats.draw_calls << " draw calls, " <<
+        stats.instances << " objects, " <<
+        stats.state_changes << " state changes, " <<
+        stats.redundant_changes << " redundant changes skipped, " <<
+        culling.visible_nodes << " visible nodes, " <<
+        culling.culled_nodes << " culled nodes, " <<
+        culling.impostor_nodes << " nodes in " <<
+        culling.impostors << " impostors, " <<
+        culling.shadow_casters << " shadow casters" << std::endl;
+  }
 }
 
 void GLWidget::resizeGL(int width, int height){
@@ -0,0 +1,152 @@
+#include "GeometryCache.h"
+#include "Box.h"
+#include "Plane.h"
+#include "RenderState.h"
+
+GeometryCache* GeometryCache::instance_ = NULL;
+
+//! A part of the singleton pattern
+/*!
+ If this function is called for the first time, the constructor is called and
+ the singleton is created.
+ \return The one instance of the GeometryCache
+ */
+GeometryCache* GeometryCache::Instance() {
+  if (!instance_)
+    instance_ = new GeometryCache();
+  return instance_;
+}
+
+//! Puts all meshes in the shared buffers and creates the vertex array.
+GeometryCache::GeometryCache() {
+  MeshData all;
+  MeshData box;
+  Box::GetMeshData(&box);
+  box_ = AddMesh(box, &all);
+  MeshData plane;
+  Plane::GetMeshData(&plane);
+  plane_ = AddMesh(plane, &all);
+
+  element_buffer_ = GLBuffer::Create();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer_.Get());
+  glBufferData(
+          GL_ELEMENT_ARRAY_BUFFER,
+          sizeof(GLushort) * all.elements.size(),
+          &all.elements[0],
+          GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  vertex_position_buffer_ = GLBuffer::Create();
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_position_buffer_.Get());
+  glBufferData(
+          GL_ARRAY_BUFFER,
+          sizeof(glm::vec3) * all.positions.size(),
+          &all.positions[0],
+          GL_STATIC_DRAW);
+
+  vertex_normal_buffer_ = GLBuffer::Create();
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_normal_buffer_.Get());
+  glBufferData(
+          GL_ARRAY_BUFFER,
+          sizeof(glm::vec3) * all.normals.size(),
+          &all.normals[0],
+          GL_STATIC_DRAW);
+
+  vertex_uv_buffer_ = GLBuffer::Create();
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_uv_buffer_.Get());
+  glBufferData(
+          GL_ARRAY_BUFFER,
+          sizeof(glm::vec2) * all.uvs.size(),
+          &all.uvs[0],
+          GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  vertex_array_ = GLVertexArray::Create();
+  RenderState::Instance()->BindVertexArray(vertex_array_.Get());
+  SetupVertexAttributes();
+  RenderState::Instance()->BindVertexArray(0);
+}
+
+//! Returns the unit Box, from -1 to 1 along every axis.
+Mesh GeometryCache::GetBox() {
+  return box_;
+}
+
+//! Returns the unit Plane, from -1 to 1 along x and z with the normal along y.
+Mesh GeometryCache::GetPlane() {
+  return plane_;
+}
+
+//! Returns the vertex array with the vertices of all meshes.
+GLuint GeometryCache::GetVertexArrayId() {
+  return vertex_array_.Get();
+}
+
+//! Makes the bound vertex array read the shared buffers.
+/*!
+  The position, normal and UV are the attributes 0, 1 and 2, like in
+  basic.vert, and the shared element buffer is bound to the vertex array.
+*/
+void GeometryCache::SetupVertexAttributes() {
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer_.Get());
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_position_buffer_.Get());
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(
+          0,                  // attribute, same as in shader.
+          3,                  // size
+          GL_FLOAT,           // type
+          GL_FALSE,           // normalized?
+          0,                  // stride
+          reinterpret_cast<void*>(0));  // array buffer offset
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_normal_buffer_.Get());
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(
+          1,                  // attribute, same as in shader.
+          3,                  // size
+          GL_FLOAT,           // type
+          GL_FALSE,           // normalized?
+          0,                  // stride
+          reinterpret_cast<void*>(0));  // array buffer offset
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_uv_buffer_.Get());
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(
+          2,                  // attribute, same as in shader.
+          2,                  // size
+          GL_FLOAT,           // type
+          GL_FALSE,           // normalized?
+          0,                  // stride
+          reinterpret_cast<void*>(0));  // array buffer offset
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//! Internal function appending a mesh to the data of all meshes.
+/*!
+  The elements are moved past the vertices of the meshes before it.
+  \param mesh_data is the mesh to add.
+  \param all is the data of all meshes added so far.
+  \return Where the mesh is in the element buffer.
+*/
+Mesh GeometryCache::AddMesh(const MeshData& mesh_data, MeshData* all) {
+  Mesh mesh;
+  mesh.first_element = all->elements.size();
+  mesh.n_elements = mesh_data.elements.size();
+  GLushort first_vertex = all->positions.size();
+  for (int i = 0; i < mesh_data.elements.size(); ++i)
+    all->elements.push_back(first_vertex + mesh_data.elements[i]);
+  all->positions.insert(
+          all->positions.end(),
+          mesh_data.positions.begin(),
+          mesh_data.positions.end());
+  all->normals.insert(
+          all->normals.end(),
+          mesh_data.normals.begin(),
+          mesh_data.normals.end());
+  all->uvs.insert(
+          all->uvs.end(),
+          mesh_data.uvs.begin(),
+          mesh_data.uvs.end());
+  return mesh;
+}
@@ -0,0 +1,167 @@
+#include "InstancedRenderer.h"
+#include "RenderState.h"
+#include "ShaderManager.h"
+
+// C++
+#include <algorithm>
+
+// Attribute locations of the instance data, see instanced.vert
+static const GLuint MODEL_LOCATION = 3; // Four columns, 3 to 6
+static const GLuint SCALE_LOCATION = 7;
+static const GLuint MATERIAL_LOCATION = 8;
+
+//! Constructor. No OpenGL buffers are created until the first Render.
+InstancedRenderer::InstancedRenderer() {
+  instance_buffer_capacity_ = 0;
+}
+
+//! Removes all boxes added since the last frame.
+void InstancedRenderer::Clear() {
+  instances_.clear();
+}
+
+//! Adds a box to draw in the next Render.
+/*!
+  \param model is the rigid transform of the box.
+  \param scale are the half extents of the box.
+  \param material_index is the index of the Material of the box, see
+  MaterialManager::GetMaterialIndex.
+*/
+void InstancedRenderer::Add(
+        const glm::mat4& model,
+        const glm::vec3& scale,
+        int material_index) {
+  BoxInstance instance;
+  instance.model = model;
+  instance.scale = scale;
+  instance.material_index = material_index;
+  instances_.push_back(instance);
+}
+
+int InstancedRenderer::GetNumberOfInstances() const {
+  return instances_.size();
+}
+
+//! Draws all added boxes with one draw call.
+/*!
+  The camera and the light sources are read from the FrameData block, see
+  ShaderManager::UpdateFrameData, and the materials from the MaterialData
+  block. The texture array is bound by the Scene.
+*/
+void InstancedRenderer::Render() {
+  if (!UploadInstances())
+    return;
+  ShaderManager::Instance()->UseProgram("Instanced");
+  RenderState* state = RenderState::Instance();
+  state->BindVertexArray(vertex_array_.Get());
+  state->DrawElementsInstanced(
+          box_.n_elements,
+          instances_.size(),
+          box_.first_element);
+}
+
+//! Draws only the depth of all added boxes, seen from the ShadowMap.
+void InstancedRenderer::RenderDepth() {
+  if (!UploadInstances())
+    return;
+  ShaderManager::Instance()->UseProgram("Shadow_Instanced");
+  RenderState* state = RenderState::Instance();
+  state->BindVertexArray(vertex_array_.Get());
+  state->DrawElementsInstanced(
+          box_.n_elements,
+          instances_.size(),
+          box_.first_element);
+}
+
+//! Internal function uploading the added boxes to the instance buffer.
+/*!
+  \return False if there is nothing to draw.
+*/
+bool InstancedRenderer::UploadInstances() {
+  if (instances_.empty())
+    return false;
+  if (vertex_array_.Get() == GL_FALSE)
+    SetupBuffers();
+
+  // Orphan the buffer so the upload does not wait for the last frame
+  int n = instances_.size();
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_.Get());
+  if (n > instance_buffer_capacity_)
+    instance_buffer_capacity_ = std::max(n, 2 * instance_buffer_capacity_);
+  glBufferData(
+          GL_ARRAY_BUFFER,
+          sizeof(BoxInstance) * instance_buffer_capacity_,
+          NULL,
+          GL_STREAM_DRAW);
+  glBufferSubData(
+          GL_ARRAY_BUFFER,
+          0,
+          sizeof(BoxInstance) * n,
+          &instances_[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+//! Deallocate all buffer data from the GPU.
+/*!
+  The renderers of the Scene and the ShadowMap live as long as the Scene,
+  so their buffers are kept over simulation restarts and only deleted here.
+*/
+void InstancedRenderer::DeleteBuffers() {
+  if (vertex_array_.Get() == GL_FALSE)
+    return;
+  instance_buffer_.Reset();
+  vertex_array_.Reset();
+  // The name of the deleted vertex array may be reused
+  RenderState::Instance()->Invalidate();
+  instance_buffer_capacity_ = 0;
+}
+
+//! Internal function creating the vertex array and the instance buffer.
+/*!
+  The vertex array reads the shared vertices of the GeometryCache and the
+  instance attributes, which advance once per instance instead of once per
+  vertex. They keep pointing at the instance buffer when its store is
+  replaced.
+*/
+void InstancedRenderer::SetupBuffers() {
+  GeometryCache* geometry = GeometryCache::Instance();
+  box_ = geometry->GetBox();
+  instance_buffer_ = GLBuffer::Create();
+  vertex_array_ = GLVertexArray::Create();
+
+  RenderState::Instance()->BindVertexArray(vertex_array_.Get());
+  geometry->SetupVertexAttributes();
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_.Get());
+  const GLsizei stride = sizeof(BoxInstance);
+  for (int i = 0; i < 4; ++i) {
+    glEnableVertexAttribArray(MODEL_LOCATION + i);
+    glVertexAttribDivisor(MODEL_LOCATION + i, 1);
+    glVertexAttribPointer(
+            MODEL_LOCATION + i,
+            4,
+            GL_FLOAT,
+            GL_FALSE,
+            stride,
+            reinterpret_cast<void*>(i * sizeof(glm::vec4)));
+  }
+  glEnableVertexAttribArray(SCALE_LOCATION);
+  glVertexAttribDivisor(SCALE_LOCATION, 1);
+  glVertexAttribPointer(
+          SCALE_LOCATION,
+          3,
+          GL_FLOAT,
+          GL_FALSE,
+          stride,
+          reinterpret_cast<void*>(sizeof(glm::mat4)));
+  glEnableVertexAttribArray(MATERIAL_LOCATION);
+  glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+  glVertexAttribIPointer(
+          MATERIAL_LOCATION,
+          1,
+          GL_INT,
+          stride,
+          reinterpret_cast<void*>(sizeof(glm::mat4) + sizeof(glm::vec3)));
+  RenderState::Instance()->BindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
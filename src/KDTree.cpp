@@ -0,0 +1,216 @@
+#include "KDTree.h"
+
+// C++
+#include <algorithm>
+
+const int KDTree::BUCKET_SIZE;
+
+//! Constructor
+/*!
+  \param dimension is the number of floats in every point.
+*/
+KDTree::KDTree(int dimension) {
+  dimension_ = dimension;
+}
+
+//! Removes all points.
+void KDTree::Clear() {
+  points_.clear();
+  nodes_.clear();
+}
+
+//! Inserts a point.
+/*!
+  The point is appended to the bucket of the leaf it falls in, which is
+  split if it overflows.
+  \param point is the point to insert, dimension floats. It is copied.
+*/
+void KDTree::Insert(const float* point) {
+  if (nodes_.empty()) {
+    KDNode root;
+    root.split_dim = -1;
+    root.split_value = 0.0f;
+    root.child[0] = root.child[1] = -1;
+    nodes_.push_back(root);
+  }
+
+  int index = Size();
+  points_.insert(points_.end(), point, point + dimension_);
+
+  int node = 0;
+  while (nodes_[node].split_dim >= 0) {
+    const KDNode& n = nodes_[node];
+    node = n.child[point[n.split_dim] >= n.split_value];
+  }
+  std::vector<int>& bucket = nodes_[node].bucket;
+  bucket.push_back(index);
+  // Buckets of identical points can not be split, only retry now and then
+  if (bucket.size() > BUCKET_SIZE && bucket.size() % BUCKET_SIZE == 1)
+    Split(node);
+}
+
+//! Finds the k nearest neighbours of a point.
+/*!
+  \param query is the point to search around, dimension floats.
+  \param k is the number of neighbours to find.
+  \param distances2 is where the squared distances to the neighbours are
+  written, closest first. Must have room for k values.
+  \param indices is where the indices of the neighbours are written. Must
+  have room for k values.
+  \return The number of neighbours found, which is k unless the tree has
+  fewer points.
+*/
+int KDTree::Nearest(
+        const float* query,
+        int k,
+        float* distances2,
+        int* indices) const {
+  if (nodes_.empty() || k <= 0)
+    return 0;
+  Candidates best;
+  best.k = k;
+  best.count = 0;
+  best.distances2 = distances2;
+  best.indices = indices;
+  std::vector<float> offsets(dimension_, 0.0f);
+  Search(0, query, 0.0f, &offsets[0], &best);
+  return best.count;
+}
+
+//! Returns the number of points in the tree.
+int KDTree::Size() const {
+  return points_.size() / dimension_;
+}
+
+//! Returns the number of floats in every point.
+int KDTree::Dimension() const {
+  return dimension_;
+}
+
+//! Returns a point in the tree.
+/*!
+  \param i is the index of the point, in insertion order.
+*/
+const float* KDTree::Point(int i) const {
+  return &points_[i * dimension_];
+}
+
+//! Internal function splitting a leaf at the median of its widest dimension.
+void KDTree::Split(int node) {
+  std::vector<int> bucket;
+  bucket.swap(nodes_[node].bucket);
+
+  int split_dim = 0;
+  float widest = 0.0f;
+  for (int d = 0; d < dimension_; ++d) {
+    float lo = points_[bucket[0] * dimension_ + d];
+    float hi = lo;
+    for (int i = 1; i < bucket.size(); ++i) {
+      const float v = points_[bucket[i] * dimension_ + d];
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+    if (hi - lo > widest) {
+      widest = hi - lo;
+      split_dim = d;
+    }
+  }
+  if (widest <= 0.0f) { // All points are identical
+    nodes_[node].bucket.swap(bucket);
+    return;
+  }
+
+  std::vector<float> values(bucket.size());
+  for (int i = 0; i < bucket.size(); ++i)
+    values[i] = points_[bucket[i] * dimension_ + split_dim];
+  std::nth_element(values.begin(), values.begin() + values.size() / 2,
+          values.end());
+  float split_value = values[values.size() / 2];
+  // Many values equal to the smallest one would leave the left side empty
+  const float min_value = *std::min_element(values.begin(), values.end());
+  if (split_value <= min_value) {
+    float next = split_value;
+    for (int i = 0; i < values.size(); ++i) {
+      if (values[i] > min_value && (next <= min_value || values[i] < next))
+        next = values[i];
+    }
+    split_value = next;
+  }
+
+  KDNode leaf;
+  leaf.split_dim = -1;
+  leaf.split_value = 0.0f;
+  leaf.child[0] = leaf.child[1] = -1;
+  int children[2] = {static_cast<int>(nodes_.size()),
+          static_cast<int>(nodes_.size()) + 1};
+  nodes_.push_back(leaf);
+  nodes_.push_back(leaf);
+  for (int i = 0; i < bucket.size(); ++i) {
+    const bool right =
+            points_[bucket[i] * dimension_ + split_dim] >= split_value;
+    nodes_[children[right]].bucket.push_back(bucket[i]);
+  }
+
+  KDNode& n = nodes_[node];
+  n.split_dim = split_dim;
+  n.split_value = split_value;
+  n.child[0] = children[0];
+  n.child[1] = children[1];
+}
+
+//! Internal recursive search, the near side first.
+/*!
+  The far side of a split is only searched if its cell is closer than the
+  worst of the k candidates found so far. The squared distance to the cell
+  is updated incrementally from the offsets to the cell in every dimension,
+  which prunes far more than the distance to the splitting plane alone.
+  \param distance2 is the squared distance from the query to the cell of
+  the node.
+  \param offsets are the offsets from the query to the cell of the node in
+  every dimension.
+*/
+void KDTree::Search(
+        int node,
+        const float* query,
+        float distance2,
+        float* offsets,
+        Candidates* best) const {
+  const KDNode& n = nodes_[node];
+  if (n.split_dim < 0) {
+    for (int i = 0; i < n.bucket.size(); ++i) {
+      const float* p = &points_[n.bucket[i] * dimension_];
+      float d2 = 0.0f;
+      for (int d = 0; d < dimension_; ++d) {
+        const float diff = p[d] - query[d];
+        d2 += diff * diff;
+      }
+      if (best->count == best->k && d2 >= best->distances2[best->k - 1])
+        continue;
+      // Insertion in to the sorted candidates
+      int j = best->count < best->k ? best->count++ : best->k - 1;
+      while (j > 0 && best->distances2[j - 1] > d2) {
+        best->distances2[j] = best->distances2[j - 1];
+        best->indices[j] = best->indices[j - 1];
+        j--;
+      }
+      best->distances2[j] = d2;
+      best->indices[j] = n.bucket[i];
+    }
+    return;
+  }
+
+  const int d = n.split_dim;
+  const float diff = query[d] - n.split_value;
+  const int near = diff >= 0.0f;
+  Search(n.child[near], query, distance2, offsets, best);
+
+  const float old_offset = offsets[d];
+  const float far_distance2 =
+          distance2 - old_offset * old_offset + diff * diff;
+  if (best->count < best->k ||
+          far_distance2 < best->distances2[best->k - 1]) {
+    offsets[d] = diff;
+    Search(n.child[1 - near], query, far_distance2, offsets, best);
+    offsets[d] = old_offset;
+  }
+}
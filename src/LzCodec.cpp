@@ -0,0 +1,146 @@
+#include "LzCodec.h"
+
+// C++
+#include <cstring>
+#include <stdint.h>
+
+const int LzCodec::MIN_MATCH;
+const int LzCodec::MAX_OFFSET;
+const int LzCodec::HASH_BITS;
+
+//! Internal function reading four unaligned bytes.
+static uint32_t Read32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+//! Internal function writing the bytes of a length that did not fit.
+static void WriteLength(int length, std::vector<char>* out) {
+  while (length >= 255) {
+    out->push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out->push_back(static_cast<char>(length));
+}
+
+//! Internal function writing one sequence.
+/*!
+  A match_length of 0 writes the last sequence without a match.
+*/
+static void WriteSequence(
+        const char* literals,
+        int n_literals,
+        int offset,
+        int match_length,
+        std::vector<char>* out) {
+  int match_code = match_length > 0 ? match_length - LzCodec::MIN_MATCH : 0;
+  int token = (n_literals < 15 ? n_literals : 15) << 4 |
+      (match_code < 15 ? match_code : 15);
+  out->push_back(static_cast<char>(token));
+  if (n_literals >= 15)
+    WriteLength(n_literals - 15, out);
+  out->insert(out->end(), literals, literals + n_literals);
+  if (match_length == 0)
+    return;
+  out->push_back(static_cast<char>(offset & 0xff));
+  out->push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15)
+    WriteLength(match_code - 15, out);
+}
+
+//! Compresses a buffer.
+/*!
+  \param in is the data to compress.
+  \param n is the number of bytes in the data.
+  \param out is where the compressed data is written, it is replaced.
+*/
+void LzCodec::Compress(const char* in, int n, std::vector<char>* out) {
+  out->clear();
+  out->reserve(n + n / 255 + 16);
+  std::vector<int> table(1 << HASH_BITS, -1);
+
+  int anchor = 0;
+  int i = 0;
+  while (i <= n - MIN_MATCH) {
+    uint32_t prefix = Read32(in + i);
+    uint32_t hash = (prefix * 2654435761u) >> (32 - HASH_BITS);
+    int candidate = table[hash];
+    table[hash] = i;
+    if (candidate < 0 || i - candidate > MAX_OFFSET ||
+        Read32(in + candidate) != prefix) {
+      ++i;
+      continue;
+    }
+    int length = MIN_MATCH;
+    while (i + length < n && in[candidate + length] == in[i + length])
+      ++length;
+    WriteSequence(in + anchor, i - anchor, i - candidate, length, out);
+    i += length;
+    anchor = i;
+  }
+  WriteSequence(in + anchor, n - anchor, 0, 0, out);
+}
+
+//! Decompresses a buffer written by Compress.
+/*!
+  \param in is the compressed data.
+  \param n is the number of bytes in the compressed data.
+  \param raw_size is the number of bytes before compression.
+  \param out is where the data is written, it is resized to raw_size.
+  \return False if the data is corrupt.
+*/
+bool LzCodec::Decompress(
+        const char* in,
+        int n,
+        int raw_size,
+        std::vector<char>* out) {
+  out->resize(raw_size);
+  char* dst = out->empty() ? NULL : &(*out)[0];
+  const unsigned char* src = reinterpret_cast<const unsigned char*>(in);
+  int ip = 0;
+  int op = 0;
+  while (ip < n) {
+    int token = src[ip++];
+
+    int n_literals = token >> 4;
+    if (n_literals == 15) {
+      int b;
+      do {
+        if (ip >= n)
+          return false;
+        b = src[ip++];
+        n_literals += b;
+      } while (b == 255);
+    }
+    if (n_literals > n - ip || n_literals > raw_size - op)
+      return false;
+    std::memcpy(dst + op, src + ip, n_literals);
+    ip += n_literals;
+    op += n_literals;
+    if (ip == n)
+      break; // The last sequence has no match
+
+    if (ip + 2 > n)
+      return false;
+    int offset = src[ip] | src[ip + 1] << 8;
+    ip += 2;
+    int length = token & 15;
+    if (length == 15) {
+      int b;
+      do {
+        if (ip >= n)
+          return false;
+        b = src[ip++];
+        length += b;
+      } while (b == 255);
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > op || length > raw_size - op)
+      return false;
+    // Byte by byte, the match may overlap what it writes
+    for (int k = 0; k < length; ++k, ++op)
+      dst[op] = dst[op - offset];
+  }
+  return op == raw_size;
+}
@@ -1,13 +1,39 @@
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDesktopWidget>
+#include <QGuiApplication>
+#include <QThreadPool>
+
+#include <cstdlib>
+#include <string>
 
 #include "SettingsManager.h"
 
 #include "MainCEWindow.h"
+#include "EvolutionManager.h"
+#include "OffscreenRenderer.h"
+#include "PhysicsThread.h"
+#include "SweepRunner.h"
+
 
+//! Prints the options of the program.
+static void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--option value]..." << std::endl <<
+        "  --config file       settings to start from, also for the GUI" << std::endl <<
+        "  --run file          runs one job of a sweep without GUI" << std::endl <<
+        "  --result file       where --run writes the best fitness per generation" << std::endl <<
+        "  --sweep file        runs a sweep without GUI" << std::endl <<
+        "  --output directory  where --sweep writes its files" << std::endl <<
+        "  --parallel n        jobs of a sweep run at the same time" << std::endl <<
+        "  --threads n         threads of the thread pool" << std::endl <<
+        "  --render output     renders without a window" << std::endl <<
+        "  --creatures file    MAP-Elites checkpoint with the creatures to render" << std::endl <<
+        "  --trajectory file   recorded run --render plays back instead" << std::endl <<
+        "  --count n           number of creatures --render shows" << std::endl <<
+        "  --frames n          number of frames --render writes" << std::endl;
+}
 
 int main(int argc, char **argv) {
-    QApplication app(argc, argv);
 /*
     SettingsManager::Instance()->SetMaxGenerations(10);
     SettingsManager::Instance()->SetPopulationSize(10);
@@ -29,7 +55,88 @@ int main(int argc, char **argv) {
     SettingsManager::Instance()->SetCreatureType(CreatureType::PONY);
     SettingsManager::Instance()->SetMainBodyDimension(Vec3(0.1,0.1,0.2));
     qRegisterMetaType<Creature>();
-    
+    qRegisterMetaType<Population>("Population");
+
+    // The options are listed by PrintUsage
+    std::string config, run, result, sweep, output = "sweep";
+    std::string render, creatures, trajectory;
+    int parallel = 0;
+    int threads = 0;
+    int count = 1;
+    int frames = 0;
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        // Every option takes a value, a missing one would shift the others
+        if (i + 1 == argc || std::string(argv[i + 1]).compare(0, 2, "--") == 0) {
+            std::cout << "ERROR: option " << flag << " needs a value!" << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        if (flag == "--config") config = argv[i + 1];
+        else if (flag == "--run") run = argv[i + 1];
+        else if (flag == "--result") result = argv[i + 1];
+        else if (flag == "--sweep") sweep = argv[i + 1];
+        else if (flag == "--output") output = argv[i + 1];
+        else if (flag == "--parallel") parallel = std::atoi(argv[i + 1]);
+        else if (flag == "--threads") threads = std::atoi(argv[i + 1]);
+        else if (flag == "--render") render = argv[i + 1];
+        else if (flag == "--creatures") creatures = argv[i + 1];
+        else if (flag == "--trajectory") trajectory = argv[i + 1];
+        else if (flag == "--count") count = std::atoi(argv[i + 1]);
+        else if (flag == "--frames") frames = std::atoi(argv[i + 1]);
+        else {
+            std::cout << "ERROR: unknown option " << flag << "!" << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!config.empty() && !SettingsManager::Instance()->LoadConfig(config))
+        std::cout << "WARNING: could not load " << config << "!" << std::endl;
+
+    if (!run.empty() || !sweep.empty()) {
+        QCoreApplication app(argc, argv);
+        if (threads > 0)
+            QThreadPool::globalInstance()->setMaxThreadCount(threads);
+        if (!run.empty())
+            return SweepRunner::RunJob(run, result.empty() ? run + ".csv" : result) ? 0 : 1;
+        SweepRunner runner;
+        if (!runner.Load(sweep))
+            return 1;
+        runner.Expand();
+        std::cout << "Sweep of " << runner.GetJobs().size() << " jobs" << std::endl;
+        return runner.Run(
+            QCoreApplication::applicationFilePath().toStdString(),
+            output, parallel) ? 0 : 1;
+    }
+
+    if (!render.empty()) {
+#ifdef OFFSCREEN_EGL
+        // The EGL context needs no platform plugin, so no display either
+        QCoreApplication app(argc, argv);
+#else
+        QGuiApplication app(argc, argv);
+#endif
+        // The context needs to be current before any Creature is built
+        OffscreenRenderer renderer;
+        if (!renderer.Init(
+                SettingsManager::Instance()->GetFrameWidth(),
+                SettingsManager::Instance()->GetFrameHeight()))
+            return 1;
+        std::vector<Creature> shown;
+        bool loaded = trajectory.empty() ?
+            OffscreenRenderer::LoadCreatures(creatures, count, &shown) :
+            OffscreenRenderer::LoadTrajectories(trajectory, count, &shown);
+        if (!loaded)
+            return 1;
+        if (frames <= 0)
+            frames = SettingsManager::Instance()->GetSimulationTime() *
+                PhysicsThread::TICKS_PER_SECOND;
+        return renderer.Render(shown, frames, render) ? 0 : 1;
+    }
+
+    QApplication app(argc, argv);
+    if (threads > 0)
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
     MainCEWindow window;
 
     window.resize(window.sizeHint());
@@ -2,6 +2,7 @@
 #include "MainCEWindow.h"
 #include "EvolutionManager.h"
 #include "Scene.h"
+#include "MapElites.h"
 
 #include <QtWidgets/QDockWidget>
 #include <QtWidgets/QLabel>
@@ -90,6 +91,8 @@ MainCEWindow::MainCEWindow()
     connect(pauseButton, SIGNAL(clicked()), EM_, SLOT(RequestPauseNow()));
 
     connect(EM_, SIGNAL(NewCreature(const Creature &)), this, SLOT(GotNewCreature(const Creature &)));
+    connect(EM_, SIGNAL(NewParetoFront(const Population &)), this, SLOT(GotParetoFront(const Population &)));
+    connect(EM_, SIGNAL(NewEliteGrid(const Population &)), this, SLOT(GotEliteGrid(const Population &)));
 
     connect(&evolution_thread_starter_, SIGNAL(finished()), this, SLOT(evoDone()));
 
@@ -290,6 +293,40 @@ void MainCEWindow::GotNewCreature(const Creature &new_creature) {
     statusBar()->showMessage(tr(message.toStdString().c_str()));
 }
 
+//! Adds all creatures on the Pareto front of a generation to the creature list
+void MainCEWindow::GotParetoFront(const Population &front) {
+    std::cout << "Got Pareto front! Size: " << front.size() << std::endl;
+    creature_count_++;
+    for (int i = 0; i < front.size(); ++i) {
+        creatures_.push_back(front[i]);
+        creature_list->addItem(QString("%1: %2").arg(creature_count_).arg(i + 1));
+    }
+    int max = SettingsManager::Instance()->GetMaxGenerations();
+    QString message = QString("Simulation in progress...   Generation %1 / %2").arg(creature_count_).arg(max);
+    statusBar()->showMessage(tr(message.toStdString().c_str()));
+}
+
+//! Replaces the creature list with all elites of the MAP-Elites grid
+/*!
+  Every elite is listed with the coordinates of its cell, maximum height,
+  deviation along x and energy waste.
+*/
+void MainCEWindow::GotEliteGrid(const Population &elites) {
+    int bins = SettingsManager::Instance()->GetMapElitesBins();
+    creature_count_++;
+    creatures_ = elites;
+    creature_list->clear();
+    for (int i = 0; i < elites.size(); ++i) {
+        int coords[MapElites::N_FEATURES];
+        MapElites::CellIndex(elites[i].simdata, bins, coords);
+        creature_list->addItem(QString("(%1, %2, %3): %4").arg(coords[0])
+            .arg(coords[1]).arg(coords[2]).arg(elites[i].GetFitness()));
+    }
+    int max = SettingsManager::Instance()->GetMaxGenerations();
+    QString message = QString("MAP-Elites in progress...   Batch %1 / %2, %3 elites").arg(creature_count_).arg(max).arg(elites.size());
+    statusBar()->showMessage(tr(message.toStdString().c_str()));
+}
+
 void MainCEWindow::CreateActions() {
     exitAct = new QAction(tr("&Quit"), this);
     exitAct->setStatusTip(tr("Quit CreatureEvolution"));
@@ -347,6 +384,20 @@ void MainCEWindow::CreateDockWindows() {
     creature_layout->addWidget(c_label);
     creature_layout->addWidget(c_list);
 
+    QHBoxLayout* evolution_mode_layout = new QHBoxLayout;
+    QLabel* em_label = new QLabel("Evolution mode");
+    QComboBox* em_list = new QComboBox();
+    em_list->addItem("Generational");
+    em_list->addItem("MAP-Elites");
+    em_list->addItem("OpenAI-ES");
+    em_list->addItem("Steady state");
+    em_list->setCurrentIndex(SettingsManager::Instance()->GetEvolutionMode());
+    evolution_mode_layout->addWidget(em_label);
+    evolution_mode_layout->addWidget(em_list);
+
+    connect (em_list, SIGNAL (activated (int)), this,
+         SLOT (ChangeEvolutionMode (int)));
+
     connect (c_list, SIGNAL (activated (int)), this,
          SLOT (ChangeCreatureType (int)));
 
@@ -375,6 +426,7 @@ void MainCEWindow::CreateDockWindows() {
     sim_time_layout->addWidget(sim_time_edit);
 
     dockedwidgets->addLayout(creature_layout);
+    dockedwidgets->addLayout(evolution_mode_layout);
     dockedwidgets->addLayout(generation_layout);
     dockedwidgets->addLayout(population_layout);
     dockedwidgets->addLayout(sim_time_layout);
@@ -394,6 +446,20 @@ void MainCEWindow::CreateDockWindows() {
     QVBoxLayout* dockedwidgets_fitness = new QVBoxLayout;
     QWidget* multiple_widgets_fitness = new QWidget;
 
+    QHBoxLayout* fitness_mode_layout = new QHBoxLayout;
+    QLabel* fm_label = new QLabel("Fitness mode");
+    QComboBox* fm_list = new QComboBox();
+    fm_list->addItem("Weighted sum");
+    fm_list->addItem("Pareto (NSGA-II)");
+    fm_list->addItem("Novelty search");
+    fm_list->setCurrentIndex(SettingsManager::Instance()->GetFitnessMode());
+    fitness_mode_layout->addWidget(fm_label);
+    fitness_mode_layout->addWidget(fm_list);
+
+    connect (fm_list, SIGNAL (activated (int)), this,
+         SLOT (ChangeFitnessMode (int)));
+
+    dockedwidgets_fitness->addLayout(fitness_mode_layout);
     dockedwidgets_fitness->addWidget(f_dist_light_slider);
     dockedwidgets_fitness->addWidget(f_max_y_slider);
     dockedwidgets_fitness->addWidget(f_accum_y_slider);
@@ -412,3 +478,19 @@ void MainCEWindow::ChangeCreatureType(int type) {
     std::cout << "Creature type: " << type << std::endl;
     SettingsManager::Instance()->SetCreatureType(type);
 }
+
+//! In Pareto mode the fitness sliders only choose the objectives and their
+// direction, the creature list then shows the Pareto front of every generation
+void MainCEWindow::ChangeFitnessMode(int mode) {
+    std::cout << "Fitness mode: " << mode << std::endl;
+    SettingsManager::Instance()->SetFitnessMode(mode);
+}
+
+//! In MAP-Elites mode the generations are batches of mutants and the
+// creature list shows all elites of the grid. In ES mode every generation
+// adds the mean creature of the evolution strategy. In steady state mode
+// every new best creature is added
+void MainCEWindow::ChangeEvolutionMode(int mode) {
+    std::cout << "Evolution mode: " << mode << std::endl;
+    SettingsManager::Instance()->SetEvolutionMode(mode);
+}
@@ -0,0 +1,290 @@
+#include "MapElites.h"
+#include "SettingsManager.h"
+#include "Simulation.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+// External
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrent>
+
+const int MapElites::N_FEATURES;
+const int MapElites::MAX_BINS;
+const int MapElites::N_SHARDS;
+const int MapElites::EVALUATION_BATCH_SIZE;
+// Maximum height, deviation along x and log(1 + energy waste)
+const float MapElites::FEATURE_MIN[MapElites::N_FEATURES] = {0.0f, 0.0f, 0.0f};
+const float MapElites::FEATURE_MAX[MapElites::N_FEATURES] = {3.0f, 10.0f, 10.0f};
+
+static const char CHECKPOINT_MAGIC[4] = {'C', 'E', 'M', 'E'};
+static const int CHECKPOINT_VERSION = 2;
+
+//! Constructor, creates an empty grid.
+MapElites::MapElites() {
+  bins_ = 0;
+  n_filled_ = 0;
+  light_position_ = btVector3(0, 5, 0);
+  for (int i = 0; i < 7; ++i)
+    weights_[i] = 0.0f;
+}
+
+//! Removes all elites, sets the size of the grid and picks a light position.
+/*!
+  \param bins is the number of cells along every feature, at most MAX_BINS.
+*/
+void MapElites::Reset(int bins) {
+  bins_ = std::max(1, std::min(MAX_BINS, bins));
+  int n_cells = bins_ * bins_ * bins_;
+  cells_ = std::vector<Creature>(n_cells);
+  occupied_.assign(n_cells, 0);
+  n_filled_ = 0;
+  // Same range as the random light position of the Simulation
+  light_position_ = btVector3(
+          rng_.UniformInt(41) - 20, 5, rng_.UniformInt(41) - 20);
+}
+
+//! Evaluates creatures and inserts them in to the grid.
+/*!
+  Used for the initial random creatures, evaluated on the thread pool like
+  any other batch.
+  \param creatures are the creatures to insert.
+  \param settings are the settings of the batch.
+*/
+void MapElites::Seed(const Population& creatures, const SettingsSnapshot& settings) {
+  candidates_ = creatures;
+  Evaluate(settings);
+}
+
+//! Evaluates one batch of mutants.
+/*!
+  Every mutant is a copy of a random elite which is then mutated. The batch
+  is split in to parts of EVALUATION_BATCH_SIZE creatures, which are
+  simulated and inserted in parallel on the global thread pool.
+  \param batch_size is the number of mutants to evaluate.
+  \param settings are the settings of the batch.
+*/
+void MapElites::Step(int batch_size, const SettingsSnapshot& settings) {
+  std::vector<int> filled;
+  for (int i = 0; i < occupied_.size(); ++i) {
+    if (occupied_[i])
+      filled.push_back(i);
+  }
+  if (filled.empty())
+    return;
+
+  candidates_.resize(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    candidates_[i] = cells_[filled[rng_.UniformInt(filled.size())]];
+    candidates_[i].Mutate(settings, rng_);
+  }
+  Evaluate(settings);
+}
+
+//! Returns copies of all elites in the grid, in cell order.
+Population MapElites::GetElites() {
+  Population elites;
+  for (int i = 0; i < cells_.size(); ++i) {
+    QMutexLocker locker(&shard_mutexes_[i % N_SHARDS]);
+    if (occupied_[i])
+      elites.push_back(cells_[i]);
+  }
+  return elites;
+}
+
+//! Returns the number of cells that have an elite.
+int MapElites::GetFilledCells() const {
+  return n_filled_;
+}
+
+//! Returns the total number of cells in the grid.
+int MapElites::GetNumberOfCells() const {
+  return cells_.size();
+}
+
+//! Writes all elites to a checkpoint file.
+/*!
+  The file starts with a header with the creature type and the size of the
+  grid and the light position, followed by the cell index and the creature
+  of every elite.
+  \param path is the file to write.
+  \return False if the file could not be written.
+*/
+bool MapElites::Save(const std::string& path) {
+  std::ofstream out(path.c_str(), std::ios::binary);
+  if (!out)
+    return false;
+  int header[4] = {
+          CHECKPOINT_VERSION,
+          SettingsManager::Instance()->GetCreatureType(),
+          bins_,
+          n_filled_};
+  out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  float light[3] = {
+          light_position_.getX(),
+          light_position_.getY(),
+          light_position_.getZ()};
+  out.write(reinterpret_cast<const char*>(light), sizeof(light));
+  for (int i = 0; i < cells_.size(); ++i) {
+    QMutexLocker locker(&shard_mutexes_[i % N_SHARDS]);
+    if (!occupied_[i])
+      continue;
+    out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+    cells_[i].Write(out);
+  }
+  return out.good();
+}
+
+//! Replaces the grid with the elites of a checkpoint file.
+/*!
+  The checkpoint must be for the current creature type. The grid is left
+  unchanged if the file can not be read, or if its size, number of elites
+  or cell indices are out of range or a cell is repeated.
+  \param path is the file to read.
+  \return False if the file could not be read.
+*/
+bool MapElites::Load(const std::string& path) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  char magic[4];
+  int header[4];
+  float light[3];
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+      !in.read(reinterpret_cast<char*>(header), sizeof(header)))
+    return false;
+  if (header[0] != CHECKPOINT_VERSION ||
+      header[1] != SettingsManager::Instance()->GetCreatureType()) {
+    std::cout << "WARNING: checkpoint " << path <<
+      " is for another creature type or version!" << std::endl;
+    return false;
+  }
+  int bins = header[2];
+  if (bins <= 0 || bins > MAX_BINS ||
+      header[3] < 0 || header[3] > bins * bins * bins) {
+    std::cout << "WARNING: checkpoint " << path << " is corrupt!" << std::endl;
+    return false;
+  }
+  if (!in.read(reinterpret_cast<char*>(light), sizeof(light)))
+    return false;
+
+  int n_cells = bins * bins * bins;
+  std::vector<Creature> cells(n_cells);
+  std::vector<char> occupied(n_cells, 0);
+  for (int i = 0; i < header[3]; ++i) {
+    int cell;
+    if (!in.read(reinterpret_cast<char*>(&cell), sizeof(cell)) ||
+        cell < 0 || cell >= n_cells || occupied[cell] ||
+        !cells[cell].Read(in))
+      return false;
+    occupied[cell] = 1;
+  }
+
+  bins_ = bins;
+  cells_.swap(cells);
+  occupied_.swap(occupied);
+  n_filled_ = header[3];
+  light_position_ = btVector3(light[0], light[1], light[2]);
+  return true;
+}
+
+//! Calculates the behavior features of a creature.
+/*!
+  \param data is the simulation data of the creature.
+  \param features is where the N_FEATURES features are written.
+*/
+void MapElites::Features(const SimData& data, float* features) {
+  features[0] = data.max_y;
+  features[1] = data.deviation_x;
+  features[2] = std::log(1.0f + std::max(0.0f, data.energy_waste));
+}
+
+//! Finds the cell of a creature.
+/*!
+  Features outside of FEATURE_MIN and FEATURE_MAX are put in the border
+  cells.
+  \param data is the simulation data of the creature.
+  \param bins is the number of cells along every feature.
+  \param coords is where the cell coordinate along every feature is
+  written, may be NULL.
+  \return The index of the cell.
+*/
+int MapElites::CellIndex(const SimData& data, int bins, int* coords) {
+  float features[N_FEATURES];
+  Features(data, features);
+  int index = 0;
+  for (int k = N_FEATURES - 1; k >= 0; --k) {
+    float t = (features[k] - FEATURE_MIN[k]) / (FEATURE_MAX[k] - FEATURE_MIN[k]);
+    int c = std::max(0, std::min(bins - 1, static_cast<int>(t * bins)));
+    if (coords)
+      coords[k] = c;
+    index = index * bins + c;
+  }
+  return index;
+}
+
+//! Internal function simulating and inserting all candidates.
+/*!
+  All Simulations use the light position of the run, and the fitness
+  weights and the simulation time are read once from the settings, so the
+  quality of all candidates is comparable.
+  \param settings are the settings of the batch.
+*/
+void MapElites::Evaluate(const SettingsSnapshot& settings) {
+  std::copy(settings.fitness_weights, settings.fitness_weights + 7, weights_);
+
+  int n = candidates_.size();
+  std::vector<EvaluationBatch> batches;
+  for (int begin = 0; begin < n; begin += EVALUATION_BATCH_SIZE) {
+    EvaluationBatch batch;
+    batch.begin = begin;
+    batch.end = std::min(n, begin + EVALUATION_BATCH_SIZE);
+    batch.settings = &settings;
+    batches.push_back(batch);
+  }
+  QtConcurrent::blockingMap(batches, EvaluateFunctor(this));
+}
+
+//! Internal function simulating a part of the batch and inserting it.
+void MapElites::EvaluateBatch(const EvaluationBatch& batch) {
+  Population creatures(candidates_.begin() + batch.begin,
+          candidates_.begin() + batch.end);
+  {
+    Simulation sim_world(*batch.settings);
+    sim_world.SetLightPosition(light_position_);
+    sim_world.AddPopulation(creatures, false);
+    sim_world.SimulatePopulation(&creatures);
+  }
+  for (int i = 0; i < creatures.size(); ++i) {
+    creatures[i].SetFitness(Quality(creatures[i].simdata));
+    TryInsert(creatures[i]);
+  }
+}
+
+//! Internal function inserting a creature if it beats the elite of its cell.
+/*!
+  The compare and replace is done under the lock of the shard of the cell.
+  \return True if the creature was inserted.
+*/
+bool MapElites::TryInsert(const Creature& creature) {
+  int cell = CellIndex(creature.simdata, bins_, NULL);
+  QMutexLocker locker(&shard_mutexes_[cell % N_SHARDS]);
+  if (occupied_[cell] && cells_[cell].GetFitness() >= creature.GetFitness())
+    return false;
+  if (!occupied_[cell])
+    n_filled_++;
+  cells_[cell] = creature;
+  occupied_[cell] = 1;
+  return true;
+}
+
+//! Internal function calculating the quality of a creature.
+/*!
+  The weighted sum of the simulation data without normalization, so the
+  quality of creatures from different batches can be compared.
+*/
+float MapElites::Quality(const SimData& data) const {
+  return data.WeightedSum(weights_);
+}
@@ -0,0 +1,107 @@
+#include "MaterialManager.h"
+#include "ShaderManager.h"
+
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+
+MaterialManager* MaterialManager::instance_ = NULL;
+const int MaterialManager::MAX_MATERIALS;
+
+//! A part of the singleton pattern
+/*!
+ If this function is called for the first time, the constructor is called and
+ the singleton is created. Does not need an OpenGL context until Update.
+ \return The one instance of the MaterialManager
+ */
+MaterialManager* MaterialManager::Instance() {
+  if (!instance_)
+    instance_ = new MaterialManager();
+  return instance_;
+}
+
+//! Constructor. The table is empty.
+MaterialManager::MaterialManager() {
+  changed_ = false;
+  n_loaded_textures_ = 0;
+}
+
+//! Returns the index of a Material in the table, adding it if it is new.
+/*!
+  Meant to be called once for every Shape or Node, not every frame. The
+  table only has a few Materials so they are searched linearly. When the
+  table is full, index 0 is returned.
+  \param material is the Material.
+  \return The index of the Material.
+*/
+int MaterialManager::GetMaterialIndex(const Material& material) {
+  for (int i = 0; i < materials_.size(); ++i) {
+    const Material& other = materials_[i];
+    if (other.reflectance == material.reflectance &&
+        other.specularity == material.specularity &&
+        other.shinyness == material.shinyness &&
+        other.texture_diffuse_type == material.texture_diffuse_type &&
+        other.GetDiffuseTextureLayer() == material.GetDiffuseTextureLayer())
+      return i;
+  }
+  if (materials_.size() == MAX_MATERIALS) {
+    std::cout << "WARNING: More than " << MAX_MATERIALS <<
+        " materials, using the first one instead!" << std::endl;
+    return 0;
+  }
+  materials_.push_back(material);
+  changed_ = true;
+  return materials_.size() - 1;
+}
+
+//! Uploads the table if it changed. Called once per frame before rendering.
+/*!
+  Every Material is two vec4s, the reflectance, specularity, shinyness and
+  texture type, then the layer of the texture in x. The buffer has room for
+  MAX_MATERIALS so it is never bound smaller than the block.
+*/
+void MaterialManager::Update() {
+  TextureManager* textures = TextureManager::Instance();
+  if (material_buffer_.Get() == GL_FALSE) {
+    material_buffer_ = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, material_buffer_.Get());
+    glBufferData(
+            GL_UNIFORM_BUFFER,
+            2 * sizeof(glm::vec4) * MAX_MATERIALS,
+            NULL,
+            GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(
+            GL_UNIFORM_BUFFER,
+            ShaderManager::MATERIAL_DATA_BINDING,
+            material_buffer_.Get());
+    changed_ = true;
+  }
+  if (!changed_ && n_loaded_textures_ == textures->GetNumberOfLoadedTextures())
+    return;
+  changed_ = false;
+  n_loaded_textures_ = textures->GetNumberOfLoadedTextures();
+  if (materials_.empty())
+    return;
+
+  std::vector<glm::vec4> data(2 * materials_.size());
+  for (int i = 0; i < materials_.size(); ++i) {
+    const Material& material = materials_[i];
+    int layer = material.GetDiffuseTextureLayer();
+    data[2 * i] = glm::vec4(
+        material.reflectance,
+        material.specularity,
+        material.shinyness,
+        material.texture_diffuse_type);
+    data[2 * i + 1] = glm::vec4(
+        textures->IsTextureLoaded(layer) ? layer : -1.0f, 0.0f, 0.0f, 0.0f);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, material_buffer_.Get());
+  glBufferSubData(
+          GL_UNIFORM_BUFFER,
+          0,
+          sizeof(glm::vec4) * data.size(),
+          &data[0]);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,184 @@
+#include "MultiObjective.h"
+
+// C++
+#include <algorithm>
+#include <limits>
+
+//! Internal lexicographic comparison of individuals, larger first.
+struct ObjectivesLargerThan {
+  ObjectivesLargerThan(const std::vector<float>& objectives, int n_objectives)
+      : objectives_(objectives), n_objectives_(n_objectives) {}
+  bool operator()(int i1, int i2) const {
+    const float* a = &objectives_[i1 * n_objectives_];
+    const float* b = &objectives_[i2 * n_objectives_];
+    for (int k = 0; k < n_objectives_; ++k) {
+      if (a[k] != b[k])
+        return a[k] > b[k];
+    }
+    return false;
+  }
+  const std::vector<float>& objectives_;
+  int n_objectives_;
+};
+
+//! Internal comparison of individuals by a single objective, smaller first.
+struct ObjectiveSmallerThan {
+  ObjectiveSmallerThan(
+          const std::vector<float>& objectives, int n_objectives, int k)
+      : objectives_(objectives), n_objectives_(n_objectives), k_(k) {}
+  bool operator()(int i1, int i2) const {
+    return objectives_[i1 * n_objectives_ + k_] <
+        objectives_[i2 * n_objectives_ + k_];
+  }
+  const std::vector<float>& objectives_;
+  int n_objectives_;
+  int k_;
+};
+
+//! Checks if an individual dominates another.
+/*!
+  \return True if a is at least as good as b in all objectives and better
+  in at least one.
+*/
+bool MultiObjective::Dominates(const float* a, const float* b, int n_objectives) {
+  bool all_not_worse = true;
+  bool any_better = false;
+  for (int k = 0; k < n_objectives; ++k) {
+    all_not_worse &= a[k] >= b[k];
+    any_better |= a[k] > b[k];
+  }
+  return all_not_worse && any_better;
+}
+
+//! Sorts a population in to non-dominated fronts.
+/*!
+  Efficient non-dominated sort with binary search (ENS-BS) by Zhang et al.
+  The individuals are first sorted lexicographically, which puts every
+  individual after all individuals dominating it. Each individual is then
+  placed in the first front that does not dominate it. An individual
+  dominated by front k + 1 is also dominated by front k, so the front is
+  found by binary search. Only individuals already placed are compared
+  against, which in practice is far fewer comparisons than the O(MN^2) of
+  the fast non-dominated sort of the original NSGA-II, and never more.
+  \param objectives are the objectives of all individuals, n_objectives per
+  individual. All objectives are maximized.
+  \param n_objectives is the number of objectives.
+  \param front is where the front of every individual is written, 0 is the
+  Pareto front.
+*/
+void MultiObjective::NonDominatedSort(
+        const std::vector<float>& objectives,
+        int n_objectives,
+        std::vector<int>* front) {
+  int n = n_objectives > 0 ? objectives.size() / n_objectives : 0;
+  front->assign(n, 0);
+  if (n == 0)
+    return;
+
+  std::vector<int> order(n);
+  for (int i = 0; i < n; ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(),
+          ObjectivesLargerThan(objectives, n_objectives));
+
+  // The objectives of the members of every front are stored contiguously,
+  // which keeps the scans cache friendly
+  std::vector<std::vector<float> > fronts;
+  for (int i = 0; i < n; ++i) {
+    const int idx = order[i];
+    const float* candidate = &objectives[idx * n_objectives];
+    int lo = 0;
+    int hi = fronts.size();
+    while (lo < hi) {
+      const int mid = (lo + hi) / 2;
+      const std::vector<float>& members = fronts[mid];
+      // The latest added members are the most likely to dominate
+      bool dominated = false;
+      for (int j = members.size() - n_objectives; j >= 0 && !dominated;
+              j -= n_objectives)
+        dominated = Dominates(&members[j], candidate, n_objectives);
+      if (dominated)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == fronts.size())
+      fronts.push_back(std::vector<float>());
+    fronts[lo].insert(fronts[lo].end(), candidate, candidate + n_objectives);
+    (*front)[idx] = lo;
+  }
+}
+
+//! Calculates the crowding distance of every individual within its front.
+/*!
+  For every objective the members of a front are sorted, and the distance
+  between the neighbours of an individual, normalized by the range of the
+  front, is added to its crowding distance. The extremes of every front
+  get an infinite distance so they are always kept.
+  \param objectives are the objectives of all individuals.
+  \param n_objectives is the number of objectives.
+  \param front is the front of every individual from NonDominatedSort.
+  \param crowding is where the crowding distances are written.
+*/
+void MultiObjective::CrowdingDistance(
+        const std::vector<float>& objectives,
+        int n_objectives,
+        const std::vector<int>& front,
+        std::vector<float>* crowding) {
+  const float infinity = std::numeric_limits<float>::infinity();
+  int n = front.size();
+  crowding->assign(n, 0.0f);
+  if (n == 0)
+    return;
+
+  int n_fronts = *std::max_element(front.begin(), front.end()) + 1;
+  std::vector<std::vector<int> > members(n_fronts);
+  for (int i = 0; i < n; ++i)
+    members[front[i]].push_back(i);
+
+  for (int f = 0; f < n_fronts; ++f) {
+    std::vector<int>& m = members[f];
+    const int size = m.size();
+    for (int k = 0; k < n_objectives; ++k) {
+      std::sort(m.begin(), m.end(),
+              ObjectiveSmallerThan(objectives, n_objectives, k));
+      const float min = objectives[m.front() * n_objectives + k];
+      const float max = objectives[m.back() * n_objectives + k];
+      (*crowding)[m.front()] = infinity;
+      (*crowding)[m.back()] = infinity;
+      if (max <= min)
+        continue;
+      const float inv_range = 1.0f / (max - min);
+      for (int j = 1; j + 1 < size; ++j) {
+        const float next = objectives[m[j + 1] * n_objectives + k];
+        const float prev = objectives[m[j - 1] * n_objectives + k];
+        (*crowding)[m[j]] += (next - prev) * inv_range;
+      }
+    }
+  }
+}
+
+//! Combines front and crowding distance in to a single fitness value.
+/*!
+  The fitness is -front + 0.5 * c / (1 + c) for crowding distance c. A
+  better front always gives a larger fitness, and within a front a larger
+  crowding distance does. Comparing these values is the crowded comparison
+  operator of NSGA-II, so the existing selection operators and elitism can
+  be used as they are.
+  \param front is the front of every individual.
+  \param crowding is the crowding distance of every individual.
+  \param fitness is where the fitness values are written.
+*/
+void MultiObjective::ScalarFitness(
+        const std::vector<int>& front,
+        const std::vector<float>& crowding,
+        std::vector<float>* fitness) {
+  const float infinity = std::numeric_limits<float>::infinity();
+  int n = front.size();
+  fitness->resize(n);
+  for (int i = 0; i < n; ++i) {
+    const float c = crowding[i];
+    const float spread = c == infinity ? 0.5f : 0.5f * c / (1.0f + c);
+    (*fitness)[i] = -static_cast<float>(front[i]) + spread;
+  }
+}
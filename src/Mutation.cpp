@@ -0,0 +1,203 @@
+#include "Mutation.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265359
+#endif
+
+const float Mutation::MIN_SIGMA = 0.0001f;
+const float Mutation::MAX_SIGMA = 1.0f;
+
+//! Mutates a genome with the given operator.
+/*!
+  \param type is the mutation operator to use.
+  \param genome is the genome to mutate.
+  \param n is the number of genes in the genome.
+  \param rate is the probability for every gene to be mutated.
+  \param sigma is the strength of the mutation.
+  \param adaptive_sigma is the evolved strength of the genome. Only used by
+  SELF_ADAPTIVE_MUTATION.
+  \param rng is the random number generator to draw from.
+*/
+void Mutation::Apply(
+        MutationType type,
+        float* genome,
+        int n,
+        float rate,
+        float sigma,
+        float* adaptive_sigma,
+        BatchRNG& rng) {
+  switch (type) {
+  case GAUSSIAN_MUTATION:
+    Gaussian(genome, n, rate, sigma, rng);
+    break;
+  case SELF_ADAPTIVE_MUTATION:
+    SelfAdaptive(genome, n, rate, adaptive_sigma, rng);
+    break;
+  case UNIFORM_MUTATION:
+  default:
+    Uniform(genome, n, rate, sigma, rng);
+    break;
+  }
+}
+
+//! Adds a uniform perturbation in [-strength, strength] to mutated genes.
+void Mutation::Uniform(
+        float* genome,
+        int n,
+        float rate,
+        float strength,
+        BatchRNG& rng) {
+  Perturb(genome, n, rate, strength, false, rng);
+}
+
+//! Adds a normal distributed perturbation with deviation sigma.
+void Mutation::Gaussian(
+        float* genome,
+        int n,
+        float rate,
+        float sigma,
+        BatchRNG& rng) {
+  Perturb(genome, n, rate, sigma, true, rng);
+}
+
+//! Self adaptive gaussian mutation.
+/*!
+  The genome carries its own mutation strength which is mutated first with
+  the log-normal rule sigma' = sigma * exp(tau * N(0,1)), tau = 1/sqrt(n).
+  The genes are then mutated with the new sigma. Strengths that give good
+  children survive together with the genome.
+  \param sigma is the strength of the genome, updated in place.
+*/
+void Mutation::SelfAdaptive(
+        float* genome,
+        int n,
+        float rate,
+        float* sigma,
+        BatchRNG& rng) {
+  if (n <= 0)
+    return;
+  float z[2];
+  FillGaussian(z, 2, rng);
+  const float tau = 1.0f / std::sqrt(static_cast<float>(n));
+  *sigma = std::min(MAX_SIGMA,
+          std::max(MIN_SIGMA, *sigma * std::exp(tau * z[0])));
+  Perturb(genome, n, rate, *sigma, true, rng);
+}
+
+//! Fills a buffer with standard normal distributed numbers.
+/*!
+  Uses the Box-Muller transform on blocks of uniform numbers. Every pair of
+  uniforms gives two normal numbers. The loop is branch free.
+  \param out is the buffer to fill.
+  \param n is the number of values to write.
+*/
+void Mutation::FillGaussian(float* out, int n, BatchRNG& rng) {
+  const int half_block = BatchRNG::BLOCK_SIZE / 2;
+  float u[BatchRNG::BLOCK_SIZE];
+  float z[BatchRNG::BLOCK_SIZE];
+  while (n > 0) {
+    const int pairs = std::min(half_block, (n + 1) / 2);
+    rng.FillUniform(u, 2 * pairs);
+    for (int i = 0; i < pairs; ++i) {
+      // 1 - u is in (0, 1] which keeps the logarithm finite
+      const float r = std::sqrt(-2.0f * std::log(1.0f - u[i]));
+      const float theta = 2.0f * static_cast<float>(M_PI) * u[pairs + i];
+      z[i] = r * std::cos(theta);
+      z[pairs + i] = r * std::sin(theta);
+    }
+    const int count = std::min(n, 2 * pairs);
+    std::copy(z, z + count, out);
+    out += count;
+    n -= count;
+  }
+}
+
+//! Internal function perturbing the genes chosen by geometric skipping.
+/*!
+  Indices and perturbations are produced in blocks. The perturbations are
+  then added with a gather/scatter loop over the chosen indices.
+  \param scale is the strength of the uniform perturbation or the sigma of
+  the gaussian.
+  \param gaussian tells if the perturbation is gaussian or uniform.
+*/
+void Mutation::Perturb(
+        float* genome,
+        int n,
+        float rate,
+        float scale,
+        bool gaussian,
+        BatchRNG& rng) {
+  int indices[BatchRNG::BLOCK_SIZE];
+  float delta[BatchRNG::BLOCK_SIZE];
+  int position = -1;
+  while (true) {
+    const int count = NextIndices(
+            indices, BatchRNG::BLOCK_SIZE, &position, n, rate, rng);
+    if (count == 0)
+      break;
+    if (gaussian) {
+      FillGaussian(delta, count, rng);
+      for (int i = 0; i < count; ++i)
+        delta[i] *= scale;
+    } else {
+      rng.FillUniform(delta, count);
+      for (int i = 0; i < count; ++i)
+        delta[i] = (2.0f * delta[i] - 1.0f) * scale;
+    }
+    for (int i = 0; i < count; ++i)
+      genome[indices[i]] += delta[i];
+  }
+}
+
+//! Internal function drawing the next block of mutated gene indices.
+/*!
+  The gap to the next mutated gene is geometric distributed with
+  P(gap = k) = (1 - rate)^k * rate, which is drawn by inversion as
+  floor(log(u) / log(1 - rate)).
+  \param indices is where the indices are written.
+  \param max_count is the maximum number of indices to write.
+  \param position is the last chosen index, -1 before the first call. It is
+  updated to the last index written.
+  \param n is the number of genes in the genome.
+  \param rate is the probability for every gene to be mutated.
+  \return The number of indices written, 0 when the end is reached.
+*/
+int Mutation::NextIndices(
+        int* indices,
+        int max_count,
+        int* position,
+        int n,
+        float rate,
+        BatchRNG& rng) {
+  if (rate <= 0.0f || *position >= n - 1)
+    return 0;
+  if (rate >= 1.0f) { // Every gene is mutated
+    int count = 0;
+    while (count < max_count && *position < n - 1)
+      indices[count++] = ++(*position);
+    return count;
+  }
+
+  float u[BatchRNG::BLOCK_SIZE];
+  const int block = std::min(max_count, BatchRNG::BLOCK_SIZE);
+  rng.FillUniform(u, block);
+  const float inv_log = 1.0f / std::log(1.0f - rate);
+  for (int i = 0; i < block; ++i) {
+    // Clamping before the conversion keeps huge gaps from overflowing
+    u[i] = std::min(static_cast<float>(n),
+            std::floor(std::log(1.0f - u[i]) * inv_log));
+  }
+
+  int count = 0;
+  for (int i = 0; i < block; ++i) {
+    *position += static_cast<int>(u[i]) + 1;
+    if (*position >= n)
+      break;
+    indices[count++] = *position;
+  }
+  return count;
+}
@@ -1,5 +1,5 @@
 #include "Node.h"
-#include "Camera.h"
+#include "MaterialManager.h"
 #include <iostream>
 
 //! Creating a Node from a btRigidBody.
@@ -10,13 +10,18 @@
 */
 Node::Node(btRigidBody* body, Material material) : shape_(material) {
   rigid_body_ = body;
+  instanced_ = false;
+  scale_ = glm::vec3(1.0f);
+  shape_transform_ = glm::mat4(1.0f);
+  material_ = material;
+  material_index_ = MaterialManager::Instance()->GetMaterialIndex(material);
   //init transform
   UpdateNode();
   //init shape
   int shape_type = rigid_body_->getCollisionShape()->getShapeType();
   switch(shape_type) {
   case BOX_SHAPE_PROXYTYPE:
-    InitBoxShape(material);
+    InitBoxShape();
     break;
   case STATIC_PLANE_PROXYTYPE:
     InitPlaneShape(material);
@@ -28,7 +33,6 @@ Node::Node(btRigidBody* body, Material material) : shape_(material) {
     shape_ = Box(material);
     break;
   }
-  shape_.SetupBuffers();
 }
 
 void Node::DebugPrint() {
@@ -63,14 +67,63 @@ glm::vec3 Node::GetPosition() {
     return glm::vec3(x,y,z);
 }
 
-//! Render the Node using the camera specified.
+//! Returns the rigid body the Node is drawn for.
+btRigidBody* Node::GetRigidBody() {
+  return rigid_body_;
+}
+
+//! Tells if the Node is drawn by an InstancedRenderer instead of Render.
+bool Node::IsInstanced() {
+  return instanced_;
+}
+
+glm::mat4 Node::GetTransform() {
+  return transform_;
+}
+
+//! Returns the half extents of an instanced box, or the scale of the plane.
+glm::vec3 Node::GetScale() {
+  return scale_;
+}
+
+Material Node::GetMaterial() {
+  return material_;
+}
+
+//! Returns the index of the Material in the table of the MaterialManager.
+int Node::GetMaterialIndex() {
+  return material_index_;
+}
+
+//! Returns the axis aligned bounding box of the Node where it is drawn.
+/*!
+  The box comes from the collision shape of the rigid body, placed with the
+  transform of the Node and not the one of the rigid body, so it is safe
+  to call while a PhysicsThread steps the body. Planes are infinite.
+  \param min is set to the corner with the smallest coordinates.
+  \param max is set to the corner with the largest coordinates.
+*/
+void Node::GetBoundingBox(glm::vec3* min, glm::vec3* max) {
+  btTransform transform;
+  transform.setFromOpenGLMatrix(glm::value_ptr(transform_));
+  btVector3 aabb_min, aabb_max;
+  rigid_body_->getCollisionShape()->getAabb(transform, aabb_min, aabb_max);
+  *min = glm::vec3(aabb_min.getX(), aabb_min.getY(), aabb_min.getZ());
+  *max = glm::vec3(aabb_max.getX(), aabb_max.getY(), aabb_max.getZ());
+}
+
+//! Render the Node.
 /*!
   In this function; the Shape corresponding to the Node will be rendered with
-  its specific render function.
-  \param camera is the camera used for rendering (believe it or not).
+  its specific render function. The camera is already in the FrameData block.
 */
-void Node::Render(Camera* camera) {
-  shape_.Render(camera, transform_);
+void Node::Render() {
+  shape_.Render(transform_ * shape_transform_, scale_);
+}
+
+//! Render only the depth of the Node, seen from the ShadowMap.
+void Node::RenderDepth() {
+  shape_.RenderDepth(transform_ * shape_transform_);
 }
 
 //! Setting the transform of the Node from the transform of the rigid body associated with it.
@@ -82,22 +135,29 @@ void Node::UpdateNode(){
     transform_ = tmp_matrix;
 }
 
-//! Internal function making the Shape a Box from the dimensions of the rigid body.
-void Node::InitBoxShape(Material material) {
+//! Internal function making the Node an instanced box from the dimensions of the rigid body.
+void Node::InitBoxShape() {
     btBoxShape* boxShape = (btBoxShape*)(rigid_body_->getCollisionShape());
     btVector3 v;
     boxShape->getVertex(0,v);
 
-    shape_ = Box(v.getX(),v.getY(),v.getZ(), material);
+    instanced_ = true;
+    scale_ = glm::vec3(v.getX(),v.getY(),v.getZ());
 }
 
 //! Internal function making the Shape a Plane from the dimensions of the rigid body.
+/*!
+  The unit Plane is scaled and moved along y by the plane constant. Only
+  the translation of the plane equation is implemented.
+*/
 void Node::InitPlaneShape(Material material) {
     btStaticPlaneShape* planeShape = (btStaticPlaneShape*)(rigid_body_->getCollisionShape());
-    btVector3 normal = planeShape->getPlaneNormal();
     float constant = planeShape->getPlaneConstant();
-    glm::vec4 plane_equation = glm::vec4(normal.getX(),normal.getY(),normal.getZ(),constant);
-    shape_ = Plane(glm::vec3(1.0f) * 200.0f, plane_equation, material);
+    shape_ = Plane(material);
+    scale_ = glm::vec3(200.0f);
+    shape_transform_ =
+        glm::translate(glm::vec3(0.0f, constant, 0.0f)) *
+        glm::scale(scale_);
 }
 
 //! Internal function making the Shape a Sphere from the dimensions of the rigid body.
@@ -107,8 +167,3 @@ void Node::InitPlaneShape(Material material) {
 void Node::InitSphereShape(Material material) {
 
 }
-
-//! Deleting the OpenGL-buffers in the Shape.
-void Node::DeleteBuffers() {
-  shape_.DeleteBuffers();
-}
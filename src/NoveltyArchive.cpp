@@ -0,0 +1,86 @@
+#include "NoveltyArchive.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+const int NoveltyArchive::MAX_K;
+
+//! Constructor
+/*!
+  \param dimension is the number of floats in every behavior descriptor.
+*/
+NoveltyArchive::NoveltyArchive(int dimension)
+    : archive_(dimension), population_(dimension) {
+  dimension_ = dimension;
+}
+
+//! Removes all behaviors from the archive and the population.
+void NoveltyArchive::Clear() {
+  archive_.Clear();
+  population_.Clear();
+}
+
+//! Sets the behaviors of the current population.
+/*!
+  \param descriptors are the behavior descriptors of the population,
+  dimension floats per creature.
+*/
+void NoveltyArchive::SetPopulation(const std::vector<float>& descriptors) {
+  population_.Clear();
+  for (int i = 0; i + dimension_ <= descriptors.size(); i += dimension_)
+    population_.Insert(&descriptors[i]);
+}
+
+//! Calculates the novelty of a creature in the current population.
+/*!
+  The k nearest neighbours are searched in both trees and merged. The
+  creature itself is skipped. Can be called concurrently for different
+  creatures.
+  \param i is the index of the creature in the population.
+  \param k is the number of neighbours, at most MAX_K.
+  \return The mean distance to the k nearest neighbours.
+*/
+float NoveltyArchive::Novelty(int i, int k) const {
+  k = std::min(k, MAX_K);
+  const float* query = population_.Point(i);
+
+  float archive_d2[MAX_K];
+  int archive_idx[MAX_K];
+  float population_d2[MAX_K + 1];
+  int population_idx[MAX_K + 1];
+  const int n_archive = archive_.Nearest(query, k, archive_d2, archive_idx);
+  const int n_population = population_.Nearest(
+          query, k + 1, population_d2, population_idx);
+
+  // Merge the two sorted lists, skipping the creature itself
+  float sum = 0.0f;
+  int count = 0;
+  int a = 0;
+  int p = 0;
+  while (count < k && (a < n_archive || p < n_population)) {
+    if (p < n_population && population_idx[p] == i) {
+      p++;
+      continue;
+    }
+    const bool from_archive = p >= n_population ||
+            (a < n_archive && archive_d2[a] < population_d2[p]);
+    sum += std::sqrt(from_archive ? archive_d2[a++] : population_d2[p++]);
+    count++;
+  }
+  return count > 0 ? sum / count : 0.0f;
+}
+
+//! Adds a behavior to the archive.
+/*!
+  Must not be called while novelty is calculated.
+  \param descriptor is the behavior descriptor, dimension floats.
+*/
+void NoveltyArchive::Add(const float* descriptor) {
+  archive_.Insert(descriptor);
+}
+
+//! Returns the number of behaviors in the archive.
+int NoveltyArchive::Size() const {
+  return archive_.Size();
+}
@@ -0,0 +1,582 @@
+#include "OffscreenRenderer.h"
+#include "MapElites.h"
+#include "RenderState.h"
+#include "Scene.h"
+#include "SettingsManager.h"
+#include "ShaderManager.h"
+#include "TextureManager.h"
+#include "TrajectoryFile.h"
+
+// C++
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+// External
+#include <QDir>
+#include <QImage>
+#include <QMutexLocker>
+#ifdef OFFSCREEN_EGL
+// Without the X11 headers, their macros clash with Qt and Bullet
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#endif
+
+const int OffscreenRenderer::N_PIXEL_BUFFERS;
+const int OffscreenRenderer::MAX_QUEUED_FRAMES;
+
+//! Internal functor ordering creatures with the best fitness first.
+struct BestFitnessFirst {
+  bool operator()(const Creature& a, const Creature& b) const {
+    return a.GetFitness() > b.GetFitness();
+  }
+};
+
+//! Constructor. Nothing is created until Init.
+OffscreenRenderer::OffscreenRenderer() {
+#ifdef OFFSCREEN_EGL
+  display_ = EGL_NO_DISPLAY;
+  context_ = EGL_NO_CONTEXT;
+#else
+  context_ = NULL;
+  surface_ = NULL;
+#endif
+  width_ = 0;
+  height_ = 0;
+  raw_out_ = NULL;
+  closing_ = false;
+  failed_ = false;
+}
+
+//! Destructor. Deletes the buffers and the context.
+OffscreenRenderer::~OffscreenRenderer() {
+  ReleaseBuffers(MakeCurrent());
+  DestroyContext();
+}
+
+//! Internal function deleting the buffers before the context is deleted.
+/*!
+  \param context_current tells if the context is current. If it is not the
+  names are given up instead, they are deleted with the context.
+*/
+void OffscreenRenderer::ReleaseBuffers(bool context_current) {
+  for (int i = 0; i < N_PIXEL_BUFFERS; ++i) {
+    if (context_current)
+      pixel_buffers_[i].Reset();
+    else
+      pixel_buffers_[i].Release();
+  }
+  if (context_current) {
+    depth_buffer_.Reset();
+    color_buffer_.Reset();
+    framebuffer_.Reset();
+  } else {
+    depth_buffer_.Release();
+    color_buffer_.Release();
+    framebuffer_.Release();
+  }
+}
+
+#ifdef OFFSCREEN_EGL
+//! Internal function telling if a list of EGL extensions has one of them.
+static bool HasEglExtension(const char* extensions, const std::string& name) {
+  if (!extensions)
+    return false;
+  std::istringstream list(extensions);
+  std::string extension;
+  while (list >> extension) {
+    if (extension == name)
+      return true;
+  }
+  return false;
+}
+
+//! Internal function creating an OpenGL 3.3 context and making it current.
+/*!
+  The display is the surfaceless platform of Mesa if the EGL library has
+  it, otherwise the default display of the driver. The context is made
+  current without a surface, all rendering goes to the framebuffer object.
+  \return False if there is no EGL display or no such context.
+*/
+bool OffscreenRenderer::CreateContext() {
+  const char* client_extensions =
+      eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display &&
+      HasEglExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    display_ = get_platform_display(
+        EGL_PLATFORM_SURFACELESS_MESA,
+        EGL_DEFAULT_DISPLAY,
+        NULL);
+  }
+  if (display_ == EGL_NO_DISPLAY)
+    display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, NULL, NULL)) {
+    std::cout << "ERROR: could not initialize an EGL display!" << std::endl;
+    display_ = EGL_NO_DISPLAY;
+    return false;
+  }
+  if (!HasEglExtension(
+          eglQueryString(display_, EGL_EXTENSIONS),
+          "EGL_KHR_surfaceless_context")) {
+    std::cout << "ERROR: EGL can not make a context current without " <<
+        "a surface!" << std::endl;
+    return false;
+  }
+
+  // Any surface type, the context is never used with one
+  const EGLint config_attributes[] = {
+    EGL_SURFACE_TYPE, 0,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  const EGLint context_attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+    EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+    EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint n_configs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(display_, config_attributes, &config, 1, &n_configs) ||
+      n_configs == 0) {
+    std::cout << "ERROR: EGL has no configuration for OpenGL!" << std::endl;
+    return false;
+  }
+  context_ = eglCreateContext(
+      display_,
+      config,
+      EGL_NO_CONTEXT,
+      context_attributes);
+  if (context_ == EGL_NO_CONTEXT || !MakeCurrent()) {
+    std::cout << "ERROR: could not create an OpenGL 3.3 context " <<
+        "through EGL!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//! Internal function making the context current, false if there is none.
+bool OffscreenRenderer::MakeCurrent() {
+  return context_ != EGL_NO_CONTEXT &&
+      eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_);
+}
+
+//! Internal function deleting the context and closing the display.
+void OffscreenRenderer::DestroyContext() {
+  if (display_ == EGL_NO_DISPLAY)
+    return;
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context_ != EGL_NO_CONTEXT)
+    eglDestroyContext(display_, context_);
+  eglTerminate(display_);
+  context_ = EGL_NO_CONTEXT;
+  display_ = EGL_NO_DISPLAY;
+}
+#else
+//! Internal function creating an OpenGL 3.3 context and making it current.
+/*!
+  Needs a QGuiApplication. The QOffscreenSurface is a hidden window or a
+  pbuffer, depending on the platform.
+  \return False if no such context could be created.
+*/
+bool OffscreenRenderer::CreateContext() {
+  QSurfaceFormat format;
+  format.setVersion(3, 3);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+
+  surface_ = new QOffscreenSurface();
+  surface_->setFormat(format);
+  surface_->create();
+  context_ = new QOpenGLContext();
+  context_->setFormat(format);
+  if (!context_->create() || !MakeCurrent()) {
+    std::cout << "ERROR: could not create an offscreen OpenGL context!" <<
+        std::endl;
+    return false;
+  }
+  return true;
+}
+
+//! Internal function making the context current, false if there is none.
+bool OffscreenRenderer::MakeCurrent() {
+  return context_ && context_->makeCurrent(surface_);
+}
+
+//! Internal function deleting the context and its surface.
+void OffscreenRenderer::DestroyContext() {
+  if (context_)
+    context_->doneCurrent();
+  delete context_;
+  delete surface_;
+  context_ = NULL;
+  surface_ = NULL;
+}
+#endif
+
+//! Creates the offscreen context and the framebuffer to render in to.
+/*!
+  See the class description for how the context is created. It is made
+  current and the managers needing OpenGL are created, like
+  GLWidget::initializeGL does.
+  \param width is the width of the frames in pixels.
+  \param height is the height of the frames in pixels.
+  \return False if no OpenGL 3.3 context could be created.
+*/
+bool OffscreenRenderer::Init(int width, int height) {
+  if (!CreateContext())
+    return false;
+  glewExperimental = true; // Needed for core profile
+  GLenum glew_result = glewInit();
+#if defined(OFFSCREEN_EGL) && defined(GLEW_ERROR_NO_GLX_DISPLAY)
+  // GLEW built for GLX loads the functions first, then finds no GLX display
+  if (glew_result == GLEW_ERROR_NO_GLX_DISPLAY)
+    glew_result = GLEW_OK;
+#endif
+  if (glew_result != GLEW_OK) {
+    std::cout << "ERROR: failed to initialize GLEW!" << std::endl;
+    return false;
+  }
+  glGetError(); // glewInit may leave an error in core profile
+
+  width_ = width;
+  height_ = height;
+  SettingsManager::Instance()->SetFrameWidth(width);
+  SettingsManager::Instance()->SetFrameHeight(height);
+
+  // The framebuffer replaces the default framebuffer of a window
+  color_buffer_ = GLRenderbuffer::Create();
+  glBindRenderbuffer(GL_RENDERBUFFER, color_buffer_.Get());
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  depth_buffer_ = GLRenderbuffer::Create();
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_.Get());
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  framebuffer_ = GLFramebuffer::Create();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.Get());
+  glFramebufferRenderbuffer(
+          GL_FRAMEBUFFER,
+          GL_COLOR_ATTACHMENT0,
+          GL_RENDERBUFFER,
+          color_buffer_.Get());
+  glFramebufferRenderbuffer(
+          GL_FRAMEBUFFER,
+          GL_DEPTH_ATTACHMENT,
+          GL_RENDERBUFFER,
+          depth_buffer_.Get());
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR: offscreen framebuffer is incomplete!" << std::endl;
+    framebuffer_.Reset();
+    return false;
+  }
+
+  // Every pixel buffer holds one RGBA frame
+  for (int i = 0; i < N_PIXEL_BUFFERS; ++i) {
+    pixel_buffers_[i] = GLBuffer::Create();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers_[i].Get());
+    glBufferData(
+            GL_PIXEL_PACK_BUFFER,
+            4 * width * height,
+            NULL,
+            GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  glViewport(0, 0, width, height);
+  glClearColor(0.8f, 0.8f, 1.0f, 1.0f);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_BACK);
+  glDepthFunc(GL_LESS);
+
+  RenderState::Instance();
+  ShaderManager::Instance();
+  // Every frame is rendered with the final textures
+  TextureManager::Instance()->FinishStreaming();
+  return true;
+}
+
+//! Simulates creatures and writes the rendered frames.
+/*!
+  The creatures are put in the Scene like in the GUI. If they all have a
+  recorded Trajectory it is played back, otherwise they are simulated.
+  \param creatures are the creatures to render.
+  \param n_frames is the number of frames, 30 per simulated second.
+  \param output is a directory for PNG files or a .rgb file, see the class
+  description.
+  \return False if Init failed or the frames could not be written.
+*/
+bool OffscreenRenderer::Render(
+        const std::vector<Creature>& creatures,
+        int n_frames,
+        const std::string& output) {
+  if (framebuffer_.Get() == GL_FALSE || !OpenOutput(output))
+    return false;
+
+  Scene* scene = Scene::Instance();
+  scene->SetFixedTimeStep(true);
+  scene->RestartSimulation(creatures);
+
+  closing_ = false;
+  failed_ = false;
+  encoder_ = std::thread(&OffscreenRenderer::RunEncoder, this);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.Get());
+  for (int frame = 0; frame < n_frames; ++frame) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene->Update();
+    scene->Render();
+
+    // Starts the copy, the pixels are not waited for here
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,
+            pixel_buffers_[frame % N_PIXEL_BUFFERS].Get());
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE,
+            reinterpret_cast<void*>(0));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (frame >= N_PIXEL_BUFFERS - 1 &&
+        !CollectFrame(frame - (N_PIXEL_BUFFERS - 1)))
+      break;
+  }
+  // The last frames are still in the pixel buffers
+  for (int frame = std::max(0, n_frames - (N_PIXEL_BUFFERS - 1));
+       frame < n_frames; ++frame) {
+    if (!CollectFrame(frame))
+      break;
+  }
+
+  {
+    QMutexLocker locker(&mutex_);
+    closing_ = true;
+    queue_changed_.wakeAll();
+  }
+  encoder_.join();
+  if (raw_out_)
+    std::fclose(raw_out_);
+  raw_out_ = NULL;
+  return !failed_;
+}
+
+//! Picks the creatures to render from a MAP-Elites checkpoint.
+/*!
+  \param checkpoint is a file written by MapElites::Save. If it is empty
+  one new random creature is picked.
+  \param count is the number of elites to pick, the ones with the best
+  fitness.
+  \param creatures is set to the picked creatures.
+  \return False if the checkpoint could not be read.
+*/
+bool OffscreenRenderer::LoadCreatures(
+        const std::string& checkpoint,
+        int count,
+        std::vector<Creature>* creatures) {
+  creatures->clear();
+  if (checkpoint.empty()) {
+    creatures->push_back(Creature());
+    return true;
+  }
+  MapElites map_elites;
+  if (!map_elites.Load(checkpoint)) {
+    std::cout << "ERROR: could not read " << checkpoint << "!" << std::endl;
+    return false;
+  }
+  *creatures = map_elites.GetElites();
+  std::sort(creatures->begin(), creatures->end(), BestFitnessFirst());
+  if (creatures->size() > count)
+    creatures->resize(std::max(1, count));
+  return true;
+}
+
+//! Picks recorded creatures to play back from a trajectory file.
+/*!
+  The file has no genomes, so every recording is put on a new Creature of
+  the current creature type, which needs to be the one of the recorded
+  run. Load its config first. The last recorded creatures are picked, they
+  are from the latest generation. Recordings with another number of bodies
+  are skipped.
+  \param path is a file written by a TrajectoryWriter.
+  \param count is the number of creatures to pick.
+  \param creatures is set to the picked creatures, each with its Trajectory.
+  \return False if the file could not be read or had no matching creature.
+*/
+bool OffscreenRenderer::LoadTrajectories(
+        const std::string& path,
+        int count,
+        std::vector<Creature>* creatures) {
+  creatures->clear();
+  TrajectoryReader reader;
+  if (!reader.Open(path)) {
+    std::cout << "ERROR: could not read " << path << "!" << std::endl;
+    return false;
+  }
+  Creature creature;
+  int n_bodies = creature.GetBody().GetBodyRoot().GetNumberOfElements();
+  TrajectoryChunk chunk;
+  std::vector<btTransform> transforms(n_bodies);
+  for (int c = reader.GetNumberOfCreatures() - 1;
+       c >= 0 && creatures->size() < std::max(1, count); --c) {
+    if (!reader.Read(c, 0, INT_MAX, &chunk))
+      continue;
+    if (chunk.n_bodies != n_bodies) {
+      std::cout << "WARNING: creature " << c << " of " << path <<
+          " has " << chunk.n_bodies << " bodies, not " << n_bodies <<
+          "!" << std::endl;
+      continue;
+    }
+    std::shared_ptr<Trajectory> trajectory =
+        std::make_shared<Trajectory>(n_bodies, chunk.frame_time);
+    trajectory->Reserve(chunk.n_frames);
+    for (int f = 0; f < chunk.n_frames; ++f) {
+      const float* frame = &chunk.values[f * chunk.FrameSize()];
+      for (int b = 0; b < n_bodies; ++b) {
+        const float* body = frame + 7 * b;
+        transforms[b].setOrigin(btVector3(body[0], body[1], body[2]));
+        transforms[b].setRotation(
+            btQuaternion(body[3], body[4], body[5], body[6]));
+      }
+      trajectory->AddFrame(&transforms[0]);
+    }
+    creature.SetTrajectory(trajectory);
+    creatures->push_back(creature);
+  }
+  if (creatures->empty()) {
+    std::cout << "ERROR: no creature of " << path << " can be played back!" <<
+        std::endl;
+    return false;
+  }
+  return true;
+}
+
+//! Internal function opening the directory or file to write to.
+bool OffscreenRenderer::OpenOutput(const std::string& output) {
+  directory_.clear();
+  raw_out_ = NULL;
+  if (output.size() > 4 &&
+      output.compare(output.size() - 4, 4, ".rgb") == 0) {
+    raw_out_ = std::fopen(output.c_str(), "wb");
+  } else if (QDir().mkpath(QString::fromStdString(output))) {
+    directory_ = output;
+    return true;
+  }
+  if (!raw_out_) {
+    std::cout << "ERROR: could not open " << output << "!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//! Internal function handing a frame read earlier to the encoder thread.
+/*!
+  The pixel buffer of the frame was filled N_PIXEL_BUFFERS - 1 frames ago,
+  so mapping it rarely waits for the GPU. Waits if the encoder is
+  MAX_QUEUED_FRAMES behind.
+  \param number is the number of the frame.
+  \return False if the encoder failed and rendering should stop.
+*/
+bool OffscreenRenderer::CollectFrame(int number) {
+  RenderedFrame frame;
+  frame.number = number;
+  {
+    QMutexLocker locker(&mutex_);
+    while (queue_.size() >= MAX_QUEUED_FRAMES && !failed_)
+      queue_changed_.wait(&mutex_);
+    if (failed_)
+      return false;
+    if (!free_pixels_.empty()) {
+      frame.pixels.swap(free_pixels_.back());
+      free_pixels_.pop_back();
+    }
+  }
+
+  int size = 4 * width_ * height_;
+  frame.pixels.resize(size);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER,
+          pixel_buffers_[number % N_PIXEL_BUFFERS].Get());
+  const void* pixels =
+      glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+  if (pixels) {
+    std::memcpy(&frame.pixels[0], pixels, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  QMutexLocker locker(&mutex_);
+  queue_.push_back(std::move(frame));
+  queue_changed_.wakeAll();
+  return true;
+}
+
+//! Internal function run by the encoder thread until all frames are written.
+void OffscreenRenderer::RunEncoder() {
+  RenderedFrame frame;
+  mutex_.lock();
+  while (true) {
+    while (queue_.empty() && !closing_)
+      queue_changed_.wait(&mutex_);
+    if (queue_.empty())
+      break;
+    frame = std::move(queue_.front());
+    queue_.pop_front();
+    queue_changed_.wakeAll();
+    mutex_.unlock();
+
+    bool written = Encode(frame);
+
+    mutex_.lock();
+    free_pixels_.push_back(std::vector<unsigned char>());
+    free_pixels_.back().swap(frame.pixels);
+    if (!written) {
+      // Rendering stops waiting, the remaining frames are dropped
+      failed_ = true;
+      queue_.clear();
+      queue_changed_.wakeAll();
+    }
+  }
+  mutex_.unlock();
+}
+
+//! Internal function writing one frame as a PNG file or to the raw stream.
+/*!
+  OpenGL reads the rows bottom up, they are flipped here.
+  \return False if the frame could not be written.
+*/
+bool OffscreenRenderer::Encode(const RenderedFrame& frame) {
+  if (!directory_.empty()) {
+    std::stringstream path;
+    path << directory_ << "/frame_" << std::setw(5) << std::setfill('0') <<
+        frame.number << ".png";
+    QImage image(&frame.pixels[0], width_, height_, QImage::Format_RGBA8888);
+    if (image.mirrored().save(QString::fromStdString(path.str())))
+      return true;
+    std::cout << "ERROR: could not write " << path.str() << "!" << std::endl;
+    return false;
+  }
+
+  row_.resize(3 * width_);
+  for (int y = height_ - 1; y >= 0; --y) {
+    const unsigned char* rgba = &frame.pixels[4 * width_ * y];
+    for (int x = 0; x < width_; ++x) {
+      row_[3 * x + 0] = rgba[4 * x + 0];
+      row_[3 * x + 1] = rgba[4 * x + 1];
+      row_[3 * x + 2] = rgba[4 * x + 2];
+    }
+    if (std::fwrite(&row_[0], 1, row_.size(), raw_out_) != row_.size()) {
+      std::cout << "ERROR: could not write the raw video stream!" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
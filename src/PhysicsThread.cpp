@@ -0,0 +1,162 @@
+#include "PhysicsThread.h"
+#include "Simulation.h"
+
+// C++
+#include <algorithm>
+// External
+#include <glm/gtc/type_ptr.hpp>
+#include <QMutexLocker>
+
+const int PhysicsThread::TICKS_PER_SECOND;
+
+//! Constructor
+PhysicsThread::PhysicsThread() {
+  simulation_ = NULL;
+  stopping_ = false;
+  previous_.time = 0.0;
+  latest_.time = 0.0;
+  light_position_.setValue(0.0f, 0.0f, 0.0f);
+  light_moved_ = false;
+}
+
+//! Destructor. Stops the thread.
+PhysicsThread::~PhysicsThread() {
+  Stop();
+}
+
+//! Starts stepping a Simulation.
+/*!
+  The current transforms become the first snapshot. The Simulation must
+  not be used by anyone else until Stop is called.
+  \param simulation is the Simulation to step.
+  \param bodies are the bodies whose transforms are interpolated, in the
+  order Interpolate returns them.
+*/
+void PhysicsThread::Start(
+        Simulation* simulation,
+        const std::vector<btRigidBody*>& bodies) {
+  Stop();
+  simulation_ = simulation;
+  bodies_ = bodies;
+  stopping_ = false;
+  start_ = std::chrono::steady_clock::now();
+  Capture(0.0, &latest_);
+  previous_ = latest_;
+  thread_ = std::thread(&PhysicsThread::Run, this);
+}
+
+//! Stops the thread and waits for the tick in progress.
+void PhysicsThread::Stop() {
+  if (!thread_.joinable())
+    return;
+  {
+    QMutexLocker locker(&mutex_);
+    stopping_ = true;
+    stop_requested_.wakeAll();
+  }
+  thread_.join();
+  simulation_ = NULL;
+}
+
+//! Returns the transforms of the bodies interpolated to the current time.
+/*!
+  Rendering is one tick behind the physics, so there are snapshots on both
+  sides of the rendered time. Positions are interpolated linearly and
+  rotations spherically.
+  \param transforms are set to one matrix per body given to Start.
+  \param target is set to the center of mass of the last creature.
+  \return False if the thread was never started.
+*/
+bool PhysicsThread::Interpolate(
+        std::vector<glm::mat4>* transforms,
+        btVector3* target) {
+  if (!thread_.joinable())
+    return false;
+  double time = GetTime() - 1.0 / TICKS_PER_SECOND;
+  QMutexLocker locker(&mutex_);
+  double span = latest_.time - previous_.time;
+  float alpha = span > 0.0 ?
+      static_cast<float>(std::min(1.0, std::max(0.0, (time - previous_.time) / span))) :
+      1.0f;
+
+  int n = latest_.transforms.size();
+  transforms->resize(n);
+  for (int i = 0; i < n; ++i) {
+    const btTransform& a = previous_.transforms[i];
+    const btTransform& b = latest_.transforms[i];
+    btTransform transform(
+        a.getRotation().slerp(b.getRotation(), alpha),
+        a.getOrigin().lerp(b.getOrigin(), alpha));
+    transform.getOpenGLMatrix(glm::value_ptr((*transforms)[i]));
+  }
+  *target = previous_.target.lerp(latest_.target, alpha);
+  return true;
+}
+
+//! Internal function run by the physics thread until Stop.
+void PhysicsThread::Run() {
+  const double tick = 1.0 / TICKS_PER_SECOND;
+  PhysicsSnapshot snapshot;
+  double next_tick = tick;
+  while (true) {
+    btVector3 light_position;
+    bool light_moved;
+    {
+      QMutexLocker locker(&mutex_);
+      light_position = light_position_;
+      light_moved = light_moved_;
+      light_moved_ = false;
+    }
+    if (light_moved)
+      simulation_->SetLightPosition(light_position);
+    simulation_->Step(static_cast<float>(tick));
+    Capture(next_tick, &snapshot);
+
+    QMutexLocker locker(&mutex_);
+    // The oldest snapshot is reused for the next tick
+    std::swap(previous_, latest_);
+    std::swap(latest_, snapshot);
+
+    next_tick += tick;
+    double now = GetTime();
+    // Skip the ticks that were missed instead of running to catch up
+    if (now > next_tick + tick)
+      next_tick = now;
+    while (!stopping_ && now < next_tick) {
+      stop_requested_.wait(&mutex_,
+          static_cast<unsigned long>(1000.0 * (next_tick - now)) + 1);
+      now = GetTime();
+    }
+    if (stopping_)
+      return;
+  }
+}
+
+//! Moves the light source target of the Simulation before the next tick.
+/*!
+  Can be called from any thread, the Simulation is only touched by the
+  physics thread. Nothing happens if the position is unchanged.
+  \param position is the new position of the target.
+*/
+void PhysicsThread::SetLightPosition(const btVector3& position) {
+  QMutexLocker locker(&mutex_);
+  if (position == light_position_)
+    return;
+  light_position_ = position;
+  light_moved_ = true;
+}
+
+//! Internal function copying the transforms of the bodies.
+void PhysicsThread::Capture(double time, PhysicsSnapshot* snapshot) {
+  snapshot->time = time;
+  snapshot->transforms.resize(bodies_.size());
+  for (int i = 0; i < bodies_.size(); ++i)
+    snapshot->transforms[i] = bodies_[i]->getWorldTransform();
+  snapshot->target = simulation_->GetLastCreatureCoords();
+}
+
+//! Internal function returning the seconds since the thread was started.
+double PhysicsThread::GetTime() const {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start_).count();
+}
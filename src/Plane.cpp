@@ -1,121 +1,83 @@
 #include "Plane.h"
 
-//! Constructor. All vertex data are set up.
+//! Constructor. Uses the unit Plane of the GeometryCache.
 /*!
-  The default Plane has a horisontal normal and is of size 1.
-  Currently, the texture type is set in this constructor and can therefore
-  not be different for different planes.
+  The Plane has a horisontal normal and is of size 1. Other sizes and
+  heights are set by the model transform.
 */
-Plane::Plane(Material material) : Shape(material) {
-  SetupVertexPositionData();
-  SetupVertexNormalData();
-  SetupVertexUVData();
-  SetupElementData();
-  TextureManager::Instance();
+Plane::Plane(Material material) :
+        Shape(GeometryCache::Instance()->GetPlane(), material) {
 }
 
-//! Constructor. All vertex data are set up.
+//! Fills in all vertex data of the unit Plane, used by the GeometryCache.
 /*!
-  Currently, the texture type is set in this constructor and can therefore
-  not be different for different planes.
-  \param scale scales the plane in all 3 dimensions.
+  \param data is set to the vertices and elements of the Plane.
 */
-Plane::Plane(glm::vec3 scale, Material material) : Shape(material) {
-  SetupVertexPositionData();
-  SetupVertexNormalData();
-  SetupVertexUVData();
-  SetupElementData();
-  for (int i = 0; i < vertex_position_data_.size(); ++i) {
-    vertex_position_data_[i].x = vertex_position_data_[i].x*scale.x;
-    vertex_position_data_[i].y = vertex_position_data_[i].y*scale.y;
-    vertex_position_data_[i].z = vertex_position_data_[i].z*scale.z;
-  }
+void Plane::GetMeshData(MeshData* data) {
+  SetupVertexPositionData(data);
+  SetupVertexNormalData(data);
+  SetupVertexUVData(data);
+  SetupElementData(data);
 }
 
-//! Constructor. All vertex data are set up.
-/*!
-  Currently, the texture type is set in this constructor and can therefore
-  not be different for different planes.
-  \param scale scales the plane in all 3 dimensions.
-  \param plane_equation defines a normal and a position along it. Currently
-  only the translation is implemented.
-*/
-Plane::Plane(glm::vec3 scale, glm::vec4 plane_equation, Material material) :
-        Shape(material) {
-  SetupVertexPositionData();
-  SetupVertexNormalData();
-  SetupVertexUVData();
-  SetupElementData();
-  for (int i = 0; i < vertex_position_data_.size(); ++i) {
-    vertex_position_data_[i].x = vertex_position_data_[i].x*scale.x;
-    vertex_position_data_[i].y = vertex_position_data_[i].y*scale.y;
-    vertex_position_data_[i].z = vertex_position_data_[i].z*scale.z;
-  }
-  //translate plane
-  for(int i=0; i < vertex_position_data_.size(); ++i) {
-      vertex_position_data_[i].y = plane_equation.w;
-  }
-}
-
-
-void Plane::SetupVertexPositionData() {
-  vertex_position_data_.resize(8);
+void Plane::SetupVertexPositionData(MeshData* data) {
+  data->positions.resize(8);
 
-  vertex_position_data_[0] = glm::vec3(-1.0f, 0.0f, -1.0f);
-  vertex_position_data_[1] = glm::vec3(1.0f, 0.0f, -1.0f);
-  vertex_position_data_[2] = glm::vec3(-1.0f, 0.0f, 1.0f);
-  vertex_position_data_[3] = glm::vec3(1.0f, 0.0f, 1.0f);
+  data->positions[0] = glm::vec3(-1.0f, 0.0f, -1.0f);
+  data->positions[1] = glm::vec3(1.0f, 0.0f, -1.0f);
+  data->positions[2] = glm::vec3(-1.0f, 0.0f, 1.0f);
+  data->positions[3] = glm::vec3(1.0f, 0.0f, 1.0f);
 
-  vertex_position_data_[4] = glm::vec3(-1.0f, 0.0f, -1.0f);
-  vertex_position_data_[5] = glm::vec3(1.0f, 0.0f, -1.0f);
-  vertex_position_data_[6] = glm::vec3(-1.0f, 0.0f, 1.0f);
-  vertex_position_data_[7] = glm::vec3(1.0f, 0.0f, 1.0f);
+  data->positions[4] = glm::vec3(-1.0f, 0.0f, -1.0f);
+  data->positions[5] = glm::vec3(1.0f, 0.0f, -1.0f);
+  data->positions[6] = glm::vec3(-1.0f, 0.0f, 1.0f);
+  data->positions[7] = glm::vec3(1.0f, 0.0f, 1.0f);
 }
 
-void Plane::SetupVertexNormalData() {
-  vertex_normal_data_.resize(8);
+void Plane::SetupVertexNormalData(MeshData* data) {
+  data->normals.resize(8);
 
-  vertex_normal_data_[0] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[1] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[2] = glm::vec3(0.0f, 1.0f, 0.0f);
-  vertex_normal_data_[3] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[0] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[1] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[2] = glm::vec3(0.0f, 1.0f, 0.0f);
+  data->normals[3] = glm::vec3(0.0f, 1.0f, 0.0f);
 
-  vertex_normal_data_[4] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[5] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[6] = glm::vec3(0.0f, -1.0f, 0.0f);
-  vertex_normal_data_[7] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[4] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[5] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[6] = glm::vec3(0.0f, -1.0f, 0.0f);
+  data->normals[7] = glm::vec3(0.0f, -1.0f, 0.0f);
 }
 
-void Plane::SetupVertexUVData() {
-  vertex_uv_data_.resize(8);
+void Plane::SetupVertexUVData(MeshData* data) {
+  data->uvs.resize(8);
 
-  vertex_uv_data_[0] = glm::vec2(0.0f, 1.0f);
-  vertex_uv_data_[1] = glm::vec2(1.0f, 1.0f);
-  vertex_uv_data_[2] = glm::vec2(0.0f, 0.0f);
-  vertex_uv_data_[3] = glm::vec2(1.0f, 0.0f);
+  data->uvs[0] = glm::vec2(0.0f, 1.0f);
+  data->uvs[1] = glm::vec2(1.0f, 1.0f);
+  data->uvs[2] = glm::vec2(0.0f, 0.0f);
+  data->uvs[3] = glm::vec2(1.0f, 0.0f);
 
-  vertex_uv_data_[4] = glm::vec2(1.0f, 1.0f);
-  vertex_uv_data_[5] = glm::vec2(0.0f, 1.0f);
-  vertex_uv_data_[6] = glm::vec2(1.0f, 0.0f);
-  vertex_uv_data_[7] = glm::vec2(0.0f, 0.0f);
+  data->uvs[4] = glm::vec2(1.0f, 1.0f);
+  data->uvs[5] = glm::vec2(0.0f, 1.0f);
+  data->uvs[6] = glm::vec2(1.0f, 0.0f);
+  data->uvs[7] = glm::vec2(0.0f, 0.0f);
 }
 
-void Plane::SetupElementData() {
-  element_data_.resize(12);
+void Plane::SetupElementData(MeshData* data) {
+  data->elements.resize(12);
 
-  element_data_[0] = 0;
-  element_data_[1] = 2;
-  element_data_[2] = 1;
+  data->elements[0] = 0;
+  data->elements[1] = 2;
+  data->elements[2] = 1;
 
-  element_data_[3] = 1;
-  element_data_[4] = 2;
-  element_data_[5] = 3;
+  data->elements[3] = 1;
+  data->elements[4] = 2;
+  data->elements[5] = 3;
 
-  element_data_[6] = 4;
-  element_data_[7] = 5;
-  element_data_[8] = 6;
+  data->elements[6] = 4;
+  data->elements[7] = 5;
+  data->elements[8] = 6;
 
-  element_data_[9] = 5;
-  element_data_[10] = 6;
-  element_data_[11] = 7;
+  data->elements[9] = 5;
+  data->elements[10] = 6;
+  data->elements[11] = 7;
 }
@@ -0,0 +1,139 @@
+#include "RenderState.h"
+
+// No OpenGL object has this name, so it never equals a binding
+static const GLuint UNKNOWN = ~0u;
+
+RenderState* RenderState::instance_ = NULL;
+
+//! A part of the singleton pattern
+/*!
+ If this function is called for the first time, the constructor is called and
+ the singleton is created. Needs an OpenGL context.
+ \return The one instance of the RenderState
+ */
+RenderState* RenderState::Instance() {
+  if (!instance_)
+    instance_ = new RenderState();
+  return instance_;
+}
+
+//! Constructor. Nothing is known to be bound.
+RenderState::RenderState() {
+  Invalidate();
+}
+
+RenderState::~RenderState() {
+}
+
+//! Starts counting a new frame and invalidates the cache.
+/*!
+  The counts of the frame that ended are kept for GetFrameStatistics.
+*/
+void RenderState::BeginFrame() {
+  last_frame_ = current_;
+  current_ = RenderStatistics();
+  Invalidate();
+}
+
+//! Forgets all bindings so the next ones always reach OpenGL.
+/*!
+  Needs to be called if anything was bound without the RenderState within
+  a frame.
+*/
+void RenderState::Invalidate() {
+  program_id_ = UNKNOWN;
+  texture_id_ = UNKNOWN;
+  vertex_array_id_ = UNKNOWN;
+  for (int i = 0; i < uniform_buffer_ids_.size(); ++i)
+    uniform_buffer_ids_[i] = UNKNOWN;
+}
+
+//! Binds a ShaderProgram unless it is already bound.
+void RenderState::UseProgram(GLuint program_id) {
+  if (Changes(&program_id_, program_id))
+    glUseProgram(program_id);
+}
+
+//! Binds an array texture in texture unit 0 unless it is already bound.
+void RenderState::BindTexture(GLuint texture_id) {
+  if (texture_id_ == UNKNOWN)
+    glActiveTexture(GL_TEXTURE0); // The only texture unit used
+  if (Changes(&texture_id_, texture_id))
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+}
+
+//! Binds a vertex array unless it is already bound.
+/*!
+  The element buffer is part of the vertex array, so it is never bound on
+  its own for drawing.
+*/
+void RenderState::BindVertexArray(GLuint vertex_array_id) {
+  if (Changes(&vertex_array_id_, vertex_array_id))
+    glBindVertexArray(vertex_array_id);
+}
+
+//! Binds a uniform buffer to a binding point unless it is already bound.
+/*!
+  \param binding is the binding point, see ShaderManager::FRAME_DATA_BINDING.
+  \param buffer_id is the uniform buffer.
+*/
+void RenderState::BindUniformBuffer(GLuint binding, GLuint buffer_id) {
+  if (binding >= uniform_buffer_ids_.size())
+    uniform_buffer_ids_.resize(binding + 1, UNKNOWN);
+  if (Changes(&uniform_buffer_ids_[binding], buffer_id))
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer_id);
+}
+
+//! Draws the triangles of the bound vertex array.
+/*!
+  \param count is the number of unsigned short indices in the element buffer.
+  \param first is the index of the first of them.
+*/
+void RenderState::DrawElements(GLsizei count, GLsizei first) {
+  glDrawElements(
+          GL_TRIANGLES,
+          count,
+          GL_UNSIGNED_SHORT,
+          reinterpret_cast<void*>(first * sizeof(GLushort)));
+  current_.draw_calls++;
+  current_.instances++;
+}
+
+//! Draws the triangles of the bound vertex array several times.
+/*!
+  \param count is the number of unsigned short indices in the element buffer.
+  \param instances is the number of instances to draw.
+  \param first is the index of the first of them.
+*/
+void RenderState::DrawElementsInstanced(
+        GLsizei count,
+        GLsizei instances,
+        GLsizei first) {
+  glDrawElementsInstanced(
+          GL_TRIANGLES,
+          count,
+          GL_UNSIGNED_SHORT,
+          reinterpret_cast<void*>(first * sizeof(GLushort)),
+          instances);
+  current_.draw_calls++;
+  current_.instances += instances;
+}
+
+//! Returns the counts of the last frame that ended.
+RenderStatistics RenderState::GetFrameStatistics() {
+  return last_frame_;
+}
+
+//! Internal function updating a cached binding.
+/*!
+  \return True if the binding changed and OpenGL needs to be called.
+*/
+bool RenderState::Changes(GLuint* current, GLuint value) {
+  if (*current == value) {
+    current_.redundant_changes++;
+    return false;
+  }
+  *current = value;
+  current_.state_changes++;
+  return true;
+}
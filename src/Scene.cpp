@@ -1,11 +1,20 @@
 #include "Scene.h"
+#include <cmath>
 #include <btBulletDynamicsCommon.h>
 #include "Plane.h"
 
+#include "MaterialManager.h"
 #include "Node.h"
+#include "RenderState.h"
 #include "Simulation.h"
 
+// C++
+#include <algorithm>
+#include <cfloat>
+
 Scene* Scene::instance_ = NULL;
+const int Scene::SHADOW_LIGHT;
+const float Scene::IMPOSTOR_PIXELS = 8.0f;
 
 //! Singleton function. Returning the instance if created.
 Scene* Scene::Instance() {
@@ -28,6 +37,10 @@ Scene::Scene() {
   //lights_[2].color = glm::vec3(0.8f, 0.8f, 1.0f);
   //lights_[2].position = glm::vec4(0.5f, 1.0f, 0.5f, 0.0f);
 
+  playback_ = false;
+  playback_time_ = 0.0f;
+  fixed_time_step_ = false;
+
   std::vector<Creature> start_creature;
   StartSimulation(start_creature);
 }
@@ -35,6 +48,7 @@ Scene::Scene() {
 //! Destructor. Ends the Simulation.
 Scene::~Scene() {
   EndSimulation();
+  shadow_map_.DeleteBuffers();
 }
 
 void Scene::SetCamera(Camera cam) {
@@ -49,75 +63,259 @@ LightSource Scene::GetLight(int i){
   return lights_[i];
 }
 
+//! Sets if the Simulation is stepped by Update instead of a PhysicsThread.
+/*!
+  With a fixed time step every Update steps the Simulation one tick of the
+  PhysicsThread, no matter how long the frame took. Used when the frames
+  are not shown in real time, like by the OffscreenRenderer. Takes effect
+  with the next RestartSimulation.
+  \param fixed is true for a fixed time step.
+*/
+void Scene::SetFixedTimeStep(bool fixed) {
+  fixed_time_step_ = fixed;
+}
+
 //! Render all the objects.
 /*!
-  Sets the Basic (phong) ShaderProgram and uploads the LightSource data. Then
-  render all Nodes.
+  Uploads the Camera and the LightSource data once for all ShaderPrograms,
+  updates the table of Materials and binds the texture array. The depth
+  seen from the spot light SHADOW_LIGHT is drawn in to the ShadowMap, where
+  the ground and the light source box are cached and only the Nodes of the
+  creatures are drawn every frame. Then render
+  all Nodes inside the Frustum of the Camera. Creatures that are smaller
+  than IMPOSTOR_PIXELS on screen are drawn as one box. The boxes of the
+  Nodes are collected and drawn together by the InstancedRenderer. The
+  other Nodes all draw from the vertex array of the GeometryCache, so the
+  RenderState skips the bindings between them.
 */
 void Scene::Render() {
-   //To make sure we use the same name
-  const char* shader_name = "Basic";
-  ShaderManager::Instance()->UseProgram(shader_name);
+  RenderState::Instance()->BeginFrame();
+  shadow_map_.Aim(lights_[SHADOW_LIGHT]);
+  ShaderManager::Instance()->UpdateFrameData(
+      &cam_,
+      lights_,
+      shadow_map_.GetMatrix());
+  MaterialManager::Instance()->Update();
+  TextureManager::Instance()->BindTextureArray();
 
-  // One light source takes 16 * sizeof(float) in size
-  ShaderManager::Instance()->GetShaderProgramFromName(
-          shader_name)->Uniform1fv(
-                  "light_data",
-                  16 * N_LIGHTS,
-                  &lights_[0].intensity);
-
-  glUseProgram(0);
+  // The Nodes before the creatures do not move by themselves
+  int first_creature_node =
+      creature_nodes_.empty() ? nodes_.size() : creature_nodes_.front();
+  shadow_map_.Render(&nodes_, first_creature_node);
 
   //draw nodes
-  for(Node& n : nodes_) {
-      n.Render(&cam_);
+  Frustum frustum = cam_.GetFrustum();
+  culling_ = CullingStatistics();
+  culling_.shadow_casters = shadow_map_.GetNumberOfCasters();
+  instanced_renderer_.Clear();
+  render_queue_.clear();
+  for (int i = 0; i < first_creature_node; ++i)
+    QueueNode(&nodes_[i], frustum);
+  for (int c = 0; c < creature_nodes_.size(); ++c) {
+    int end = c + 1 < creature_nodes_.size() ?
+        creature_nodes_[c + 1] : nodes_.size();
+    QueueCreature(creature_nodes_[c], end, frustum);
   }
+  for (int i = 0; i < render_queue_.size(); ++i)
+    render_queue_[i]->Render();
+  instanced_renderer_.Render();
+}
+
+//! Returns the counts of the Nodes culled and simplified in the last frame.
+CullingStatistics Scene::GetCullingStatistics() {
+  return culling_;
+}
+
+//! Internal function adding a Node to be drawn if it is in the Frustum.
+void Scene::QueueNode(Node* node, const Frustum& frustum) {
+  glm::vec3 min, max;
+  node->GetBoundingBox(&min, &max);
+  if (!frustum.IntersectsBox(min, max)) {
+    culling_.culled_nodes++;
+    return;
+  }
+  culling_.visible_nodes++;
+  if (node->IsInstanced())
+    instanced_renderer_.Add(
+        node->GetTransform(),
+        node->GetScale(),
+        node->GetMaterialIndex());
+  else
+    render_queue_.push_back(node);
+}
+
+//! Internal function adding the Nodes of one creature to be drawn.
+/*!
+  The creature is culled as a whole if its bounding box is outside of the
+  Frustum. If it is smaller than IMPOSTOR_PIXELS on screen, its bounding
+  box is drawn with the material of its first body instead of its bodies.
+  \param begin is the index of the first Node of the creature.
+  \param end is the index after the last Node of the creature.
+  \param frustum is the Frustum of the Camera.
+*/
+void Scene::QueueCreature(int begin, int end, const Frustum& frustum) {
+  if (begin == end)
+    return;
+  glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+  for (int i = begin; i < end; ++i) {
+    glm::vec3 node_min, node_max;
+    nodes_[i].GetBoundingBox(&node_min, &node_max);
+    min = glm::min(min, node_min);
+    max = glm::max(max, node_max);
+  }
+  if (!frustum.IntersectsBox(min, max)) {
+    culling_.culled_nodes += end - begin;
+    return;
+  }
+
+  glm::vec3 center = 0.5f * (min + max);
+  glm::vec3 half_extents = 0.5f * (max - min);
+  if (cam_.GetPixelSize(center, glm::length(half_extents)) < IMPOSTOR_PIXELS) {
+    instanced_renderer_.Add(
+        glm::translate(glm::mat4(1.0f), center),
+        half_extents,
+        nodes_[begin].GetMaterialIndex());
+    culling_.impostor_nodes += end - begin;
+    culling_.impostors++;
+    return;
+  }
+  for (int i = begin; i < end; ++i)
+    QueueNode(&nodes_[i], frustum);
 }
 
 //! Updates all components of the Scene.
 /*!
-  Updates the Camera position, LightSource direction and all Nodes. Then step
-  the simulation.
+  Updates the Camera position, LightSource direction and all Nodes from the
+  latest snapshots of the PhysicsThread. The Simulation is not touched,
+  unless the Scene has a fixed time step.
 */
 void Scene::Update() {
+  if (playback_) {
+    UpdatePlayback();
+    return;
+  }
+
+  // The settings are only read on this thread
+  Vec3 target_pos = SettingsManager::Instance()->GetTargetPos();
+  btVector3 light_position(target_pos.x, target_pos.y, target_pos.z);
+  btVector3 target;
+  if (fixed_time_step_) {
+    sim_->SetLightPosition(light_position);
+    sim_->Step(1.0f / PhysicsThread::TICKS_PER_SECOND);
+    for (Node& node : nodes_)
+      node.UpdateNode();
+    target = sim_->GetLastCreatureCoords();
+  } else {
+    physics_.SetLightPosition(light_position);
+    if (!physics_.Interpolate(&transforms_, &target))
+      return;
+    for (int i = 0; i < nodes_.size() && i < transforms_.size(); ++i)
+      nodes_[i].SetTransform(transforms_[i]);
+  }
+
   // Update Camera
-  btVector3 target = sim_->GetLastCreatureCoords();
   cam_.SetTarget(glm::vec3(target.getX(),target.getY(),target.getZ()));
   cam_.UpdateMatrices();
 
   // Update Light source
   lights_[1].spot_direction = cam_.GetTarget() - glm::vec3(lights_[1].position);
   // Update the target light source
-  lights_[0].position = glm::vec4(
-          SettingsManager::Instance()->GetTargetPos().x,
-          SettingsManager::Instance()->GetTargetPos().y,
-          SettingsManager::Instance()->GetTargetPos().z,
-          1.0f);
-
-  for(Node& n : nodes_) {
-      n.UpdateNode();
+  lights_[0].position = glm::vec4(target_pos.x, target_pos.y, target_pos.z, 1.0f);
+}
+
+//! Plays back the recorded Trajectories one step further.
+/*!
+  Sets the transforms of the Nodes straight from the recordings, the
+  Simulation only provides the shapes. The creatures are displaced along
+  the x-axis like in the Simulation and the light source target is put
+  where it was during the recording. The playback loops.
+*/
+void Scene::UpdatePlayback() {
+  // The ground and the light source come first, see Simulation::GetNodes
+  int node = 2;
+  btVector3 center(0.0f, 0.0f, 0.0f);
+  for (int i = 0; i < trajectories_.size(); ++i) {
+    const Trajectory& trajectory = *trajectories_[i];
+    float time = std::fmod(playback_time_,
+            trajectory.GetDuration() + trajectory.GetFrameTime());
+    center.setValue(0.0f, 0.0f, 0.0f);
+    for (int b = 0; b < trajectory.GetNumberOfBodies(); ++b) {
+      btTransform transform = trajectory.Sample(time, b);
+      transform.getOrigin() += btVector3(static_cast<float>(i), 0.0f, 0.0f);
+      center += transform.getOrigin();
+      glm::mat4 matrix;
+      transform.getOpenGLMatrix(glm::value_ptr(matrix));
+      nodes_[node++].SetTransform(matrix);
+    }
+    center /= std::max(1, trajectory.GetNumberOfBodies());
   }
-  sim_->Step(1.0f/30.0f);
+  playback_time_ += 1.0f/30.0f;
+
+  btVector3 light = trajectories_.front()->GetLightPosition();
+  nodes_[1].SetPosition(glm::vec3(light.getX(), light.getY(), light.getZ()));
+  lights_[0].position = glm::vec4(light.getX(), light.getY(), light.getZ(), 1.0f);
+
+  // Follow the last creature like when simulating
+  cam_.SetTarget(glm::vec3(center.getX(), center.getY(), center.getZ()));
+  cam_.UpdateMatrices();
+  lights_[1].spot_direction = cam_.GetTarget() - glm::vec3(lights_[1].position);
 }
 
 //! Creates a new Simulation and adding the Creatures.
 /*!
+  Playback is used if every creature has a Trajectory that matches its
+  bodies.
   \param viz_creatures are the creatures that should be added to the
   simulation.
 */
 void Scene::StartSimulation(std::vector<Creature> viz_creatures) {
-    sim_ = new Simulation(true);
+    sim_ = new Simulation(*SettingsManager::Instance()->GetSnapshot(), true);
     sim_->AddPopulation(viz_creatures, true);
     nodes_ = sim_->GetNodes();
+
+    // The Nodes of the creatures come last, see Simulation::GetNodes
+    std::vector<int> body_counts = sim_->GetCreatureBodyCounts();
+    int first_node = nodes_.size();
+    for (int i = 0; i < body_counts.size(); ++i)
+      first_node -= body_counts[i];
+    creature_nodes_.clear();
+    for (int i = 0; i < body_counts.size(); ++i) {
+      creature_nodes_.push_back(first_node);
+      first_node += body_counts[i];
+    }
+
+    trajectories_.clear();
+    int n_bodies = 0;
+    for (int i = 0; i < viz_creatures.size(); ++i) {
+      std::shared_ptr<const Trajectory> trajectory =
+          viz_creatures[i].GetTrajectory();
+      if (!trajectory || trajectory->GetNumberOfFrames() == 0)
+        break;
+      trajectories_.push_back(trajectory);
+      n_bodies += trajectory->GetNumberOfBodies();
+    }
+    playback_ = !viz_creatures.empty() &&
+        trajectories_.size() == viz_creatures.size() &&
+        nodes_.size() == n_bodies + 2;
+    if (!playback_)
+      trajectories_.clear();
+    playback_time_ = 0.0f;
+
+    if (!playback_ && !fixed_time_step_) {
+      std::vector<btRigidBody*> bodies;
+      for (Node& node : nodes_)
+        bodies.push_back(node.GetRigidBody());
+      physics_.Start(sim_, bodies);
+    }
 }
 
-//! Deletes the Simulation and deleting all the buffers for the Nodes
+//! Deletes the Simulation.
+/*!
+  The Nodes own no OpenGL objects, their meshes stay in the GeometryCache.
+*/
 void Scene::EndSimulation() {
+    physics_.Stop();
     delete sim_;
-    //nodes_.clear();
-    for (Node& node : nodes_) {
-      node.DeleteBuffers();
-    }
 }
 
 //! Ends the current simulation and creates a new one, adding the Creatures.
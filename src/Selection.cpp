@@ -0,0 +1,192 @@
+#include "Selection.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+const float Selection::TRUNCATION_RATIO = 0.5f;
+
+//! Internal comparison of indices by their fitness, larger fitness first.
+struct IndexFitnessLargerThan {
+  IndexFitnessLargerThan(const std::vector<float>& fitness)
+      : fitness_(fitness) {}
+  bool operator()(int i1, int i2) const {
+    return fitness_[i1] > fitness_[i2];
+  }
+  const std::vector<float>& fitness_;
+};
+
+//! Constructor, creates an unprepared tournament selection.
+Selection::Selection() {
+  type_ = TOURNAMENT_SELECTION;
+  tournament_size_ = 3;
+  n_truncated_ = 0;
+}
+
+//! Prepares the selection for a new generation.
+/*!
+  \param type is the selection operator to use.
+  \param fitness are the fitness values of the population.
+  \param tournament_size is the number of creatures competing in a
+  tournament. Only used by TOURNAMENT_SELECTION.
+*/
+void Selection::Prepare(
+        SelectionType type,
+        const std::vector<float>& fitness,
+        int tournament_size) {
+  type_ = type;
+  tournament_size_ = std::max(1, tournament_size);
+  fitness_ = fitness;
+  int n = fitness_.size();
+
+  switch (type_) {
+  case RANK_SELECTION:
+    order_.resize(n);
+    for (int i = 0; i < n; ++i)
+      order_[i] = i;
+    std::sort(order_.begin(), order_.end(), IndexFitnessLargerThan(fitness_));
+    break;
+  case TRUNCATION_SELECTION:
+    n_truncated_ = std::max(1, static_cast<int>(n * TRUNCATION_RATIO));
+    order_.resize(n);
+    for (int i = 0; i < n; ++i)
+      order_[i] = i;
+    if (n_truncated_ < n) {
+      std::nth_element(order_.begin(), order_.begin() + n_truncated_,
+              order_.end(), IndexFitnessLargerThan(fitness_));
+    }
+    break;
+  case STOCHASTIC_UNIVERSAL_SAMPLING: {
+    // Shift the fitness values to be positive
+    float min_fitness = *std::min_element(fitness_.begin(), fitness_.end());
+    for (float& f : fitness_)
+      f = f - min_fitness + 1e-6f;
+    break;
+  }
+  case TOURNAMENT_SELECTION:
+  default:
+    break;
+  }
+}
+
+//! Selects a number of parents.
+/*!
+  \param count is the number of parents to select.
+  \param rng is the random number generator to draw from.
+  \param out is where the indices of the parents are written.
+*/
+void Selection::SelectMany(int count, BatchRNG& rng, int* out) {
+  if (fitness_.empty() || count <= 0)
+    return;
+  switch (type_) {
+  case RANK_SELECTION:
+    Rank(count, rng, out);
+    break;
+  case STOCHASTIC_UNIVERSAL_SAMPLING:
+    StochasticUniversal(count, rng, out);
+    break;
+  case TRUNCATION_SELECTION:
+    Truncation(count, rng, out);
+    break;
+  case TOURNAMENT_SELECTION:
+  default:
+    Tournament(count, rng, out);
+    break;
+  }
+}
+
+//! Finds the best creatures without sorting the whole population.
+/*!
+  The n_elite best indices are partitioned to the front with nth_element,
+  which is O(n), and only those are sorted.
+  \param fitness are the fitness values of the population.
+  \param n_elite is the number of best creatures to find.
+  \param ranking is where the indices are written. The first n_elite are the
+  best creatures, best first. The order of the rest is unspecified.
+*/
+void Selection::RankElite(
+        const std::vector<float>& fitness,
+        int n_elite,
+        std::vector<int>* ranking) {
+  int n = fitness.size();
+  n_elite = std::min(n, std::max(0, n_elite));
+  ranking->resize(n);
+  for (int i = 0; i < n; ++i)
+    (*ranking)[i] = i;
+  IndexFitnessLargerThan larger_than(fitness);
+  if (n_elite < n) {
+    std::nth_element(ranking->begin(), ranking->begin() + n_elite,
+            ranking->end(), larger_than);
+  }
+  std::sort(ranking->begin(), ranking->begin() + n_elite, larger_than);
+}
+
+//! Internal function, tournament selection.
+/*!
+  The best of tournament_size uniformly drawn creatures wins.
+*/
+void Selection::Tournament(int count, BatchRNG& rng, int* out) {
+  int n = fitness_.size();
+  for (int i = 0; i < count; ++i) {
+    int best = rng.UniformInt(n);
+    for (int j = 1; j < tournament_size_; ++j) {
+      int idx = rng.UniformInt(n);
+      best = fitness_[idx] > fitness_[best] ? idx : best;
+    }
+    out[i] = best;
+  }
+}
+
+//! Internal function, linear rank selection.
+/*!
+  The probability of a creature is proportional to n - rank, where the best
+  creature has rank 0. The rank is drawn in O(1) by inverting the
+  cumulative distribution, x = 1 - sqrt(1 - u) has the density 2(1 - x).
+*/
+void Selection::Rank(int count, BatchRNG& rng, int* out) {
+  int n = order_.size();
+  for (int i = 0; i < count; ++i) {
+    float x = 1.0f - std::sqrt(1.0f - rng.Uniform());
+    int rank = std::min(n - 1, static_cast<int>(x * n));
+    out[i] = order_[rank];
+  }
+}
+
+//! Internal function, stochastic universal sampling.
+/*!
+  Fitness proportional selection with evenly spaced pointers and one random
+  offset. This has the minimum possible spread, every creature is selected
+  either floor or ceil of its expected number of times. One pass over the
+  population is needed for all pointers. The result is shuffled so that
+  consecutive parents are not neighbours in the population.
+*/
+void Selection::StochasticUniversal(int count, BatchRNG& rng, int* out) {
+  int n = fitness_.size();
+  double total = 0.0;
+  for (int i = 0; i < n; ++i)
+    total += fitness_[i];
+  double step = total / count;
+  double pointer = rng.Uniform() * step;
+  double cumulative = 0.0;
+  int idx = 0;
+  for (int i = 0; i < count; ++i) {
+    while (idx < n - 1 && cumulative + fitness_[idx] <= pointer) {
+      cumulative += fitness_[idx];
+      idx++;
+    }
+    out[i] = idx;
+    pointer += step;
+  }
+  // Fisher-Yates shuffle
+  for (int i = count - 1; i > 0; --i)
+    std::swap(out[i], out[rng.UniformInt(i + 1)]);
+}
+
+//! Internal function, truncation selection.
+/*!
+  Uniform selection among the TRUNCATION_RATIO best creatures.
+*/
+void Selection::Truncation(int count, BatchRNG& rng, int* out) {
+  for (int i = 0; i < count; ++i)
+    out[i] = order_[rng.UniformInt(n_truncated_)];
+}
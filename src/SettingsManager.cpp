@@ -1,58 +1,128 @@
 #include "SettingsManager.h"
+#include "Crossover.h"
+#include "Mutation.h"
+#include "Selection.h"
+#include "MultiObjective.h"
+#include "NoveltyArchive.h"
+#include "MapElites.h"
+// C++
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
-SettingsManager* SettingsManager::instance_ = NULL;
-
+//! Singleton function. Returning the instance, created on first use.
 SettingsManager* SettingsManager::Instance() {
-  if (!instance_) // only allow one instance of class to be generated
-    instance_ = new SettingsManager();
-  return instance_;
+  // Thread safe initialization in C++11, only one instance is ever created
+  static SettingsManager* instance = new SettingsManager();
+  return instance;
 }
 
 //! Constructor
 SettingsManager::SettingsManager(){
 
+  frame_width_ = 800;
+  frame_height_ = 600;
   rotation_sensitivity_ = M_PI * 2.0f;
+  print_render_statistics_ = false;
+  shader_hot_reload_ = false;
   // set default values
-  population_size_ = 10;
-  max_generations_ = 20;
-  crossover_ratio_ = 0.8;
-  elitism_ratio_ = 0.2;
+  SettingsSnapshot* snapshot = new SettingsSnapshot();
+  snapshot->population_size = 10;
+  snapshot->max_generations = 20;
+  snapshot->crossover = 0.8;
+  snapshot->crossover_type = UNIFORM_CROSSOVER;
+  snapshot->elitism = 0.2;
+
+  snapshot->mutation = 0.8;
+  snapshot->mutation_internal = 0.2;
+  snapshot->mutation_sigma = 0.1;
+  snapshot->mutation_type = UNIFORM_MUTATION;
+  snapshot->selection_type = TOURNAMENT_SELECTION;
+  snapshot->tournament_size = 3;
+  snapshot->simulation_time = 30;
+  snapshot->fitness_mode = WEIGHTED_SUM_FITNESS;
+  snapshot->novelty_neighbours = 15;
+
+  snapshot->evolution_mode = GENERATIONAL_EVOLUTION;
+  snapshot->map_elites_bins = 10;
+  snapshot->map_elites_checkpoint = "map_elites.chk";
 
-  mutation_ratio_ = 0.8;
-  mutation_ratio_internal_ = 0.2;
-  mutation_sigma_ = 0.1;
+  snapshot->es_sigma = 0.02;
+  snapshot->es_learning_rate = 0.01;
+
+  snapshot->record_trajectories = true;
+  snapshot->trajectory_file = ""; // Not written by default, it grows large
+  snapshot_.reset(snapshot);
 
   target_pos_ = Vec3(10,5,20);
 }
 
 //! Destructor
 SettingsManager::~SettingsManager(void){
-  delete instance_;
+}
+
+//! Returns the current settings. Can be called from any thread.
+/*!
+  The snapshot never changes, later changes of the settings publish a new
+  one. Keep the pointer for as long as the same settings should be used.
+*/
+std::shared_ptr<const SettingsSnapshot> SettingsManager::GetSnapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+//! Internal function starting a change of the settings.
+/*!
+  Locks out other writers and returns a copy of the current snapshot to
+  change. Must be followed by EndUpdate.
+*/
+SettingsSnapshot* SettingsManager::BeginUpdate() {
+  update_mutex_.lock();
+  return new SettingsSnapshot(*snapshot_);
+}
+
+//! Internal function publishing the snapshot from BeginUpdate.
+void SettingsManager::EndUpdate(SettingsSnapshot* snapshot) {
+  snapshot->version++;
+  std::atomic_store(&snapshot_,
+      std::shared_ptr<const SettingsSnapshot>(snapshot));
+  update_mutex_.unlock();
 }
 
 int SettingsManager::GetPopulationSize(){
-  return population_size_;
+  return GetSnapshot()->population_size;
 }
 int SettingsManager::GetMaxGenerations(){
-  return max_generations_;
+  return GetSnapshot()->max_generations;
 }
 float SettingsManager::GetCrossover(){
-  return crossover_ratio_;
+  return GetSnapshot()->crossover;
+}
+int SettingsManager::GetCrossoverType(){
+  return GetSnapshot()->crossover_type;
 }
 float SettingsManager::GetElitism(){
-  return elitism_ratio_;
+  return GetSnapshot()->elitism;
 }
 float SettingsManager::GetMutation(){
-  return mutation_ratio_;
+  return GetSnapshot()->mutation;
 }
 float SettingsManager::GetMutationInternal(){
-  return mutation_ratio_internal_;
+  return GetSnapshot()->mutation_internal;
 }
 float SettingsManager::GetMutationSigma(){
-  return mutation_sigma_;
+  return GetSnapshot()->mutation_sigma;
+}
+int SettingsManager::GetMutationType(){
+  return GetSnapshot()->mutation_type;
+}
+int SettingsManager::GetSelectionType(){
+  return GetSnapshot()->selection_type;
+}
+int SettingsManager::GetTournamentSize(){
+  return GetSnapshot()->tournament_size;
 }
 int SettingsManager::GetSimulationTime(){
-  return simulation_time_;
+  return GetSnapshot()->simulation_time;
 }
 int SettingsManager::GetFrameWidth(){
   return frame_width_;
@@ -63,6 +133,12 @@ int SettingsManager::GetFrameHeight(){
 float SettingsManager::GetRotationSensitivity(){
   return rotation_sensitivity_;
 }
+bool SettingsManager::GetPrintRenderStatistics(){
+  return print_render_statistics_;
+}
+bool SettingsManager::GetShaderHotReload(){
+  return shader_hot_reload_;
+}
 Vec3 SettingsManager::GetMainBodyDimension(){
   return main_body_dim_;
 }
@@ -73,74 +149,116 @@ Vec3 SettingsManager::GetTargetPos(){
 // where should the control of all the variables lie?
 // ex not smaller than 0 and some variables must med 0->1.
 void SettingsManager::SetPopulationSize(int population_size){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(population_size <= 0){
-    population_size_ = 1;
+    snapshot->population_size = 1;
     std::cout << "WARNING: population size clamped to 1!" << std::endl;
   }
   else
-    population_size_ = population_size; 
+    snapshot->population_size = population_size;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetMaxGenerations(int max_generations){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(max_generations <= 0){
-    max_generations_ = 1;
+    snapshot->max_generations = 1;
     std::cout << "WARNING: max genereations clamped to 1!" << std::endl;
   }
   else
-    max_generations_ = max_generations; 
+    snapshot->max_generations = max_generations;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetCrossover(float crossover_ratio){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(crossover_ratio < 0.0f || crossover_ratio > 1.0f){
-    crossover_ratio_ = glm::clamp(crossover_ratio, 0.0f,1.0f);
-    std::cout << "WARNING: crossover ratio clamped to " << crossover_ratio_ <<
+    snapshot->crossover = glm::clamp(crossover_ratio, 0.0f,1.0f);
+    std::cout << "WARNING: crossover ratio clamped to " << snapshot->crossover <<
       "!" << std::endl;
   }
   else
-    crossover_ratio_ = crossover_ratio;
+    snapshot->crossover = crossover_ratio;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetCrossoverType(int crossover_type){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->crossover_type = crossover_type;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetElitism(float elitism_ratio){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(elitism_ratio < 0.0f || elitism_ratio > 1.0f){
-    elitism_ratio_ = glm::clamp(elitism_ratio, 0.0f,1.0f);
-    std::cout << "WARNING: elitism ratio clamped to " << elitism_ratio_ <<
+    snapshot->elitism = glm::clamp(elitism_ratio, 0.0f,1.0f);
+    std::cout << "WARNING: elitism ratio clamped to " << snapshot->elitism <<
       "!" << std::endl;
   }
   else
-    elitism_ratio_ = elitism_ratio;
+    snapshot->elitism = elitism_ratio;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetMutation(float mutation_ratio){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(mutation_ratio < 0.0f || mutation_ratio > 1.0f){
-    mutation_ratio_ = glm::clamp(mutation_ratio, 0.0f,1.0f);
-    std::cout << "WARNING: mutation ratio clamped to " << mutation_ratio_ <<
+    snapshot->mutation = glm::clamp(mutation_ratio, 0.0f,1.0f);
+    std::cout << "WARNING: mutation ratio clamped to " << snapshot->mutation <<
       "!" << std::endl;
   }
   else
-    mutation_ratio_ = mutation_ratio;
+    snapshot->mutation = mutation_ratio;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetMutationInternal(float mutation_ratio_internal){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(mutation_ratio_internal < 0.0f || mutation_ratio_internal > 1.0f){
-    mutation_ratio_internal_ = glm::clamp(mutation_ratio_internal, 0.0f,1.0f);
-    std::cout << "WARNING: internal mutation ratio clamped to " << mutation_ratio_internal_ <<
+    snapshot->mutation_internal = glm::clamp(mutation_ratio_internal, 0.0f,1.0f);
+    std::cout << "WARNING: internal mutation ratio clamped to " << snapshot->mutation_internal <<
       "!" << std::endl;
   }
   else
-    mutation_ratio_internal_ = mutation_ratio_internal;
+    snapshot->mutation_internal = mutation_ratio_internal;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetMutationSigma(float mutation_sigma){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(mutation_sigma < 0.0f || mutation_sigma > 1.0f){
-    mutation_sigma_ = glm::clamp(mutation_sigma, 0.0f,1.0f);
-    std::cout << "WARNING: mutation sigma ratio clamped to " << mutation_sigma_ <<
+    snapshot->mutation_sigma = glm::clamp(mutation_sigma, 0.0f,1.0f);
+    std::cout << "WARNING: mutation sigma ratio clamped to " << snapshot->mutation_sigma <<
       "!" << std::endl;
   }
   else
-    mutation_sigma_ = mutation_sigma;
+    snapshot->mutation_sigma = mutation_sigma;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetMutationType(int mutation_type){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->mutation_type = mutation_type;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetSelectionType(int selection_type){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->selection_type = selection_type;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetTournamentSize(int tournament_size){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  if(tournament_size < 1){
+    snapshot->tournament_size = 1;
+    std::cout << "WARNING: tournament size clamped to " << snapshot->tournament_size <<
+      "!" << std::endl;
+  }
+  else
+    snapshot->tournament_size = tournament_size;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetSimulationTime(int sim_time){
+  SettingsSnapshot* snapshot = BeginUpdate();
   if(sim_time < 10){
-    simulation_time_ = 10;
-    std::cout << "WARNING: simulation time clamped to " << simulation_time_ <<
+    snapshot->simulation_time = 10;
+    std::cout << "WARNING: simulation time clamped to " << snapshot->simulation_time <<
       "!" << std::endl;
   }
   else
-    simulation_time_ = sim_time;
+    snapshot->simulation_time = sim_time;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetTargetPos(Vec3 pos){
   target_pos_ = pos;
@@ -154,58 +272,183 @@ void SettingsManager::SetFrameHeight(int frame_height){
 void SettingsManager::SetRotationSensitivity(float sense){
   rotation_sensitivity_ = sense;
 }
+void SettingsManager::SetPrintRenderStatistics(bool print){
+  print_render_statistics_ = print;
+}
+void SettingsManager::SetShaderHotReload(bool reload){
+  shader_hot_reload_ = reload;
+}
 
 void SettingsManager::SetCreatureType(int creature){
-  creature_type_ = creature; 
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->creature_type = creature;
+  EndUpdate(snapshot);
 }
 int SettingsManager::GetCreatureType(){
-  return creature_type_; 
+  return GetSnapshot()->creature_type; 
 }
 
 float SettingsManager::GetFitnessDistanceLight() {
-  return fitness_distance_light_;
+  return GetSnapshot()->fitness_weights[0];
 }
 float SettingsManager::GetFitnessDistanceZ() {
-  return fitness_distance_z_;
+  return GetSnapshot()->fitness_weights[1];
 }
 float SettingsManager::GetFitnessMaxY() {
-  return fitness_max_y_;
+  return GetSnapshot()->fitness_weights[2];
 }
 float SettingsManager::GetFitnessAccumY() {
-  return fitness_accumulated_y;
+  return GetSnapshot()->fitness_weights[3];
 }
 float SettingsManager::GetFitnessAccumHeadY() {
-  return fitness_accumulated_head_y;
+  return GetSnapshot()->fitness_weights[4];
 }
 float SettingsManager::GetFitnessDeviationX() {
-  return fitness_deviation_x;
+  return GetSnapshot()->fitness_weights[5];
 }
 float SettingsManager::GetFitnessEnergy() {
-  return fitness_energy_;
+  return GetSnapshot()->fitness_weights[6];
+}
+//! Writes all seven fitness weights, in the order of the getters above
+void SettingsManager::GetFitnessWeights(float* weights) {
+  std::shared_ptr<const SettingsSnapshot> snapshot = GetSnapshot();
+  for (int i = 0; i < 7; ++i)
+    weights[i] = snapshot->fitness_weights[i];
+}
+int SettingsManager::GetFitnessMode() {
+  return GetSnapshot()->fitness_mode;
+}
+int SettingsManager::GetNoveltyNeighbours() {
+  return GetSnapshot()->novelty_neighbours;
+}
+int SettingsManager::GetEvolutionMode() {
+  return GetSnapshot()->evolution_mode;
+}
+int SettingsManager::GetMapElitesBins() {
+  return GetSnapshot()->map_elites_bins;
+}
+std::string SettingsManager::GetMapElitesCheckpoint() {
+  return GetSnapshot()->map_elites_checkpoint;
+}
+float SettingsManager::GetEsSigma() {
+  return GetSnapshot()->es_sigma;
+}
+float SettingsManager::GetEsLearningRate() {
+  return GetSnapshot()->es_learning_rate;
+}
+bool SettingsManager::GetRecordTrajectories() {
+  return GetSnapshot()->record_trajectories;
+}
+std::string SettingsManager::GetTrajectoryFile() {
+  return GetSnapshot()->trajectory_file;
 }
 
 void SettingsManager::SetFitnessDistanceLight(float val){
-  fitness_distance_light_ = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[0] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessDistanceZ(float val){
-  fitness_distance_z_ = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[1] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessMaxY(float val){
-  fitness_max_y_ = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[2] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessAccumY(float val){
-  fitness_accumulated_y = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[3] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessAccumHeadY(float val){
-  fitness_accumulated_head_y = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[4] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessDeviationX(float val){
-  fitness_deviation_x = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[5] = val;
+  EndUpdate(snapshot);
 }
 void SettingsManager::SetFitnessEnergy(float val){
-  fitness_energy_ = val;
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_weights[6] = val;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetFitnessMode(int fitness_mode){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->fitness_mode = fitness_mode;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetNoveltyNeighbours(int k){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  if(k < 1 || k > NoveltyArchive::MAX_K){
+    snapshot->novelty_neighbours = glm::clamp(k, 1, NoveltyArchive::MAX_K);
+    std::cout << "WARNING: novelty neighbours clamped to " <<
+      snapshot->novelty_neighbours << "!" << std::endl;
+  }
+  else
+    snapshot->novelty_neighbours = k;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetEvolutionMode(int evolution_mode){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->evolution_mode = evolution_mode;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetMapElitesBins(int bins){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  if(bins < 1){
+    snapshot->map_elites_bins = 1;
+    std::cout << "WARNING: MAP-Elites bins clamped to 1!" << std::endl;
+  }
+  else
+    snapshot->map_elites_bins = bins;
+  EndUpdate(snapshot);
+}
+//! An empty path disables checkpointing of the MAP-Elites grid
+void SettingsManager::SetMapElitesCheckpoint(std::string path){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->map_elites_checkpoint = path;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetEsSigma(float sigma){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  if(sigma <= 0.0f){
+    snapshot->es_sigma = 0.001f;
+    std::cout << "WARNING: ES sigma clamped to " << snapshot->es_sigma <<
+      "!" << std::endl;
+  }
+  else
+    snapshot->es_sigma = sigma;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetEsLearningRate(float learning_rate){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  if(learning_rate <= 0.0f){
+    snapshot->es_learning_rate = 0.001f;
+    std::cout << "WARNING: ES learning rate clamped to " <<
+      snapshot->es_learning_rate << "!" << std::endl;
+  }
+  else
+    snapshot->es_learning_rate = learning_rate;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetRecordTrajectories(bool record){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->record_trajectories = record;
+  EndUpdate(snapshot);
+}
+void SettingsManager::SetTrajectoryFile(std::string path){
+  SettingsSnapshot* snapshot = BeginUpdate();
+  snapshot->trajectory_file = path;
+  EndUpdate(snapshot);
 }
 
+
 // void SettingsManager::AddBestCreature(Creature creature) {
 //   best_creatures_.push_back(creature);
 // }
@@ -222,3 +465,288 @@ void SettingsManager::SetMainBodyDimension(Vec3 vec){
   main_body_dim_ = vec;
 }
 
+
+//! A setting of type T that can be read from and written to a config file.
+template <typename T>
+struct ConfigEntry {
+  const char* key;
+  T (SettingsManager::*get)();
+  void (SettingsManager::*set)(T);
+};
+
+static const ConfigEntry<int> INT_ENTRIES[] = {
+  {"population_size", &SettingsManager::GetPopulationSize, &SettingsManager::SetPopulationSize},
+  {"max_generations", &SettingsManager::GetMaxGenerations, &SettingsManager::SetMaxGenerations},
+  {"crossover_type", &SettingsManager::GetCrossoverType, &SettingsManager::SetCrossoverType},
+  {"mutation_type", &SettingsManager::GetMutationType, &SettingsManager::SetMutationType},
+  {"selection_type", &SettingsManager::GetSelectionType, &SettingsManager::SetSelectionType},
+  {"tournament_size", &SettingsManager::GetTournamentSize, &SettingsManager::SetTournamentSize},
+  {"simulation_time", &SettingsManager::GetSimulationTime, &SettingsManager::SetSimulationTime},
+  {"creature_type", &SettingsManager::GetCreatureType, &SettingsManager::SetCreatureType},
+  {"fitness_mode", &SettingsManager::GetFitnessMode, &SettingsManager::SetFitnessMode},
+  {"novelty_neighbours", &SettingsManager::GetNoveltyNeighbours, &SettingsManager::SetNoveltyNeighbours},
+  {"evolution_mode", &SettingsManager::GetEvolutionMode, &SettingsManager::SetEvolutionMode},
+  {"map_elites_bins", &SettingsManager::GetMapElitesBins, &SettingsManager::SetMapElitesBins},
+  {"frame_width", &SettingsManager::GetFrameWidth, &SettingsManager::SetFrameWidth},
+  {"frame_height", &SettingsManager::GetFrameHeight, &SettingsManager::SetFrameHeight}
+};
+
+static const ConfigEntry<float> FLOAT_ENTRIES[] = {
+  {"crossover", &SettingsManager::GetCrossover, &SettingsManager::SetCrossover},
+  {"elitism", &SettingsManager::GetElitism, &SettingsManager::SetElitism},
+  {"mutation", &SettingsManager::GetMutation, &SettingsManager::SetMutation},
+  {"mutation_internal", &SettingsManager::GetMutationInternal, &SettingsManager::SetMutationInternal},
+  {"mutation_sigma", &SettingsManager::GetMutationSigma, &SettingsManager::SetMutationSigma},
+  {"fitness_distance_light", &SettingsManager::GetFitnessDistanceLight, &SettingsManager::SetFitnessDistanceLight},
+  {"fitness_distance_z", &SettingsManager::GetFitnessDistanceZ, &SettingsManager::SetFitnessDistanceZ},
+  {"fitness_max_y", &SettingsManager::GetFitnessMaxY, &SettingsManager::SetFitnessMaxY},
+  {"fitness_accum_y", &SettingsManager::GetFitnessAccumY, &SettingsManager::SetFitnessAccumY},
+  {"fitness_accum_head_y", &SettingsManager::GetFitnessAccumHeadY, &SettingsManager::SetFitnessAccumHeadY},
+  {"fitness_deviation_x", &SettingsManager::GetFitnessDeviationX, &SettingsManager::SetFitnessDeviationX},
+  {"fitness_energy", &SettingsManager::GetFitnessEnergy, &SettingsManager::SetFitnessEnergy},
+  {"es_sigma", &SettingsManager::GetEsSigma, &SettingsManager::SetEsSigma},
+  {"es_learning_rate", &SettingsManager::GetEsLearningRate, &SettingsManager::SetEsLearningRate},
+  {"rotation_sensitivity", &SettingsManager::GetRotationSensitivity, &SettingsManager::SetRotationSensitivity}
+};
+
+static const ConfigEntry<std::string> STRING_ENTRIES[] = {
+  {"map_elites_checkpoint", &SettingsManager::GetMapElitesCheckpoint, &SettingsManager::SetMapElitesCheckpoint},
+  {"trajectory_file", &SettingsManager::GetTrajectoryFile, &SettingsManager::SetTrajectoryFile}
+};
+
+static const ConfigEntry<bool> BOOL_ENTRIES[] = {
+  {"record_trajectories", &SettingsManager::GetRecordTrajectories, &SettingsManager::SetRecordTrajectories},
+  {"print_render_statistics", &SettingsManager::GetPrintRenderStatistics, &SettingsManager::SetPrintRenderStatistics},
+  {"shader_hot_reload", &SettingsManager::GetShaderHotReload, &SettingsManager::SetShaderHotReload}
+};
+
+static const ConfigEntry<Vec3> VEC3_ENTRIES[] = {
+  {"target_pos", &SettingsManager::GetTargetPos, &SettingsManager::SetTargetPos},
+  {"main_body_dimension", &SettingsManager::GetMainBodyDimension, &SettingsManager::SetMainBodyDimension}
+};
+
+//! Internal function parsing a whole string as one value.
+template <typename T>
+static bool ParseValue(const std::string& text, T* value) {
+  std::istringstream in(text);
+  in >> *value;
+  return !in.fail() && (in >> std::ws).eof();
+}
+
+template <>
+bool ParseValue<std::string>(const std::string& text, std::string* value) {
+  *value = text;
+  return true;
+}
+
+template <>
+bool ParseValue<bool>(const std::string& text, bool* value) {
+  if (text == "true" || text == "1")
+    *value = true;
+  else if (text == "false" || text == "0")
+    *value = false;
+  else
+    return false;
+  return true;
+}
+
+template <>
+bool ParseValue<Vec3>(const std::string& text, Vec3* value) {
+  std::istringstream in(text);
+  in >> value->x >> value->y >> value->z;
+  return !in.fail() && (in >> std::ws).eof();
+}
+
+//! Internal function formatting a value so ParseValue reads it back.
+template <typename T>
+static std::string FormatValue(const T& value) {
+  std::ostringstream out;
+  out << std::setprecision(9) << value;
+  return out.str();
+}
+
+template <>
+std::string FormatValue<bool>(const bool& value) {
+  return value ? "true" : "false";
+}
+
+template <>
+std::string FormatValue<Vec3>(const Vec3& value) {
+  std::ostringstream out;
+  out << std::setprecision(9) << value.x << " " << value.y << " " << value.z;
+  return out.str();
+}
+
+//! Internal function setting the entry with the key, if there is one.
+template <typename T, int N>
+static bool SetEntry(
+        SettingsManager* settings,
+        const ConfigEntry<T> (&entries)[N],
+        const std::string& key,
+        const std::string& text,
+        bool* found) {
+  for (int i = 0; i < N; ++i) {
+    if (key != entries[i].key)
+      continue;
+    *found = true;
+    T value;
+    if (!ParseValue(text, &value))
+      return false;
+    (settings->*entries[i].set)(value);
+    return true;
+  }
+  return false;
+}
+
+//! Internal function reading the entry with the key, if there is one.
+template <typename T, int N>
+static bool GetEntry(
+        SettingsManager* settings,
+        const ConfigEntry<T> (&entries)[N],
+        const std::string& key,
+        std::string* text) {
+  for (int i = 0; i < N; ++i) {
+    if (key == entries[i].key) {
+      *text = FormatValue((settings->*entries[i].get)());
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Internal function appending the keys of entries.
+template <typename T, int N>
+static void AddKeys(
+        const ConfigEntry<T> (&entries)[N],
+        std::vector<std::string>* keys) {
+  for (int i = 0; i < N; ++i)
+    keys->push_back(entries[i].key);
+}
+
+//! Returns the key of every setting, in the order SaveConfig writes them.
+std::vector<std::string> SettingsManager::GetKeys() {
+  std::vector<std::string> keys;
+  AddKeys(INT_ENTRIES, &keys);
+  AddKeys(FLOAT_ENTRIES, &keys);
+  AddKeys(STRING_ENTRIES, &keys);
+  AddKeys(BOOL_ENTRIES, &keys);
+  AddKeys(VEC3_ENTRIES, &keys);
+  return keys;
+}
+
+//! Tells if a setting only takes whole numbers.
+bool SettingsManager::IsWholeNumber(const std::string& key) {
+  for (int i = 0; i < sizeof(INT_ENTRIES) / sizeof(INT_ENTRIES[0]); ++i) {
+    if (key == INT_ENTRIES[i].key)
+      return true;
+  }
+  return false;
+}
+
+//! Sets a setting from its text in a config file.
+/*!
+  The value goes through the same setter as a change in the GUI, so it is
+  clamped the same way. Enumerations are given by their number.
+  \param key is the name of the setting, as returned by GetKeys.
+  \param value is the text of the value. Vectors are three numbers
+  separated by spaces and booleans are true or false.
+  \return False if the key is unknown or the value can not be parsed.
+*/
+bool SettingsManager::SetValue(const std::string& key, const std::string& value) {
+  bool found = false;
+  if (SetEntry(this, INT_ENTRIES, key, value, &found) ||
+      SetEntry(this, FLOAT_ENTRIES, key, value, &found) ||
+      SetEntry(this, STRING_ENTRIES, key, value, &found) ||
+      SetEntry(this, BOOL_ENTRIES, key, value, &found) ||
+      SetEntry(this, VEC3_ENTRIES, key, value, &found))
+    return true;
+  if (found)
+    std::cout << "WARNING: bad value '" << value << "' for " << key << "!" << std::endl;
+  else
+    std::cout << "WARNING: unknown setting " << key << "!" << std::endl;
+  return false;
+}
+
+//! Returns the text of a setting as it is written to a config file.
+/*!
+  \return The empty string if the key is unknown.
+*/
+std::string SettingsManager::GetValue(const std::string& key) {
+  std::string value;
+  if (GetEntry(this, INT_ENTRIES, key, &value) ||
+      GetEntry(this, FLOAT_ENTRIES, key, &value) ||
+      GetEntry(this, STRING_ENTRIES, key, &value) ||
+      GetEntry(this, BOOL_ENTRIES, key, &value) ||
+      GetEntry(this, VEC3_ENTRIES, key, &value))
+    return value;
+  return "";
+}
+
+//! Splits a config line in to its key and value.
+/*!
+  Lines are "key = value". Everything after a # is a comment and the key
+  and value are trimmed.
+  \return False for lines without a setting.
+*/
+bool SettingsManager::ParseConfigLine(
+        const std::string& line,
+        std::string* key,
+        std::string* value) {
+  std::string text = line.substr(0, line.find('#'));
+  key->clear();
+  value->clear();
+  size_t equals = text.find('=');
+  if (equals == std::string::npos)
+    return false;
+  const char* space = " \t\r";
+  std::string k = text.substr(0, equals);
+  std::string v = text.substr(equals + 1);
+  size_t begin = k.find_first_not_of(space);
+  if (begin == std::string::npos)
+    return false;
+  *key = k.substr(begin, k.find_last_not_of(space) - begin + 1);
+  begin = v.find_first_not_of(space);
+  if (begin != std::string::npos)
+    *value = v.substr(begin, v.find_last_not_of(space) - begin + 1);
+  return true;
+}
+
+//! Reads settings from a config file.
+/*!
+  Every line of the file is "key = value", with the keys of GetKeys.
+  Settings that are not in the file keep their value. Bad lines are
+  reported and skipped.
+  \return False if the file can not be read or has bad lines.
+*/
+bool SettingsManager::LoadConfig(const std::string& path) {
+  std::ifstream in(path.c_str());
+  if (!in)
+    return false;
+  bool ok = true;
+  std::string line, key, value;
+  for (int n = 1; std::getline(in, line); ++n) {
+    if (!ParseConfigLine(line, &key, &value)) {
+      // Blank lines and comments are fine, anything else is an error
+      if (line.substr(0, line.find('#')).find_first_not_of(" \t\r") !=
+          std::string::npos) {
+        std::cout << "WARNING: " << path << ":" << n << " is not a setting!" << std::endl;
+        ok = false;
+      }
+      continue;
+    }
+    if (!SetValue(key, value))
+      ok = false;
+  }
+  return ok;
+}
+
+//! Writes all settings to a config file LoadConfig can read.
+bool SettingsManager::SaveConfig(const std::string& path) {
+  std::ofstream out(path.c_str());
+  if (!out)
+    return false;
+  std::vector<std::string> keys = GetKeys();
+  for (int i = 0; i < keys.size(); ++i)
+    out << keys[i] << " = " << GetValue(keys[i]) << std::endl;
+  return out.good();
+}
@@ -1,11 +1,56 @@
 #include "ShaderManager.h"
 #include "Scene.h"
+#include "Camera.h"
+#include "MaterialManager.h"
+#include "RenderState.h"
+
+#include <cstring>
+#include <set>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+//! Data of the FrameData uniform block with the std140 layout, see basic.frag
+struct FrameData {
+  glm::mat4 V;
+  glm::mat4 P;
+  glm::mat4 shadow_VP; // Of the shadow map, see ShadowMap
+  glm::vec4 camera_data; // Far clipping distance in x
+  LightSource lights[Scene::N_LIGHTS]; // Read as vec4s in the shaders
+};
+
+static_assert(sizeof(LightSource) == 16 * sizeof(float),
+    "A LightSource must be four vec4s in the FrameData block");
+
+// First bytes of a cached program binary, see ShaderProgram::SaveBinary
+static const unsigned int PROGRAM_BINARY_MAGIC = 0x42505243; // "CRPB"
+
+//! Adds bytes to a 64 bit FNV-1a hash.
+static void Hash(const char* bytes, size_t size, unsigned long long* hash) {
+  for (size_t i = 0; i < size; ++i) {
+    *hash ^= static_cast<unsigned char>(bytes[i]);
+    *hash *= 1099511628211ULL;
+  }
+}
+
+//! Returns the modification time of a file, 0 if it does not exist.
+static long long LastModified(const std::string& file_path) {
+  QFileInfo info(QString::fromStdString(file_path));
+  return info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+}
 
 ///////////////////
 // ShaderManager //
 ///////////////////
 
 ShaderManager* ShaderManager::instance_ = NULL;
+const GLuint ShaderManager::FRAME_DATA_BINDING;
+const GLuint ShaderManager::MATERIAL_DATA_BINDING;
+const GLint ShaderManager::TEXTURE_ARRAY_UNIT;
+const GLint ShaderManager::SHADOW_MAP_UNIT;
+const char* ShaderManager::SHADER_CACHE_DIRECTORY = "data/shader_cache";
+const int ShaderManager::WATCH_INTERVAL_MS;
 
 //! A part of the singleton pattern
 /*!
@@ -26,16 +71,28 @@ ShaderManager* ShaderManager::Instance() {
  These use the shaders added in the previous call.
 */
 ShaderManager::ShaderManager() {
+  stopping_ = false;
   AddAllShaders();
   AddSimpleMvpShaderProgram();
   AddBasicShaderProgram();
+  AddInstancedShaderProgram();
+  AddShadowShaderPrograms();
+
+  // The FrameData block of all ShaderPrograms reads from the same buffer
+  frame_buffer_ = GLBuffer::Create();
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer_.Get());
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frame_buffer_.Get());
 }
 
 //! ShaderManager destructor
 /*!
- First, all Shaders are deleted, then all ShaderPrograms.
+ First the watcher thread is stopped, then all Shaders and then all
+ ShaderPrograms are deleted. The frame data buffer is deleted last.
 */
 ShaderManager::~ShaderManager() {
+  StopWatching();
   //Delete shaders
   std::map<std::string, Shader*>::iterator shader_iter = shaders_.begin();
   while (shader_iter != shaders_.end()) {
@@ -54,7 +111,7 @@ ShaderManager::~ShaderManager() {
 //! Add all shaders specified
 /*!
  All the Shaders used by the program shall be added. First all Shaders are
- created (compiled) and then they are put in the std::map of Shaders. All
+ created (read) and then they are put in the std::map of Shaders. All
  pre-processor commands for the Shaders are written explicitly here.
  This is to determine constants like N_LIGHTS before the Shader is
  compiled.
@@ -64,9 +121,17 @@ void ShaderManager::AddAllShaders() {
   std::stringstream preprocessor;
   preprocessor << "#version 330 core \n";
 
-  std::stringstream preprocessor_basic_frag;
-  preprocessor_basic_frag << preprocessor.str() <<
-          "#define N_LIGHTS " << Scene::N_LIGHTS;
+  // The FrameData block needs N_LIGHTS in both vertex and fragment shaders
+  std::stringstream preprocessor_basic;
+  preprocessor_basic << preprocessor.str() <<
+          "#define N_LIGHTS " << Scene::N_LIGHTS <<
+          "\n#define MAX_MATERIALS " << MaterialManager::MAX_MATERIALS <<
+          "\n#define SHADOW_LIGHT " << Scene::SHADOW_LIGHT;
+
+  // The material index comes from the instance instead of a uniform
+  std::stringstream preprocessor_instanced;
+  preprocessor_instanced << preprocessor_basic.str() <<
+          "\n#define INSTANCED";
 
   // Create shaders
   Shader* simple_mvp_vert = new Shader(
@@ -79,23 +144,50 @@ void ShaderManager::AddAllShaders() {
       GL_FRAGMENT_SHADER);
   Shader* basic_vert = new Shader(
       "data/shaders/basic.vert",
-      preprocessor.str().c_str(),
+      preprocessor_basic.str().c_str(),
       GL_VERTEX_SHADER);
   Shader* basic_frag = new Shader(
       "data/shaders/basic.frag",
-      preprocessor_basic_frag.str().c_str(),
+      preprocessor_basic.str().c_str(),
+      GL_FRAGMENT_SHADER);
+  Shader* instanced_vert = new Shader(
+      "data/shaders/instanced.vert",
+      preprocessor_basic.str().c_str(),
+      GL_VERTEX_SHADER);
+  Shader* instanced_frag = new Shader(
+      "data/shaders/basic.frag",
+      preprocessor_instanced.str().c_str(),
+      GL_FRAGMENT_SHADER);
+  Shader* shadow_vert = new Shader(
+      "data/shaders/shadow.vert",
+      preprocessor_basic.str().c_str(),
+      GL_VERTEX_SHADER);
+  Shader* shadow_instanced_vert = new Shader(
+      "data/shaders/shadow.vert",
+      preprocessor_instanced.str().c_str(),
+      GL_VERTEX_SHADER);
+  Shader* shadow_frag = new Shader(
+      "data/shaders/shadow.frag",
+      preprocessor.str().c_str(),
       GL_FRAGMENT_SHADER);
   // Put shaders in the map
   shaders_.insert(StringShaderPair("Simple_MVP_Vert", simple_mvp_vert));
   shaders_.insert(StringShaderPair("Simple_MVP_Frag", simple_mvp_frag));
   shaders_.insert(StringShaderPair("Basic_Vert", basic_vert));
   shaders_.insert(StringShaderPair("Basic_Frag", basic_frag));
+  shaders_.insert(StringShaderPair("Instanced_Vert", instanced_vert));
+  shaders_.insert(StringShaderPair("Instanced_Frag", instanced_frag));
+  shaders_.insert(StringShaderPair("Shadow_Vert", shadow_vert));
+  shaders_.insert(StringShaderPair(
+      "Shadow_Instanced_Vert",
+      shadow_instanced_vert));
+  shaders_.insert(StringShaderPair("Shadow_Frag", shadow_frag));
 }
 
 //! Add the specific ShaderProgram Simple_MVP
 /*!
  This is a specific creator function for the shader Simple_MVP. This function
- relies on that the specific Shaders used are already compiled. Therefore they
+ relies on that the specific Shaders used are already added. Therefore they
  can be picked from the std::map of Shaders and then put in the constructor of
  the new ShaderProgram. The ShaderProgram is then inserted in the
  ShaderManager. All the specific locations also needs to be added, these are
@@ -121,7 +213,7 @@ void ShaderManager::AddSimpleMvpShaderProgram(){
 /*!
  This is a specific creator function for the Shader "Basic". This function
  relies
- on that the specific Shaders used are already compiled. Therefore they can be
+ on that the specific Shaders used are already added. Therefore they can be
  picked from the std::map of shaders and then put in the constructor of the new
  ShaderProgram. The ShaderProgram is then inserted in the ShaderManager. All
  the specific locations also needs to be added, these are then called by name
@@ -140,24 +232,75 @@ void ShaderManager::AddBasicShaderProgram(){
       shader_program_name,
       simple_mvp_shader_program) );
   // Create all locations
-  shader_programs_[shader_program_name]->CreateUniformLocation("MVP");
-  shader_programs_[shader_program_name]->CreateUniformLocation("MV");
   shader_programs_[shader_program_name]->CreateUniformLocation("M");
-  shader_programs_[shader_program_name]->CreateUniformLocation("V");
-  shader_programs_[shader_program_name]->CreateUniformLocation("far_clipping");
-
+  shader_programs_[shader_program_name]->CreateUniformLocation("N");
+  shader_programs_[shader_program_name]->CreateUniformLocation("scale");
   shader_programs_[shader_program_name]->CreateUniformLocation(
-          "light_data"); // Containt all lights
-  shader_programs_[shader_program_name]->CreateUniformLocation(
-          "texture_sampler2D");
-  shader_programs_[shader_program_name]->CreateUniformLocation(
-          "material.reflectance");
-  shader_programs_[shader_program_name]->CreateUniformLocation(
-          "material.specularity");
-  shader_programs_[shader_program_name]->CreateUniformLocation(
-          "material.shinyness");
-    shader_programs_[shader_program_name]->CreateUniformLocation(
-          "material.texture_type");
+          "material_index");
+  shader_programs_[shader_program_name]->BindSampler(
+          "texture_array", TEXTURE_ARRAY_UNIT);
+  shader_programs_[shader_program_name]->BindSampler(
+          "shadow_map", SHADOW_MAP_UNIT);
+  // The camera, lights and materials are uniform blocks
+  shader_programs_[shader_program_name]->BindUniformBlock(
+          "FrameData", FRAME_DATA_BINDING);
+  shader_programs_[shader_program_name]->BindUniformBlock(
+          "MaterialData", MATERIAL_DATA_BINDING);
+}
+
+//! Add the specific ShaderProgram Instanced
+/*!
+ The same shading as Basic, for boxes drawn by the InstancedRenderer. The
+ model matrix, scale and material index are attributes of every instance.
+ */
+
+void ShaderManager::AddInstancedShaderProgram(){
+  // Create ShaderProgram
+  ShaderProgram* instanced_shader_program =
+  new ShaderProgram(shaders_["Instanced_Vert"],
+                    shaders_["Instanced_Frag"]);
+  // The name with which to refer to the ShaderProgram
+  const char* shader_program_name = "Instanced";
+  // Put ShaderProgram in the map
+  shader_programs_.insert(StringShaderProgPair(
+      shader_program_name,
+      instanced_shader_program) );
+  // Create all locations
+  shader_programs_[shader_program_name]->BindSampler(
+          "texture_array", TEXTURE_ARRAY_UNIT);
+  shader_programs_[shader_program_name]->BindSampler(
+          "shadow_map", SHADOW_MAP_UNIT);
+  shader_programs_[shader_program_name]->BindUniformBlock(
+          "FrameData", FRAME_DATA_BINDING);
+  shader_programs_[shader_program_name]->BindUniformBlock(
+          "MaterialData", MATERIAL_DATA_BINDING);
+}
+
+//! Add the specific ShaderPrograms Shadow and Shadow_Instanced
+/*!
+ Only write the depth seen from the light of the ShadowMap. Shadow draws a
+ Shape with the model transform M and Shadow_Instanced draws the boxes of
+ an InstancedRenderer. The matrix of the light is in the FrameData block.
+ */
+
+void ShaderManager::AddShadowShaderPrograms(){
+  ShaderProgram* shadow_shader_program =
+  new ShaderProgram(shaders_["Shadow_Vert"],
+                    shaders_["Shadow_Frag"]);
+  shader_programs_.insert(StringShaderProgPair(
+      "Shadow",
+      shadow_shader_program) );
+  shadow_shader_program->CreateUniformLocation("M");
+  shadow_shader_program->BindUniformBlock("FrameData", FRAME_DATA_BINDING);
+
+  ShaderProgram* shadow_instanced_shader_program =
+  new ShaderProgram(shaders_["Shadow_Instanced_Vert"],
+                    shaders_["Shadow_Frag"]);
+  shader_programs_.insert(StringShaderProgPair(
+      "Shadow_Instanced",
+      shadow_instanced_shader_program) );
+  shadow_instanced_shader_program->BindUniformBlock(
+          "FrameData", FRAME_DATA_BINDING);
 }
 
 //! Used for accessing the ShaderPrograms.
@@ -179,7 +322,7 @@ ShaderProgram* ShaderManager::GetShaderProgramFromName(const char* name) {
  */
 
 void ShaderManager::UseProgram(const char* name) {
-  glUseProgram(shader_programs_[name]->getID());
+  shader_programs_[name]->Use();
 }
 
 //! Used for unbinding ShaderPrograms.
@@ -189,7 +332,147 @@ void ShaderManager::UseProgram(const char* name) {
 */
 
 void ShaderManager::UnbindCurrentShader() {
-  glUseProgram(0);
+  RenderState::Instance()->UseProgram(0);
+}
+
+//! Uploads the camera and the LightSources for the next frame.
+/*!
+ All ShaderPrograms read them from the FrameData block, so they are uploaded
+ once per frame instead of once per ShaderProgram and draw call.
+ \param camera is the camera from where the frame is rendered.
+ \param lights are the Scene::N_LIGHTS LightSources of the Scene.
+ \param shadow_matrix is the view projection of the ShadowMap.
+*/
+
+void ShaderManager::UpdateFrameData(
+        Camera* camera,
+        const LightSource* lights,
+        const glm::mat4& shadow_matrix) {
+  FrameData data;
+  data.V = camera->GetViewMatrix();
+  data.P = camera->GetProjectionMatrix();
+  data.shadow_VP = shadow_matrix;
+  data.camera_data = glm::vec4(camera->GetFarClipping(), 0.0f, 0.0f, 0.0f);
+  for (int i = 0; i < Scene::N_LIGHTS; ++i)
+    data.lights[i] = lights[i];
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer_.Get());
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//! Starts watching the shader files for changes.
+/*!
+ A background thread checks the files every WATCH_INTERVAL_MS and reads the
+ ones that changed. Nothing is compiled there, OpenGL is only called by
+ ReloadChangedShaders on the thread of the context. Calling it again while
+ watching does nothing.
+*/
+
+void ShaderManager::StartWatching() {
+  if (watcher_.joinable())
+    return;
+  std::set<std::string> file_paths;
+  std::map<std::string, Shader*>::iterator shader_iter = shaders_.begin();
+  for (; shader_iter != shaders_.end(); ++shader_iter)
+    file_paths.insert(shader_iter->second->GetFilePath());
+  watched_files_.clear();
+  std::set<std::string>::iterator path_iter = file_paths.begin();
+  for (; path_iter != file_paths.end(); ++path_iter) {
+    WatchedFile file;
+    file.path = *path_iter;
+    file.last_modified = LastModified(file.path);
+    watched_files_.push_back(file);
+  }
+  stopping_ = false;
+  watcher_ = std::thread(&ShaderManager::Watch, this);
+}
+
+//! Relinks the ShaderPrograms of shader files that changed since last call.
+/*!
+ Needs to be called on the thread of the OpenGL context, once per frame is
+ enough. A ShaderProgram that fails to compile or link keeps the program it
+ had, so a mistake in a shader file only prints the errors.
+*/
+
+void ShaderManager::ReloadChangedShaders() {
+  std::map<std::string, std::string> changed_files;
+  {
+    QMutexLocker locker(&watch_mutex_);
+    if (changed_files_.empty())
+      return;
+    changed_files.swap(changed_files_);
+  }
+
+  std::set<Shader*> changed_shaders;
+  std::map<std::string, Shader*>::iterator shader_iter = shaders_.begin();
+  for (; shader_iter != shaders_.end(); ++shader_iter) {
+    Shader* shader = shader_iter->second;
+    std::map<std::string, std::string>::iterator file_iter =
+        changed_files.find(shader->GetFilePath());
+    if (file_iter != changed_files.end()) {
+      shader->SetFileSource(file_iter->second);
+      changed_shaders.insert(shader);
+    }
+  }
+
+  std::map<std::string, ShaderProgram*>::iterator program_iter =
+      shader_programs_.begin();
+  for (; program_iter != shader_programs_.end(); ++program_iter) {
+    std::set<Shader*>::iterator it = changed_shaders.begin();
+    for (; it != changed_shaders.end(); ++it) {
+      if (program_iter->second->UsesShader(*it)) {
+        printf("Reloading ShaderProgram %s\n", program_iter->first.c_str());
+        if (!program_iter->second->Link())
+          printf("Keeping the previous %s\n", program_iter->first.c_str());
+        break;
+      }
+    }
+  }
+}
+
+//! Internal function stopping the watcher thread, if it is running.
+
+void ShaderManager::StopWatching() {
+  if (!watcher_.joinable())
+    return;
+  watch_mutex_.lock();
+  stopping_ = true;
+  stop_requested_.wakeAll();
+  watch_mutex_.unlock();
+  watcher_.join();
+}
+
+//! Internal function run by the watcher thread.
+/*!
+ Polls the modification times of the watched files. A changed file is read
+ here and handed to ReloadChangedShaders, a newer change of the same file
+ replaces it if it was not reloaded yet.
+*/
+
+void ShaderManager::Watch() {
+  QMutexLocker locker(&watch_mutex_);
+  while (!stopping_) {
+    stop_requested_.wait(&watch_mutex_, WATCH_INTERVAL_MS);
+    if (stopping_)
+      break;
+    locker.unlock();
+    std::map<std::string, std::string> changed_files;
+    for (int i = 0; i < watched_files_.size(); ++i) {
+      long long last_modified = LastModified(watched_files_[i].path);
+      if (last_modified == watched_files_[i].last_modified)
+        continue;
+      // Editors may remove the file before writing it, try again next time
+      std::string file_source;
+      if (Shader::ReadFile(watched_files_[i].path, &file_source)) {
+        watched_files_[i].last_modified = last_modified;
+        changed_files[watched_files_[i].path] = file_source;
+      }
+    }
+    locker.relock();
+    std::map<std::string, std::string>::iterator it = changed_files.begin();
+    for (; it != changed_files.end(); ++it)
+      changed_files_[it->first] = it->second;
+  }
 }
 
 ///////////////////
@@ -198,7 +481,8 @@ void ShaderManager::UnbindCurrentShader() {
 
 //! Constructor for the ShaderProgram class
 /*!
- All the shaders passed in the arguments gets linked in to a ShaderProgram.
+ All the shaders passed in the arguments gets linked in to a ShaderProgram,
+ see Link.
  \param Pointers to the shaders to be linked in the order vertex, fragment,
  geometry and tesselation shader. Vertex and fragment shaders are the only
  ones that are needed.
@@ -209,55 +493,222 @@ ShaderProgram::ShaderProgram(Shader* vertex_shader,
                              Shader* geometry_shader,
                              Shader* tesselation_shader) {
   if (vertex_shader == NULL || fragment_shader == NULL) {
-    program_id_ = 0;
     std::cout << "ERROR: ShaderProgram could not be created. " <<
         "Vertex shader and fragment shader are required!" << std::endl;
     return;
   }
 
-  // Link the program
-  printf("Linking ShaderProgram\n");
-  program_id_ = glCreateProgram();
+  shaders_.push_back(vertex_shader);
+  shaders_.push_back(fragment_shader);
+  if (geometry_shader)
+    shaders_.push_back(geometry_shader);
+  if (tesselation_shader)
+    shaders_.push_back(tesselation_shader);
+  Link();
+}
 
-  GLint result = GL_FALSE;
-  int info_log_length;
+//! Links the Shaders in to a new program which replaces the current one.
+/*!
+ If the driver supports program binaries, a binary cached by an earlier run
+ with the same Shader sources and driver is loaded instead of compiling and
+ linking. Otherwise the Shaders are compiled and linked and the binary is
+ saved in ShaderManager::SHADER_CACHE_DIRECTORY. The current program is only
+ replaced if the new one links, a failed one is deleted when Link returns.
+ The created uniform and attribute locations
+ and uniform block bindings are resolved again for the new program, so the
+ handles stay valid.
+ \return True if the program was replaced.
+ */
+
+bool ShaderProgram::Link(){
+  GLProgram program = GLProgram::Create();
+  GLuint program_id = program.Get();
+  std::string cache_path = GetCachePath();
+  GLint result = LoadBinary(program_id, cache_path) ? GL_TRUE : GL_FALSE;
+
+  if (result == GL_FALSE) {
+    // Link the program
+    printf("Linking ShaderProgram\n");
+    for (int i = 0; i < shaders_.size(); ++i) {
+      GLuint shader_id = shaders_[i]->GetShaderId();
+      if (shader_id == 0)
+        return false;
+      glAttachShader(program_id, shader_id);
+    }
+    if (!cache_path.empty()) {
+      glProgramParameteri(
+          program_id,
+          GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+          GL_TRUE);
+    }
+    glLinkProgram(program_id);
+    for (int i = 0; i < shaders_.size(); ++i)
+      glDetachShader(program_id, shaders_[i]->GetShaderId());
+
+    // Check the program
+    int info_log_length;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
+    if ( info_log_length > 0 ){
+      std::vector<char> program_error_message(info_log_length+1);
+      glGetProgramInfoLog(
+          program_id,
+          info_log_length,
+          NULL,
+          &program_error_message[0]);
+      printf("%s\n", &program_error_message[0]);
+    }
+    if (result == GL_FALSE)
+      return false;
+    if (!cache_path.empty())
+      SaveBinary(program_id, cache_path);
+  }
 
-  if (vertex_shader) {
-    glAttachShader(program_id_, vertex_shader->GetShaderId());
+  program_ = std::move(program);
+  // Locations may differ in the new program
+  std::map<std::string, int>::iterator uniform_iter = uniform_handles_.begin();
+  for (; uniform_iter != uniform_handles_.end(); ++uniform_iter) {
+    uniform_locations_[uniform_iter->second] =
+        glGetUniformLocation(program_.Get(), uniform_iter->first.c_str());
   }
-  if (fragment_shader) {
-    glAttachShader(program_id_, fragment_shader->GetShaderId());
+  std::map<std::string, GLint>::iterator attribute_iter =
+      attribute_locations_.begin();
+  for (; attribute_iter != attribute_locations_.end(); ++attribute_iter) {
+    attribute_iter->second =
+        glGetAttribLocation(program_.Get(), attribute_iter->first.c_str());
   }
-  if (geometry_shader) {
-    glAttachShader(program_id_, geometry_shader->GetShaderId());
+  std::map<std::string, GLuint>::iterator block_iter = uniform_blocks_.begin();
+  for (; block_iter != uniform_blocks_.end(); ++block_iter) {
+    GLuint index =
+        glGetUniformBlockIndex(program_.Get(), block_iter->first.c_str());
+    if (index != GL_INVALID_INDEX)
+      glUniformBlockBinding(program_.Get(), index, block_iter->second);
   }
-  if (tesselation_shader) {
-    glAttachShader(program_id_, tesselation_shader->GetShaderId());
+  // Uniforms of a new program start at zero
+  if (!sampler_units_.empty())
+    RenderState::Instance()->UseProgram(program_.Get());
+  std::map<std::string, GLint>::iterator sampler_iter = sampler_units_.begin();
+  for (; sampler_iter != sampler_units_.end(); ++sampler_iter) {
+    glUniform1i(
+        glGetUniformLocation(program_.Get(), sampler_iter->first.c_str()),
+        sampler_iter->second);
   }
-  glLinkProgram(program_id_);
+  // The name of the deleted program may be reused
+  RenderState::Instance()->Invalidate();
+  return true;
+}
 
-	// Check the program
-	glGetProgramiv(program_id_, GL_LINK_STATUS, &result);
-	glGetProgramiv(program_id_, GL_INFO_LOG_LENGTH, &info_log_length);
-	if ( info_log_length > 0 ){
-		std::vector<char> program_error_message(info_log_length+1);
-		glGetProgramInfoLog(
-        program_id_,
-        info_log_length,
-        NULL,
-        &program_error_message[0]);
-		printf("%s\n", &program_error_message[0]);
-    //if linking the shaders failed, set to 0
-    if(result == GL_FALSE)
-      program_id_ = 0;
+//! Returns true if the Shader is linked in to the ShaderProgram.
+
+bool ShaderProgram::UsesShader(Shader* shader){
+  for (int i = 0; i < shaders_.size(); ++i) {
+    if (shaders_[i] == shader)
+      return true;
+  }
+  return false;
+}
+
+//! Internal function returning the path of the cached program binary.
+/*!
+ The file name is a hash of the Shader sources and the driver, so a binary
+ is never loaded for other sources or by another driver.
+ \return The path, or an empty string if program binaries are not supported.
+ */
+
+std::string ShaderProgram::GetCachePath(){
+  if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+    return "";
+  GLint n_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  if (n_formats == 0)
+    return "";
+
+  unsigned long long hash = 14695981039346656037ULL;
+  for (int i = 0; i < shaders_.size(); ++i) {
+    const std::string& source = shaders_[i]->GetSource();
+    Hash(source.c_str(), source.size() + 1, &hash); // With the \0 separator
+  }
+  const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+  for (int i = 0; i < 3; ++i) {
+    const char* driver_string =
+        reinterpret_cast<const char*>(glGetString(driver_strings[i]));
+    if (driver_string)
+      Hash(driver_string, strlen(driver_string) + 1, &hash);
+  }
+  char file_name[32];
+  snprintf(file_name, sizeof(file_name), "/%016llx.bin", hash);
+  return ShaderManager::SHADER_CACHE_DIRECTORY + std::string(file_name);
+}
+
+//! Internal function loading a cached program binary.
+/*!
+ \param program_id is the program to load the binary in to.
+ \param path is the path from GetCachePath.
+ \return True if the binary was found and accepted by the driver.
+ */
+
+bool ShaderProgram::LoadBinary(GLuint program_id, const std::string& path){
+  if (path.empty())
+    return false;
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    return false;
+  unsigned int magic = 0;
+  GLenum format = 0;
+  GLint length = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  file.read(reinterpret_cast<char*>(&format), sizeof(format));
+  file.read(reinterpret_cast<char*>(&length), sizeof(length));
+  if (!file || magic != PROGRAM_BINARY_MAGIC || length <= 0)
+    return false;
+  std::vector<char> binary(length);
+  file.read(&binary[0], length);
+  if (!file)
+    return false;
+
+  glProgramBinary(program_id, format, &binary[0], length);
+  // Drivers reject binaries after updates even if the version string is kept
+  GLint result = GL_FALSE;
+  glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+  if (result == GL_FALSE)
+    return false;
+  printf("Loaded ShaderProgram %s\n", path.c_str());
+  return true;
+}
+
+//! Internal function saving the binary of a linked program to the cache.
+/*!
+ Failing to save only means that the program is linked again next time.
+ \param program_id is the linked program.
+ \param path is the path from GetCachePath.
+ */
+
+void ShaderProgram::SaveBinary(GLuint program_id, const std::string& path){
+  GLint length = 0;
+  glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
     return;
-	}
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program_id, length, &length, &format, &binary[0]);
+
+  QDir().mkpath(ShaderManager::SHADER_CACHE_DIRECTORY);
+  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    printf("Could not cache ShaderProgram in %s\n", path.c_str());
+    return;
+  }
+  unsigned int magic = PROGRAM_BINARY_MAGIC;
+  file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+  file.write(&binary[0], length);
 }
 
-//! Delete the ShaderProgram.
+//! Binds the ShaderProgram unless it is already bound, see RenderState.
 
-ShaderProgram::~ShaderProgram(){
-  glDeleteProgram(program_id_);
+void ShaderProgram::Use(){
+  RenderState::Instance()->UseProgram(program_.Get());
 }
 
 //! Create a location for an attribute in the ShaderProgram.
@@ -270,7 +721,7 @@ ShaderProgram::~ShaderProgram(){
 */
 
 void ShaderProgram::CreateAttribLocation(const char* name){
-  GLint loc = glGetAttribLocation(program_id_, name);
+  GLint loc = glGetAttribLocation(program_.Get(), name);
   if (loc == -1) {
     std::cout << "Error: Unknown Attrib name: " << name <<
     ". Could not create Attrib location." << std::endl;
@@ -283,20 +734,168 @@ void ShaderProgram::CreateAttribLocation(const char* name){
 /*!
  The name of the uniform needs to be specified in the source code of the
  shader. If it is not found it can not be created and an error message is
- printed. If it is found, the location is added to the std::map of uniforms.
- Then they can be accessed via name instead of GLint.
+ printed. The location is resolved once here and given a handle, then it can
+ be accessed via the handle or via name instead of GLint.
  \param name is the name of the uniform for which to create the location.
+ \return The handle of the uniform.
  */
 
-void ShaderProgram::CreateUniformLocation(const char* name){
-  GLint loc = glGetUniformLocation(program_id_, name);
+int ShaderProgram::CreateUniformLocation(const char* name){
+  GLint loc = glGetUniformLocation(program_.Get(), name);
   if (loc == -1) {
     std::cout << "Error: Unknown Uniform name: " << name <<
     ". Could not create Uniform location." << std::endl;
-        uniform_locations_.insert(std::pair<std::string, GLint>(name,loc));
-  } else{
-    uniform_locations_.insert(std::pair<std::string, GLint>(name,loc));
   }
+  std::map<std::string, int>::iterator it = uniform_handles_.find(name);
+  if (it != uniform_handles_.end()) {
+    uniform_locations_[it->second] = loc;
+    return it->second;
+  }
+  int handle = uniform_locations_.size();
+  uniform_handles_.insert(std::pair<std::string, int>(name, handle));
+  uniform_locations_.push_back(loc);
+  return handle;
+}
+
+//! Returns the handle of a uniform created with CreateUniformLocation.
+/*!
+ Meant to be called once, the handle is then used for setting data without
+ looking up the name.
+ \param name is the name of the uniform.
+ \return The handle of the uniform, or -1 if it was never created.
+ */
+
+int ShaderProgram::GetUniformHandle(const char* name){
+  std::map<std::string, int>::iterator it = uniform_handles_.find(name);
+  return it == uniform_handles_.end() ? -1 : it->second;
+}
+
+//! Binds a uniform block of the ShaderProgram to a binding point.
+/*!
+ The uniform buffer bound to the same binding point is then used for the
+ block. Blocks that are not found are ignored with an error message.
+ \param name is the name of the uniform block in the shader source code.
+ \param binding is the binding point, see ShaderManager::FRAME_DATA_BINDING.
+ */
+
+void ShaderProgram::BindUniformBlock(const char* name, GLuint binding){
+  GLuint index = glGetUniformBlockIndex(program_.Get(), name);
+  if (index == GL_INVALID_INDEX) {
+    std::cout << "Error: Unknown Uniform block name: " << name <<
+    ". Could not bind Uniform block." << std::endl;
+    return;
+  }
+  glUniformBlockBinding(program_.Get(), index, binding);
+  uniform_blocks_[name] = binding; // Bound again by Link
+}
+
+//! Sets the texture unit a sampler of the ShaderProgram reads from.
+/*!
+ Samplers that are not found are ignored with an error message.
+ \param name is the name of the sampler in the shader source code.
+ \param unit is the texture unit, see ShaderManager::SHADOW_MAP_UNIT.
+ */
+
+void ShaderProgram::BindSampler(const char* name, GLint unit){
+  GLint location = glGetUniformLocation(program_.Get(), name);
+  if (location == -1) {
+    std::cout << "Error: Unknown sampler name: " << name <<
+    ". Could not bind sampler." << std::endl;
+    return;
+  }
+  Use();
+  glUniform1i(location, unit);
+  sampler_units_[name] = unit; // Set again by Link
+}
+
+//! Internal function returning the location of a uniform from its name.
+/*!
+ Uniforms that were never created return -1, which OpenGL ignores.
+ */
+
+GLint ShaderProgram::GetUniformLocation(const char* name){
+  int handle = GetUniformHandle(name);
+  return handle == -1 ? -1 : uniform_locations_[handle];
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param v0 is the value to set.
+*/
+
+void ShaderProgram::Uniform1f(int handle, GLfloat v0){
+  glUniform1f(uniform_locations_[handle], v0);
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param v0 is the value to set.
+*/
+
+void ShaderProgram::Uniform1i(int handle, GLint v0){
+  glUniform1i(uniform_locations_[handle], v0);
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param count is the number of values to set.
+ \param value is a pointer to the values.
+*/
+
+void ShaderProgram::Uniform1fv(int handle, GLsizei count, const GLfloat *value){
+  glUniform1fv(uniform_locations_[handle], count, value);
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param count is the number of vectors to set.
+ \param value is a pointer to the values.
+*/
+
+void ShaderProgram::Uniform3fv(int handle, GLsizei count, const GLfloat *value){
+  glUniform3fv(uniform_locations_[handle], count, value);
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param count is the number of matrices to set.
+ \param transpose is true if the matrix is transposed
+ \param value is the value to set.
+*/
+
+void ShaderProgram::UniformMatrix4fv(
+    int handle,
+    GLsizei count,
+    GLboolean transpose,
+    const GLfloat *value){
+  glUniformMatrix4fv(uniform_locations_[handle], count, transpose, value);
+}
+
+//! Wrapper for OpenGL's function for uniform data.
+/*!
+ Set data for the specific uniform.
+ \param handle is the handle returned by CreateUniformLocation.
+ \param count is the number of matrices to set.
+ \param transpose is true if the matrix is transposed
+ \param value is the value to set.
+*/
+
+void ShaderProgram::UniformMatrix3fv(
+    int handle,
+    GLsizei count,
+    GLboolean transpose,
+    const GLfloat *value){
+  glUniformMatrix3fv(uniform_locations_[handle], count, transpose, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -308,7 +907,7 @@ void ShaderProgram::CreateUniformLocation(const char* name){
 
 // Uniforms
 void ShaderProgram::Uniform1f(const char* name, GLfloat v0){
-  glUniform1f(uniform_locations_[name], v0);
+  glUniform1f(GetUniformLocation(name), v0);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -320,7 +919,7 @@ void ShaderProgram::Uniform1f(const char* name, GLfloat v0){
 */
 
 void ShaderProgram::Uniform2f(const char* name, GLfloat v0, GLfloat v1){
-  glUniform2f(uniform_locations_[name], v0, v1);
+  glUniform2f(GetUniformLocation(name), v0, v1);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -337,7 +936,7 @@ void ShaderProgram::Uniform3f(
     GLfloat v0,
     GLfloat v1,
     GLfloat v2){
-  glUniform3f(uniform_locations_[name], v0, v1, v2);
+  glUniform3f(GetUniformLocation(name), v0, v1, v2);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -355,7 +954,7 @@ void ShaderProgram::Uniform4f(
     GLfloat v1,
     GLfloat v2,
     GLfloat v3){
-  glUniform4f(uniform_locations_[name], v0, v1, v2, v3);
+  glUniform4f(GetUniformLocation(name), v0, v1, v2, v3);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -366,7 +965,7 @@ void ShaderProgram::Uniform4f(
 */
 
 void ShaderProgram::Uniform1i(const char* name, GLint v0){
-  glUniform1i(uniform_locations_[name], v0);
+  glUniform1i(GetUniformLocation(name), v0);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -378,7 +977,7 @@ void ShaderProgram::Uniform1i(const char* name, GLint v0){
  */
 
 void ShaderProgram::Uniform2i(const char* name, GLint v0, GLint v1){
-  glUniform2i(uniform_locations_[name], v0, v1);
+  glUniform2i(GetUniformLocation(name), v0, v1);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -391,7 +990,7 @@ void ShaderProgram::Uniform2i(const char* name, GLint v0, GLint v1){
  */
 
 void ShaderProgram::Uniform3i(const char* name, GLint v0, GLint v1, GLint v2){
-  glUniform3i(uniform_locations_[name], v0, v1, v2);
+  glUniform3i(GetUniformLocation(name), v0, v1, v2);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -409,7 +1008,7 @@ void ShaderProgram::Uniform4i(
     GLint v1,
     GLint v2,
     GLint v3){
-  glUniform4i(uniform_locations_[name], v0, v1, v2, v3);
+  glUniform4i(GetUniformLocation(name), v0, v1, v2, v3);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -424,7 +1023,7 @@ void ShaderProgram::Uniform1fv(
     const char* name,
     GLsizei count,
     const GLfloat *value){
-  glUniform1fv(uniform_locations_[name], count, value);
+  glUniform1fv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -439,7 +1038,7 @@ void ShaderProgram::Uniform2fv(
     const char* name,
     GLsizei count,
     const GLfloat *value){
-  glUniform2fv(uniform_locations_[name], count, value);
+  glUniform2fv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -454,7 +1053,7 @@ void ShaderProgram::Uniform3fv(
     const char* name,
     GLsizei count,
     const GLfloat *value){
-  glUniform3fv(uniform_locations_[name], count, value);
+  glUniform3fv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -469,7 +1068,7 @@ void ShaderProgram::Uniform4fv(
     const char* name,
     GLsizei count,
     const GLfloat *value){
-  glUniform4fv(uniform_locations_[name], count, value);
+  glUniform4fv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -484,7 +1083,7 @@ void ShaderProgram::Uniform1iv(
     const char* name,
     GLsizei count,
     const GLint *value){
-  glUniform1iv(uniform_locations_[name], count, value);
+  glUniform1iv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -499,7 +1098,7 @@ void ShaderProgram::Uniform2iv(
     const char* name,
     GLsizei count,
     const GLint *value){
-  glUniform2iv(uniform_locations_[name], count, value);
+  glUniform2iv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -514,7 +1113,7 @@ void ShaderProgram::Uniform3iv(
     const char* name,
     GLsizei count,
     const GLint *value){
-  glUniform3iv(uniform_locations_[name], count, value);
+  glUniform3iv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -529,7 +1128,7 @@ void ShaderProgram::Uniform4iv(
     const char* name,
     GLsizei count,
     const GLint *value){
-  glUniform4iv(uniform_locations_[name], count, value);
+  glUniform4iv(GetUniformLocation(name), count, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -546,7 +1145,7 @@ void ShaderProgram::UniformMatrix2fv(
     GLsizei count,
     GLboolean transpose,
     const GLfloat *value){
-  glUniformMatrix2fv(uniform_locations_[name], count, transpose, value);
+  glUniformMatrix2fv(GetUniformLocation(name), count, transpose, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -563,7 +1162,7 @@ void ShaderProgram::UniformMatrix3fv(
     GLsizei count,
     GLboolean transpose,
     const GLfloat *value){
-  glUniformMatrix3fv(uniform_locations_[name], count, transpose, value);
+  glUniformMatrix3fv(GetUniformLocation(name), count, transpose, value);
 }
 
 //! Wrapper for OpenGL's function for uniform data.
@@ -580,7 +1179,7 @@ void ShaderProgram::UniformMatrix4fv(
     GLsizei count,
     GLboolean transpose,
     const GLfloat *value){
-  glUniformMatrix4fv(uniform_locations_[name], count, transpose, value);
+  glUniformMatrix4fv(GetUniformLocation(name), count, transpose, value);
 }
 
 //! Wrapper for OpenGL's function for attribute data.
@@ -753,7 +1352,7 @@ void ShaderProgram::VertexAttribI4uiv(const char* name, const GLuint *v){
 */
 
 GLuint ShaderProgram::getID(){
-  return program_id_;
+  return program_.Get();
 }
 
 ////////////
@@ -762,75 +1361,122 @@ GLuint ShaderProgram::getID(){
 
 //! Constructor for the shader
 /*!
- Compiles the Shader from the file path.
+ Reads the Shader source from the file path. The Shader is compiled the
+ first time its id is needed, see GetShaderId.
  \param file_path is the path for where the Shader source is to be found.
+ \param preprocessor_code is put before the source of the file.
  \param type is the type of the Shader. Can be GL_VERTEX_SHADER or
  GL_FRAGMENT_SHADER.
  */
 
 Shader::Shader(const char* file_path, const char* preprocessor_code, int type){
-  // Create the shader
-  shader_id_ = glCreateShader(type);
-
-
-  if (shader_id_ == 0) {
-    std::cout << "ERROR: Invalid shader type: " << type << "!" << std::endl;
-    return;
-  }
+  type_ = type;
+  file_path_ = file_path;
+  preprocessor_code_ = preprocessor_code;
   // Read the Shader code from the file
-	std::string shader_code = preprocessor_code;
-	std::ifstream shader_stream(file_path, std::ios::in);
-	if(shader_stream.is_open()){
-		std::string line = "";
-		while(getline(shader_stream, line))
-			shader_code += "\n" + line;
-		shader_stream.close();
-	}else{
+  std::string file_source;
+  if (!ReadFile(file_path_, &file_source)) {
 		printf("ERROR: Impossible to open %s. Are you in the right directory?\n",
            file_path);
 		getchar();
-    shader_id_ = 0;
     return;
   }
+  source_ = preprocessor_code_ + file_source;
+}
 
-  GLint result = GL_FALSE;
-	int info_log_length;
+//! Get the id of the Shader.
+/*!
+ Compiles the Shader if it is not compiled yet.
+ \return The id, or 0 if the Shader could not be compiled.
+ */
 
-  // Compile Vertex Shader
-	printf("Compiling shader : %s\n", file_path);
-	char const * vertex_source_pointer = shader_code.c_str();
-	glShaderSource(shader_id_, 1, &vertex_source_pointer , NULL);
-	glCompileShader(shader_id_);
+GLuint Shader::GetShaderId(){
+  if (shader_.Get() == 0)
+    Compile();
+  return shader_.Get();
+}
 
+//! Returns the source code, the preprocessor code followed by the file.
 
-	// Check Vertex Shader
-	glGetShaderiv(shader_id_, GL_COMPILE_STATUS, &result);
-	glGetShaderiv(shader_id_, GL_INFO_LOG_LENGTH, &info_log_length);
-	if ( info_log_length > 0 ){
-		std::vector<char> error_message(info_log_length+1);
-		glGetShaderInfoLog(shader_id_, info_log_length, NULL, &error_message[0]);
-		printf("%s\n", &error_message[0]);
-    //if compiling the shader failed, set to 0
-    if(result == GL_FALSE)
-      shader_id_ = 0;
-    return;
-	}
+const std::string& Shader::GetSource(){
+  return source_;
+}
 
+//! Returns the path of the shader file.
+
+const std::string& Shader::GetFilePath(){
+  return file_path_;
 }
 
-//! Destructor for the shader
+//! Replaces the source of the file, the preprocessor code is kept.
 /*!
- Releases memory on the GPU.
-*/
+ The Shader is compiled again the next time its id is needed. ShaderPrograms
+ using it need to be linked again to use the new source.
+ \param file_source is the new content of the file, read by ReadFile.
+ */
 
-Shader::~Shader(){
-  glDeleteShader
-  (shader_id_);
+void Shader::SetFileSource(const std::string& file_source){
+  source_ = preprocessor_code_ + file_source;
+  shader_.Reset();
 }
 
+//! Reads a shader file.
+/*!
+ Every line is preceded by a new line, so the file can be put directly after
+ the preprocessor code. Does not call OpenGL and can be used on any thread.
+ \param file_path is the path of the file.
+ \param file_source is set to the content of the file.
+ \return False if the file could not be opened.
+ */
 
-//! Get the id of the Shader.
+bool Shader::ReadFile(const std::string& file_path, std::string* file_source){
+	std::ifstream shader_stream(file_path.c_str(), std::ios::in);
+	if(!shader_stream.is_open())
+    return false;
+  file_source->clear();
+  std::string line = "";
+  while(getline(shader_stream, line))
+    *file_source += "\n" + line;
+  shader_stream.close();
+  return true;
+}
 
-GLuint Shader::GetShaderId(){
-  return shader_id_;
+//! Internal function compiling the source code.
+/*!
+ Sets the id to 0 if the Shader could not be compiled.
+ */
+
+void Shader::Compile(){
+  if (source_.empty())
+    return; // The file could not be read
+
+  // Create the shader
+  shader_ = GLShader(glCreateShader(type_));
+  GLuint shader_id = shader_.Get();
+  if (shader_id == 0) {
+    std::cout << "ERROR: Invalid shader type: " << type_ << "!" << std::endl;
+    return;
+  }
+
+  GLint result = GL_FALSE;
+	int info_log_length;
+
+  // Compile Vertex Shader
+	printf("Compiling shader : %s\n", file_path_.c_str());
+	char const * vertex_source_pointer = source_.c_str();
+	glShaderSource(shader_id, 1, &vertex_source_pointer , NULL);
+	glCompileShader(shader_id);
+
+
+	// Check Vertex Shader
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+	glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+	if ( info_log_length > 0 ){
+		std::vector<char> error_message(info_log_length+1);
+		glGetShaderInfoLog(shader_id, info_log_length, NULL, &error_message[0]);
+		printf("%s\n", &error_message[0]);
+	}
+  //if compiling the shader failed, set to 0
+  if(result == GL_FALSE)
+    shader_.Reset();
 }
@@ -0,0 +1,256 @@
+#include "ShadowMap.h"
+#include "Node.h"
+#include "Scene.h"
+#include "ShaderManager.h"
+
+// C++
+#include <cmath>
+
+// Depth bias of the shadow pass, keeps lit surfaces from shadowing themselves
+static const float POLYGON_OFFSET_FACTOR = 2.0f;
+static const float POLYGON_OFFSET_UNITS = 4.0f;
+// Smaller differences between transforms are not a movement
+static const float MOVE_TOLERANCE = 1e-4f;
+
+const int ShadowMap::SIZE;
+const float ShadowMap::MARGIN_DEGREES = 5.0f;
+const float ShadowMap::NEAR_CLIPPING = 0.5f;
+const float ShadowMap::FAR_CLIPPING = 100.0f;
+
+//! Constructor. No OpenGL objects are created until the first Render.
+ShadowMap::ShadowMap() {
+  spot_cutoff_ = 0.0f;
+  aimed_ = false;
+  static_valid_ = false;
+  n_casters_ = 0;
+  n_static_updates_ = 0;
+}
+
+//! Aims the shadow map at the cone of a spot light.
+/*!
+  Nothing changes while the spot stays within MARGIN_DEGREES of the
+  direction the map was aimed in, so the cached depth stays valid. Should
+  be called every frame before GetMatrix is used.
+  \param light is the spot light casting the shadows.
+*/
+void ShadowMap::Aim(const LightSource& light) {
+  float length = glm::length(light.spot_direction);
+  if (length == 0.0f)
+    return;
+  glm::vec3 position(light.position);
+  glm::vec3 direction = light.spot_direction / length;
+  if (aimed_ &&
+      position == position_ &&
+      light.spot_cutoff == spot_cutoff_ &&
+      glm::dot(direction, direction_) >=
+          std::cos(glm::radians(MARGIN_DEGREES)))
+    return;
+
+  position_ = position;
+  direction_ = direction;
+  spot_cutoff_ = light.spot_cutoff;
+  glm::vec3 up = std::abs(direction.y) > 0.99f ?
+      glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+  glm::mat4 view = glm::lookAt(position, position + direction, up);
+  glm::mat4 projection = glm::perspective(
+      glm::radians(2.0f * (light.spot_cutoff + MARGIN_DEGREES)),
+      1.0f,
+      NEAR_CLIPPING,
+      FAR_CLIPPING);
+  matrix_ = projection * view;
+  aimed_ = true;
+  static_valid_ = false;
+}
+
+//! Returns the view projection matrix of the light, see Aim.
+glm::mat4 ShadowMap::GetMatrix() const {
+  return matrix_;
+}
+
+//! Returns the volume seen from the light, Nodes outside cast no shadow.
+Frustum ShadowMap::GetFrustum() const {
+  return Frustum(matrix_);
+}
+
+//! Returns the number of moving boxes drawn in the last Render.
+int ShadowMap::GetNumberOfCasters() const {
+  return n_casters_;
+}
+
+//! Returns how many times the depth of the static Nodes has been drawn.
+int ShadowMap::GetNumberOfStaticUpdates() const {
+  return n_static_updates_;
+}
+
+//! Draws the depth seen from the light and binds the shadow map.
+/*!
+  The FrameData block needs to have the matrix of GetMatrix, see
+  ShaderManager::UpdateFrameData. The cached depth of the static Nodes is
+  only drawn again if the map was aimed or they moved. The frame buffer and
+  the viewport are restored afterwards, and the shadow map is bound to
+  ShaderManager::SHADOW_MAP_UNIT for the rest of the frame.
+  \param nodes are all Nodes of the Scene.
+  \param n_static_nodes is the number of Nodes, first in nodes, that do not
+  move by themselves.
+*/
+void ShadowMap::Render(std::vector<Node>* nodes, int n_static_nodes) {
+  // Saved first, SetupBuffers binds frame buffers too
+  GLint frame_buffer_id;
+  GLint viewport[4];
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &frame_buffer_id);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  if (shadow_texture_.Get() == GL_FALSE)
+    SetupBuffers();
+  glViewport(0, 0, SIZE, SIZE);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(POLYGON_OFFSET_FACTOR, POLYGON_OFFSET_UNITS);
+
+  Frustum frustum = GetFrustum();
+  bool moved = StaticNodesMoved(nodes, n_static_nodes);
+  if (!static_valid_ || moved) {
+    glBindFramebuffer(GL_FRAMEBUFFER, static_frame_buffer_.Get());
+    glClear(GL_DEPTH_BUFFER_BIT);
+    static_boxes_.Clear();
+    for (int i = 0; i < n_static_nodes; ++i)
+      AddCaster(&(*nodes)[i], frustum, &static_boxes_);
+    static_boxes_.RenderDepth();
+    static_valid_ = true;
+    n_static_updates_++;
+  }
+
+  // Start from the cached depth, the copy never leaves the GPU
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, static_frame_buffer_.Get());
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadow_frame_buffer_.Get());
+  glBlitFramebuffer(
+      0, 0, SIZE, SIZE,
+      0, 0, SIZE, SIZE,
+      GL_DEPTH_BUFFER_BIT,
+      GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, shadow_frame_buffer_.Get());
+  dynamic_boxes_.Clear();
+  for (int i = n_static_nodes; i < nodes->size(); ++i)
+    AddCaster(&(*nodes)[i], frustum, &dynamic_boxes_);
+  dynamic_boxes_.RenderDepth();
+  n_casters_ = dynamic_boxes_.GetNumberOfInstances();
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_id);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  // Unit 0 stays active, the RenderState binds the texture array there
+  glActiveTexture(GL_TEXTURE0 + ShaderManager::SHADOW_MAP_UNIT);
+  glBindTexture(GL_TEXTURE_2D, shadow_texture_.Get());
+  glActiveTexture(GL_TEXTURE0);
+}
+
+//! Deallocate all textures and buffers from the GPU.
+void ShadowMap::DeleteBuffers() {
+  shadow_frame_buffer_.Reset();
+  static_frame_buffer_.Reset();
+  shadow_texture_.Reset();
+  static_texture_.Reset();
+  static_boxes_.DeleteBuffers();
+  dynamic_boxes_.DeleteBuffers();
+  static_valid_ = false;
+}
+
+//! Internal function creating the depth textures and their frame buffers.
+void ShadowMap::SetupBuffers() {
+  shadow_texture_ = CreateDepthTexture();
+  static_texture_ = CreateDepthTexture();
+  shadow_frame_buffer_ = GLFramebuffer::Create();
+  static_frame_buffer_ = GLFramebuffer::Create();
+  GLuint texture_ids[2] = {shadow_texture_.Get(), static_texture_.Get()};
+  GLuint frame_buffer_ids[2] = {
+      shadow_frame_buffer_.Get(),
+      static_frame_buffer_.Get()};
+  for (int i = 0; i < 2; ++i) {
+    glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_ids[i]);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER,
+        GL_DEPTH_ATTACHMENT,
+        GL_TEXTURE_2D,
+        texture_ids[i],
+        0);
+    // Depth only
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      printf("ERROR : Shadow map frame buffer is not complete\n");
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+//! Internal function creating a SIZE x SIZE depth texture.
+/*!
+  Lookups with a sampler2DShadow compare with the stored depth and filter
+  the results of the four nearest pixels. Outside of the map everything is
+  lit.
+  \return The new texture.
+*/
+GLTexture ShadowMap::CreateDepthTexture() {
+  GLTexture texture = GLTexture::Create();
+  glBindTexture(GL_TEXTURE_2D, texture.Get());
+  glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_DEPTH_COMPONENT24,
+      SIZE,
+      SIZE,
+      0,
+      GL_DEPTH_COMPONENT,
+      GL_UNSIGNED_INT,
+      NULL);
+  const GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(
+      GL_TEXTURE_2D,
+      GL_TEXTURE_COMPARE_MODE,
+      GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+//! Internal function telling if a static Node moved since the cache was drawn.
+/*!
+  Also remembers the current transforms for the next call.
+*/
+bool ShadowMap::StaticNodesMoved(std::vector<Node>* nodes, int n_static_nodes) {
+  bool moved = static_transforms_.size() != n_static_nodes;
+  static_transforms_.resize(n_static_nodes);
+  for (int i = 0; i < n_static_nodes; ++i) {
+    glm::mat4 transform = (*nodes)[i].GetTransform();
+    for (int c = 0; c < 4; ++c) {
+      glm::vec4 difference = glm::abs(transform[c] - static_transforms_[i][c]);
+      if (glm::max(glm::max(difference.x, difference.y),
+                   glm::max(difference.z, difference.w)) > MOVE_TOLERANCE)
+        moved = true;
+    }
+    static_transforms_[i] = transform;
+  }
+  return moved;
+}
+
+//! Internal function drawing a Node in to the bound depth buffer.
+/*!
+  Nodes outside of the frustum of the light are skipped. Boxes are added
+  to be drawn together by RenderDepth of the InstancedRenderer, the other
+  Nodes are drawn right away.
+*/
+void ShadowMap::AddCaster(
+        Node* node,
+        const Frustum& frustum,
+        InstancedRenderer* boxes) {
+  glm::vec3 min, max;
+  node->GetBoundingBox(&min, &max);
+  if (!frustum.IntersectsBox(min, max))
+    return;
+  if (node->IsInstanced())
+    boxes->Add(node->GetTransform(), node->GetScale(), node->GetMaterialIndex());
+  else
+    node->RenderDepth();
+}
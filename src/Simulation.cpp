@@ -1,6 +1,15 @@
 #include "Simulation.h"
 
-Simulation::Simulation(bool vis_sim) {
+const int Simulation::RECORD_STRIDE;
+
+//! Creates a Simulation with the ground and the light source.
+/*!
+  \param settings is the snapshot of the generation or batch the Simulation
+  belongs to. The simulation time is read from it, so all Simulations of a
+  batch run equally long even if the GUI changes the setting meanwhile.
+  \param vis_sim tells if the Simulation is shown in the Scene.
+*/
+Simulation::Simulation(const SettingsSnapshot& settings, bool vis_sim) {
   broad_phase_ = new btDbvtBroadphase();
   collision_configuration_ = new btDefaultCollisionConfiguration();
   dispatcher_ = new btCollisionDispatcher(collision_configuration_);
@@ -9,10 +18,13 @@ Simulation::Simulation(bool vis_sim) {
   dynamics_world_ = new btDiscreteDynamicsWorld(dispatcher_,
   broad_phase_, solver_, collision_configuration_);
 
-  time_to_simulate_ = SettingsManager::Instance()->GetSimulationTime();
+  time_to_simulate_ = settings.simulation_time;
   counter_ = 0.0;
   fps_ = 60;
   vis_sim_ = vis_sim;
+  record_ = false;
+  writer_ = NULL;
+  writer_generation_ = 0;
 
   // Material
   ground_material_.texture_diffuse_type = CHECKERBOARD;
@@ -124,6 +136,7 @@ void Simulation::AddPopulation(Population population, bool disp) {
   float displacement = 0.0f;
   for (int i = 0; i < population.size(); ++i) {
     population[i].simdata.ResetData();
+    population[i].SetTrajectory(NULL);
     BulletCreature* btc;
     if(disp)
       btc = new BulletCreature(population[i], displacement);
@@ -152,20 +165,14 @@ void Simulation::AddPopulation(Population population, bool disp) {
   }
 }
 
+//! Steps the physics and the creatures.
+/*!
+  The light source target of a visualization Simulation is moved by the
+  Scene with SetLightPosition, through the PhysicsThread when it steps the
+  Simulation.
+  \param dt is the time step in seconds.
+*/
 void Simulation::Step(float dt) {
-  // Update the position of the target
-  if (vis_sim_) {
-    btTransform light_pos;
-    light_pos.setIdentity();
-
-    light_pos.setOrigin(btVector3(
-            SettingsManager::Instance()->GetTargetPos().x,
-            SettingsManager::Instance()->GetTargetPos().y,
-            SettingsManager::Instance()->GetTargetPos().z));
-    light_rigid_body_->setCenterOfMassTransform(light_pos);
-  }
-
-
   /*
     Step through all BulletCreatures and Creatures to update motors
     and feed Creature with performance data.
@@ -213,25 +220,137 @@ void Simulation::Step(float dt) {
     //std::vector<float> sim_data;
     //sim_data.push_back(distance2_to_light);
     bt_population_[i]->SetDistanceToLight(distance2_to_light);
-    bt_population_[i]->CollectData();
+    bt_population_[i]->CollectData(counter_ / time_to_simulate_);
   }
   dynamics_world_->stepSimulation(dt, 1);
   counter_ += dt;
 }
 
 Population Simulation::SimulatePopulation() {
+  Population creatures_with_data(bt_population_.size());
+  SimulatePopulation(&creatures_with_data);
+  return creatures_with_data;
+}
+
+//! Simulates the added creatures and writes the result back in place.
+/*!
+  \param population is where the creatures with simulation data are
+  written. It must have the same size as the population added to the
+  Simulation. Assigning in to the existing creatures reuses their memory.
+*/
+void Simulation::SimulatePopulation(Population* population) {
   float dt = 1.0f / static_cast<float>(fps_);
+  int n_steps = fps_*time_to_simulate_;
+
+  trajectories_.clear();
+  if (record_) {
+    for (int i = 0; i < bt_population_.size(); ++i) {
+      int n_bodies = bt_population_[i]->GetRigidBodies().size();
+      trajectories_.push_back(std::make_shared<Trajectory>(
+              n_bodies, RECORD_STRIDE * dt));
+      trajectories_.back()->Reserve(n_steps / RECORD_STRIDE + 1);
+      trajectories_.back()->SetLightPosition(GetLightPosition());
+    }
+  }
+  bool write = writer_ && writer_->IsOpen();
+  chunks_.clear();
+  if (write) {
+    int first_creature = writer_->ReserveCreatures(bt_population_.size());
+    chunks_.resize(bt_population_.size());
+    for (int i = 0; i < bt_population_.size(); ++i) {
+      chunks_[i].creature = first_creature + i;
+      chunks_[i].generation = writer_generation_;
+      chunks_[i].n_bodies = bt_population_[i]->GetRigidBodies().size();
+      chunks_[i].n_joints = bt_population_[i]->GetJoints().size();
+      chunks_[i].frame_time = RECORD_STRIDE * dt;
+    }
+  }
+  if (record_ || write)
+    RecordFrame();
 
-  for (int i = 0; i < fps_*time_to_simulate_; ++i) {
+  for (int i = 0; i < n_steps; ++i) {
     Step(dt);
+    if ((record_ || write) && (i + 1) % RECORD_STRIDE == 0)
+      RecordFrame();
   }
+  for (int i = 0; i < chunks_.size(); ++i)
+    FlushChunk(i);
 
-  Population creatures_with_data;
   for (int i = 0; i < bt_population_.size(); ++i) {
-    creatures_with_data.push_back(bt_population_[i]->GetCreature());
+    (*population)[i] = bt_population_[i]->GetCreature();
+    if (record_)
+      (*population)[i].SetTrajectory(trajectories_[i]);
   }
+}
 
-  return creatures_with_data;
+//! Sets if SimulatePopulation records a Trajectory of every creature.
+/*!
+  The transforms of all rigid bodies are recorded every RECORD_STRIDE steps
+  and the Trajectory is set on the simulated creatures, so they can be
+  played back exactly as they were evaluated.
+  \param record tells if the creatures should be recorded.
+*/
+void Simulation::SetRecording(bool record) {
+  record_ = record;
+}
+
+//! Sets a file that SimulatePopulation writes the motion of all creatures to.
+/*!
+  Every RECORD_STRIDE steps the transforms of all rigid bodies and the
+  angles of all joints are recorded. Every TrajectoryWriter::CHUNK_FRAMES
+  frames of a creature are handed to the writer as one chunk.
+  \param writer is the writer, NULL stops writing.
+  \param generation is stored with the chunks.
+*/
+void Simulation::SetTrajectoryWriter(TrajectoryWriter* writer, int generation) {
+  writer_ = writer;
+  writer_generation_ = generation;
+}
+
+//! Internal function recording the current state of all creatures.
+void Simulation::RecordFrame() {
+  for (int i = 0; i < bt_population_.size(); ++i) {
+    std::vector<btRigidBody*> bodies = bt_population_[i]->GetRigidBodies();
+    frame_transforms_.resize(bodies.size());
+    for (int j = 0; j < bodies.size(); ++j)
+      frame_transforms_[j] = bodies[j]->getWorldTransform();
+    if (record_ && !bodies.empty())
+      trajectories_[i]->AddFrame(&frame_transforms_[0]);
+
+    if (chunks_.empty())
+      continue;
+    TrajectoryChunk& chunk = chunks_[i];
+    if (chunk.values.empty())
+      chunk.values.reserve(TrajectoryWriter::CHUNK_FRAMES * chunk.FrameSize());
+    for (int j = 0; j < bodies.size(); ++j) {
+      const btVector3& origin = frame_transforms_[j].getOrigin();
+      btQuaternion rotation = frame_transforms_[j].getRotation();
+      chunk.values.push_back(origin.getX());
+      chunk.values.push_back(origin.getY());
+      chunk.values.push_back(origin.getZ());
+      chunk.values.push_back(rotation.getX());
+      chunk.values.push_back(rotation.getY());
+      chunk.values.push_back(rotation.getZ());
+      chunk.values.push_back(rotation.getW());
+    }
+    std::vector<btHingeConstraint*> joints = bt_population_[i]->GetJoints();
+    for (int j = 0; j < joints.size(); ++j)
+      chunk.values.push_back(joints[j]->getHingeAngle());
+    chunk.n_frames++;
+    if (chunk.n_frames == TrajectoryWriter::CHUNK_FRAMES)
+      FlushChunk(i);
+  }
+}
+
+//! Internal function giving the recorded frames of a creature to the writer.
+void Simulation::FlushChunk(int i) {
+  TrajectoryChunk& chunk = chunks_[i];
+  if (chunk.n_frames == 0)
+    return;
+  writer_->Submit(&chunk);
+  chunk.first_frame += chunk.n_frames;
+  chunk.n_frames = 0;
+  chunk.values.clear();
 }
 
 std::vector<Node> Simulation::GetNodes() {
@@ -252,9 +371,37 @@ std::vector<Node> Simulation::GetNodes() {
     return nodes;
 }
 
+//! Returns the number of bodies of every creature, in the order of GetNodes.
+std::vector<int> Simulation::GetCreatureBodyCounts() {
+    std::vector<int> counts;
+    for(BulletCreature* bt_creature : bt_population_)
+        counts.push_back(bt_creature->GetRigidBodies().size());
+    return counts;
+}
+
 btVector3 Simulation::GetLastCreatureCoords() {
    if(bt_population_.size() > 0)
        return bt_population_.back()->GetCenterOfMass();
    else
        return btVector3(0.0,0.0,0.0);
 }
+
+//! Returns the position of the light source target.
+btVector3 Simulation::GetLightPosition() {
+  return light_rigid_body_->getCenterOfMassPosition();
+}
+
+//! Moves the light source target.
+/*!
+  The target is placed at a random position when the Simulation is
+  created. Simulations evaluating creatures that should be compared to each
+  other can share the same position with this.
+  \param position is the new position of the target.
+*/
+void Simulation::SetLightPosition(const btVector3& position) {
+  btTransform light_pos;
+  light_pos.setIdentity();
+  light_pos.setOrigin(position);
+  light_rigid_body_->setCenterOfMassTransform(light_pos);
+  light_rigid_body_->getMotionState()->setWorldTransform(light_pos);
+}
@@ -0,0 +1,375 @@
+#include "SweepRunner.h"
+#include "BatchRNG.h"
+#include "EvolutionManager.h"
+#include "SettingsManager.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+// External
+#include <QDir>
+#include <QProcess>
+#include <QStringList>
+#include <QThread>
+
+//! Internal function removing spaces around a string.
+static std::string Trim(const std::string& text) {
+  size_t begin = text.find_first_not_of(" \t\r");
+  if (begin == std::string::npos)
+    return "";
+  return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+//! Internal function formatting a value drawn from a range.
+static std::string FormatRangeValue(double value, bool integer) {
+  std::ostringstream out;
+  if (integer)
+    out << static_cast<long long>(std::floor(value + 0.5));
+  else
+    out << std::setprecision(6) << value;
+  return out.str();
+}
+
+//! Constructor
+SweepRunner::SweepRunner() {
+  random_design_ = false;
+  samples_ = 10;
+  grid_steps_ = 3;
+  repeats_ = 1;
+  seed_ = 1;
+}
+
+//! Reads a sweep file.
+/*!
+  Every setting and value is checked on a SettingsManager of its own, so
+  mistakes are found before any job is started.
+  \return False if the file can not be read or has bad lines.
+*/
+bool SweepRunner::Load(const std::string& path) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    std::cout << "WARNING: could not read " << path << "!" << std::endl;
+    return false;
+  }
+  fixed_.clear();
+  parameters_.clear();
+  jobs_.clear();
+
+  SettingsManager check;
+  bool ok = true;
+  std::string line, key, value;
+  for (int n = 1; std::getline(in, line); ++n) {
+    if (!SettingsManager::ParseConfigLine(line, &key, &value)) {
+      if (!Trim(line.substr(0, line.find('#'))).empty()) {
+        std::cout << "WARNING: " << path << ":" << n << " is not a setting!" << std::endl;
+        ok = false;
+      }
+      continue;
+    }
+
+    if (key.compare(0, 6, "sweep_") == 0) {
+      std::istringstream number(value);
+      if (key == "sweep_design" && (value == "grid" || value == "random"))
+        random_design_ = value == "random";
+      else if (key == "sweep_samples" && number >> samples_ && samples_ > 0) {}
+      else if (key == "sweep_grid_steps" && number >> grid_steps_ && grid_steps_ > 0) {}
+      else if (key == "sweep_repeats" && number >> repeats_ && repeats_ > 0) {}
+      else if (key == "sweep_seed" && number >> seed_) {}
+      else {
+        std::cout << "WARNING: " << path << ":" << n << " bad sweep setting!" << std::endl;
+        ok = false;
+      }
+      continue;
+    }
+
+    SweepParameter parameter;
+    parameter.key = key;
+    parameter.low = 0.0;
+    parameter.high = 0.0;
+    parameter.integer = false;
+    size_t dots = value.find("..");
+    if (value.find(',') != std::string::npos) {
+      std::istringstream list(value);
+      std::string item;
+      while (std::getline(list, item, ','))
+        parameter.values.push_back(Trim(item));
+      for (int i = 0; i < parameter.values.size(); ++i)
+        ok = check.SetValue(key, parameter.values[i]) && ok;
+      parameters_.push_back(parameter);
+    }
+    else if (dots != std::string::npos) {
+      std::string low = Trim(value.substr(0, dots));
+      std::string high = Trim(value.substr(dots + 2));
+      std::istringstream range(low + " " + high);
+      if (!(range >> parameter.low >> parameter.high) ||
+          !check.SetValue(key, low) || !check.SetValue(key, high)) {
+        std::cout << "WARNING: " << path << ":" << n << " bad range!" << std::endl;
+        ok = false;
+        continue;
+      }
+      parameter.integer = SettingsManager::IsWholeNumber(key);
+      parameters_.push_back(parameter);
+    }
+    else {
+      ok = check.SetValue(key, value) && ok;
+      fixed_.push_back(std::make_pair(key, value));
+    }
+  }
+  return ok;
+}
+
+//! Creates the jobs of the design.
+/*!
+  A grid design has a job for every combination of the values of the
+  parameters, a random design has sweep_samples points where every
+  parameter is drawn independently. Every point is repeated sweep_repeats
+  times.
+*/
+void SweepRunner::Expand() {
+  jobs_.clear();
+
+  std::vector<std::vector<std::string> > points;
+  if (random_design_) {
+    BatchRNG rng(seed_);
+    for (int p = 0; p < samples_; ++p) {
+      std::vector<std::string> values;
+      for (int i = 0; i < parameters_.size(); ++i) {
+        const SweepParameter& parameter = parameters_[i];
+        if (!parameter.values.empty()) {
+          values.push_back(
+              parameter.values[rng.UniformInt(parameter.values.size())]);
+        }
+        else {
+          double low = parameter.low;
+          double high = parameter.high;
+          if (parameter.integer) {
+            // Every whole number is equally likely, the ends included
+            low -= 0.5;
+            high += 0.5;
+          }
+          values.push_back(FormatRangeValue(
+              low + rng.Uniform() * (high - low), parameter.integer));
+        }
+      }
+      points.push_back(values);
+    }
+  }
+  else {
+    std::vector<std::vector<std::string> > levels(parameters_.size());
+    for (int i = 0; i < parameters_.size(); ++i) {
+      const SweepParameter& parameter = parameters_[i];
+      levels[i] = parameter.values;
+      if (!levels[i].empty())
+        continue;
+      for (int s = 0; s < grid_steps_; ++s) {
+        double t = grid_steps_ > 1 ? s / double(grid_steps_ - 1) : 0.0;
+        std::string value = FormatRangeValue(
+            parameter.low + t * (parameter.high - parameter.low),
+            parameter.integer);
+        if (levels[i].empty() || levels[i].back() != value)
+          levels[i].push_back(value);
+      }
+    }
+    // Count through the combinations, the last parameter changes fastest
+    std::vector<int> level(parameters_.size(), 0);
+    while (true) {
+      std::vector<std::string> values;
+      for (int i = 0; i < parameters_.size(); ++i)
+        values.push_back(levels[i][level[i]]);
+      points.push_back(values);
+      int i = parameters_.size() - 1;
+      while (i >= 0 && ++level[i] == levels[i].size()) {
+        level[i] = 0;
+        --i;
+      }
+      if (i < 0)
+        break;
+    }
+  }
+
+  for (int p = 0; p < points.size(); ++p) {
+    for (int r = 0; r < repeats_; ++r) {
+      SweepJob job;
+      job.index = jobs_.size();
+      job.point = p;
+      job.repeat = r;
+      job.values = points[p];
+      jobs_.push_back(job);
+    }
+  }
+}
+
+const std::vector<SweepParameter>& SweepRunner::GetParameters() const {
+  return parameters_;
+}
+
+const std::vector<SweepJob>& SweepRunner::GetJobs() const {
+  return jobs_;
+}
+
+//! Writes the config file of a job.
+/*!
+  The settings of this process are the base, then the shared settings of
+  the sweep and the values of the job are applied. Files written by the
+  run are moved next to the config, so parallel jobs do not share them.
+  \param job is the job.
+  \param prefix is the path of the job without extension, the config is
+  written to prefix.cfg.
+*/
+bool SweepRunner::WriteJobConfig(const SweepJob& job, const std::string& prefix) {
+  SettingsManager settings;
+  std::vector<std::string> keys = SettingsManager::GetKeys();
+  for (int i = 0; i < keys.size(); ++i)
+    settings.SetValue(keys[i], SettingsManager::Instance()->GetValue(keys[i]));
+  for (int i = 0; i < fixed_.size(); ++i)
+    settings.SetValue(fixed_[i].first, fixed_[i].second);
+  for (int i = 0; i < parameters_.size(); ++i)
+    settings.SetValue(parameters_[i].key, job.values[i]);
+
+  if (!settings.GetMapElitesCheckpoint().empty())
+    settings.SetMapElitesCheckpoint(prefix + ".chk");
+  if (!settings.GetTrajectoryFile().empty())
+    settings.SetTrajectoryFile(prefix + ".cetr");
+  return settings.SaveConfig(prefix + ".cfg");
+}
+
+//! Internal function returning the path of a job without extension.
+std::string SweepRunner::JobPrefix(
+        const std::string& directory,
+        const SweepJob& job) const {
+  std::ostringstream prefix;
+  prefix << directory << "/job_" << std::setw(4) << std::setfill('0') << job.index;
+  return prefix.str();
+}
+
+//! Runs all jobs and collects the results in directory/sweep.csv.
+/*!
+  The config, result and log of every job are kept in the directory.
+  \param program is the executable started for every job with --run.
+  \param directory is where all files of the sweep are written.
+  \param max_parallel is the number of jobs run at the same time, the
+  number of threads of the machine if 0 or less.
+  \return False if a job failed or the results could not be written.
+*/
+bool SweepRunner::Run(
+        const std::string& program,
+        const std::string& directory,
+        int max_parallel) {
+  if (!QDir().mkpath(QString::fromStdString(directory))) {
+    std::cout << "WARNING: could not create " << directory << "!" << std::endl;
+    return false;
+  }
+  int cores = std::max(1, QThread::idealThreadCount());
+  if (max_parallel <= 0)
+    max_parallel = cores;
+  int threads = std::max(1, cores / max_parallel);
+
+  bool ok = true;
+  int next = 0;
+  std::vector<std::pair<int, QProcess*> > running;
+  while (next < jobs_.size() || !running.empty()) {
+    while (next < jobs_.size() && running.size() < max_parallel) {
+      const SweepJob& job = jobs_[next++];
+      std::string prefix = JobPrefix(directory, job);
+      if (!WriteJobConfig(job, prefix)) {
+        std::cout << "WARNING: could not write " << prefix << ".cfg!" << std::endl;
+        ok = false;
+        continue;
+      }
+      QProcess* process = new QProcess();
+      process->setProcessChannelMode(QProcess::MergedChannels);
+      process->setStandardOutputFile(QString::fromStdString(prefix + ".log"));
+      QStringList arguments;
+      arguments << "--run" << QString::fromStdString(prefix + ".cfg") <<
+          "--result" << QString::fromStdString(prefix + ".csv") <<
+          "--threads" << QString::number(threads);
+      process->start(QString::fromStdString(program), arguments);
+      if (!process->waitForStarted()) {
+        std::cout << "WARNING: job " << job.index << " could not be started!" << std::endl;
+        ok = false;
+        delete process;
+        continue;
+      }
+      running.push_back(std::make_pair(job.index, process));
+      std::cout << "Started job " << job.index + 1 << " / " << jobs_.size() << std::endl;
+    }
+
+    for (int i = 0; i < running.size(); ++i) {
+      QProcess* process = running[i].second;
+      if (process->state() != QProcess::NotRunning &&
+          !process->waitForFinished(100))
+        continue;
+      // A process that never ran also ends NotRunning with exit code 0
+      if (process->error() == QProcess::FailedToStart ||
+          process->exitStatus() != QProcess::NormalExit ||
+          process->exitCode() != 0) {
+        std::cout << "WARNING: job " << running[i].first << " failed!" << std::endl;
+        ok = false;
+      }
+      delete process;
+      running.erase(running.begin() + i);
+      --i;
+    }
+  }
+  return WriteResults(directory) && ok;
+}
+
+//! Internal function merging the results of all jobs.
+/*!
+  Every row is one generation of one job, with the values of the
+  parameters of the job, so the curves of a design point can be grouped.
+*/
+bool SweepRunner::WriteResults(const std::string& directory) {
+  std::string path = directory + "/sweep.csv";
+  std::ofstream out(path.c_str());
+  if (!out) {
+    std::cout << "WARNING: could not write " << path << "!" << std::endl;
+    return false;
+  }
+  out << "job,point,repeat";
+  for (int i = 0; i < parameters_.size(); ++i)
+    out << "," << parameters_[i].key;
+  out << ",generation,best_fitness,seconds" << std::endl;
+
+  for (int j = 0; j < jobs_.size(); ++j) {
+    const SweepJob& job = jobs_[j];
+    std::ifstream in((JobPrefix(directory, job) + ".csv").c_str());
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line)) {
+      out << job.index << "," << job.point << "," << job.repeat;
+      for (int i = 0; i < job.values.size(); ++i)
+        out << "," << job.values[i];
+      out << "," << line << std::endl;
+    }
+  }
+  return out.good();
+}
+
+//! Runs one job in this process, used by the processes Run starts.
+/*!
+  \param config is the config file of the job.
+  \param result is where the best fitness of every generation is written.
+  \return False if the config or the result could not be read or written.
+*/
+bool SweepRunner::RunJob(const std::string& config, const std::string& result) {
+  if (!SettingsManager::Instance()->LoadConfig(config)) {
+    std::cout << "WARNING: could not load " << config << "!" << std::endl;
+    return false;
+  }
+  EvolutionManager evolution;
+  evolution.startEvolutionProcess();
+
+  std::ofstream out(result.c_str());
+  out << "generation,best_fitness,seconds" << std::endl;
+  const std::vector<ProgressRecord>& progress = evolution.GetProgress();
+  for (int i = 0; i < progress.size(); ++i) {
+    out << progress[i].generation << "," << progress[i].best_fitness << "," <<
+        progress[i].seconds << std::endl;
+  }
+  return out.good();
+}
@@ -0,0 +1,371 @@
+#include "TextureCodec.h"
+
+// C++
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const int TextureCodec::DXT1_BLOCK_SIZE;
+
+#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
+#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
+#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+
+//! Internal function packing a colour to RGB565.
+static int To565(const unsigned char* rgb) {
+  int r = (rgb[0] * 31 + 127) / 255;
+  int g = (rgb[1] * 63 + 127) / 255;
+  int b = (rgb[2] * 31 + 127) / 255;
+  return r << 11 | g << 5 | b;
+}
+
+//! Internal function unpacking a RGB565 colour the way the GPU does.
+static void From565(int color, unsigned char* rgb) {
+  int r = color >> 11 & 31;
+  int g = color >> 5 & 63;
+  int b = color & 31;
+  rgb[0] = static_cast<unsigned char>(r << 3 | r >> 2);
+  rgb[1] = static_cast<unsigned char>(g << 2 | g >> 4);
+  rgb[2] = static_cast<unsigned char>(b << 3 | b >> 2);
+}
+
+// Function based on the implementation from opengl-tutorial.org
+
+//! Reads a 24 bit bitmap in to one uncompressed level.
+/*!
+  \param file_path is the path of the .bmp file.
+  \param texture is replaced by the image.
+  \return False if the file could not be read or is not a 24 bit bitmap.
+*/
+bool TextureCodec::ReadBitmapFile(const char* file_path, TextureData* texture) {
+  printf("Reading bitmap image : %s\n", file_path);
+
+  // Data read from the header of the BMP file
+  unsigned char header[54];
+
+  // Open the file
+  FILE * file = fopen(file_path,"rb");
+  if (!file){
+    printf("%s could not be opened. Are you in the right directory?\n",
+      file_path);
+    return false;
+  }
+
+  // Read the header, i.e. the 54 first bytes. A BMP files always begins
+  // with "BM", it needs to be an uncompressed 24bpp file.
+  if (fread(header, 1, 54, file) != 54 ||
+      header[0] != 'B' || header[1] != 'M' ||
+      *(int*)&(header[0x1E]) != 0 ||
+      *(short*)&(header[0x1C]) != 24) {
+    printf("Not a correct BMP file\n");
+    fclose(file);
+    return false;
+  }
+
+  // Read the information about the image
+  unsigned int data_pos = *(int*)&(header[0x0A]);
+  int width = *(int*)&(header[0x12]);
+  int height = *(int*)&(header[0x16]);
+  bool top_down = height < 0; // The first row is the bottom unless negative
+  height = abs(height);
+  if (data_pos == 0)
+    data_pos = 54; // The BMP header is done that way
+  if (width <= 0 || height == 0) {
+    printf("Not a correct BMP file\n");
+    fclose(file);
+    return false;
+  }
+
+  // Rows are padded to four bytes in the file
+  int row_size = width * 3;
+  int row_stride = (row_size + 3) & ~3;
+  std::vector<unsigned char> row(row_stride);
+  texture->data.resize(row_size * height);
+  fseek(file, data_pos, SEEK_SET);
+  for (int y = 0; y < height; ++y) {
+    if (fread(&row[0], 1, row_stride, file) != row_stride &&
+        (y < height - 1 || ferror(file))) {
+      printf("Not a correct BMP file\n");
+      fclose(file);
+      return false;
+    }
+    unsigned char* out =
+        &texture->data[(top_down ? height - 1 - y : y) * row_size];
+    for (int x = 0; x < width; ++x) { // BGR to RGB
+      out[3 * x] = row[3 * x + 2];
+      out[3 * x + 1] = row[3 * x + 1];
+      out[3 * x + 2] = row[3 * x];
+    }
+  }
+  fclose(file);
+
+  TextureLevel level = {width, height, 0, row_size * height};
+  texture->levels.assign(1, level);
+  texture->internal_format = GL_RGB8;
+  texture->compressed = false;
+  return true;
+}
+
+// Function based on the implementation from opengl-tutorial.org
+
+//! Reads a DXT1, DXT3 or DXT5 compressed DDS file with all its levels.
+/*!
+  \param file_path is the path of the .dds file.
+  \param texture is replaced by the image.
+  \return False if the file could not be read or has another format.
+*/
+bool TextureCodec::ReadDDSFile(const char* file_path, TextureData* texture) {
+  unsigned char header[124];
+
+  /* try to open the file */
+  FILE *fp = fopen(file_path, "rb");
+  if (fp == NULL){
+    printf(
+            "%s could not be opened. Are you in the right directory?\n",
+            file_path);
+    return false;
+  }
+
+  /* verify the type of file and get the surface desc */
+  char filecode[4];
+  if (fread(filecode, 1, 4, fp) != 4 ||
+      strncmp(filecode, "DDS ", 4) != 0 ||
+      fread(&header, 124, 1, fp) != 1) {
+    fclose(fp);
+    return false;
+  }
+
+  unsigned int height      = *(unsigned int*)&(header[8 ]);
+  unsigned int width       = *(unsigned int*)&(header[12]);
+  unsigned int mipMapCount = *(unsigned int*)&(header[24]);
+  unsigned int fourCC      = *(unsigned int*)&(header[80]);
+
+  switch(fourCC)
+  {
+  case FOURCC_DXT1:
+    texture->internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    break;
+  case FOURCC_DXT3:
+    texture->internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    break;
+  case FOURCC_DXT5:
+    texture->internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    break;
+  default:
+    fclose(fp);
+    return false;
+  }
+  texture->compressed = true;
+
+  unsigned int blockSize = (fourCC == FOURCC_DXT1) ? 8 : 16;
+  if (mipMapCount == 0)
+    mipMapCount = 1; // Files without mipmaps may leave it out
+
+  /* how big is it going to be including all mipmaps? */
+  texture->levels.clear();
+  int offset = 0;
+  for (unsigned int level=0; level<mipMapCount && (width || height); ++level)
+  {
+    TextureLevel texture_level;
+    texture_level.width = width;
+    texture_level.height = height;
+    texture_level.offset = offset;
+    texture_level.size = ((width+3)/4)*((height+3)/4)*blockSize;
+    texture->levels.push_back(texture_level);
+    offset += texture_level.size;
+    width  /= 2;
+    height /= 2;
+
+    // Deal with Non-Power-Of-Two textures.
+    if(width < 1) width = 1;
+    if(height < 1) height = 1;
+  }
+
+  texture->data.resize(offset);
+  size_t read = fread(&texture->data[0], 1, offset, fp);
+  /* close the file pointer */
+  fclose(fp);
+  return read == offset;
+}
+
+//! Resizes an uncompressed texture with one level.
+/*!
+  Every pixel is interpolated bilinearly between the four closest pixels of
+  the old image, with the pixel centers of both aligned at the borders.
+  \param texture is the texture with level 0 only.
+  \param width is the new width.
+  \param height is the new height.
+*/
+void TextureCodec::Resize(TextureData* texture, int width, int height) {
+  if (texture->compressed || texture->levels.size() != 1)
+    return;
+  const TextureLevel& level = texture->levels[0];
+  if (level.width == width && level.height == height)
+    return;
+  std::vector<unsigned char> data(width * height * 3);
+  const unsigned char* src = &texture->data[level.offset];
+  float scale_x = width > 1 ? (level.width - 1) / float(width - 1) : 0.0f;
+  float scale_y = height > 1 ? (level.height - 1) / float(height - 1) : 0.0f;
+  for (int y = 0; y < height; ++y) {
+    float sy = y * scale_y;
+    int y0 = static_cast<int>(sy);
+    int y1 = y0 + 1 < level.height ? y0 + 1 : y0;
+    float fy = sy - y0;
+    for (int x = 0; x < width; ++x) {
+      float sx = x * scale_x;
+      int x0 = static_cast<int>(sx);
+      int x1 = x0 + 1 < level.width ? x0 + 1 : x0;
+      float fx = sx - x0;
+      for (int c = 0; c < 3; ++c) {
+        float top =
+            src[(y0 * level.width + x0) * 3 + c] * (1.0f - fx) +
+            src[(y0 * level.width + x1) * 3 + c] * fx;
+        float bottom =
+            src[(y1 * level.width + x0) * 3 + c] * (1.0f - fx) +
+            src[(y1 * level.width + x1) * 3 + c] * fx;
+        data[(y * width + x) * 3 + c] =
+            static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+      }
+    }
+  }
+  texture->data.swap(data);
+  TextureLevel resized = {width, height, 0, width * height * 3};
+  texture->levels[0] = resized;
+}
+
+//! Adds the mipmap levels of an uncompressed texture with one level.
+/*!
+  Every pixel of a level is the average of 2x2 pixels of the level before,
+  down to 1x1. Odd sizes repeat the last row or column.
+  \param texture is the texture with level 0 only.
+*/
+void TextureCodec::GenerateMipmaps(TextureData* texture) {
+  if (texture->compressed || texture->levels.size() != 1)
+    return;
+  TextureLevel level = texture->levels[0];
+  while (level.width > 1 || level.height > 1) {
+    TextureLevel next;
+    next.width = level.width > 1 ? level.width / 2 : 1;
+    next.height = level.height > 1 ? level.height / 2 : 1;
+    next.offset = texture->data.size();
+    next.size = next.width * next.height * 3;
+    texture->data.resize(next.offset + next.size);
+    const unsigned char* src = &texture->data[level.offset];
+    unsigned char* dst = &texture->data[next.offset];
+    for (int y = 0; y < next.height; ++y) {
+      int y0 = 2 * y < level.height ? 2 * y : level.height - 1;
+      int y1 = y0 + 1 < level.height ? y0 + 1 : y0;
+      for (int x = 0; x < next.width; ++x) {
+        int x0 = 2 * x < level.width ? 2 * x : level.width - 1;
+        int x1 = x0 + 1 < level.width ? x0 + 1 : x0;
+        for (int c = 0; c < 3; ++c) {
+          int sum =
+              src[(y0 * level.width + x0) * 3 + c] +
+              src[(y0 * level.width + x1) * 3 + c] +
+              src[(y1 * level.width + x0) * 3 + c] +
+              src[(y1 * level.width + x1) * 3 + c];
+          dst[(y * next.width + x) * 3 + c] =
+              static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+    texture->levels.push_back(next);
+    level = next;
+  }
+}
+
+//! Compresses all levels of an uncompressed texture to DXT1.
+/*!
+  Blocks reaching outside of a level repeat its last row or column.
+  \param texture is the uncompressed texture, it is replaced.
+*/
+void TextureCodec::CompressDxt1(TextureData* texture) {
+  if (texture->compressed)
+    return;
+  std::vector<unsigned char> data;
+  unsigned char rgb[48];
+  for (int i = 0; i < texture->levels.size(); ++i) {
+    TextureLevel& level = texture->levels[i];
+    const unsigned char* src = &texture->data[level.offset];
+    int blocks_x = (level.width + 3) / 4;
+    int blocks_y = (level.height + 3) / 4;
+    int offset = data.size();
+    data.resize(offset + blocks_x * blocks_y * DXT1_BLOCK_SIZE);
+    unsigned char* block = &data[offset];
+    for (int by = 0; by < blocks_y; ++by) {
+      for (int bx = 0; bx < blocks_x; ++bx) {
+        for (int p = 0; p < 16; ++p) {
+          int x = 4 * bx + p % 4;
+          int y = 4 * by + p / 4;
+          x = x < level.width ? x : level.width - 1;
+          y = y < level.height ? y : level.height - 1;
+          std::memcpy(&rgb[3 * p], &src[(y * level.width + x) * 3], 3);
+        }
+        CompressDxt1Block(rgb, block);
+        block += DXT1_BLOCK_SIZE;
+      }
+    }
+    level.offset = offset;
+    level.size = data.size() - offset;
+  }
+  texture->data.swap(data);
+  texture->internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  texture->compressed = true;
+}
+
+//! Compresses one 4x4 block of pixels to DXT1.
+/*!
+  The first end point is never smaller than the second, so the block always
+  has four colours and no transparency.
+  \param rgb are the 16 pixels row by row, three bytes each.
+  \param block is where the DXT1_BLOCK_SIZE bytes are written.
+*/
+void TextureCodec::CompressDxt1Block(
+        const unsigned char* rgb,
+        unsigned char* block) {
+  unsigned char min[3] = {255, 255, 255};
+  unsigned char max[3] = {0, 0, 0};
+  for (int p = 0; p < 16; ++p) {
+    for (int c = 0; c < 3; ++c) {
+      min[c] = rgb[3 * p + c] < min[c] ? rgb[3 * p + c] : min[c];
+      max[c] = rgb[3 * p + c] > max[c] ? rgb[3 * p + c] : max[c];
+    }
+  }
+  int color0 = To565(max);
+  int color1 = To565(min);
+
+  unsigned int indices = 0; // All pixels get color0 in a single colour block
+  if (color0 != color1) {
+    unsigned char palette[4][3];
+    From565(color0, palette[0]);
+    From565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int p = 0; p < 16; ++p) {
+      int best = 0;
+      int best_distance = 3 * 255 * 255 + 1;
+      for (int i = 0; i < 4; ++i) {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c) {
+          int d = rgb[3 * p + c] - palette[i][c];
+          distance += d * d;
+        }
+        if (distance < best_distance) {
+          best_distance = distance;
+          best = i;
+        }
+      }
+      indices |= static_cast<unsigned int>(best) << (2 * p);
+    }
+  }
+
+  // Little endian end points followed by the indices
+  block[0] = color0 & 0xff;
+  block[1] = color0 >> 8;
+  block[2] = color1 & 0xff;
+  block[3] = color1 >> 8;
+  for (int i = 0; i < 4; ++i)
+    block[4 + i] = (indices >> (8 * i)) & 0xff;
+}
@@ -1,4 +1,7 @@
 #include "TextureManager.h"
+#include "RenderState.h"
+
+#include <QMutexLocker>
 
 //////////////
 // Material //
@@ -13,26 +16,30 @@ Material::Material() {
   texture_diffuse_type = TextureType::STANDARD;
 }
 
-//! Returns the texture id of the diffuse texture of the Material.
+//! Returns the layer of the diffuse texture in the texture array.
 /*!
-  This function should be used when binding the diffuse texture for the
-  Material. 
- \return The texture id of the diffuse texture of the Material.
+  This function should be used when putting the Material in the table of the
+  MaterialManager. It needs the OpenGL context, the TextureManager is
+  created by the first call.
+ \return The layer of the diffuse texture of the Material, -1 if none.
 */
-GLuint Material::GetDiffuseTextureID() {
-  return texture_diffuse_id_;
+int Material::GetDiffuseTextureLayer() const {
+  if (texture_diffuse_name_.empty())
+    return -1;
+  return TextureManager::Instance()->GetLayerFromName(
+          texture_diffuse_name_.c_str());
 }
 
 //! Sets the diffuse texture.
 /*!
-  The texture provided must have been loaded in to the TextureManager before
-  this function can be called. Otherwise an invalid texture id will be set.
+  Only the name is kept, no OpenGL calls are made. The texture must have been
+  loaded in to the TextureManager when the Material is rendered, otherwise
+  no texture will be used.
  \param texturename is the name of the texture as it was defined when loaded
  in the TextureManager.
 */
 void Material::SetDiffuseTexture(const char* texturename) {
-  texture_diffuse_id_ =
-          TextureManager::Instance()->GetIDFromName(texturename);
+  texture_diffuse_name_ = texturename;
 }
 
 ////////////////////
@@ -40,6 +47,9 @@ void Material::SetDiffuseTexture(const char* texturename) {
 ////////////////////
 
 TextureManager* TextureManager::instance_ = NULL;
+const int TextureManager::TEXTURE_SIZE;
+const int TextureManager::MAX_TEXTURES;
+const int TextureManager::UPLOAD_BYTES_PER_FRAME;
 
 //! A part of the singleton pattern
 /*!
@@ -54,9 +64,61 @@ TextureManager* TextureManager::Instance() {
   return instance_;
 }
 
+//! Creates the texture array with all its levels, but without any data.
 TextureManager::TextureManager(){
   printf("Initializing TextureManager.\n");
 
+  compress_ = GLEW_EXT_texture_compression_s3tc;
+  n_levels_ = 1;
+  for (int size = TEXTURE_SIZE; size > 1; size /= 2)
+    n_levels_++;
+
+  texture_array_ = GLTexture::Create();
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_.Get());
+  for (int level = 0; level < n_levels_; ++level) {
+    int size = TEXTURE_SIZE >> level;
+    if (compress_) {
+      int blocks = (size + 3) / 4;
+      glCompressedTexImage3D(
+              GL_TEXTURE_2D_ARRAY,
+              level,
+              GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+              size,
+              size,
+              MAX_TEXTURES,
+              0,
+              blocks * blocks * TextureCodec::DXT1_BLOCK_SIZE * MAX_TEXTURES,
+              NULL);
+    } else {
+      glTexImage3D(
+              GL_TEXTURE_2D_ARRAY,
+              level,
+              GL_RGB8,
+              size,
+              size,
+              MAX_TEXTURES,
+              0,
+              GL_RGB,
+              GL_UNSIGNED_BYTE,
+              NULL);
+    }
+  }
+  // ... nice trilinear filtering.
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(
+          GL_TEXTURE_2D_ARRAY,
+          GL_TEXTURE_MIN_FILTER,
+          GL_LINEAR_MIPMAP_LINEAR);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  pixel_buffer_ = GLBuffer::Create();
+  n_loaded_textures_ = 0;
+  n_loading_ = 0;
+  closing_ = false;
+  loader_ = std::thread(&TextureManager::RunLoader, this);
+
   LoadTexture("data/textures/test_texture.bmp","test_texture");
   LoadTexture("data/textures/test_texture2.bmp","test_texture2");
 
@@ -64,12 +126,28 @@ TextureManager::TextureManager(){
 }
 
 TextureManager::~TextureManager(){
-  FreeAll();
+  {
+    QMutexLocker locker(&mutex_);
+    closing_ = true;
+    queue_changed_.wakeAll();
+  }
+  loader_.join();
+}
+
+//! Returns the extension of a file name in capitals.
+static std::string GetExtension(const char* filename) {
+  std::string extension = filename;
+  extension = extension.substr(extension.size() < 3 ? 0 : extension.size() - 3);
+  for (int i = 0; i < extension.size(); ++i)
+    extension[i] = toupper(extension[i]);
+  return extension;
 }
 
 //! Load a texture from file and give it a name.
 /*!
-  Currently only bmp and dds files are supported.
+  Currently only bmp and dds files are supported. The texture gets its layer
+  right away but the file is read in the background, it is used by the
+  shaders once UpdateStreaming has uploaded it.
   \param filename is the path to the image file
   \texturename is the name which the texture will be referred to when used.
  */
@@ -77,296 +155,219 @@ void TextureManager::LoadTexture(
   const char* filename,
   const char* texturename) {
   printf("Loading : %s\n", filename);
-  // Create an ID for the texture
-  GLuint texture_id = 0;
 
   // To determine the type
-  char filename_caps[80];
-  int len = strlen(filename);
-  for (int i=0; i<=len; ++i) // <= to include the NULL as well
-    filename_caps[i] = toupper(filename[i]);
-  
-
-  if (strcmp(filename_caps + (len - 3), "BMP") == 0)
-    texture_id = LoadBitmapFile(filename);
-  else if (strcmp (filename_caps + (len - 3), "DDS") == 0)
-    texture_id = LoadDDSFile(filename);
-  else {
-    printf("ERROR : Unable to load extension : %s\n",
-            filename_caps + (len - 3));
+  std::string extension = GetExtension(filename);
+  if (extension != "BMP" && extension != "DDS") {
+    printf("ERROR : Unable to load extension : %s\n", extension.c_str());
     return;
   }
-  if (texture_id == 0)
+  if (textures_.size() == MAX_TEXTURES) {
+    printf("ERROR : No layer left for : %s\n", filename);
     return;
-  // Add to the map
-  textures_.insert(std::pair<std::string, GLuint>(texturename, texture_id));
-  printf("Loaded : %s\n", filename);
-}
-
-//! Releases the given texture from graphics memory.
-/*!
-  \param texturename is the name of the texture.
-*/
-void TextureManager::FreeTexture(const char* texturename){
-  glDeleteTextures(1, &textures_[texturename]);
-}
-
-//! Releases all textures from graphics memory.
-/*!
-  \param texturename is the name of the texture.
-*/
-void TextureManager::FreeAll(){
-  std::map<std::string, GLuint>::iterator texture_iter =
-      textures_.begin();
-  while (texture_iter != textures_.end()) {
-    glDeleteTextures(1, &texture_iter->second);
-    texture_iter++;
   }
-}
 
-//! Binds the given texture provided the name exists.
-/*!
-  This shall be done when rendering a shape to give it the specified texture.
-  This function is currently only for diffuse texture but similar functions
-  can be used for other types as well (normal maps or reflection maps). This
-  function is possibly a little bit slower than the one that takes a GLuint
-  directly since the texture needs to be found in a std::map before it can
-  be bound.
-  \param texturename is the name of the texture.
- */
-void TextureManager::BindTexture(const char* texturename) {
-  // Bind our texture in Texture Unit 0
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textures_[texturename]);
+  // Add to the map
+  int layer = textures_.size();
+  textures_.insert(std::pair<std::string, int>(texturename, layer));
+  loaded_.push_back(false);
+
+  TextureRequest request;
+  request.filename = filename;
+  request.layer = layer;
+  QMutexLocker locker(&mutex_);
+  requests_.push_back(request);
+  queue_changed_.wakeAll();
 }
 
-//! Binds the given texture provided it is created.
+//! Binds the texture array with all textures.
 /*!
-  This shall be done when rendering a shape to give it the specified texture.
-  This function is currently only for diffuse texture but similar functions
-  can be used for other types as well (normal maps or reflection maps).
-  \param texture_id is the id of the texture.
+  This shall be done once before rendering, all Shapes sample the layer of
+  their Material from the same array.
  */
-void TextureManager::BindTexture(GLuint texture_id) {
+void TextureManager::BindTextureArray() {
   // Bind our texture in Texture Unit 0
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
+  RenderState::Instance()->BindTexture(texture_array_.Get());
 }
 
-//! Returns the id of the texture given its name.
+//! Returns the layer of the texture given its name.
 /*!
-  Returns 0 if the texture does not exist.
+  Returns -1 if the texture does not exist.
   \param texturename is the name of the texture.
-  \return the id of the given texture.
+  \return the layer of the given texture.
  */
-GLuint TextureManager::GetIDFromName(const char* texturename) {
-  return textures_[texturename];
+int TextureManager::GetLayerFromName(const char* texturename) {
+  std::map<std::string, int>::iterator it = textures_.find(texturename);
+  return it == textures_.end() ? -1 : it->second;
 }
 
-// Function implementation copied from opengl-tutorial.org
-
-GLuint TextureManager::LoadBitmapFile(const char * imagepath){
-
-  printf("Reading bitmap image : %s\n", imagepath);
-
-  // Data read from the header of the BMP file
-  unsigned char header[54];
-  unsigned int dataPos;
-  unsigned int imageSize;
-  unsigned int width, height;
-  // Actual RGB data
-  unsigned char * data;
-
-  // Open the file
-  FILE * file = fopen(imagepath,"rb");
-  if (!file){
-    printf("%s could not be opened. Are you in the right directory?\n",
-      imagepath); getchar(); return 0;}
+//! Tells if all levels of a layer are uploaded.
+bool TextureManager::IsTextureLoaded(int layer) {
+  return layer >= 0 && layer < loaded_.size() && loaded_[layer];
+}
 
-  // Read the header, i.e. the 54 first bytes
+//! Returns the number of uploaded layers, it only grows.
+int TextureManager::GetNumberOfLoadedTextures() {
+  return n_loaded_textures_;
+}
 
-  // If less than 54 bytes are read, problem
-  if ( fread(header, 1, 54, file)!=54 ){ 
-    printf("Not a correct BMP file\n");
-    return 0;
-  }
-  // A BMP files always begins with "BM"
-  if ( header[0]!='B' || header[1]!='M' ){
-    printf("Not a correct BMP file\n");
-    return 0;
-  }
-  // Make sure this is a 24bpp file
-  if ( *(int*)&(header[0x1E])!=0  ){
-    printf("Not a correct BMP file\n");
-    return 0;
+//! Uploads read textures, at most UPLOAD_BYTES_PER_FRAME at a time.
+/*!
+  Meant to be called once per frame before rendering. A level is never
+  split, so at least one level is uploaded if there is one.
+*/
+void TextureManager::UpdateStreaming() {
+  {
+    QMutexLocker locker(&mutex_);
+    while (!read_textures_.empty()) {
+      uploads_.push_back(std::move(read_textures_.front()));
+      read_textures_.pop_front();
+    }
   }
-  if ( *(int*)&(header[0x1C])!=24 ){
-    printf("Not a correct BMP file\n");
-    return 0;
+  int n_bytes = 0;
+  while (!uploads_.empty() && n_bytes < UPLOAD_BYTES_PER_FRAME) {
+    TextureUpload& upload = uploads_.front();
+    n_bytes += upload.data.levels[upload.next_level].size;
+    if (UploadLevel(&upload)) {
+      loaded_[upload.layer] = true;
+      n_loaded_textures_++;
+      printf("Loaded : %s\n", upload.filename.c_str());
+      uploads_.pop_front();
+    }
   }
-
-  // Read the information about the image
-  dataPos    = *(int*)&(header[0x0A]);
-  imageSize  = *(int*)&(header[0x22]);
-  width      = *(int*)&(header[0x12]);
-  height     = *(int*)&(header[0x16]);
-
-  // Some BMP files are misformatted, guess missing information
-  if (imageSize==0)    imageSize=width*height*3;
-  // 3 : one byte for each Red, Green and Blue component
-  if (dataPos==0)      dataPos=54; // The BMP header is done that way
-
-  // Create a buffer
-  data = new unsigned char [imageSize];
-
-  // Read the actual data from the file into the buffer
-  fread(data,1,imageSize,file);
-
-  // Everything is in memory now, the file wan be closed
-  fclose (file);
-
-  // Create one OpenGL texture
-  GLuint textureID;
-  glGenTextures(1, &textureID);
-  
-  // "Bind" the newly created texture :
-  // all future texture functions will modify this texture
-  glBindTexture(GL_TEXTURE_2D, textureID);
-
-  // Give the image to OpenGL
-  glTexImage2D(
-          GL_TEXTURE_2D,
-          0,
-          GL_RGB,
-          width,
-          height,
-          0,
-          GL_BGR,
-          GL_UNSIGNED_BYTE,
-          data);
-
-  // OpenGL has now copied the data. Free our own version
-  delete [] data;
-
-
-  // Poor filtering, or ...
-  //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); 
-
-  // ... nice trilinear filtering.
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(
-          GL_TEXTURE_2D,
-          GL_TEXTURE_MIN_FILTER,
-          GL_LINEAR_MIPMAP_LINEAR);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  // Return the ID of the texture we just created
-  return textureID;
 }
 
-
-#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
-#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
-#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
-
-// Function implementation copied from opengl-tutorial.org
-
-GLuint TextureManager::LoadDDSFile(const char * imagepath){
-
-  unsigned char header[124];
-
-  FILE *fp; 
- 
-  /* try to open the file */ 
-  fp = fopen(imagepath, "rb"); 
-  if (fp == NULL){
-    printf(
-            "%s could not be opened. Are you in the right directory?\n",
-            imagepath);
-    getchar(); 
-    return 0;
+//! Waits until all loaded textures are read and uploaded.
+/*!
+  For rendering where every frame needs the final textures, like the
+  OffscreenRenderer. Files that can not be read keep the placeholder.
+*/
+void TextureManager::FinishStreaming() {
+  while (true) {
+    {
+      QMutexLocker locker(&mutex_);
+      while (read_textures_.empty() && (n_loading_ > 0 || !requests_.empty()))
+        queue_changed_.wait(&mutex_);
+      if (read_textures_.empty() && uploads_.empty())
+        return;
+    }
+    UpdateStreaming();
   }
-   
-  /* verify the type of file */ 
-  char filecode[4]; 
-  fread(filecode, 1, 4, fp); 
-  if (strncmp(filecode, "DDS ", 4) != 0) { 
-    fclose(fp); 
-    return 0; 
+}
+
+//! Internal function run by the loader thread.
+/*!
+  Reads the requested files and prepares all their levels, nothing is
+  uploaded here since the thread has no OpenGL context.
+*/
+void TextureManager::RunLoader() {
+  QMutexLocker locker(&mutex_);
+  while (true) {
+    while (requests_.empty() && !closing_)
+      queue_changed_.wait(&mutex_);
+    if (closing_)
+      return;
+    TextureRequest request = requests_.front();
+    requests_.pop_front();
+    ++n_loading_;
+    locker.unlock();
+
+    TextureUpload upload;
+    upload.filename = request.filename;
+    upload.layer = request.layer;
+    bool read = ReadTexture(request.filename, &upload.data);
+    if (!read)
+      printf("ERROR : Unable to read : %s\n", request.filename.c_str());
+    upload.next_level = upload.data.levels.size() - 1;
+
+    locker.relock();
+    --n_loading_;
+    if (read)
+      read_textures_.push_back(std::move(upload));
+    queue_changed_.wakeAll();
   }
-  
-  /* get the surface desc */ 
-  fread(&header, 124, 1, fp); 
-
-  unsigned int height      = *(unsigned int*)&(header[8 ]);
-  unsigned int width       = *(unsigned int*)&(header[12]);
-  unsigned int linearSize  = *(unsigned int*)&(header[16]);
-  unsigned int mipMapCount = *(unsigned int*)&(header[24]);
-  unsigned int fourCC      = *(unsigned int*)&(header[80]);
-
- 
-  unsigned char * buffer;
-  unsigned int bufsize;
-  /* how big is it going to be including all mipmaps? */ 
-  bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize; 
-  buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char)); 
-  fread(buffer, 1, bufsize, fp); 
-  /* close the file pointer */ 
-  fclose(fp);
-
-  unsigned int components  = (fourCC == FOURCC_DXT1) ? 3 : 4; 
-  unsigned int format;
-  switch(fourCC) 
-  { 
-  case FOURCC_DXT1: 
-    format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; 
-    break; 
-  case FOURCC_DXT3: 
-    format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
-    break;
-  case FOURCC_DXT5: 
-    format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
-    break; 
-  default: 
-    free(buffer); 
-    return 0; 
+}
+
+//! Internal function reading a texture in the format of the texture array.
+/*!
+  Bitmaps are converted. DDS files are used as they are, so they need to be
+  DXT1 with TEXTURE_SIZE pixels on each side and all mipmap levels, and the
+  driver needs to support DXT1.
+  \param filename is the path to the image file.
+  \param data is set to all levels of the texture.
+  \return False if the file could not be read or has the wrong format.
+*/
+bool TextureManager::ReadTexture(
+        const std::string& filename,
+        TextureData* data) {
+  if (GetExtension(filename.c_str()) == "DDS") {
+    return compress_ &&
+        TextureCodec::ReadDDSFile(filename.c_str(), data) &&
+        data->internal_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT &&
+        data->levels.size() == n_levels_ &&
+        data->levels[0].width == TEXTURE_SIZE &&
+        data->levels[0].height == TEXTURE_SIZE;
   }
+  if (!TextureCodec::ReadBitmapFile(filename.c_str(), data))
+    return false;
+  TextureCodec::Resize(data, TEXTURE_SIZE, TEXTURE_SIZE);
+  TextureCodec::GenerateMipmaps(data);
+  if (compress_)
+    TextureCodec::CompressDxt1(data);
+  return true;
+}
 
-  // Create one OpenGL texture
-  GLuint textureID;
-  glGenTextures(1, &textureID);
-
-  // "Bind" the newly created texture :
-  // all future texture functions will modify this texture
-  glBindTexture(GL_TEXTURE_2D, textureID);
-  glPixelStorei(GL_UNPACK_ALIGNMENT,1); 
-  
-  unsigned int blockSize =
-        (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16; 
-  unsigned int offset = 0;
-
-  /* load the mipmaps */ 
-  for (unsigned int level=0; level<mipMapCount && (width || height); ++level) 
-  { 
-    unsigned int size = ((width+3)/4)*((height+3)/4)*blockSize; 
-    glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height,  
-      0, size, buffer + offset); 
-   
-    offset += size; 
-    width  /= 2; 
-    height /= 2; 
-
-    // Deal with Non-Power-Of-Two textures.
-    // This code is not included in the webpage to reduce clutter.
-    if(width < 1) width = 1;
-    if(height < 1) height = 1;
-
-  } 
-
-  free(buffer); 
-
-  return textureID;
-}
\ No newline at end of file
+//! Internal function uploading the next level of a texture.
+/*!
+  The level is copied to the pixel buffer object, the copy from there to the
+  texture array is done by the GPU without waiting for it. Getting a new
+  store for the buffer every time keeps the driver from waiting for the last
+  copy.
+  \return True if level 0 was uploaded and the layer is complete.
+*/
+bool TextureManager::UploadLevel(TextureUpload* upload) {
+  const TextureData& data = upload->data;
+  int level = upload->next_level;
+  const TextureLevel& texture_level = data.levels[level];
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_.Get());
+  glBufferData(
+          GL_PIXEL_UNPACK_BUFFER,
+          texture_level.size,
+          &data.data[texture_level.offset],
+          GL_STREAM_DRAW);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_.Get());
+  if (data.compressed) {
+    glCompressedTexSubImage3D(
+            GL_TEXTURE_2D_ARRAY,
+            level,
+            0,
+            0,
+            upload->layer,
+            texture_level.width,
+            texture_level.height,
+            1,
+            GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+            texture_level.size,
+            reinterpret_cast<void*>(0));
+  } else {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+    glTexSubImage3D(
+            GL_TEXTURE_2D_ARRAY,
+            level,
+            0,
+            0,
+            upload->layer,
+            texture_level.width,
+            texture_level.height,
+            1,
+            GL_RGB,
+            GL_UNSIGNED_BYTE,
+            reinterpret_cast<void*>(0));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  upload->next_level--;
+  return level == 0;
+}
@@ -0,0 +1,171 @@
+#include "Trajectory.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+// One millimeter, positions within 32 meters of the start can be stored
+const float Trajectory::POSITION_SCALE = 0.001f;
+
+static const float ROTATION_SCALE = 32767.0f;
+
+//! Internal function rounding and clamping a value to a short.
+static short Quantize(float value) {
+  float rounded = std::floor(value + 0.5f);
+  return static_cast<short>(std::max(-32767.0f, std::min(32767.0f, rounded)));
+}
+
+//! Constructor, creates an empty Trajectory without bodies.
+Trajectory::Trajectory() {
+  n_bodies_ = 0;
+  n_frames_ = 0;
+  frame_time_ = 0.0f;
+  for (int i = 0; i < 3; ++i)
+    light_position_[i] = 0.0f;
+}
+
+//! Constructor, creates a Trajectory without frames.
+/*!
+  \param n_bodies is the number of bodies in every frame.
+  \param frame_time is the time in seconds between two frames.
+*/
+Trajectory::Trajectory(int n_bodies, float frame_time) {
+  n_bodies_ = n_bodies;
+  n_frames_ = 0;
+  frame_time_ = frame_time;
+  origins_.resize(3 * n_bodies);
+  for (int i = 0; i < 3; ++i)
+    light_position_[i] = 0.0f;
+}
+
+//! Allocates memory for a number of frames.
+void Trajectory::Reserve(int n_frames) {
+  samples_.reserve(n_frames * n_bodies_);
+}
+
+//! Adds a frame at the end of the Trajectory.
+/*!
+  \param transforms are the world transforms of all bodies.
+*/
+void Trajectory::AddFrame(const btTransform* transforms) {
+  if (n_frames_ == 0) {
+    for (int b = 0; b < n_bodies_; ++b) {
+      for (int k = 0; k < 3; ++k)
+        origins_[3 * b + k] = transforms[b].getOrigin()[k];
+    }
+  }
+  for (int b = 0; b < n_bodies_; ++b) {
+    BodySample sample;
+    const btVector3& origin = transforms[b].getOrigin();
+    for (int k = 0; k < 3; ++k) {
+      sample.position[k] =
+          Quantize((origin[k] - origins_[3 * b + k]) / POSITION_SCALE);
+    }
+    btQuaternion rotation = transforms[b].getRotation();
+    // q and -q are the same rotation, keep w positive
+    if (rotation.getW() < 0.0f)
+      rotation = -rotation;
+    sample.rotation[0] = Quantize(rotation.getX() * ROTATION_SCALE);
+    sample.rotation[1] = Quantize(rotation.getY() * ROTATION_SCALE);
+    sample.rotation[2] = Quantize(rotation.getZ() * ROTATION_SCALE);
+    sample.rotation[3] = Quantize(rotation.getW() * ROTATION_SCALE);
+    samples_.push_back(sample);
+  }
+  n_frames_++;
+}
+
+//! Returns the transform of a body in a recorded frame.
+/*!
+  \param frame is the frame, clamped to the recorded frames.
+  \param body is the index of the body.
+*/
+btTransform Trajectory::GetTransform(int frame, int body) const {
+  if (n_frames_ == 0)
+    return btTransform::getIdentity();
+  frame = std::max(0, std::min(n_frames_ - 1, frame));
+  const BodySample& sample = samples_[frame * n_bodies_ + body];
+  btVector3 origin(
+      origins_[3 * body] + sample.position[0] * POSITION_SCALE,
+      origins_[3 * body + 1] + sample.position[1] * POSITION_SCALE,
+      origins_[3 * body + 2] + sample.position[2] * POSITION_SCALE);
+  btQuaternion rotation(
+      sample.rotation[0] / ROTATION_SCALE,
+      sample.rotation[1] / ROTATION_SCALE,
+      sample.rotation[2] / ROTATION_SCALE,
+      sample.rotation[3] / ROTATION_SCALE);
+  rotation.normalize();
+  return btTransform(rotation, origin);
+}
+
+//! Returns the transform of a body at any time.
+/*!
+  The positions of the two closest frames are interpolated linearly and
+  the rotations spherically. Times outside of the Trajectory give the first
+  or last frame.
+  \param time is the time in seconds since the first frame.
+  \param body is the index of the body.
+*/
+btTransform Trajectory::Sample(float time, int body) const {
+  if (n_frames_ < 2 || frame_time_ <= 0.0f)
+    return GetTransform(0, body);
+  float t = std::max(0.0f, time / frame_time_);
+  int frame = static_cast<int>(t);
+  if (frame >= n_frames_ - 1)
+    return GetTransform(n_frames_ - 1, body);
+  float alpha = t - frame;
+  btTransform from = GetTransform(frame, body);
+  btTransform to = GetTransform(frame + 1, body);
+  return btTransform(
+      from.getRotation().slerp(to.getRotation(), alpha),
+      from.getOrigin().lerp(to.getOrigin(), alpha));
+}
+
+//! Get function.
+/*!
+  \return The number of recorded frames.
+*/
+int Trajectory::GetNumberOfFrames() const {
+  return n_frames_;
+}
+
+//! Get function.
+/*!
+  \return The number of bodies in every frame.
+*/
+int Trajectory::GetNumberOfBodies() const {
+  return n_bodies_;
+}
+
+//! Get function.
+/*!
+  \return The time in seconds between two frames.
+*/
+float Trajectory::GetFrameTime() const {
+  return frame_time_;
+}
+
+//! Get function.
+/*!
+  \return The time in seconds from the first to the last frame.
+*/
+float Trajectory::GetDuration() const {
+  return std::max(0, n_frames_ - 1) * frame_time_;
+}
+
+//! Get function.
+/*!
+  \return The position of the light source target during the recording.
+*/
+btVector3 Trajectory::GetLightPosition() const {
+  return btVector3(light_position_[0], light_position_[1], light_position_[2]);
+}
+
+//! Set function.
+/*!
+  \param position is the position of the light source target during the
+  recording.
+*/
+void Trajectory::SetLightPosition(const btVector3& position) {
+  for (int i = 0; i < 3; ++i)
+    light_position_[i] = position[i];
+}
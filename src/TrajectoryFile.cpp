@@ -0,0 +1,478 @@
+#include "TrajectoryFile.h"
+#include "LzCodec.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+#include <utility>
+// External
+#include <QMutexLocker>
+
+const int TrajectoryWriter::CHUNK_FRAMES;
+const int TrajectoryWriter::MAX_QUEUED_BYTES;
+
+static const char FILE_MAGIC[4] = {'C', 'E', 'T', 'R'};
+static const char CHUNK_MAGIC[4] = {'C', 'E', 'C', 'H'};
+static const char INDEX_MAGIC[4] = {'C', 'E', 'I', 'X'};
+static const int FILE_VERSION = 1;
+static const int CHUNK_HEADER_INTS = 8;
+static const int FOOTER_SIZE = sizeof(long long) + sizeof(int) + 4;
+
+// Quantization steps, 1 mm, 1 / 32767 of a quaternion unit and 0.1 mrad
+static const float POSITION_STEP = 0.001f;
+static const float ROTATION_STEP = 1.0f / 32767.0f;
+static const float ANGLE_STEP = 0.0001f;
+
+//! Internal function returning the quantization step of a value in a frame.
+static float Step(int value, int n_bodies) {
+  if (value >= 7 * n_bodies)
+    return ANGLE_STEP;
+  return value % 7 < 3 ? POSITION_STEP : ROTATION_STEP;
+}
+
+//! Internal function appending a signed integer as a zigzag varint.
+static void PutVarint(int value, std::vector<char>* out) {
+  uint32_t zigzag = (static_cast<uint32_t>(value) << 1) ^
+      static_cast<uint32_t>(value >> 31);
+  while (zigzag >= 0x80) {
+    out->push_back(static_cast<char>(zigzag | 0x80));
+    zigzag >>= 7;
+  }
+  out->push_back(static_cast<char>(zigzag));
+}
+
+//! Internal function reading a zigzag varint.
+/*!
+  \return False if the buffer ends in the middle of the varint.
+*/
+static bool GetVarint(const std::vector<char>& in, int* pos, int* value) {
+  uint32_t zigzag = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*pos >= in.size())
+      return false;
+    uint32_t b = static_cast<unsigned char>(in[(*pos)++]);
+    zigzag |= (b & 0x7f) << shift;
+    if (b < 0x80) {
+      *value = static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Internal function quantizing and delta encoding the values of a chunk.
+/*!
+  The first frame of a chunk is stored as is, so every chunk can be decoded
+  on its own. Quaternions are flipped to a positive w.
+*/
+static void EncodeChunk(const TrajectoryChunk& chunk, std::vector<char>* out) {
+  const int frame_size = chunk.FrameSize();
+  std::vector<int> previous(frame_size, 0);
+  out->clear();
+  for (int f = 0; f < chunk.n_frames; ++f) {
+    const float* frame = &chunk.values[f * frame_size];
+    for (int v = 0; v < frame_size; ++v) {
+      float value = frame[v];
+      if (v < 7 * chunk.n_bodies && v % 7 >= 3 && frame[v - v % 7 + 6] < 0.0f)
+        value = -value;
+      int q = static_cast<int>(std::floor(value / Step(v, chunk.n_bodies) + 0.5f));
+      PutVarint(q - previous[v], out);
+      previous[v] = q;
+    }
+  }
+}
+
+//! Internal function decoding the values written by EncodeChunk.
+static bool DecodeChunk(const std::vector<char>& in, TrajectoryChunk* chunk) {
+  const int frame_size = chunk->FrameSize();
+  std::vector<int> previous(frame_size, 0);
+  chunk->values.resize(chunk->n_frames * frame_size);
+  int pos = 0;
+  for (int f = 0; f < chunk->n_frames; ++f) {
+    float* frame = &chunk->values[f * frame_size];
+    for (int v = 0; v < frame_size; ++v) {
+      int delta;
+      if (!GetVarint(in, &pos, &delta))
+        return false;
+      previous[v] += delta;
+      frame[v] = previous[v] * Step(v, chunk->n_bodies);
+    }
+  }
+  return pos == in.size();
+}
+
+//! Constructor, the writer is closed until Open.
+TrajectoryWriter::TrajectoryWriter() {
+  queued_bytes_ = 0;
+  closing_ = false;
+  open_ = false;
+  next_creature_ = 0;
+  dropped_chunks_ = 0;
+}
+
+//! Destructor, closes the file.
+TrajectoryWriter::~TrajectoryWriter() {
+  Close();
+}
+
+//! Creates a file and starts the I/O thread.
+/*!
+  \param path is the file to write, an existing file is replaced.
+  \return False if the file could not be created.
+*/
+bool TrajectoryWriter::Open(const std::string& path) {
+  Close();
+  out_.open(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out_)
+    return false;
+  out_.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+  out_.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+
+  index_.clear();
+  queued_bytes_ = 0;
+  closing_ = false;
+  next_creature_ = 0;
+  dropped_chunks_ = 0;
+  open_ = true;
+  thread_ = std::thread(&TrajectoryWriter::Run, this);
+  return true;
+}
+
+//! Writes all queued chunks and the index, then closes the file.
+void TrajectoryWriter::Close() {
+  if (!open_)
+    return;
+  {
+    QMutexLocker locker(&mutex_);
+    closing_ = true;
+    queue_changed_.wakeAll();
+  }
+  thread_.join();
+
+  long long index_offset = out_.tellp();
+  for (int i = 0; i < index_.size(); ++i) {
+    const TrajectoryIndexEntry& entry = index_[i];
+    out_.write(reinterpret_cast<const char*>(&entry.creature), sizeof(int));
+    out_.write(reinterpret_cast<const char*>(&entry.generation), sizeof(int));
+    out_.write(reinterpret_cast<const char*>(&entry.first_frame), sizeof(int));
+    out_.write(reinterpret_cast<const char*>(&entry.n_frames), sizeof(int));
+    out_.write(reinterpret_cast<const char*>(&entry.offset), sizeof(long long));
+  }
+  int count = index_.size();
+  out_.write(reinterpret_cast<const char*>(&index_offset), sizeof(index_offset));
+  out_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out_.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  out_.close();
+
+  QMutexLocker locker(&mutex_);
+  open_ = false;
+  if (dropped_chunks_ > 0) {
+    std::cout << "WARNING: " << dropped_chunks_ <<
+      " trajectory chunks were dropped!" << std::endl;
+  }
+}
+
+//! Tells if chunks are accepted.
+bool TrajectoryWriter::IsOpen() const {
+  return open_;
+}
+
+//! Reserves identifiers for a number of creatures. Can be called concurrently.
+/*!
+  \param n is the number of creatures.
+  \return The identifier of the first creature, the others follow.
+*/
+int TrajectoryWriter::ReserveCreatures(int n) {
+  return next_creature_.fetch_add(n);
+}
+
+//! Queues a chunk for writing. Can be called concurrently.
+/*!
+  Never waits for the disk. The values of the chunk are moved to the queue
+  and the chunk is left without values.
+  \param chunk is the chunk to write.
+  \return False if the chunk was dropped because the queue is full or the
+  writer is closed.
+*/
+bool TrajectoryWriter::Submit(TrajectoryChunk* chunk) {
+  long long bytes = chunk->values.size() * sizeof(float);
+  QMutexLocker locker(&mutex_);
+  if (!open_ || closing_ || queued_bytes_ + bytes > MAX_QUEUED_BYTES) {
+    dropped_chunks_++;
+    return false;
+  }
+  queue_.push_back(std::move(*chunk));
+  chunk->values.clear();
+  queued_bytes_ += bytes;
+  queue_changed_.wakeOne();
+  return true;
+}
+
+//! Returns the number of chunks dropped since Open.
+int TrajectoryWriter::GetDroppedChunks() const {
+  return dropped_chunks_;
+}
+
+//! Internal function run by the I/O thread until Close.
+void TrajectoryWriter::Run() {
+  TrajectoryChunk chunk;
+  mutex_.lock();
+  while (true) {
+    while (queue_.empty() && !closing_)
+      queue_changed_.wait(&mutex_);
+    if (queue_.empty())
+      break;
+    chunk = std::move(queue_.front());
+    queue_.pop_front();
+    mutex_.unlock();
+
+    WriteChunk(chunk);
+
+    mutex_.lock();
+    queued_bytes_ -= chunk.values.size() * sizeof(float);
+  }
+  mutex_.unlock();
+}
+
+//! Internal function encoding, compressing and writing one chunk.
+void TrajectoryWriter::WriteChunk(const TrajectoryChunk& chunk) {
+  if (chunk.n_frames <= 0 ||
+      chunk.values.size() != chunk.n_frames * chunk.FrameSize())
+    return;
+  EncodeChunk(chunk, &encoded_);
+  LzCodec::Compress(encoded_.empty() ? NULL : &encoded_[0],
+          encoded_.size(), &compressed_);
+
+  TrajectoryIndexEntry entry;
+  entry.creature = chunk.creature;
+  entry.generation = chunk.generation;
+  entry.first_frame = chunk.first_frame;
+  entry.n_frames = chunk.n_frames;
+  entry.offset = out_.tellp();
+  index_.push_back(entry);
+
+  int header[CHUNK_HEADER_INTS] = {
+          chunk.creature,
+          chunk.generation,
+          chunk.first_frame,
+          chunk.n_frames,
+          chunk.n_bodies,
+          chunk.n_joints,
+          static_cast<int>(encoded_.size()),
+          static_cast<int>(compressed_.size())};
+  out_.write(CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+  out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  out_.write(reinterpret_cast<const char*>(&chunk.frame_time), sizeof(float));
+  out_.write(&compressed_[0], compressed_.size());
+}
+
+//! Constructor, creates a reader without a file.
+TrajectoryReader::TrajectoryReader() {
+}
+
+//! Opens a file and reads its index.
+/*!
+  \param path is the file to read.
+  \return False if the file could not be opened or is not a trajectory
+  file.
+*/
+bool TrajectoryReader::Open(const std::string& path) {
+  in_.close();
+  in_.clear();
+  index_.clear();
+  creature_chunks_.clear();
+  in_.open(path.c_str(), std::ios::binary);
+  char magic[4];
+  int version;
+  if (!in_.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+      !in_.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+      version != FILE_VERSION)
+    return false;
+
+  if (!ReadIndex() && !RebuildIndex())
+    return false;
+
+  for (int i = 0; i < index_.size(); ++i) {
+    int creature = index_[i].creature;
+    if (creature < 0)
+      continue;
+    if (creature >= creature_chunks_.size())
+      creature_chunks_.resize(creature + 1);
+    creature_chunks_[creature].push_back(i);
+  }
+  for (int c = 0; c < creature_chunks_.size(); ++c) {
+    std::vector<int>& chunks = creature_chunks_[c];
+    std::sort(chunks.begin(), chunks.end(), [this](int a, int b) {
+      return index_[a].first_frame < index_[b].first_frame;
+    });
+  }
+  return true;
+}
+
+//! Returns where all chunks of the file are.
+const std::vector<TrajectoryIndexEntry>& TrajectoryReader::GetIndex() const {
+  return index_;
+}
+
+//! Returns one more than the largest creature identifier in the file.
+int TrajectoryReader::GetNumberOfCreatures() const {
+  return creature_chunks_.size();
+}
+
+//! Reads a time window of one creature.
+/*!
+  Only the chunks overlapping the window are read and decoded.
+  \param creature is the identifier of the creature.
+  \param begin_frame is the first frame of the window.
+  \param end_frame is one past the last frame of the window.
+  \param out is where the frames are written. Its first_frame is the first
+  recorded frame in the window.
+  \return False if no frames were recorded in the window or the file is
+  corrupt.
+*/
+bool TrajectoryReader::Read(
+        int creature,
+        int begin_frame,
+        int end_frame,
+        TrajectoryChunk* out) {
+  if (creature < 0 || creature >= creature_chunks_.size())
+    return false;
+  out->values.clear();
+  out->n_frames = 0;
+  TrajectoryChunk chunk;
+  const std::vector<int>& chunks = creature_chunks_[creature];
+  for (int i = 0; i < chunks.size(); ++i) {
+    const TrajectoryIndexEntry& entry = index_[chunks[i]];
+    int begin = std::max(begin_frame, entry.first_frame);
+    int end = std::min(end_frame, entry.first_frame + entry.n_frames);
+    if (begin >= end)
+      continue;
+    if (!ReadChunk(entry, &chunk))
+      return false;
+    if (out->n_frames == 0) {
+      *out = chunk;
+      out->values.clear();
+      out->first_frame = begin;
+      out->n_frames = 0;
+    }
+    int frame_size = chunk.FrameSize();
+    out->values.insert(out->values.end(),
+            chunk.values.begin() + (begin - chunk.first_frame) * frame_size,
+            chunk.values.begin() + (end - chunk.first_frame) * frame_size);
+    out->n_frames += end - begin;
+  }
+  return out->n_frames > 0;
+}
+
+//! Reads and decodes one chunk.
+/*!
+  \param entry is the index entry of the chunk.
+  \param chunk is where the chunk is written.
+  \return False if the chunk is corrupt.
+*/
+bool TrajectoryReader::ReadChunk(
+        const TrajectoryIndexEntry& entry,
+        TrajectoryChunk* chunk) {
+  in_.clear();
+  in_.seekg(entry.offset);
+  char magic[4];
+  int header[CHUNK_HEADER_INTS];
+  if (!in_.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, CHUNK_MAGIC, sizeof(magic)) != 0 ||
+      !in_.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+      !in_.read(reinterpret_cast<char*>(&chunk->frame_time), sizeof(float)) ||
+      header[3] < 0 || header[4] < 0 || header[5] < 0 ||
+      header[6] < 0 || header[7] < 0)
+    return false;
+  chunk->creature = header[0];
+  chunk->generation = header[1];
+  chunk->first_frame = header[2];
+  chunk->n_frames = header[3];
+  chunk->n_bodies = header[4];
+  chunk->n_joints = header[5];
+  compressed_.resize(header[7]);
+  if (header[7] > 0 && !in_.read(&compressed_[0], header[7]))
+    return false;
+  return LzCodec::Decompress(compressed_.empty() ? NULL : &compressed_[0],
+          compressed_.size(), header[6], &encoded_) &&
+      DecodeChunk(encoded_, chunk);
+}
+
+//! Internal function reading the index at the end of a closed file.
+bool TrajectoryReader::ReadIndex() {
+  in_.clear();
+  in_.seekg(0, std::ios::end);
+  long long size = in_.tellg();
+  if (size < 8 + FOOTER_SIZE)
+    return false;
+  in_.seekg(size - FOOTER_SIZE);
+  long long index_offset;
+  int count;
+  char magic[4];
+  if (!in_.read(reinterpret_cast<char*>(&index_offset), sizeof(index_offset)) ||
+      !in_.read(reinterpret_cast<char*>(&count), sizeof(count)) ||
+      !in_.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+      count < 0 || index_offset < 8 ||
+      index_offset + count * 24LL + FOOTER_SIZE != size)
+    return false;
+
+  in_.seekg(index_offset);
+  index_.resize(count);
+  for (int i = 0; i < count; ++i) {
+    TrajectoryIndexEntry& entry = index_[i];
+    in_.read(reinterpret_cast<char*>(&entry.creature), sizeof(int));
+    in_.read(reinterpret_cast<char*>(&entry.generation), sizeof(int));
+    in_.read(reinterpret_cast<char*>(&entry.first_frame), sizeof(int));
+    in_.read(reinterpret_cast<char*>(&entry.n_frames), sizeof(int));
+    in_.read(reinterpret_cast<char*>(&entry.offset), sizeof(long long));
+  }
+  if (!in_) {
+    index_.clear();
+    return false;
+  }
+  return true;
+}
+
+//! Internal function rebuilding the index of a file that was not closed.
+/*!
+  Skips from chunk header to chunk header and stops at the first chunk that
+  is incomplete.
+*/
+bool TrajectoryReader::RebuildIndex() {
+  in_.clear();
+  in_.seekg(0, std::ios::end);
+  long long size = in_.tellg();
+  long long offset = 8;
+  index_.clear();
+  while (true) {
+    in_.clear();
+    in_.seekg(offset);
+    char magic[4];
+    int header[CHUNK_HEADER_INTS];
+    if (!in_.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, CHUNK_MAGIC, sizeof(magic)) != 0 ||
+        !in_.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[7] < 0)
+      break;
+    long long end = offset + sizeof(magic) + sizeof(header) + sizeof(float) +
+        header[7];
+    if (end > size)
+      break;
+    TrajectoryIndexEntry entry;
+    entry.creature = header[0];
+    entry.generation = header[1];
+    entry.first_frame = header[2];
+    entry.n_frames = header[3];
+    entry.offset = offset;
+    index_.push_back(entry);
+    offset = end;
+  }
+  std::cout << "Rebuilt the index of " << index_.size() <<
+    " trajectory chunks" << std::endl;
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef BATCHRNG_H
+#define BATCHRNG_H
+
+// C++
+#include <stdint.h>
+#include <ctime>
+
+//! A fast random number generator producing numbers in blocks.
+/*!
+  The generator runs N_LANES independent xorshift128+ streams side by side.
+  Since every lane is updated with the same shifts, xors and adds, the loop
+  filling a block is vectorized by the compiler. Numbers are drawn from an
+  internal block which is refilled when empty, so single draws are cheap too.
+  A BatchRNG is not thread safe, every thread should use its own generator.
+  Different streams from the same seed give independent substreams.
+*/
+class BatchRNG {
+public:
+  BatchRNG();
+  BatchRNG(uint64_t seed, uint64_t stream = 0);
+
+  void Seed(uint64_t seed, uint64_t stream = 0);
+
+  uint64_t Next();
+  float Uniform();
+  int UniformInt(int n);
+
+  void Fill(uint64_t* out, int n);
+  void FillUniform(float* out, int n);
+
+  static const int N_LANES = 4;
+  static const int BLOCK_SIZE = 256;
+private:
+  void Refill();
+
+  uint64_t s0_[N_LANES];
+  uint64_t s1_[N_LANES];
+  uint64_t block_[BLOCK_SIZE];
+  int block_pos_;
+};
+
+#endif // BATCHRNG_H
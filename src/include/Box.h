@@ -10,18 +10,18 @@
 
 //! Used in the render process. A box to render.
 /*!
-  This class extends Shape and it therefore a containter of all the vertex data
-  used by OpenGL in the rendering process.
+  This class extends Shape and draws the Box of the GeometryCache, it also
+  defines the vertex data of that mesh.
 */
 class Box : public Shape {
 public:
   Box(Material material);
-  Box(float scale_x, float scale_y, float scale_z, Material material);
+  static void GetMeshData(MeshData* data);
 private:
-  void SetupVertexPositionData();
-  void SetupVertexNormalData();
-  void SetupVertexUVData();
-  void SetupElementData();
+  static void SetupVertexPositionData(MeshData* data);
+  static void SetupVertexNormalData(MeshData* data);
+  static void SetupVertexUVData(MeshData* data);
+  static void SetupElementData(MeshData* data);
 };
 
 #endif  // BOX_H
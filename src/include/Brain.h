@@ -4,8 +4,12 @@
 //C++
 #include <vector>
 #include <cmath>
+#include <iostream>
 //Internal
 #include "AutoInitRNG.h"
+#include "BatchRNG.h"
+#include "Crossover.h"
+#include "Mutation.h"
 #include "SettingsManager.h"
 
 typedef std::vector<float> f_vec;
@@ -14,20 +18,40 @@ typedef std::vector<float> f_vec;
 /*!
   The Brain works with a neural network to calculate a list of outputs from
   a list of inputs. The inputs can be the angle of the joints or direction
-  to the target light source.
+  to the target light source. All weights are stored in one flat genome,
+  first the weights of the hidden nodes and then the weights of the output
+  nodes, one node after the other.
 */
 class Brain {
 public:
-  Brain(){}
+  Brain() : n_input_(0), n_hidden_(0), n_output_(0), sigma_(-1.0f) {}
   Brain(int n_input, int n_output);
+  Brain(int n_input, int n_hidden, int n_output);
   f_vec CalculateOutput(const f_vec& input);
-  void Mutate();
-  std::vector<Brain> Crossover(Brain mate);
+  void Mutate(const SettingsSnapshot& settings, BatchRNG& rng);
+  static void Crossover(
+          const Brain& mom,
+          const Brain& dad,
+          Brain* child0,
+          Brain* child1,
+          CrossoverType type,
+          BatchRNG& rng);
+  int GetGenomeSize() const;
+  std::vector<int> GetNeuronOffsets() const;
+  const f_vec& GetGenome() const;
+  void SetGenome(const f_vec& genome);
+  void Write(std::ostream& out) const;
+  bool Read(std::istream& in);
 private:
-  std::vector<f_vec> hidden_nodes_;
-  std::vector<f_vec> output_nodes_;
-  static AutoInitRNG rng_;
-  float dot(const f_vec& x, const f_vec& y);
+  void InitRandomWeights(int n_input, int n_hidden, int n_output);
+
+  int n_input_;
+  int n_hidden_;
+  int n_output_;
+  f_vec weights_;
+  float sigma_; // Mutation strength for self adaptive mutation
+  static thread_local AutoInitRNG rng_; // One per thread of the pool
+  float dot(const float* x, const float* y, int n);
   float transfer(float x);
 };
 
@@ -36,7 +36,7 @@ public:
 
   // Setters
   void SetDistanceToLight(float distance);
-  void CollectData();
+  void CollectData(float progress);
   void UpdateMotors(std::vector<float> input);
 private:
   // Fitness data from world
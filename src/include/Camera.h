@@ -10,6 +10,19 @@
 // Internal
 #include "SettingsManager.h"
 
+//! The volume seen by a camera, bounded by six planes.
+/*!
+  Used for culling objects outside of the view before they are rendered.
+*/
+class Frustum {
+public:
+  Frustum();
+  Frustum(const glm::mat4& view_projection);
+  bool IntersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+private:
+  glm::vec4 planes_[6]; // Normal pointing inwards in xyz, distance in w
+};
+
 //! The camera class is used to obtain the view and projection matrices.
 /*!
   For rendering the view and projection matries are used. These matrices
@@ -27,6 +40,8 @@ public:
   glm::vec3 GetTarget();
   void SetTarget(glm::vec3 target);
   float GetFarClipping();
+  Frustum GetFrustum();
+  float GetPixelSize(glm::vec3 center, float radius);
 
   void UpdateMatrices();
   void IncrementXrotation(float h);
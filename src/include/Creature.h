@@ -7,13 +7,16 @@
 #include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <string>
 #include <vector>
 // Internal
 #include "Brain.h"
 #include "Body.h"
 #include "AutoInitRNG.h"
+#include "BatchRNG.h"
 #include "SettingsManager.h"
+#include "Trajectory.h"
 
 // TO DO : ändra SimData så den sparar värden som vi vill mäta!
 
@@ -26,6 +29,14 @@ struct SimData {
     float accumulated_head_y;
     float energy_waste;
 
+    // Behavior used by novelty search
+    static const int N_HEAD_PROFILE = 8;
+    static const int BEHAVIOR_SIZE = 3 + N_HEAD_PROFILE;
+    float final_x;
+    float final_y;
+    float final_z;
+    float head_y_profile[N_HEAD_PROFILE]; // Head height at evenly spaced times
+
     SimData() {
         ResetData();
     }
@@ -37,6 +48,31 @@ struct SimData {
         deviation_x = 0.0f;
         accumulated_head_y = 0.0f;
         energy_waste = 0.0f;
+        final_x = 0.0f;
+        final_y = 0.0f;
+        final_z = 0.0f;
+        for (int i = 0; i < N_HEAD_PROFILE; ++i)
+            head_y_profile[i] = 0.0f;
+    }
+    //! Returns the weighted sum of the values without any normalization.
+    // The weights are in the order of SettingsManager::GetFitnessWeights.
+    float WeightedSum(const float* weights) const {
+        return weights[0] * distance_light +
+            weights[1] * distance_z +
+            weights[2] * max_y +
+            weights[3] * accumulated_y +
+            weights[4] * accumulated_head_y +
+            weights[5] * deviation_x +
+            weights[6] * energy_waste;
+    }
+    //! Writes the behavior descriptor, the final center of mass followed by
+    // the head height profile, BEHAVIOR_SIZE floats.
+    void GetBehavior(float* behavior) const {
+        behavior[0] = final_x;
+        behavior[1] = final_y;
+        behavior[2] = final_z;
+        for (int i = 0; i < N_HEAD_PROFILE; ++i)
+            behavior[3 + i] = head_y_profile[i];
     }
 };
 
@@ -55,12 +91,24 @@ public:
     float GetFitness() const;
     Brain GetBrain();
     Body GetBody();
-    void Mutate();
+    void Mutate(const SettingsSnapshot& settings, BatchRNG& rng);
+    void Write(std::ostream& out) const;
+    bool Read(std::istream& in);
+    const f_vec& GetGenome() const;
+    void SetGenome(const f_vec& genome);
+    std::shared_ptr<const Trajectory> GetTrajectory() const;
+    void SetTrajectory(std::shared_ptr<const Trajectory> trajectory);
 /*
     SimData GetSimData();
     void SetSimData(SimData);
 */
-    std::vector<Creature> Crossover(Creature mate);
+    static void Crossover(
+            const Creature& mom,
+            const Creature& dad,
+            Creature* child0,
+            Creature* child1,
+            CrossoverType type,
+            BatchRNG& rng);
 
     SimData simdata;
 
@@ -68,8 +116,7 @@ private:
     float fitness_;
     Brain brain_;
     Body body_;
-
-    static AutoInitRNG rng_;
+    std::shared_ptr<const Trajectory> trajectory_; // Shared between copies
 
 };
 Q_DECLARE_METATYPE(Creature);
@@ -0,0 +1,79 @@
+#ifndef CROSSOVER_H
+#define CROSSOVER_H
+
+// C++
+#include <vector>
+// Internal
+#include "BatchRNG.h"
+
+enum CrossoverType {
+  UNIFORM_CROSSOVER = 0, // Every gene from a random parent
+  N_POINT_CROSSOVER = 1, // Segments between random cut points are swapped
+  ARITHMETIC_CROSSOVER = 2, // Weighted average of the parents
+  BLX_ALPHA_CROSSOVER = 3, // Uniform sample around the parents' interval
+  NEURON_CROSSOVER = 4 // Whole neurons from a random parent
+};
+
+//! Recombination operators working on flat genomes.
+/*!
+  All operators take two parent genomes of the same length n and write two
+  children. The genomes are contiguous float buffers (the weights of a Brain)
+  so the kernels are branch free loops over memory which the compiler
+  vectorizes. Random numbers are drawn in blocks from a BatchRNG. The
+  children must not overlap with the parents.
+*/
+class Crossover {
+public:
+  static void Apply(
+          CrossoverType type,
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          int n,
+          const std::vector<int>& neuron_offsets,
+          BatchRNG& rng);
+
+  static void Uniform(
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          int n,
+          BatchRNG& rng);
+  static void NPoint(
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          int n,
+          int n_points,
+          BatchRNG& rng);
+  static void Arithmetic(
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          int n,
+          BatchRNG& rng);
+  static void BlendAlpha(
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          int n,
+          float alpha,
+          BatchRNG& rng);
+  static void PerNeuron(
+          const float* mom,
+          const float* dad,
+          float* child0,
+          float* child1,
+          const std::vector<int>& neuron_offsets,
+          BatchRNG& rng);
+
+  static const int N_POINTS = 2;
+  static const float BLX_ALPHA;
+};
+
+#endif // CROSSOVER_H
@@ -2,15 +2,33 @@
 #define EVOLUTIONMANAGER_H
 #include <iostream>
 
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <ctime>
 #include <QObject>
 #include "Creature.h"
 #include "AutoInitRNG.h"
+#include "BatchRNG.h"
+#include "Selection.h"
+#include "MultiObjective.h"
+#include "NoveltyArchive.h"
+#include "MapElites.h"
+#include "EvolutionStrategy.h"
+#include "TrajectoryFile.h"
+#include "SettingsManager.h"
 
 #include <QMutex>
 
 typedef std::vector<Creature> Population;
+Q_DECLARE_METATYPE(Population);
+
+//! Best fitness after one generation, batch or iteration of a run.
+struct ProgressRecord {
+	int generation;
+	float best_fitness;
+	double seconds; // Wall time since the start of the run
+};
 
 //! Holds an evolution and can start an evolution process.
 //Stores the best creatures from all generations and stores all the generations
@@ -23,11 +41,16 @@ public:
 
 	void startEvolutionProcess();
     void RunEvolution();
+    void RunMapElites();
+    void RunEvolutionStrategy();
+    void RunSteadyState();
     void CreateNewRandomPopulation();
 	Creature GetBestCreatureFromLastGeneration();
 	void PrintBestFitnessValues();
 	Creature GetBestCreature();
+	Population GetParetoFront();
 	Population GetAllBestCreatures();
+	const std::vector<ProgressRecord>& GetProgress() const;
   void PrintPopulation();
   bool NeedEndNow();
 	void RequestEndNowFunc();
@@ -38,19 +61,145 @@ public slots:
 
 signals:
 	void NewCreature(const Creature &new_creature);
+	void NewParetoFront(const Population &front);
+	void NewEliteGrid(const Population &elites);
 
 private:
 	std::vector<Creature> best_creatures_; // holds alla the best creatures from the populations
 	Population current_population_;
+	Population next_population_; // Buffer the offspring are written to
     static AutoInitRNG rng_;
+	BatchRNG batch_rng_;
+	Selection selection_;
+	std::vector<float> fitness_; // Fitness of the current population
+	std::vector<int> ranking_; // Indices of the current population, best first
+	std::vector<int> parents_; // Two selected parents per bred slot
+	std::vector<int> pareto_front_; // Front of every creature, 0 is the Pareto front
+	NoveltyArchive novelty_archive_;
+	std::vector<float> behaviors_; // Behavior descriptors of the current population
+	MapElites map_elites_;
+	EvolutionStrategy evolution_strategy_;
+	Creature es_base_; // Body of all candidates, the Brain gets their genome
+	std::vector<int> es_offsets_; // Noise table offset of every pair
+	std::vector<float> es_fitness_; // Fitness of every candidate, pair by pair
+	// Shared by all Simulations of an ES iteration or a steady state run
+	btVector3 light_position_;
+	float weights_[7]; // Fitness weights, read when the light is placed
+	TrajectoryWriter trajectory_writer_; // Motion of every simulated creature
+	int generation_; // Current generation or iteration
+	// Settings captured at the start of every generation, batch or iteration
+	std::shared_ptr<const SettingsSnapshot> settings_;
+	std::vector<ProgressRecord> progress_;
+	std::chrono::steady_clock::time_point run_start_;
+
+	void RecordProgress(int generation, float best_fitness);
 	
 	Population CreateRandomPopulation(int pop_size);
 	void SimulatePopulation();
 	void CalculateFitnessOnPopulation();
-	void SortPopulation();
-	Creature TournamentSelection();
+	void CalculateParetoFitness();
+	void CalculateNoveltyFitness();
+	void RankPopulation(int n_elite);
+
+	//! Settings read once per generation when breeding.
+	struct OffspringSettings {
+		const SettingsSnapshot* snapshot; // Kept alive by settings_
+		float crossover;
+		CrossoverType crossover_type;
+		int elitism_pivot;
+	};
+
+	//! A range of slots in the next population bred by one task.
+	struct OffspringBatch {
+		int begin;
+		int end;
+		BatchRNG rng;
+	};
+
+	//! Functor used for breeding the batches on the thread pool.
+	struct BreedFunctor {
+		typedef void result_type;
+		BreedFunctor(EvolutionManager* em, const OffspringSettings& settings)
+			: em_(em), settings_(settings) {}
+		void operator()(OffspringBatch& batch) {
+			em_->BreedBatch(settings_, batch);
+		}
+		EvolutionManager* em_;
+		OffspringSettings settings_;
+	};
+
+	//! A range of creatures whose novelty is calculated by one task.
+	struct NoveltyBatch {
+		int begin;
+		int end;
+	};
+
+	//! Functor used for calculating novelty on the thread pool.
+	struct NoveltyFunctor {
+		typedef void result_type;
+		NoveltyFunctor(EvolutionManager* em, int k) : em_(em), k_(k) {}
+		void operator()(NoveltyBatch& batch) {
+			for (int i = batch.begin; i < batch.end; ++i)
+				em_->fitness_[i] = em_->novelty_archive_.Novelty(i, k_);
+		}
+		EvolutionManager* em_;
+		int k_;
+	};
+
+	//! A range of ES candidates evaluated in one Simulation by one task.
+	struct EsBatch {
+		int begin;
+		int end;
+	};
+
+	//! Functor used for evaluating ES candidates on the thread pool.
+	struct EsFunctor {
+		typedef void result_type;
+		EsFunctor(EvolutionManager* em) : em_(em) {}
+		void operator()(EsBatch& batch) {
+			em_->EvaluateEsBatch(batch);
+		}
+		EvolutionManager* em_;
+	};
+
+	void EvaluateEsBatch(const EsBatch& batch);
+
+	//! State of one steady state worker.
+	struct SteadyStateWorker {
+		BatchRNG rng;
+	};
+
+	//! Functor running a steady state worker on the thread pool.
+	struct SteadyStateFunctor {
+		typedef void result_type;
+		SteadyStateFunctor(EvolutionManager* em) : em_(em) {}
+		void operator()(SteadyStateWorker& worker) {
+			em_->RunSteadyStateWorker(worker);
+		}
+		EvolutionManager* em_;
+	};
+
+	void RunSteadyStateWorker(SteadyStateWorker& worker);
+	int SteadyStateTournament(int tournament_size, BatchRNG& rng);
+	void SteadyStateInsert(const Creature& creature);
+	void EvaluateWithSharedLight(Population* creatures, int generation);
+
+	QMutex steady_state_mutex_; // Guards the population in steady state
+	int steady_state_budget_; // Number of evaluations of the run
+	int steady_state_started_;
+	int steady_state_completed_;
+	float best_fitness_;
 
 	void NextGeneration();
+	void BreedBatch(const OffspringSettings& settings, OffspringBatch& batch);
+
+	static const int OFFSPRING_BATCH_SIZE = 32;
+	static const int MAX_PARETO_FRONT_SIZE = 10;
+	static const int NOVELTY_BATCH_SIZE = 256;
+	static const float NOVELTY_ARCHIVE_PROBABILITY;
+	static const int MAP_ELITES_CHECKPOINT_INTERVAL = 10;
+	static const int ES_BATCH_SIZE = 16;
+	static const int STEADY_STATE_BATCH_SIZE = 4;
 
 	bool end_now_request_;
 	QBasicMutex* mutex_;
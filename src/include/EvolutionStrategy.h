@@ -0,0 +1,70 @@
+#ifndef EVOLUTIONSTRATEGY_H
+#define EVOLUTIONSTRATEGY_H
+
+// C++
+#include <vector>
+// Internal
+#include "BatchRNG.h"
+
+//! A large table of normal distributed numbers shared by all workers.
+/*!
+  A perturbation of a genome is a slice of the table, identified only by
+  its offset. Workers rebuild any perturbation from the offset, so only
+  offsets and fitness values have to be passed around, never genomes. The
+  table is generated once from a fixed seed.
+*/
+class NoiseTable {
+public:
+  static const NoiseTable& Instance();
+
+  const float* Get(int offset) const;
+  int SampleOffset(int n, BatchRNG& rng) const;
+  int Size() const;
+
+  static const int TABLE_SIZE = 1 << 22;
+private:
+  NoiseTable();
+  std::vector<float> noise_;
+};
+
+//! Evolution strategy in the style of OpenAI-ES on a flat genome.
+/*!
+  Keeps a mean genome theta. Every iteration samples pairs of antithetic
+  perturbations theta + sigma * eps and theta - sigma * eps from the shared
+  noise table. After evaluation the fitness values are replaced by centered
+  ranks, which makes the update invariant to the scale of the fitness, and
+  theta is moved along the estimated gradient with the Adam optimizer.
+*/
+class EvolutionStrategy {
+public:
+  EvolutionStrategy();
+
+  void Reset(const std::vector<float>& theta, float sigma, float learning_rate);
+  void Sample(int n_pairs, std::vector<int>* offsets);
+  void Perturbed(int offset, bool negative, float* genome) const;
+  void Update(
+          const std::vector<int>& offsets,
+          const std::vector<float>& fitness);
+
+  const std::vector<float>& GetTheta() const;
+  int GetGenomeSize() const;
+
+  static void CenteredRanks(
+          const std::vector<float>& fitness,
+          std::vector<float>* ranks);
+
+  static const float ADAM_BETA1;
+  static const float ADAM_BETA2;
+  static const float ADAM_EPSILON;
+private:
+  std::vector<float> theta_;
+  std::vector<float> gradient_;
+  std::vector<float> adam_m_;
+  std::vector<float> adam_v_;
+  int iteration_;
+  float sigma_;
+  float learning_rate_;
+  BatchRNG rng_;
+};
+
+#endif // EVOLUTIONSTRATEGY_H
@@ -0,0 +1,125 @@
+#ifndef GLOBJECT_H
+#define GLOBJECT_H
+
+// C++
+#include <utility>
+// External
+#include <GL/glew.h>
+
+//! Owns the name of one OpenGL object and deletes it when destroyed.
+/*!
+  The Traits say how the object is created and deleted, see GLBuffer and
+  the other typedefs below. A GLObject can be moved but not copied, so
+  every name is deleted exactly once, by the last owner. The name 0 is
+  never deleted. Objects need to be destroyed, or Reset, while their
+  context is current.
+*/
+template <class Traits>
+class GLObject {
+public:
+  GLObject() : id_(0) {}
+  explicit GLObject(GLuint id) : id_(id) {}
+  GLObject(GLObject&& other) : id_(other.Release()) {}
+  ~GLObject() { Reset(); }
+
+  GLObject& operator=(GLObject&& other) {
+    if (this != &other)
+      Reset(other.Release());
+    return *this;
+  }
+
+  //! Creates a new object with Traits::Create.
+  static GLObject Create() { return GLObject(Traits::Create()); }
+
+  GLuint Get() const { return id_; }
+
+  //! Gives up the name without deleting it.
+  GLuint Release() {
+    GLuint id = id_;
+    id_ = 0;
+    return id;
+  }
+
+  //! Deletes the object and takes the name of another one.
+  void Reset(GLuint id = 0) {
+    if (id_ != 0)
+      Traits::Delete(id_);
+    id_ = id;
+  }
+private:
+  GLObject(const GLObject&);
+  GLObject& operator=(const GLObject&);
+
+  GLuint id_;
+};
+
+//! How GLBuffers are created and deleted.
+struct BufferTraits {
+  static GLuint Create() {
+    GLuint id;
+    glGenBuffers(1, &id);
+    return id;
+  }
+  static void Delete(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+//! How GLVertexArrays are created and deleted.
+struct VertexArrayTraits {
+  static GLuint Create() {
+    GLuint id;
+    glGenVertexArrays(1, &id);
+    return id;
+  }
+  static void Delete(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+//! How GLTextures are created and deleted.
+struct TextureTraits {
+  static GLuint Create() {
+    GLuint id;
+    glGenTextures(1, &id);
+    return id;
+  }
+  static void Delete(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+//! How GLFramebuffers are created and deleted.
+struct FramebufferTraits {
+  static GLuint Create() {
+    GLuint id;
+    glGenFramebuffers(1, &id);
+    return id;
+  }
+  static void Delete(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+
+//! How GLRenderbuffers are created and deleted.
+struct RenderbufferTraits {
+  static GLuint Create() {
+    GLuint id;
+    glGenRenderbuffers(1, &id);
+    return id;
+  }
+  static void Delete(GLuint id) { glDeleteRenderbuffers(1, &id); }
+};
+
+//! How GLPrograms are created and deleted.
+struct ProgramTraits {
+  static GLuint Create() { return glCreateProgram(); }
+  static void Delete(GLuint id) { glDeleteProgram(id); }
+};
+
+//! How GLShaders are deleted, they are created with a type by glCreateShader.
+struct ShaderTraits {
+  static void Delete(GLuint id) { glDeleteShader(id); }
+};
+
+typedef GLObject<BufferTraits> GLBuffer;
+typedef GLObject<VertexArrayTraits> GLVertexArray;
+typedef GLObject<TextureTraits> GLTexture;
+typedef GLObject<FramebufferTraits> GLFramebuffer;
+typedef GLObject<RenderbufferTraits> GLRenderbuffer;
+typedef GLObject<ProgramTraits> GLProgram;
+typedef GLObject<ShaderTraits> GLShader;
+
+#endif // GLOBJECT_H
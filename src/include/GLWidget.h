@@ -38,6 +38,7 @@ protected:
 private:
     QPoint lastPos;
     bool enable_render_;
+    int frame_count_;
 };
 
 #endif // GLWIDGET_H
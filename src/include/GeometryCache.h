@@ -0,0 +1,66 @@
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+// Internal
+#include "GLObject.h"
+
+//! Vertex data of a mesh before it is put in the GeometryCache.
+struct MeshData {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> uvs;
+  std::vector<GLushort> elements;
+};
+
+//! A mesh in the shared buffers of the GeometryCache.
+struct Mesh {
+  GLsizei first_element; // In the element buffer
+  GLsizei n_elements;
+  Mesh() {
+    first_element = 0;
+    n_elements = 0;
+  }
+};
+
+//! Holds the vertices of all meshes in buffers shared by every Shape.
+/*!
+  There is one unit Box and one unit Plane, put in the same vertex and
+  element buffers once when the GeometryCache is created. Shapes only keep
+  the Mesh they draw and are scaled by their model transform, so creating
+  Nodes never generates or uploads vertices. All meshes are drawn from the
+  same vertex array, and vertex arrays with more attributes, like the one
+  of an InstancedRenderer, can read the same buffers through
+  SetupVertexAttributes. This class uses the singleton pattern.
+*/
+class GeometryCache {
+public:
+  static GeometryCache* Instance();
+
+  Mesh GetBox();
+  Mesh GetPlane();
+  GLuint GetVertexArrayId();
+  void SetupVertexAttributes();
+private:
+  GeometryCache();
+  Mesh AddMesh(const MeshData& mesh_data, MeshData* all);
+
+  static GeometryCache* instance_;
+  GLVertexArray vertex_array_;
+  GLBuffer element_buffer_;
+  GLBuffer vertex_position_buffer_;
+  GLBuffer vertex_normal_buffer_;
+  GLBuffer vertex_uv_buffer_;
+
+  Mesh box_;
+  Mesh plane_;
+};
+
+#endif // GEOMETRYCACHE_H
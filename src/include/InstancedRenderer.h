@@ -0,0 +1,54 @@
+#ifndef INSTANCEDRENDERER_H
+#define INSTANCEDRENDERER_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+// Internal
+#include "GeometryCache.h"
+#include "GLObject.h"
+
+//! One box drawn by the InstancedRenderer, as it is stored in the instance buffer.
+struct BoxInstance {
+  glm::mat4 model; // Rigid transform of the box
+  glm::vec3 scale; // Half extents of the box
+  GLint material_index; // In the table of the MaterialManager
+};
+
+//! Draws many boxes with one shared mesh.
+/*!
+  All boxes use the unit Box of the GeometryCache. The boxes to draw are added
+  every frame and uploaded to one instance buffer, then drawn with one
+  instanced draw call. The transform, size and material index of every box
+  are attributes of its instance and all textures are layers of one array,
+  so nothing changes between boxes. Used by the Scene for the body parts of
+  the creatures and by the ShadowMap for the boxes casting shadows.
+*/
+class InstancedRenderer {
+public:
+  InstancedRenderer();
+
+  void Clear();
+  void Add(const glm::mat4& model, const glm::vec3& scale, int material_index);
+  void Render();
+  void RenderDepth();
+  void DeleteBuffers();
+  int GetNumberOfInstances() const;
+private:
+  bool UploadInstances();
+  void SetupBuffers();
+
+  Mesh box_;
+  GLVertexArray vertex_array_; // The shared vertices and the instance buffer
+  GLBuffer instance_buffer_;
+  int instance_buffer_capacity_; // In instances
+
+  std::vector<BoxInstance> instances_; // Uploaded to the instance buffer
+};
+
+#endif // INSTANCEDRENDERER_H
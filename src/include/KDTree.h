@@ -0,0 +1,62 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+// C++
+#include <vector>
+
+//! A bucketed KD-tree for k nearest neighbour search that grows incrementally.
+/*!
+  Points are stored in one flat array. Leaves hold buckets of up to
+  BUCKET_SIZE points and are split at the median of their widest dimension
+  when they overflow, so inserting a point never rebuilds the tree and
+  costs O(log n) on average. Queries do not modify the tree and can run
+  concurrently, but not while points are inserted.
+*/
+class KDTree {
+public:
+  KDTree(int dimension = 1);
+
+  void Clear();
+  void Insert(const float* point);
+  int Nearest(
+          const float* query,
+          int k,
+          float* distances2,
+          int* indices) const;
+
+  int Size() const;
+  int Dimension() const;
+  const float* Point(int i) const;
+
+  static const int BUCKET_SIZE = 32;
+private:
+  //! A node is either a leaf with a bucket of points or a split.
+  struct KDNode {
+    int split_dim; // -1 for a leaf
+    float split_value;
+    int child[2]; // Smaller than and larger or equal to split_value
+    std::vector<int> bucket;
+  };
+
+  //! The k best candidates found so far, as a sorted array.
+  struct Candidates {
+    int k;
+    int count;
+    float* distances2;
+    int* indices;
+  };
+
+  void Split(int node);
+  void Search(
+          int node,
+          const float* query,
+          float distance2,
+          float* offsets,
+          Candidates* best) const;
+
+  int dimension_;
+  std::vector<float> points_;
+  std::vector<KDNode> nodes_;
+};
+
+#endif // KDTREE_H
@@ -0,0 +1,30 @@
+#ifndef LZCODEC_H
+#define LZCODEC_H
+
+// C++
+#include <vector>
+
+//! A small and fast LZ77 compressor in the style of LZ4.
+/*!
+  The compressed data is a list of sequences. Every sequence is a token
+  with the number of literals and the length of a match, the literals and
+  a two byte offset back to where the match starts. Lengths that do not fit
+  in the token continue in bytes of 255. The last sequence only has
+  literals. Matches are found with a single hash table of four byte
+  prefixes, so compression is one pass without search.
+*/
+class LzCodec {
+public:
+  static void Compress(const char* in, int n, std::vector<char>* out);
+  static bool Decompress(
+          const char* in,
+          int n,
+          int raw_size,
+          std::vector<char>* out);
+
+  static const int MIN_MATCH = 4;
+  static const int MAX_OFFSET = 65535;
+  static const int HASH_BITS = 14;
+};
+
+#endif // LZCODEC_H
@@ -34,6 +34,8 @@ QT_END_NAMESPACE
 class GLWidget;
 class EvolutionManager;
 
+typedef std::vector<Creature> Population;
+
 class MainCEWindow : public QMainWindow
 {
     Q_OBJECT
@@ -54,6 +56,8 @@ public slots:
     void evoDone();
 
     void GotNewCreature(const Creature &new_creature);
+    void GotParetoFront(const Population &front);
+    void GotEliteGrid(const Population &elites);
 
     void setValueMut(int value);
     void setValueMutInternal(int value);
@@ -68,6 +72,8 @@ public slots:
     //void changeReleased();
     void GameOfWorms();
     void ChangeCreatureType(int type);
+    void ChangeFitnessMode(int mode);
+    void ChangeEvolutionMode(int mode);
 
     void FSetDistTarget(int value);
     void FSetDistZ(int value);
@@ -0,0 +1,94 @@
+#ifndef MAPELITES_H
+#define MAPELITES_H
+
+// C++
+#include <atomic>
+#include <string>
+#include <vector>
+// External
+#include <QMutex>
+#include <btBulletDynamicsCommon.h>
+// Internal
+#include "BatchRNG.h"
+#include "Creature.h"
+
+typedef std::vector<Creature> Population;
+
+enum EvolutionMode {
+  GENERATIONAL_EVOLUTION = 0, // One population evolved generation by generation
+  MAP_ELITES_EVOLUTION = 1, // Grid of elites with different behaviors
+  ES_EVOLUTION = 2, // Evolution strategy on the Brain weights of one creature
+  STEADY_STATE_EVOLUTION = 3 // Asynchronous, offspring replace the worst
+};
+
+//! The MAP-Elites quality diversity algorithm.
+/*!
+  A grid of cells is indexed by behavior features of the creatures, the
+  maximum height, the deviation along the x-axis and the energy waste. Every
+  cell keeps the best creature found with those features. Batches of
+  mutants of random elites are evaluated in parallel, each part of a batch
+  in its own Simulation, and inserted in to the grid concurrently. The cells
+  are protected by a fixed number of sharded locks, so inserting in to
+  different cells rarely waits. The light position is chosen once by Reset
+  and kept in checkpoints, so all elites of a run are judged against the
+  same light.
+*/
+class MapElites {
+public:
+  MapElites();
+
+  void Reset(int bins);
+  void Seed(const Population& creatures, const SettingsSnapshot& settings);
+  void Step(int batch_size, const SettingsSnapshot& settings);
+
+  Population GetElites();
+  int GetFilledCells() const;
+  int GetNumberOfCells() const;
+  bool Save(const std::string& path);
+  bool Load(const std::string& path);
+
+  static void Features(const SimData& data, float* features);
+  static int CellIndex(const SimData& data, int bins, int* coords);
+
+  static const int N_FEATURES = 3;
+  static const int MAX_BINS = 32; // Along every feature
+  static const int N_SHARDS = 64;
+  static const int EVALUATION_BATCH_SIZE = 16;
+  static const float FEATURE_MIN[N_FEATURES];
+  static const float FEATURE_MAX[N_FEATURES];
+private:
+  //! A range of candidates evaluated in one Simulation by one task.
+  struct EvaluationBatch {
+    int begin;
+    int end;
+    const SettingsSnapshot* settings;
+  };
+
+  //! Functor used for evaluating the batches on the thread pool.
+  struct EvaluateFunctor {
+    typedef void result_type;
+    EvaluateFunctor(MapElites* me) : me_(me) {}
+    void operator()(EvaluationBatch& batch) {
+      me_->EvaluateBatch(batch);
+    }
+    MapElites* me_;
+  };
+
+  void Evaluate(const SettingsSnapshot& settings);
+  void EvaluateBatch(const EvaluationBatch& batch);
+  bool TryInsert(const Creature& creature);
+  float Quality(const SimData& data) const;
+
+  int bins_;
+  std::vector<Creature> cells_;
+  std::vector<char> occupied_;
+  std::atomic<int> n_filled_;
+  QMutex shard_mutexes_[N_SHARDS];
+
+  Population candidates_; // The creatures of the current batch
+  btVector3 light_position_; // Shared by all Simulations of the run
+  float weights_[7]; // Fitness weights read once per batch
+  BatchRNG rng_;
+};
+
+#endif // MAPELITES_H
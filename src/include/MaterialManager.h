@@ -0,0 +1,40 @@
+#ifndef MATERIALMANAGER_H
+#define MATERIALMANAGER_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+// Internal
+#include "GLObject.h"
+#include "TextureManager.h"
+
+//! Table of all Materials used for rendering, shared by all ShaderPrograms.
+/*!
+  Every distinct Material gets an index in the table, which is a uniform
+  buffer bound to the MaterialData block, see basic.frag. Shapes set the
+  index as a uniform and the instances of the InstancedRenderer carry it as
+  an attribute, so one draw call can use any number of Materials. The table
+  is uploaded by Update when Materials were added or textures finished
+  loading, Materials with textures still loading point at no layer and get
+  the placeholder. This class uses the singleton pattern.
+*/
+class MaterialManager {
+public:
+  static MaterialManager* Instance();
+
+  int GetMaterialIndex(const Material& material);
+  void Update();
+
+  static const int MAX_MATERIALS = 256; // Same in the shaders
+private:
+  MaterialManager();
+
+  static MaterialManager* instance_;
+  std::vector<Material> materials_;
+  GLBuffer material_buffer_; // Created by the first Update
+  bool changed_; // Materials were added since the last upload
+  int n_loaded_textures_; // When the table was uploaded
+};
+
+#endif // MATERIALMANAGER_H
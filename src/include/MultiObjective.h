@@ -0,0 +1,40 @@
+#ifndef MULTIOBJECTIVE_H
+#define MULTIOBJECTIVE_H
+
+// C++
+#include <vector>
+
+enum FitnessMode {
+  WEIGHTED_SUM_FITNESS = 0, // Weighted sum of the normalized objectives
+  PARETO_FITNESS = 1, // NSGA-II, Pareto rank and crowding distance
+  NOVELTY_FITNESS = 2 // Novelty search, distance to known behaviors
+};
+
+//! Pareto ranking of a population with several objectives, as in NSGA-II.
+/*!
+  The objectives of a population are stored in one flat array, n_objectives
+  values per individual, and all objectives are maximized. The individuals
+  are sorted in to non-dominated fronts where front 0 is the Pareto front.
+  Within a front, individuals in sparse regions get a larger crowding
+  distance.
+*/
+class MultiObjective {
+public:
+  static void NonDominatedSort(
+          const std::vector<float>& objectives,
+          int n_objectives,
+          std::vector<int>* front);
+  static void CrowdingDistance(
+          const std::vector<float>& objectives,
+          int n_objectives,
+          const std::vector<int>& front,
+          std::vector<float>* crowding);
+  static void ScalarFitness(
+          const std::vector<int>& front,
+          const std::vector<float>& crowding,
+          std::vector<float>* fitness);
+
+  static bool Dominates(const float* a, const float* b, int n_objectives);
+};
+
+#endif // MULTIOBJECTIVE_H
@@ -0,0 +1,73 @@
+#ifndef MUTATION_H
+#define MUTATION_H
+
+// Internal
+#include "BatchRNG.h"
+
+enum MutationType {
+  UNIFORM_MUTATION = 0, // Uniform perturbation in [-sigma, sigma]
+  GAUSSIAN_MUTATION = 1, // Normal distributed perturbation
+  SELF_ADAPTIVE_MUTATION = 2 // Gaussian with a sigma evolved per genome
+};
+
+//! Mutation operators working on flat genomes.
+/*!
+  Instead of flipping a coin for every gene, the genes to mutate are chosen
+  by geometric skipping. The distance to the next mutated gene is drawn from
+  a geometric distribution, which gives exactly the same distribution of
+  mutated genes but only needs random numbers for the genes that are
+  mutated. Indices, uniforms and perturbations are all computed in blocks
+  with branch free loops which the compiler vectorizes.
+*/
+class Mutation {
+public:
+  static void Apply(
+          MutationType type,
+          float* genome,
+          int n,
+          float rate,
+          float sigma,
+          float* adaptive_sigma,
+          BatchRNG& rng);
+
+  static void Uniform(
+          float* genome,
+          int n,
+          float rate,
+          float strength,
+          BatchRNG& rng);
+  static void Gaussian(
+          float* genome,
+          int n,
+          float rate,
+          float sigma,
+          BatchRNG& rng);
+  static void SelfAdaptive(
+          float* genome,
+          int n,
+          float rate,
+          float* sigma,
+          BatchRNG& rng);
+
+  static void FillGaussian(float* out, int n, BatchRNG& rng);
+
+  static const float MIN_SIGMA;
+  static const float MAX_SIGMA;
+private:
+  static void Perturb(
+          float* genome,
+          int n,
+          float rate,
+          float scale,
+          bool gaussian,
+          BatchRNG& rng);
+  static int NextIndices(
+          int* indices,
+          int max_count,
+          int* position,
+          int n,
+          float rate,
+          BatchRNG& rng);
+};
+
+#endif // MUTATION_H
@@ -18,32 +18,44 @@
 #include "Box.h"
 #include "Plane.h"
 
-class Camera;
-
 //! Interface between simulation and rendering.
 /*!
   This class is the interface between btRigidBody which describes rigid bodies
   in the physics world and Shape which are used for rendering the boxes
-  and the planes.
+  and the planes. No Node has buffers of its own. Boxes are drawn by an
+  InstancedRenderer with the transform, scale and material of the Node, the
+  other Shapes draw a Mesh of the GeometryCache scaled by shape_transform_.
 */
 class Node {
 public:
   Node(btRigidBody* body, Material material);
-  void Render(Camera* camera);
+  void Render();
+  void RenderDepth();
   void SetTransform(glm::mat4 trans);
   void SetPosition(glm::vec3 pos);
   glm::vec3 GetPosition();
+  btRigidBody* GetRigidBody();
+  bool IsInstanced();
+  glm::mat4 GetTransform();
+  glm::vec3 GetScale();
+  Material GetMaterial();
+  int GetMaterialIndex();
+  void GetBoundingBox(glm::vec3* min, glm::vec3* max);
   void DebugPrint();
   void UpdateNode();
-  void DeleteBuffers();
 private:
-  void InitBoxShape(Material material);
+  void InitBoxShape();
   void InitPlaneShape(Material material);
   void InitSphereShape(Material material);
 
   glm::mat4 transform_;
   Shape shape_;
+  glm::mat4 shape_transform_; // Scale and offset of the Mesh of shape_
   btRigidBody* rigid_body_;
+  bool instanced_; // Drawn by an InstancedRenderer instead of shape_
+  glm::vec3 scale_; // Half extents of a box or the plane
+  Material material_;
+  int material_index_; // In the table of the MaterialManager
 };
 
 #endif //NODE_H
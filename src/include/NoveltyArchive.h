@@ -0,0 +1,33 @@
+#ifndef NOVELTYARCHIVE_H
+#define NOVELTYARCHIVE_H
+
+// C++
+#include <vector>
+// Internal
+#include "KDTree.h"
+
+//! Archive of behavior descriptors for novelty search.
+/*!
+  The novelty of a behavior is the mean distance to its k nearest
+  neighbours among the archive and the current population. Both are
+  indexed by KD-trees, the archive tree grows incrementally over the whole
+  evolution and the population tree is rebuilt every generation.
+*/
+class NoveltyArchive {
+public:
+  NoveltyArchive(int dimension = 1);
+
+  void Clear();
+  void SetPopulation(const std::vector<float>& descriptors);
+  float Novelty(int i, int k) const;
+  void Add(const float* descriptor);
+  int Size() const;
+
+  static const int MAX_K = 64;
+private:
+  int dimension_;
+  KDTree archive_;
+  KDTree population_;
+};
+
+#endif // NOVELTYARCHIVE_H
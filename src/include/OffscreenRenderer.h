@@ -0,0 +1,125 @@
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+// C++
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+// External
+#include <GL/glew.h>
+#include <QMutex>
+#include <QWaitCondition>
+// Internal
+#include "Creature.h"
+#include "GLObject.h"
+
+// The context comes from EGL on Linux and from Qt elsewhere, see Init
+#if defined(__linux__)
+#define OFFSCREEN_EGL
+#else
+class QOffscreenSurface;
+class QOpenGLContext;
+#endif
+
+//! One frame read back from the framebuffer, RGBA with the bottom row first.
+struct RenderedFrame {
+  int number;
+  std::vector<unsigned char> pixels;
+};
+
+//! Renders the Scene without a window, to a PNG sequence or a raw video.
+/*!
+  The Scene is rendered in to a framebuffer object of an offscreen OpenGL
+  context, so no window is opened. On Linux the context is created through
+  EGL without any surface, on the surfaceless platform of Mesa if there is
+  one, so no display or X server is needed. Servers without a GPU use the
+  software rasterizer of Mesa:
+
+    LIBGL_ALWAYS_SOFTWARE=1 CreatureEvolution --render frames
+        --creatures map_elites.chk
+
+  Other systems use a QOffscreenSurface, which needs a QGuiApplication.
+
+  Recorded runs are played back instead of simulated with --trajectory and
+  the file written by the TrajectoryWriter, see LoadTrajectories.
+
+  Frames are read in to a ring of N_PIXEL_BUFFERS pixel buffer objects and
+  mapped N_PIXEL_BUFFERS - 1 frames later, so the GPU copies the pixels
+  while the next frames are rendered instead of glReadPixels waiting for
+  it. The mapped frames are encoded and written by a background thread. At
+  most MAX_QUEUED_FRAMES wait for it, after that rendering waits.
+
+  The output is a directory of frame_00000.png files, or a raw rgb24 video
+  stream if it ends with .rgb. The stream can be a named pipe read by
+  ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x600 -r 30 -i gait.rgb gait.mp4
+  The Scene has a fixed time step, every frame is one tick of the
+  PhysicsThread no matter how long it takes to render.
+*/
+class OffscreenRenderer {
+public:
+  OffscreenRenderer();
+  ~OffscreenRenderer();
+
+  bool Init(int width, int height);
+  bool Render(
+          const std::vector<Creature>& creatures,
+          int n_frames,
+          const std::string& output);
+
+  static bool LoadCreatures(
+          const std::string& checkpoint,
+          int count,
+          std::vector<Creature>* creatures);
+  static bool LoadTrajectories(
+          const std::string& path,
+          int count,
+          std::vector<Creature>* creatures);
+
+  static const int N_PIXEL_BUFFERS = 3;
+  static const int MAX_QUEUED_FRAMES = 8;
+private:
+  OffscreenRenderer(const OffscreenRenderer&);
+  OffscreenRenderer& operator=(const OffscreenRenderer&);
+
+  bool OpenOutput(const std::string& output);
+  bool CollectFrame(int number);
+  void RunEncoder();
+  bool Encode(const RenderedFrame& frame);
+  void ReleaseBuffers(bool context_current);
+  bool CreateContext();
+  bool MakeCurrent();
+  void DestroyContext();
+
+#ifdef OFFSCREEN_EGL
+  // An EGLDisplay and an EGLContext, egl.h is only included by the .cpp
+  void* display_;
+  void* context_;
+#else
+  QOpenGLContext* context_;
+  QOffscreenSurface* surface_;
+#endif
+  int width_;
+  int height_;
+  GLFramebuffer framebuffer_;
+  GLRenderbuffer color_buffer_;
+  GLRenderbuffer depth_buffer_;
+  GLBuffer pixel_buffers_[N_PIXEL_BUFFERS];
+
+  std::string directory_; // Of the PNG files, empty for a raw stream
+  std::FILE* raw_out_;
+  std::thread encoder_;
+
+  QMutex mutex_; // Guards the members below
+  QWaitCondition queue_changed_;
+  std::deque<RenderedFrame> queue_; // Waiting to be encoded
+  std::vector<std::vector<unsigned char> > free_pixels_; // Reused buffers
+  bool closing_;
+  bool failed_;
+
+  // Only used by the encoder thread
+  std::vector<unsigned char> row_; // One rgb24 row of a raw stream
+};
+
+#endif // OFFSCREENRENDERER_H
@@ -0,0 +1,71 @@
+#ifndef PHYSICSTHREAD_H
+#define PHYSICSTHREAD_H
+
+// C++
+#include <chrono>
+#include <thread>
+#include <vector>
+// External
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+#include <btBulletDynamicsCommon.h>
+#include <QMutex>
+#include <QWaitCondition>
+
+class Simulation;
+
+//! Transforms of the bodies of a Simulation after one tick.
+struct PhysicsSnapshot {
+  double time; // Seconds since the thread was started
+  std::vector<btTransform> transforms; // One per body given to Start
+  btVector3 target; // Center of mass of the last creature
+};
+
+//! Steps a visualization Simulation on its own thread.
+/*!
+  The Simulation is stepped at TICKS_PER_SECOND, independent of the frame
+  rate. After every tick the transforms of the bodies are copied in to a
+  snapshot and the two latest snapshots are kept. The GUI thread never
+  touches the Simulation while the thread runs, it only interpolates
+  between the snapshots, so a slow physics step never stalls rendering.
+  Moving the light source target is handed to the thread the same way, and
+  applied before the next tick.
+  If a tick takes longer than its time the thread falls behind and the
+  rendering shows the latest snapshot until it catches up.
+*/
+class PhysicsThread {
+public:
+  PhysicsThread();
+  ~PhysicsThread();
+
+  void Start(Simulation* simulation, const std::vector<btRigidBody*>& bodies);
+  void Stop();
+  bool Interpolate(std::vector<glm::mat4>* transforms, btVector3* target);
+  void SetLightPosition(const btVector3& position);
+
+  static const int TICKS_PER_SECOND = 30;
+private:
+  PhysicsThread(const PhysicsThread&);
+  PhysicsThread& operator=(const PhysicsThread&);
+
+  void Run();
+  void Capture(double time, PhysicsSnapshot* snapshot);
+  double GetTime() const;
+
+  Simulation* simulation_; // Only used by the physics thread while it runs
+  std::vector<btRigidBody*> bodies_;
+  std::thread thread_;
+  std::chrono::steady_clock::time_point start_;
+
+  QMutex mutex_; // Guards the members below
+  QWaitCondition stop_requested_;
+  bool stopping_;
+  PhysicsSnapshot previous_;
+  PhysicsSnapshot latest_;
+  btVector3 light_position_; // Requested by the GUI thread
+  bool light_moved_; // Since the last tick
+};
+
+#endif // PHYSICSTHREAD_H
@@ -11,19 +11,18 @@
 
 //! Used in the render process. A plane to render.
 /*!
-  This class extends Shape and it therefore a containter of all the vertex data
-  used by OpenGL in the rendering process.
+  This class extends Shape and draws the Plane of the GeometryCache, it also
+  defines the vertex data of that mesh.
 */
 class Plane : public Shape {
 public:
   Plane(Material material);
-  Plane(glm::vec3 scale, Material material);
-  Plane(glm::vec3 scale, glm::vec4 plane_equation, Material material);
+  static void GetMeshData(MeshData* data);
 private:
-  void SetupVertexPositionData();
-  void SetupVertexNormalData();
-  void SetupVertexUVData();
-  void SetupElementData();
+  static void SetupVertexPositionData(MeshData* data);
+  static void SetupVertexNormalData(MeshData* data);
+  static void SetupVertexUVData(MeshData* data);
+  static void SetupElementData(MeshData* data);
 };
 
 #endif // PLANE_H
@@ -0,0 +1,71 @@
+#ifndef RENDERSTATE_H
+#define RENDERSTATE_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+
+//! Counts of the OpenGL calls issued during one frame.
+struct RenderStatistics {
+  int state_changes; // Bindings that reached OpenGL
+  int redundant_changes; // Bindings skipped since they were already set
+  int draw_calls;
+  int instances; // Objects drawn by all draw calls together
+  RenderStatistics() {
+    state_changes = 0;
+    redundant_changes = 0;
+    draw_calls = 0;
+    instances = 0;
+  }
+};
+
+//! Cache of the OpenGL bindings used by the render loop.
+/*!
+  Every program, texture, vertex array and uniform buffer bound while
+  rendering goes through the RenderState, which only calls OpenGL when the
+  binding actually changes. Nothing is unbound after a draw, the next draw
+  binds what it needs. The cache is invalidated at the start of every frame,
+  so code outside of the render loop (loading textures, creating buffers) can
+  call OpenGL directly. Within a frame, bindings made around the RenderState
+  make the cache wrong. All calls are counted, see GetFrameStatistics.
+  This class uses the singleton pattern.
+*/
+class RenderState {
+public:
+  static RenderState* Instance();
+
+  void BeginFrame();
+  void Invalidate();
+
+  void UseProgram(GLuint program_id);
+  void BindTexture(GLuint texture_id);
+  void BindVertexArray(GLuint vertex_array_id);
+  void BindUniformBuffer(GLuint binding, GLuint buffer_id);
+
+  void DrawElements(GLsizei count, GLsizei first = 0);
+  void DrawElementsInstanced(
+          GLsizei count,
+          GLsizei instances,
+          GLsizei first = 0);
+
+  RenderStatistics GetFrameStatistics();
+private:
+  RenderState();
+  ~RenderState();
+
+  bool Changes(GLuint* current, GLuint value);
+
+  static RenderState* instance_;
+
+  // Bound objects, UNKNOWN if they may have been changed outside the cache
+  GLuint program_id_;
+  GLuint texture_id_; // Array texture in texture unit 0
+  GLuint vertex_array_id_;
+  std::vector<GLuint> uniform_buffer_ids_; // One per binding point
+
+  RenderStatistics current_; // The frame in progress
+  RenderStatistics last_frame_;
+};
+
+#endif // RENDERSTATE_H
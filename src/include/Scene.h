@@ -1,8 +1,12 @@
 #ifndef SCENE_H
 #define SCENE_H
+#include <memory>
 #include <vector>
 #include "Camera.h"
 #include "Creature.h"
+#include "InstancedRenderer.h"
+#include "PhysicsThread.h"
+#include "ShadowMap.h"
 #include "SettingsManager.h"
 
 class Node;
@@ -45,10 +49,31 @@ struct LightSource {
   }
 };
 
+//! Counts of the Nodes culled and simplified during one frame.
+struct CullingStatistics {
+  int visible_nodes; // Drawn as they are
+  int culled_nodes; // Outside of the Frustum
+  int impostor_nodes; // Of creatures drawn as one impostor box
+  int impostors;
+  int shadow_casters; // Moving boxes drawn in to the ShadowMap
+  CullingStatistics() {
+    visible_nodes = 0;
+    culled_nodes = 0;
+    impostor_nodes = 0;
+    impostors = 0;
+    shadow_casters = 0;
+  }
+};
+
 //! This class handles the simulation of the physics world to be rendered.
 /*!
   The Scene contains a Simulation, a Camera, all Nodes to be rendered and all
-  LightSources used in the rendering process.
+  LightSources used in the rendering process. The Simulation is stepped by
+  a PhysicsThread and Update only interpolates the transforms of the Nodes
+  from its snapshots. If all creatures have a recorded Trajectory, they are
+  played back instead and the physics is never stepped. Nodes outside of
+  the view of the Camera are not rendered, see GetCullingStatistics. The
+  spot light SHADOW_LIGHT casts shadows, see ShadowMap.
 */
 class Scene {
 public:
@@ -64,18 +89,38 @@ public:
   Camera* GetCamera();
   LightSource GetLight(int i);
   void RestartSimulation(std::vector<Creature> viz_creatures);
+  void SetFixedTimeStep(bool fixed);
+  CullingStatistics GetCullingStatistics();
 
   static const int N_LIGHTS = 2;
+  static const int SHADOW_LIGHT = 1; // Index of the spot light with a ShadowMap
+  static const float IMPOSTOR_PIXELS;
 private:
   void StartSimulation(std::vector<Creature> viz_creatures);
   void EndSimulation();
+  void UpdatePlayback();
+  void QueueNode(Node* node, const Frustum& frustum);
+  void QueueCreature(int begin, int end, const Frustum& frustum);
   
   static Scene* instance_;
   Simulation* sim_;
+  PhysicsThread physics_;
+  bool fixed_time_step_; // Stepped by Update instead of physics_
+  std::vector<glm::mat4> transforms_; // Interpolated, one per Node
   Camera cam_;
   LightSource lights_[N_LIGHTS];
+  ShadowMap shadow_map_; // Of lights_[SHADOW_LIGHT]
 
   std::vector<Node> nodes_;
+  InstancedRenderer instanced_renderer_; // Draws all boxes of the Nodes
+  std::vector<Node*> render_queue_; // The other Nodes
+  std::vector<int> creature_nodes_; // Index of the first Node of every creature
+  CullingStatistics culling_; // Of the last frame
+
+  // Playback of recorded creatures instead of simulating them
+  bool playback_;
+  float playback_time_;
+  std::vector<std::shared_ptr<const Trajectory> > trajectories_;
 };
 
 #endif  // SCENE_H
@@ -0,0 +1,54 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+// C++
+#include <vector>
+// Internal
+#include "BatchRNG.h"
+
+enum SelectionType {
+  TOURNAMENT_SELECTION = 0, // Best of a number of random creatures
+  RANK_SELECTION = 1, // Linear ranking
+  STOCHASTIC_UNIVERSAL_SAMPLING = 2, // Fitness proportional, evenly spaced
+  TRUNCATION_SELECTION = 3 // Uniform among the best
+};
+
+//! Selection operators working on arrays of fitness values.
+/*!
+  A Selection is prepared once per generation from the fitness values of
+  the population and then draws the indices of the parents. Only indices
+  and fitness values are sorted or partitioned, never the creatures.
+  Preparing is O(n) for tournament, stochastic universal sampling and
+  truncation (nth_element partitioning) and O(n log n) for rank selection.
+  Every draw is O(1), except for tournament which is O(tournament size).
+*/
+class Selection {
+public:
+  Selection();
+
+  void Prepare(
+          SelectionType type,
+          const std::vector<float>& fitness,
+          int tournament_size);
+  void SelectMany(int count, BatchRNG& rng, int* out);
+
+  static void RankElite(
+          const std::vector<float>& fitness,
+          int n_elite,
+          std::vector<int>* ranking);
+
+  static const float TRUNCATION_RATIO;
+private:
+  void Tournament(int count, BatchRNG& rng, int* out);
+  void Rank(int count, BatchRNG& rng, int* out);
+  void StochasticUniversal(int count, BatchRNG& rng, int* out);
+  void Truncation(int count, BatchRNG& rng, int* out);
+
+  SelectionType type_;
+  int tournament_size_;
+  int n_truncated_;
+  std::vector<float> fitness_;
+  std::vector<int> order_; // Indices, best first, for rank and truncation
+};
+
+#endif // SELECTION_H
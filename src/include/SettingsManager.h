@@ -7,34 +7,127 @@
 //C++
 #include <iostream>
 #include <vector>
+#include <string>
+#include <memory>
 // External
+#include <QMutex>
 #include "vec3.h"
 #ifndef Q_MOC_RUN
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #endif
 
-// class Creature;
-// class Body;
-// class Brain;
+//! Immutable copy of all settings used by the evolution and simulation.
+/*!
+  A new snapshot is published every time a setting changes and is never
+  modified after that. Worker threads capture the current snapshot once and
+  then read the plain fields, no matter what the GUI thread changes in the
+  meantime. The version is increased by every change.
+*/
+struct SettingsSnapshot {
+  int version;
 
-//! Class to handle all the settings in the program. Can only instance one SettingsManager-class in the whole program. Singleton pattern. 
+  // Evolution settings
+  int population_size;
+  int max_generations;
+  float crossover;
+  int crossover_type;
+  float elitism;
+  float mutation;
+  float mutation_internal;
+  float mutation_sigma;
+  int mutation_type;
+  int selection_type;
+  int tournament_size;
+  int simulation_time;
+  int creature_type;
+
+  // In the order of SettingsManager::GetFitnessWeights
+  float fitness_weights[7];
+  int fitness_mode;
+  int novelty_neighbours;
+
+  int evolution_mode;
+  int map_elites_bins;
+  std::string map_elites_checkpoint;
+  float es_sigma;
+  float es_learning_rate;
+  bool record_trajectories;
+  std::string trajectory_file;
+
+  SettingsSnapshot() {
+    version = 0;
+    population_size = 0;
+    max_generations = 0;
+    crossover = 0.0f;
+    crossover_type = 0;
+    elitism = 0.0f;
+    mutation = 0.0f;
+    mutation_internal = 0.0f;
+    mutation_sigma = 0.0f;
+    mutation_type = 0;
+    selection_type = 0;
+    tournament_size = 1;
+    simulation_time = 0;
+    creature_type = 0;
+    for (int i = 0; i < 7; ++i)
+      fitness_weights[i] = 0.0f;
+    fitness_mode = 0;
+    novelty_neighbours = 1;
+    evolution_mode = 0;
+    map_elites_bins = 1;
+    es_sigma = 0.0f;
+    es_learning_rate = 0.0f;
+    record_trajectories = false;
+  }
+};
+
+//! Class to handle all the settings in the program. Instance returns the settings used by the whole program. Singleton pattern.
+/*!
+  The settings used by the evolution are kept in a SettingsSnapshot which
+  is replaced atomically on every change, so they can be read from any
+  thread. The render settings are only used by the GUI thread. Other
+  instances can be created to prepare the settings of a run, for example
+  the jobs of a SweepRunner, and saved to a config file.
+*/
 class SettingsManager {
 public:
+  SettingsManager();
+  ~SettingsManager(void);
+
   static SettingsManager* Instance();
 
+  bool LoadConfig(const std::string& path);
+  bool SaveConfig(const std::string& path);
+  bool SetValue(const std::string& key, const std::string& value);
+  std::string GetValue(const std::string& key);
+  static std::vector<std::string> GetKeys();
+  static bool IsWholeNumber(const std::string& key);
+  static bool ParseConfigLine(
+          const std::string& line,
+          std::string* key,
+          std::string* value);
+
+  std::shared_ptr<const SettingsSnapshot> GetSnapshot() const;
+
   int GetPopulationSize();
   int GetMaxGenerations();
   float GetCrossover();
+  int GetCrossoverType();
   float GetElitism();
   float GetMutation();
   float GetMutationInternal();
   float GetMutationSigma();
+  int GetMutationType();
+  int GetSelectionType();
+  int GetTournamentSize();
   int GetSimulationTime();
 
   int GetFrameWidth();
   int GetFrameHeight();
   float GetRotationSensitivity();
+  bool GetPrintRenderStatistics();
+  bool GetShaderHotReload();
 
   Vec3 GetMainBodyDimension();
 
@@ -50,14 +143,31 @@ public:
   float GetFitnessAccumHeadY();
   float GetFitnessDeviationX();
   float GetFitnessEnergy();  
+  void GetFitnessWeights(float* weights);
+  int GetFitnessMode();
+  int GetNoveltyNeighbours();
+
+  int GetEvolutionMode();
+  int GetMapElitesBins();
+  std::string GetMapElitesCheckpoint();
+
+  float GetEsSigma();
+  float GetEsLearningRate();
+
+  bool GetRecordTrajectories();
+  std::string GetTrajectoryFile();
 
   void SetPopulationSize(int population_size);
   void SetMaxGenerations(int max_generations);
   void SetCrossover(float crossover_ratio);
+  void SetCrossoverType(int crossover_type);
   void SetElitism(float elitism_ratio);
   void SetMutation(float mutation_ratio);
   void SetMutationInternal(float mutation_ratio_internal);
   void SetMutationSigma(float mutation_sigma);
+  void SetMutationType(int mutation_type);
+  void SetSelectionType(int selection_type);
+  void SetTournamentSize(int tournament_size);
   void SetSimulationTime(int time);
 
   void SetTargetPos(Vec3 pos);
@@ -65,6 +175,8 @@ public:
   void SetFrameWidth(int frame_width);
   void SetFrameHeight(int frame_height);
   void SetRotationSensitivity(float sense);
+  void SetPrintRenderStatistics(bool print);
+  void SetShaderHotReload(bool reload);
 
   void SetFitnessDistanceLight(float val);
   void SetFitnessDistanceZ(float val);
@@ -73,6 +185,18 @@ public:
   void SetFitnessAccumHeadY(float val);
   void SetFitnessDeviationX(float val);
   void SetFitnessEnergy(float val);
+  void SetFitnessMode(int fitness_mode);
+  void SetNoveltyNeighbours(int k);
+
+  void SetEvolutionMode(int evolution_mode);
+  void SetMapElitesBins(int bins);
+  void SetMapElitesCheckpoint(std::string path);
+
+  void SetEsSigma(float sigma);
+  void SetEsLearningRate(float learning_rate);
+
+  void SetRecordTrajectories(bool record);
+  void SetTrajectoryFile(std::string path);
 
   // void AddBestCreature(Creature creature);
   // Creature GetBestCreature();
@@ -81,18 +205,14 @@ public:
   void SetMainBodyDimension(Vec3 dimension);
 
 private:
-  SettingsManager();
-  ~SettingsManager(void); 
-  // Evolution settings
-  int population_size_;
-  int max_generations_;
-  float crossover_ratio_;
-  float elitism_ratio_;
+  SettingsManager(const SettingsManager&);
+  SettingsManager& operator=(const SettingsManager&);
 
-  int simulation_time_;
-  float mutation_ratio_;
-  float mutation_ratio_internal_;
-  float mutation_sigma_;
+  SettingsSnapshot* BeginUpdate();
+  void EndUpdate(SettingsSnapshot* snapshot);
+
+  std::shared_ptr<const SettingsSnapshot> snapshot_; // Replaced atomically
+  QMutex update_mutex_; // Serializes writers of snapshot_
 
   // Render settings
   int frame_width_;
@@ -100,23 +220,13 @@ private:
   float rotation_sensitivity_; //will result in half a round on a
   // retina sceen and one round on a normal screen when moving mouse from one
   // side to the other.
-
-  int creature_type_; 
-
-  float fitness_distance_light_;
-  float fitness_distance_z_;
-  float fitness_max_y_;
-  float fitness_accumulated_y;
-  float fitness_deviation_x;
-  float fitness_accumulated_head_y;
-  float fitness_energy_;
+  bool print_render_statistics_; // See RenderState::GetFrameStatistics
+  bool shader_hot_reload_; // See ShaderManager::StartWatching
 
   Vec3 target_pos_;
 
   //std::vector<Creature> best_creatures_;
   Vec3 main_body_dim_;
-
-  static SettingsManager* instance_;
 };
 
 #endif // SETTINGSMANAGER
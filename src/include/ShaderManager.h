@@ -8,12 +8,23 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <thread>
 
 // External
 #include <GL/glew.h>
+#include <QMutex>
+#include <QWaitCondition>
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+// Internal
+#include "GLObject.h"
 
+class Camera;
 class Shader;
 class ShaderProgram;
+struct LightSource;
 class SimpleMvpShaderProgram;
 
 typedef std::pair<std::string, Shader*> StringShaderPair;
@@ -22,7 +33,11 @@ typedef std::pair<std::string, ShaderProgram*> StringShaderProgPair;
 //! The ShaderManager handles all the Shaders and ShaderPrograms.
 /*!
   This class uses the singleton pattern which makes it accessable from all
-  around the program.
+  around the program. Linked ShaderPrograms are cached on disk in
+  SHADER_CACHE_DIRECTORY, so the Shaders are only compiled when their
+  source or the driver changes. With StartWatching the shader files are
+  polled by a background thread and changed files are read there, then
+  ReloadChangedShaders relinks the ShaderPrograms using them.
 */
 class ShaderManager{
 public:
@@ -30,16 +45,49 @@ public:
   ShaderProgram* GetShaderProgramFromName(const char* name);
   void UseProgram(const char* name);
   void UnbindCurrentShader();
+  void UpdateFrameData(
+          Camera* camera,
+          const LightSource* lights,
+          const glm::mat4& shadow_matrix);
+  void StartWatching();
+  void ReloadChangedShaders();
+
+  // Binding points of the uniform blocks, see basic.frag
+  static const GLuint FRAME_DATA_BINDING = 0;
+  static const GLuint MATERIAL_DATA_BINDING = 1;
+  // Texture units of the samplers, see basic.frag
+  static const GLint TEXTURE_ARRAY_UNIT = 0;
+  static const GLint SHADOW_MAP_UNIT = 1;
+  static const char* SHADER_CACHE_DIRECTORY;
+  static const int WATCH_INTERVAL_MS = 500;
 private:
   ShaderManager();
 	~ShaderManager();
   void AddAllShaders();
   void AddSimpleMvpShaderProgram();
   void AddBasicShaderProgram();
+  void AddInstancedShaderProgram();
+  void AddShadowShaderPrograms();
+  void StopWatching();
+  void Watch();
+
+  //! A shader file polled by the watcher thread.
+  struct WatchedFile {
+    std::string path;
+    long long last_modified; // Milliseconds since the epoch
+  };
   
   static ShaderManager* instance_;
   std::map<std::string, Shader*> shaders_;
   std::map<std::string, ShaderProgram*> shader_programs_;
+  GLBuffer frame_buffer_; // Uniform buffer of the FrameData block
+
+  std::thread watcher_;
+  std::vector<WatchedFile> watched_files_; // Only used by the watcher thread
+  QMutex watch_mutex_; // Guards the members below
+  QWaitCondition stop_requested_;
+  bool stopping_;
+  std::map<std::string, std::string> changed_files_; // Path to new source
 };
 
 //! A ShaderProgram is the result of linked Shaders.
@@ -50,11 +98,31 @@ public:
           Shader* fragment_shader = NULL,
           Shader* geometry_shader = NULL,
           Shader* tesselation_shader = NULL);
-	~ShaderProgram();
   
   GLuint getID();
+  bool Link();
+  bool UsesShader(Shader* shader);
+  void Use();
   void CreateAttribLocation(const char* name);
-  void CreateUniformLocation(const char* name);
+  int CreateUniformLocation(const char* name);
+  int GetUniformHandle(const char* name);
+  void BindUniformBlock(const char* name, GLuint binding);
+  void BindSampler(const char* name, GLint unit);
+
+  // Handles are resolved once when the location is created, setting data
+  // with a handle is only an index in to a std::vector.
+  void Uniform1f(int handle, GLfloat v0);
+  void Uniform1i(int handle, GLint v0);
+  void Uniform1fv(int handle, GLsizei count, const GLfloat *value);
+  void Uniform3fv(int handle, GLsizei count, const GLfloat *value);
+  void UniformMatrix3fv(int handle,
+          GLsizei count,
+          GLboolean transpose,
+          const GLfloat *value);
+  void UniformMatrix4fv(int handle,
+          GLsizei count,
+          GLboolean transpose,
+          const GLfloat *value);
   
   // Using the std::map it is enough with the name to set data.
   // No locations needed.
@@ -117,23 +185,44 @@ public:
   void VertexAttribI4uiv(const char* name, const GLuint *v);
   
 private:
-  GLuint program_id_;
-  std::map<std::string, GLint> uniform_locations_;
+  GLint GetUniformLocation(const char* name);
+  bool LoadBinary(GLuint program_id, const std::string& path);
+  void SaveBinary(GLuint program_id, const std::string& path);
+  std::string GetCachePath();
+
+  GLProgram program_;
+  std::vector<Shader*> shaders_;
+  std::map<std::string, GLuint> uniform_blocks_; // Name to binding point
+  std::map<std::string, GLint> sampler_units_; // Name to texture unit
+  std::map<std::string, int> uniform_handles_;
+  std::vector<GLint> uniform_locations_; // One per handle
   std::map<std::string, GLint> attribute_locations_;
 };
 
 //! A Shader is compiled from source code in a shader file.
 /*!
  A Shader does not work by itself. They need to be compiled in to a
- ShaderProgram.
+ ShaderProgram. The source is read when the Shader is created but only
+ compiled when a ShaderProgram needs it, so Shaders of ShaderPrograms
+ found in the cache are never compiled.
 */
 class Shader{
 public:
 	Shader(const char* file_path, const char* preprocessor_code, int type);
-	~Shader();
   GLuint GetShaderId();
-private:  
-  GLuint shader_id_;
+  const std::string& GetSource();
+  const std::string& GetFilePath();
+  void SetFileSource(const std::string& file_source);
+
+  static bool ReadFile(const std::string& file_path, std::string* file_source);
+private:
+  void Compile();
+
+  GLShader shader_;
+  int type_;
+  std::string file_path_;
+  std::string preprocessor_code_;
+  std::string source_; // Preprocessor code followed by the file
 };
 
 #endif // SHADERMANAGER_H
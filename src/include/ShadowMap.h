@@ -0,0 +1,72 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+#ifndef Q_MOC_RUN
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#endif
+// Internal
+#include "Camera.h"
+#include "GLObject.h"
+#include "InstancedRenderer.h"
+
+class Node;
+struct LightSource;
+
+//! Depth of the Scene seen from a spot light, used to shadow it.
+/*!
+  The static Nodes, like the ground, are drawn once in to a cached depth
+  texture. Every frame the cache is copied to the shadow map on the GPU and
+  only the moving boxes are drawn on top of it, with one instanced draw
+  call. The frustum of the map is MARGIN_DEGREES wider than the cone of the
+  spot and is only aimed again when the spot has turned more than that, so
+  the cache survives while the spot follows a creature. The cache is drawn
+  again when the map is aimed or a static Node moves. basic.frag reads the
+  map from ShaderManager::SHADOW_MAP_UNIT with the matrix of GetMatrix.
+*/
+class ShadowMap {
+public:
+  ShadowMap();
+
+  void Aim(const LightSource& light);
+  glm::mat4 GetMatrix() const;
+  Frustum GetFrustum() const;
+  void Render(std::vector<Node>* nodes, int n_static_nodes);
+  void DeleteBuffers();
+  int GetNumberOfCasters() const;
+  int GetNumberOfStaticUpdates() const;
+
+  static const int SIZE = 1024; // Pixels on each side
+  static const float MARGIN_DEGREES;
+  static const float NEAR_CLIPPING;
+  static const float FAR_CLIPPING;
+private:
+  void SetupBuffers();
+  GLTexture CreateDepthTexture();
+  bool StaticNodesMoved(std::vector<Node>* nodes, int n_static_nodes);
+  void AddCaster(Node* node, const Frustum& frustum, InstancedRenderer* boxes);
+
+  GLTexture shadow_texture_; // Sampled by the shaders
+  GLFramebuffer shadow_frame_buffer_;
+  GLTexture static_texture_; // Depth of the static Nodes only
+  GLFramebuffer static_frame_buffer_;
+
+  glm::vec3 position_; // Of the light when the map was aimed
+  glm::vec3 direction_;
+  float spot_cutoff_;
+  glm::mat4 matrix_; // View projection of the light
+  bool aimed_;
+  bool static_valid_; // The cached depth matches matrix_ and the Nodes
+  std::vector<glm::mat4> static_transforms_; // When the cache was drawn
+
+  InstancedRenderer static_boxes_;
+  InstancedRenderer dynamic_boxes_;
+  int n_casters_; // Moving boxes drawn in the last Render
+  int n_static_updates_; // Times the cache has been drawn
+};
+
+#endif // SHADOWMAP_H
@@ -13,39 +13,28 @@
 #include <glm/ext.hpp>
 #endif
 // Internal
-//#include "Camera.h"
+#include "GeometryCache.h"
 #include "ShaderManager.h"
 #include "TextureManager.h"
 
-class Camera;
-
-//! This is the class containing all OpenGL data used for rendering
+//! This is the class drawing a Mesh of the GeometryCache.
 /*!
   The Shape class is used by the Node class and is the class closest to the
   actual rendering process. This class uses the ShaderPrograms and textures to
-  render the actual triangles.
+  render the triangles of its Mesh. The vertices are shared with all other
+  Shapes, so a Shape owns no OpenGL objects and is cheap to create and copy.
 */
 class Shape {
 public:
   Shape(Material material);
-  ~Shape();
-  void SetupBuffers();
-  void DebugPrint();
-  void Render(Camera* camera, glm::mat4 model_transform);
-  void DeleteBuffers();
+  Shape(const Mesh& mesh, Material material);
+  void Render(glm::mat4 model_transform, glm::vec3 scale);
+  void RenderDepth(glm::mat4 model_transform);
+  Mesh GetMesh();
 protected:
-  GLuint vertex_array_id_;
-  GLuint element_buffer_id_;
-  GLuint vertex_position_buffer_id_;
-  GLuint vertex_normal_buffer_id_;
-  GLuint vertex_uv_buffer_id_;
-
-  std::vector<glm::vec3> vertex_position_data_;
-  std::vector<glm::vec3> vertex_normal_data_;
-  std::vector<glm::vec2> vertex_uv_data_;
-  std::vector<GLushort> element_data_;
-
+  Mesh mesh_;
   Material material_;
+  int material_index_; // In the table of the MaterialManager
 };
 
 #endif // SHAPE_H
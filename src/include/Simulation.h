@@ -1,10 +1,12 @@
 #ifndef Simulation_H
 #define Simulation_H
 
+#include <memory>
 #include <vector>
 #include "Creature.h"
 #include "BulletCreature.h"
 #include "Node.h"
+#include "TrajectoryFile.h"
 
 #define BIT(x) (1<<(x))
 enum collisiontypes {
@@ -17,7 +19,7 @@ typedef std::vector<Creature> Population;
 
 class Simulation {
   public:
-    Simulation(bool vis_sim = false);
+    Simulation(const SettingsSnapshot& settings, bool vis_sim = false);
     ~Simulation();
 
     virtual void Step(float dt);
@@ -25,9 +27,20 @@ class Simulation {
 
     void AddPopulation(Population population, bool disp);
     Population SimulatePopulation();
+    void SimulatePopulation(Population* population);
     std::vector<Node> GetNodes();
+    std::vector<int> GetCreatureBodyCounts();
     btVector3 GetLastCreatureCoords();
+    btVector3 GetLightPosition();
+    void SetLightPosition(const btVector3& position);
+    void SetRecording(bool record);
+    void SetTrajectoryWriter(TrajectoryWriter* writer, int generation);
+
+    static const int RECORD_STRIDE = 2;
   private:
+    void RecordFrame();
+    void FlushChunk(int i);
+
     btBroadphaseInterface* broad_phase_;
     btDefaultCollisionConfiguration* collision_configuration_;
     btCollisionDispatcher* dispatcher_;
@@ -55,6 +68,14 @@ class Simulation {
 
     AutoInitRNG rng_;
     bool vis_sim_;
+
+    bool record_;
+    std::vector<std::shared_ptr<Trajectory> > trajectories_;
+    std::vector<btTransform> frame_transforms_; // Scratch for RecordFrame
+
+    TrajectoryWriter* writer_;
+    int writer_generation_;
+    std::vector<TrajectoryChunk> chunks_; // Frames not yet given to writer_
 };
 
 #endif  // Simulation_H
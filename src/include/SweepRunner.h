@@ -0,0 +1,76 @@
+#ifndef SWEEPRUNNER_H
+#define SWEEPRUNNER_H
+
+// C++
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+//! A setting that is varied by a sweep.
+struct SweepParameter {
+  std::string key;
+  std::vector<std::string> values; // Listed values, empty for a range
+  double low; // Range used when no values are listed
+  double high;
+  bool integer; // Range of whole numbers
+};
+
+//! One evolution run of a sweep.
+struct SweepJob {
+  int index;
+  int point; // Point of the design, shared by the repeats
+  int repeat;
+  std::vector<std::string> values; // One per parameter
+};
+
+//! Runs many evolutions with different settings and collects the results.
+/*!
+  A sweep file has the same "key = value" lines as a config file, for the
+  settings all jobs share. A setting with a list of values separated by
+  commas, or a range "low .. high", is a parameter of the sweep. These
+  lines control the design:
+
+    sweep_design = grid     # Every combination, or random
+    sweep_samples = 20      # Number of points of a random design
+    sweep_grid_steps = 3    # Values of a range in a grid design
+    sweep_repeats = 1       # Runs of every point
+    sweep_seed = 1          # Seed of a random design
+
+  Every job runs in its own process with its own config file, started
+  from the settings of this process, so jobs never share a SettingsManager
+  or a file. At most max_parallel jobs run at the same time and the thread
+  pool is split between them. The best fitness of every generation of
+  every job is collected in one CSV file.
+*/
+class SweepRunner {
+public:
+  SweepRunner();
+
+  bool Load(const std::string& path);
+  void Expand();
+  const std::vector<SweepParameter>& GetParameters() const;
+  const std::vector<SweepJob>& GetJobs() const;
+  bool WriteJobConfig(const SweepJob& job, const std::string& prefix);
+  bool Run(
+          const std::string& program,
+          const std::string& directory,
+          int max_parallel);
+
+  static bool RunJob(const std::string& config, const std::string& result);
+private:
+  std::string JobPrefix(const std::string& directory, const SweepJob& job) const;
+  bool WriteResults(const std::string& directory);
+
+  std::vector<std::pair<std::string, std::string> > fixed_; // Shared settings
+  std::vector<SweepParameter> parameters_;
+  std::vector<SweepJob> jobs_;
+
+  bool random_design_;
+  int samples_;
+  int grid_steps_;
+  int repeats_;
+  uint64_t seed_;
+};
+
+#endif // SWEEPRUNNER_H
@@ -0,0 +1,57 @@
+#ifndef TEXTURECODEC_H
+#define TEXTURECODEC_H
+
+// C++
+#include <vector>
+// External
+#include <GL/glew.h>
+
+//! One mipmap level of a TextureData.
+struct TextureLevel {
+  int width;
+  int height;
+  int offset; // In TextureData::data
+  int size; // In bytes
+};
+
+//! Decoded texture ready to be uploaded, with all mipmap levels.
+/*!
+  Uncompressed textures are tightly packed RGB rows, compressed ones are
+  S3TC blocks. The first row is the bottom of the image like OpenGL expects.
+*/
+struct TextureData {
+  GLenum internal_format; // GL_RGB8 or one of the S3TC formats
+  bool compressed;
+  std::vector<TextureLevel> levels; // Level 0 first
+  std::vector<unsigned char> data;
+  TextureData() {
+    internal_format = GL_RGB8;
+    compressed = false;
+  }
+};
+
+//! Reads image files and prepares them for the GPU without calling OpenGL.
+/*!
+  Meant to run on a loader thread, see TextureManager. Bitmaps are read as
+  RGB and get a mipmap chain by averaging 2x2 pixels, which can then be
+  compressed to DXT1. DXT1 splits the image in 4x4 blocks and stores two
+  RGB565 end points and a 2 bit index per pixel picking one of four colours
+  between them, eight bytes per block instead of 48. The end points are the
+  corners of the bounding box of the colours in the block. DDS files are
+  already compressed and are read with the levels they have. Bitmaps of
+  another size than the texture array of the TextureManager are resized
+  with bilinear filtering before the mipmaps are made.
+*/
+class TextureCodec {
+public:
+  static bool ReadBitmapFile(const char* file_path, TextureData* texture);
+  static bool ReadDDSFile(const char* file_path, TextureData* texture);
+  static void Resize(TextureData* texture, int width, int height);
+  static void GenerateMipmaps(TextureData* texture);
+  static void CompressDxt1(TextureData* texture);
+  static void CompressDxt1Block(const unsigned char* rgb, unsigned char* block);
+
+  static const int DXT1_BLOCK_SIZE = 8; // Bytes of one 4x4 block
+};
+
+#endif // TEXTURECODEC_H
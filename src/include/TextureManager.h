@@ -9,8 +9,15 @@
 #include <map>
 #include <stdio.h>
 #include <cstring>
+#include <deque>
+#include <thread>
 // External
 #include <GL/glew.h>
+#include <QMutex>
+#include <QWaitCondition>
+// Internal
+#include "GLObject.h"
+#include "TextureCodec.h"
 
 enum TextureType{
   STANDARD = 0, // Not procedural
@@ -27,13 +34,16 @@ enum TextureType{
   which can be set to make the appearance different when shading.
   The value of texture_diffuse_type tells whether the texture is of STANDARD=0
   type  which means it is read from an image file. Other types are
-  CHECKERBOARD=1 which is a procedural texture.
+  CHECKERBOARD=1 which is a procedural texture. The shaders read materials
+  from the table of the MaterialManager. A Material only keeps the name of
+  its texture, so Creatures can be built and simulated without an OpenGL
+  context. The layer is looked up when the Material is rendered.
 */
 
 class Material {
 public:
   Material();
-  GLuint GetDiffuseTextureID();
+  int GetDiffuseTextureLayer() const;
   void SetDiffuseTexture(const char* texturename);
   
   float reflectance;
@@ -41,7 +51,7 @@ public:
   float shinyness;
   int texture_diffuse_type;
 private:
-  GLuint texture_diffuse_id_;
+  std::string texture_diffuse_name_; // Empty if none
 };
 
 //! TextureManager is a singleton class which means it can be accessed from all around the application.
@@ -50,6 +60,16 @@ private:
   is created) in to graphics memory and then be reused for different
   objects in the scene. Currently there is only diffuse textures but this
   can be extended for use of normal-maps for example.
+
+  All textures are layers of one array texture of MAX_TEXTURES layers with
+  TEXTURE_SIZE pixels on each side, so it is bound once per frame and one
+  draw call can use all of them. The layer of a texture is given by
+  LoadTexture right away, the file is read by a loader thread which also
+  resizes it, creates the mipmaps and compresses it to DXT1 when the driver
+  supports it, see TextureCodec. UpdateStreaming then uploads at most
+  UPLOAD_BYTES_PER_FRAME per frame through a pixel buffer object. Until all
+  levels of a layer are uploaded, the MaterialManager tells the shaders to
+  use a grey placeholder instead.
 */
 
 class TextureManager {
@@ -58,22 +78,58 @@ public:
   static void Destroy(void);
 
   void LoadTexture(const char* filename, const char* texturename);
-  void FreeTexture(const char* texturename);
-  void FreeAll();
-  void BindTexture(const char* texturename);
-  void BindTexture(GLuint texture_id);
+  void BindTextureArray();
+
+  int GetLayerFromName(const char* texturename);
+  bool IsTextureLoaded(int layer);
+  int GetNumberOfLoadedTextures();
 
-  GLuint GetIDFromName(const char* texturename);
+  void UpdateStreaming();
+  void FinishStreaming();
 
+  static const int TEXTURE_SIZE = 512;
+  static const int MAX_TEXTURES = 16;
+  static const int UPLOAD_BYTES_PER_FRAME = 1 << 20;
 private:
   TextureManager();
   ~TextureManager();
 
-  GLuint LoadBitmapFile(const char* filename);
-  GLuint LoadDDSFile(const char* filename);
+  //! A texture file waiting for or being read by the loader thread.
+  struct TextureRequest {
+    std::string filename;
+    int layer;
+  };
+
+  //! A read texture waiting for or being uploaded by UpdateStreaming.
+  struct TextureUpload {
+    std::string filename;
+    int layer;
+    TextureData data;
+    int next_level; // Counts down to 0
+  };
 
-  std::map<std::string, GLuint> textures_;
+  void RunLoader();
+  bool ReadTexture(const std::string& filename, TextureData* data);
+  bool UploadLevel(TextureUpload* upload);
+
+  std::map<std::string, int> textures_; // Name to layer
+  std::vector<bool> loaded_; // If all levels of a layer are uploaded
+  int n_loaded_textures_;
   static TextureManager *instance_;
+
+  GLTexture texture_array_;
+  int n_levels_; // Mipmap levels of every layer
+  std::thread loader_;
+  bool compress_; // If the driver supports DXT1, read by the loader thread
+  GLBuffer pixel_buffer_; // Staging buffer of the uploads
+  std::deque<TextureUpload> uploads_; // Only used by the OpenGL thread
+
+  QMutex mutex_; // Guards the members below
+  QWaitCondition queue_changed_;
+  std::deque<TextureRequest> requests_;
+  std::deque<TextureUpload> read_textures_; // Waiting for UpdateStreaming
+  int n_loading_; // Requests taken by the loader thread and not yet loaded
+  bool closing_;
 };
 
 #endif // TEXTUREMANAGER_H
\ No newline at end of file
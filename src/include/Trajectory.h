@@ -0,0 +1,51 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+// C++
+#include <vector>
+// External
+#include <LinearMath/btTransform.h>
+
+//! Recorded transforms of all rigid bodies of a creature.
+/*!
+  A Trajectory is recorded while a creature is evaluated and can be played
+  back without simulating the physics again, so the replay is exactly what
+  was evaluated. Frames are recorded at a fixed frame time. Every body is
+  stored compactly as a position relative to its first frame, quantized to
+  POSITION_SCALE meters, and a quaternion with every component quantized to
+  a short.
+*/
+class Trajectory {
+public:
+  Trajectory();
+  Trajectory(int n_bodies, float frame_time);
+
+  void Reserve(int n_frames);
+  void AddFrame(const btTransform* transforms);
+  btTransform GetTransform(int frame, int body) const;
+  btTransform Sample(float time, int body) const;
+
+  int GetNumberOfFrames() const;
+  int GetNumberOfBodies() const;
+  float GetFrameTime() const;
+  float GetDuration() const;
+  btVector3 GetLightPosition() const;
+  void SetLightPosition(const btVector3& position);
+
+  static const float POSITION_SCALE;
+private:
+  //! One quantized body transform.
+  struct BodySample {
+    short position[3];
+    short rotation[4];
+  };
+
+  int n_bodies_;
+  int n_frames_;
+  float frame_time_;
+  std::vector<float> origins_; // First position of every body, xyz
+  std::vector<BodySample> samples_; // Frame by frame, body by body
+  float light_position_[3];
+};
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,131 @@
+#ifndef TRAJECTORYFILE_H
+#define TRAJECTORYFILE_H
+
+// C++
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+// External
+#include <QMutex>
+#include <QWaitCondition>
+
+//! Consecutive recorded frames of one creature.
+/*!
+  Every frame has the position xyz and rotation quaternion xyzw of every
+  body followed by the angle of every joint, FrameSize floats in total.
+  Chunks read from a file have quaternions with positive w.
+*/
+struct TrajectoryChunk {
+  int creature; // Unique in the file, from TrajectoryWriter::ReserveCreatures
+  int generation;
+  int first_frame;
+  int n_frames;
+  int n_bodies;
+  int n_joints;
+  float frame_time;
+  std::vector<float> values;
+
+  TrajectoryChunk() {
+    creature = 0;
+    generation = 0;
+    first_frame = 0;
+    n_frames = 0;
+    n_bodies = 0;
+    n_joints = 0;
+    frame_time = 0.0f;
+  }
+
+  int FrameSize() const {
+    return 7 * n_bodies + n_joints;
+  }
+};
+
+//! Where a chunk is in the file.
+struct TrajectoryIndexEntry {
+  int creature;
+  int generation;
+  int first_frame;
+  int n_frames;
+  long long offset;
+};
+
+//! Writes recorded trajectories to an append only file.
+/*!
+  Chunks are handed over with Submit and encoded and written by a
+  background thread, so simulations never wait for the disk. The values of
+  a chunk are quantized, delta encoded frame to frame as variable length
+  integers and compressed with LzCodec. The memory of chunks waiting to be
+  written is bounded by MAX_QUEUED_BYTES, chunks submitted when the queue
+  is full are dropped and counted. Close appends an index of all chunks so
+  a TrajectoryReader can seek to a creature or time window directly.
+*/
+class TrajectoryWriter {
+public:
+  TrajectoryWriter();
+  ~TrajectoryWriter();
+
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const;
+
+  int ReserveCreatures(int n);
+  bool Submit(TrajectoryChunk* chunk);
+  int GetDroppedChunks() const;
+
+  static const int CHUNK_FRAMES = 64;
+  static const int MAX_QUEUED_BYTES = 64 << 20;
+private:
+  TrajectoryWriter(const TrajectoryWriter&);
+  TrajectoryWriter& operator=(const TrajectoryWriter&);
+
+  void Run();
+  void WriteChunk(const TrajectoryChunk& chunk);
+
+  std::ofstream out_;
+  std::thread thread_;
+  QMutex mutex_;
+  QWaitCondition queue_changed_;
+  std::deque<TrajectoryChunk> queue_;
+  long long queued_bytes_;
+  bool closing_;
+  bool open_;
+  std::atomic<int> next_creature_;
+  std::atomic<int> dropped_chunks_;
+
+  // Only used by the I/O thread
+  std::vector<TrajectoryIndexEntry> index_;
+  std::vector<char> encoded_;
+  std::vector<char> compressed_;
+};
+
+//! Reads files written by TrajectoryWriter.
+/*!
+  Only the index is read when opening. Reading a creature or a time window
+  decodes only the chunks that overlap it. Files that were not closed have
+  no index, it is then rebuilt by skipping from chunk header to chunk
+  header.
+*/
+class TrajectoryReader {
+public:
+  TrajectoryReader();
+
+  bool Open(const std::string& path);
+  const std::vector<TrajectoryIndexEntry>& GetIndex() const;
+  int GetNumberOfCreatures() const;
+  bool Read(int creature, int begin_frame, int end_frame, TrajectoryChunk* out);
+  bool ReadChunk(const TrajectoryIndexEntry& entry, TrajectoryChunk* chunk);
+private:
+  bool ReadIndex();
+  bool RebuildIndex();
+
+  std::ifstream in_;
+  std::vector<TrajectoryIndexEntry> index_;
+  std::vector<std::vector<int> > creature_chunks_; // Index entries per creature
+  std::vector<char> encoded_;
+  std::vector<char> compressed_;
+};
+
+#endif // TRAJECTORYFILE_H
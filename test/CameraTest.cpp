@@ -0,0 +1,67 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+#include "Camera.h"
+
+/* *
+* Test class for the Frustum of a Camera
+*/
+class CameraTest : public ::testing::Test {
+protected:
+	CameraTest() {
+		// Looking from (0,0,10) down the negative z-axis
+		glm::mat4 view = glm::lookAt(
+			glm::vec3(0.0f, 0.0f, 10.0f),
+			glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(
+			static_cast<float>(M_PI) / 2.0f, 1.0f, 0.1f, 100.0f);
+		camera = Camera(view, projection);
+	}
+
+	virtual ~CameraTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	Camera camera;
+};
+
+TEST_F(CameraTest, FrustumTest) {
+	Frustum frustum = camera.GetFrustum();
+	glm::vec3 half(0.5f);
+	// In front of the camera, partly inside and behind it
+	EXPECT_TRUE(frustum.IntersectsBox(-half, half));
+	EXPECT_TRUE(frustum.IntersectsBox(
+		glm::vec3(9.0f, -0.5f, -0.5f), glm::vec3(11.0f, 0.5f, 0.5f)));
+	EXPECT_FALSE(frustum.IntersectsBox(
+		glm::vec3(-0.5f, -0.5f, 11.0f), glm::vec3(0.5f, 0.5f, 12.0f)));
+	// Far to the side, above and beyond the far clipping plane
+	EXPECT_FALSE(frustum.IntersectsBox(
+		glm::vec3(20.0f, -0.5f, -0.5f), glm::vec3(21.0f, 0.5f, 0.5f)));
+	EXPECT_FALSE(frustum.IntersectsBox(
+		glm::vec3(-0.5f, 30.0f, -0.5f), glm::vec3(0.5f, 31.0f, 0.5f)));
+	EXPECT_FALSE(frustum.IntersectsBox(
+		glm::vec3(-0.5f, -0.5f, -200.0f), glm::vec3(0.5f, 0.5f, -95.0f)));
+	// A huge box like the one of the ground plane
+	EXPECT_TRUE(frustum.IntersectsBox(glm::vec3(-1e18f), glm::vec3(1e18f)));
+
+	// The default Frustum contains everything
+	EXPECT_TRUE(Frustum().IntersectsBox(
+		glm::vec3(1000.0f), glm::vec3(1001.0f)));
+}
+
+TEST_F(CameraTest, PixelSizeTest) {
+	SettingsManager::Instance()->SetFrameHeight(600);
+	// A 90 degree field of view is 600 pixels high 10 units away
+	EXPECT_NEAR(300.0f, camera.GetPixelSize(glm::vec3(0.0f), 10.0f), 0.01f);
+	EXPECT_NEAR(30.0f, camera.GetPixelSize(glm::vec3(0.0f), 1.0f), 0.01f);
+	EXPECT_NEAR(15.0f, camera.GetPixelSize(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f), 0.01f);
+}
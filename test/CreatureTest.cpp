@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 
 #include "gtest/gtest.h"
 #include "Creature.h"
@@ -31,4 +32,27 @@ TEST_F(CreatureTest, NothingTest) {
 	std::cout << "Testing Nothing!";
 	int val = 0;
 	EXPECT_EQ(0,val);
-}
\ No newline at end of file
+}
+TEST_F(CreatureTest, WriteReadTest) {
+	c.SetFitness(0.5f);
+	c.simdata.max_y = 2.0f;
+	std::stringstream stream;
+	c.Write(stream);
+
+	Creature read;
+	EXPECT_TRUE(read.Read(stream));
+	EXPECT_EQ(0.5f, read.GetFitness());
+	EXPECT_EQ(2.0f, read.simdata.max_y);
+	EXPECT_EQ(c.GetBrain().GetGenomeSize(), read.GetBrain().GetGenomeSize());
+	EXPECT_FALSE(read.Read(stream));
+}
+TEST_F(CreatureTest, BrainInputSizeTest) {
+	// The inputs of Simulation::Step: a bias, the light direction and the
+	// joint angles. The Brain must not be re-initialized by them.
+	int n_joints = c.GetBody().GetTotalNumberOfJoints();
+	std::vector<float> input(1 + 3 + n_joints, 0.5f);
+	std::vector<float> genome = c.GetBrain().GetGenome();
+	std::vector<float> output = c.CalculateBrainOutput(input);
+	EXPECT_EQ(n_joints, output.size());
+	EXPECT_EQ(genome, c.GetBrain().GetGenome());
+}
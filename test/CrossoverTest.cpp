@@ -0,0 +1,112 @@
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "Crossover.h"
+
+/* *
+* Test class for the crossover operators
+*/
+class CrossoverTest : public ::testing::Test {
+protected:
+	CrossoverTest() : rng(1234) {
+
+	}
+
+	virtual ~CrossoverTest() {
+
+	}
+
+	virtual void SetUp() {
+		mom.resize(GENOME_SIZE);
+		dad.resize(GENOME_SIZE);
+		child0.resize(GENOME_SIZE);
+		child1.resize(GENOME_SIZE);
+		for (int i = 0; i < GENOME_SIZE; ++i){
+			mom[i] = i;
+			dad[i] = -i;
+		}
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	static const int GENOME_SIZE = 1000;
+	BatchRNG rng;
+	std::vector<float> mom;
+	std::vector<float> dad;
+	std::vector<float> child0;
+	std::vector<float> child1;
+};
+
+TEST_F(CrossoverTest, UniformTest) {
+	Crossover::Uniform(&mom[0], &dad[0], &child0[0], &child1[0],
+		GENOME_SIZE, rng);
+
+	int from_mom = 0;
+	for (int i = 1; i < GENOME_SIZE; ++i){
+		// Every gene comes from one parent and the other child gets the other
+		EXPECT_EQ(-child0[i], child1[i]);
+		EXPECT_EQ(i, std::abs(child0[i]));
+		if (child0[i] > 0)
+			from_mom++;
+	}
+	EXPECT_GT(from_mom, GENOME_SIZE / 3);
+	EXPECT_LT(from_mom, 2 * GENOME_SIZE / 3);
+}
+
+TEST_F(CrossoverTest, NPointTest) {
+	Crossover::NPoint(&mom[0], &dad[0], &child0[0], &child1[0],
+		GENOME_SIZE, 2, rng);
+
+	// With two cut points the parent changes at most twice along the genome
+	int changes = 0;
+	for (int i = 2; i < GENOME_SIZE; ++i){
+		EXPECT_EQ(-child0[i], child1[i]);
+		if ((child0[i] > 0) != (child0[i - 1] > 0))
+			changes++;
+	}
+	EXPECT_LE(changes, 2);
+	EXPECT_GT(child0[1], 0);
+}
+
+TEST_F(CrossoverTest, ArithmeticTest) {
+	Crossover::Arithmetic(&mom[0], &dad[0], &child0[0], &child1[0],
+		GENOME_SIZE, rng);
+
+	for (int i = 0; i < GENOME_SIZE; ++i){
+		EXPECT_NEAR(mom[i] + dad[i], child0[i] + child1[i], 1e-3f);
+		EXPECT_LE(std::abs(child0[i]), i + 1e-3f);
+	}
+}
+
+TEST_F(CrossoverTest, BlendAlphaTest) {
+	float alpha = 0.5f;
+	Crossover::BlendAlpha(&mom[0], &dad[0], &child0[0], &child1[0],
+		GENOME_SIZE, alpha, rng);
+
+	for (int i = 0; i < GENOME_SIZE; ++i){
+		// The interval is [-i, i] extended by alpha * 2i on both sides
+		EXPECT_LE(std::abs(child0[i]), 2.0f * i + 1e-3f);
+		EXPECT_LE(std::abs(child1[i]), 2.0f * i + 1e-3f);
+	}
+}
+
+TEST_F(CrossoverTest, PerNeuronTest) {
+	std::vector<int> neuron_offsets;
+	for (int i = 0; i <= GENOME_SIZE; i += 10)
+		neuron_offsets.push_back(i);
+
+	Crossover::PerNeuron(&mom[0], &dad[0], &child0[0], &child1[0],
+		neuron_offsets, rng);
+
+	// All weights of a neuron come from the same parent
+	for (int n = 0; n < GENOME_SIZE / 10; ++n){
+		bool from_mom = child0[n * 10 + 1] > 0;
+		for (int i = n * 10 + 1; i < (n + 1) * 10; ++i){
+			EXPECT_EQ(from_mom, child0[i] > 0);
+			EXPECT_EQ(-child0[i], child1[i]);
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "EvolutionStrategy.h"
+
+/* *
+* Test class for the evolution strategy
+*/
+class EvolutionStrategyTest : public ::testing::Test {
+protected:
+	EvolutionStrategyTest() {
+
+	}
+
+	virtual ~EvolutionStrategyTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	//! Negative squared distance to a genome of ones
+	float Fitness(const float* genome) {
+		float sum = 0.0f;
+		for (int i = 0; i < GENOME_SIZE; ++i)
+			sum += (genome[i] - 1.0f) * (genome[i] - 1.0f);
+		return -sum;
+	}
+
+	static const int GENOME_SIZE = 100;
+	EvolutionStrategy es;
+};
+
+TEST_F(EvolutionStrategyTest, CenteredRanksTest) {
+	float values[] = {3.0f, -10.0f, 7.0f};
+	std::vector<float> ranks;
+	EvolutionStrategy::CenteredRanks(
+		std::vector<float>(values, values + 3), &ranks);
+	EXPECT_FLOAT_EQ(0.0f, ranks[0]);
+	EXPECT_FLOAT_EQ(-0.5f, ranks[1]);
+	EXPECT_FLOAT_EQ(0.5f, ranks[2]);
+}
+
+TEST_F(EvolutionStrategyTest, AntitheticTest) {
+	es.Reset(std::vector<float>(GENOME_SIZE, 0.0f), 0.1f, 0.01f);
+	std::vector<int> offsets;
+	es.Sample(1, &offsets);
+	std::vector<float> positive(GENOME_SIZE);
+	std::vector<float> negative(GENOME_SIZE);
+	es.Perturbed(offsets[0], false, &positive[0]);
+	es.Perturbed(offsets[0], true, &negative[0]);
+	for (int i = 0; i < GENOME_SIZE; ++i)
+		EXPECT_FLOAT_EQ(-positive[i], negative[i]);
+}
+
+TEST_F(EvolutionStrategyTest, SphereTest) {
+	const int n_pairs = 50;
+	es.Reset(std::vector<float>(GENOME_SIZE, 0.0f), 0.05f, 0.02f);
+	float start = Fitness(&es.GetTheta()[0]);
+
+	std::vector<int> offsets;
+	std::vector<float> fitness(2 * n_pairs);
+	std::vector<float> genome(GENOME_SIZE);
+	for (int iteration = 0; iteration < 200; ++iteration) {
+		es.Sample(n_pairs, &offsets);
+		for (int p = 0; p < n_pairs; ++p) {
+			es.Perturbed(offsets[p], false, &genome[0]);
+			fitness[2 * p] = Fitness(&genome[0]);
+			es.Perturbed(offsets[p], true, &genome[0]);
+			fitness[2 * p + 1] = Fitness(&genome[0]);
+		}
+		es.Update(offsets, fitness);
+	}
+	float end = Fitness(&es.GetTheta()[0]);
+	std::cout << "Fitness from " << start << " to " << end << std::endl;
+	EXPECT_GT(end, 0.01f * start);
+}
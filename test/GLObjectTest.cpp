@@ -0,0 +1,94 @@
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "GLObject.h"
+
+// Hands out names like glGen* and counts the live ones, no context needed
+struct CountingTraits {
+	static GLuint Create() {
+		n_alive++;
+		return ++last_name;
+	}
+	static void Delete(GLuint id) {
+		n_alive--;
+		n_deleted++;
+	}
+	static GLuint last_name;
+	static int n_alive;
+	static int n_deleted;
+};
+
+GLuint CountingTraits::last_name = 0;
+int CountingTraits::n_alive = 0;
+int CountingTraits::n_deleted = 0;
+
+typedef GLObject<CountingTraits> CountingObject;
+
+/* *
+* Test class for the ownership of OpenGL objects
+*/
+class GLObjectTest : public ::testing::Test {
+protected:
+	GLObjectTest() {
+
+	}
+
+	virtual ~GLObjectTest() {
+
+	}
+
+	virtual void SetUp() {
+		CountingTraits::n_alive = 0;
+		CountingTraits::n_deleted = 0;
+	}
+
+	virtual void TearDown() {
+
+	}
+};
+
+TEST_F(GLObjectTest, OwnershipTest) {
+	{
+		CountingObject empty;
+		EXPECT_EQ(0, empty.Get());
+		CountingObject object = CountingObject::Create();
+		GLuint name = object.Get();
+		EXPECT_NE(0, name);
+		EXPECT_EQ(1, CountingTraits::n_alive);
+
+		// Moving hands over the name without deleting it
+		CountingObject moved(std::move(object));
+		EXPECT_EQ(0, object.Get());
+		EXPECT_EQ(name, moved.Get());
+		empty = std::move(moved);
+		EXPECT_EQ(name, empty.Get());
+		EXPECT_EQ(1, CountingTraits::n_alive);
+
+		// Assigning over an object deletes the old one
+		empty = CountingObject::Create();
+		EXPECT_EQ(1, CountingTraits::n_alive);
+		EXPECT_EQ(1, CountingTraits::n_deleted);
+
+		CountingObject released = CountingObject::Create();
+		GLuint released_name = released.Release();
+		EXPECT_NE(0, released_name);
+		EXPECT_EQ(0, released.Get());
+		CountingTraits::Delete(released_name);
+	}
+	EXPECT_EQ(0, CountingTraits::n_alive);
+}
+
+TEST_F(GLObjectTest, ReplaceSoakTest) {
+	// Every hot reload links a new program and moves it over the current
+	// one, like ShaderProgram::Link. The old name is deleted every time.
+	const int n_reloads = 10000;
+	CountingObject program;
+	for (int reload = 0; reload < n_reloads; ++reload) {
+		CountingObject linked = CountingObject::Create();
+		program = std::move(linked);
+		EXPECT_EQ(1, CountingTraits::n_alive);
+	}
+	EXPECT_EQ(n_reloads - 1, CountingTraits::n_deleted);
+	program.Reset();
+	EXPECT_EQ(0, CountingTraits::n_alive);
+}
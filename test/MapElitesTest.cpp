@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "MapElites.h"
+#include "SettingsManager.h"
+
+/* *
+* Test class for the MAP-Elites grid
+*/
+class MapElitesTest : public ::testing::Test {
+protected:
+	MapElitesTest() {
+
+	}
+
+	virtual ~MapElitesTest() {
+
+	}
+
+	virtual void SetUp() {
+		grid.Reset(BINS);
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	// Writes a checkpoint with the given header and elites in the cells
+	void WriteCheckpoint(
+			const char* path,
+			int bins,
+			int count,
+			const std::vector<int>& cells) {
+		std::ofstream out(path, std::ios::binary);
+		int header[4] = {2, SettingsManager::Instance()->GetCreatureType(), bins, count};
+		float light[3] = {0.0f, 5.0f, 0.0f};
+		out.write("CEME", 4);
+		out.write(reinterpret_cast<const char*>(header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(light), sizeof(light));
+		for (int i = 0; i < cells.size(); ++i) {
+			out.write(reinterpret_cast<const char*>(&cells[i]), sizeof(int));
+			Creature().Write(out);
+		}
+	}
+
+	static const int BINS = 10;
+	MapElites grid;
+};
+
+TEST_F(MapElitesTest, CellIndexTest) {
+	int n_cells = BINS * BINS * BINS;
+	EXPECT_EQ(n_cells, grid.GetNumberOfCells());
+	EXPECT_EQ(0, grid.GetFilledCells());
+
+	SimData data;
+	int coords[MapElites::N_FEATURES];
+	EXPECT_EQ(0, MapElites::CellIndex(data, BINS, coords));
+
+	// Features outside of the range end up in the border cells
+	data.max_y = 100.0f;
+	data.deviation_x = -1.0f;
+	data.energy_waste = 1e30f;
+	int cell = MapElites::CellIndex(data, BINS, coords);
+	EXPECT_EQ(BINS - 1, coords[0]);
+	EXPECT_EQ(0, coords[1]);
+	EXPECT_EQ(BINS - 1, coords[2]);
+	EXPECT_EQ(coords[0] + BINS * (coords[1] + BINS * coords[2]), cell);
+}
+
+TEST_F(MapElitesTest, CheckpointTest) {
+	const char* path = "map_elites_test.chk";
+	EXPECT_TRUE(grid.Save(path));
+
+	MapElites loaded;
+	loaded.Reset(1);
+	EXPECT_TRUE(loaded.Load(path));
+	EXPECT_EQ(BINS * BINS * BINS, loaded.GetNumberOfCells());
+	EXPECT_EQ(0, loaded.GetFilledCells());
+	std::remove(path);
+
+	EXPECT_FALSE(loaded.Load("no_such_checkpoint.chk"));
+}
+
+TEST_F(MapElitesTest, PopulatedCheckpointTest) {
+	const char* path = "map_elites_test.chk";
+	SettingsManager::Instance()->SetSimulationTime(1);
+	Population creatures(8);
+	grid.Seed(creatures, *SettingsManager::Instance()->GetSnapshot());
+	ASSERT_GT(grid.GetFilledCells(), 0);
+	ASSERT_TRUE(grid.Save(path));
+
+	MapElites loaded;
+	loaded.Reset(1);
+	ASSERT_TRUE(loaded.Load(path));
+	EXPECT_EQ(grid.GetNumberOfCells(), loaded.GetNumberOfCells());
+	EXPECT_EQ(grid.GetFilledCells(), loaded.GetFilledCells());
+
+	// The same elites come back in the same cells
+	Population elites = grid.GetElites();
+	Population loaded_elites = loaded.GetElites();
+	ASSERT_EQ(elites.size(), loaded_elites.size());
+	for (int i = 0; i < elites.size(); ++i) {
+		EXPECT_EQ(
+			MapElites::CellIndex(elites[i].simdata, BINS, NULL),
+			MapElites::CellIndex(loaded_elites[i].simdata, BINS, NULL));
+		EXPECT_FLOAT_EQ(elites[i].GetFitness(), loaded_elites[i].GetFitness());
+		float features[MapElites::N_FEATURES];
+		float loaded_features[MapElites::N_FEATURES];
+		MapElites::Features(elites[i].simdata, features);
+		MapElites::Features(loaded_elites[i].simdata, loaded_features);
+		for (int k = 0; k < MapElites::N_FEATURES; ++k)
+			EXPECT_FLOAT_EQ(features[k], loaded_features[k]);
+	}
+	std::remove(path);
+}
+
+TEST_F(MapElitesTest, CorruptCheckpointTest) {
+	const char* path = "map_elites_test.chk";
+	MapElites loaded;
+	loaded.Reset(1);
+
+	std::vector<int> cells;
+	cells.push_back(3);
+	cells.push_back(7);
+	WriteCheckpoint(path, 2, 2, cells);
+	EXPECT_TRUE(loaded.Load(path));
+	EXPECT_EQ(2, loaded.GetFilledCells());
+
+	// Grids too large, counts out of range and repeated cells are rejected
+	WriteCheckpoint(path, MapElites::MAX_BINS + 1, 0, std::vector<int>());
+	EXPECT_FALSE(loaded.Load(path));
+	WriteCheckpoint(path, 2, -1, std::vector<int>());
+	EXPECT_FALSE(loaded.Load(path));
+	WriteCheckpoint(path, 2, 9, cells);
+	EXPECT_FALSE(loaded.Load(path));
+	cells.push_back(8);
+	WriteCheckpoint(path, 2, 3, cells);
+	EXPECT_FALSE(loaded.Load(path));
+	cells.back() = 3;
+	WriteCheckpoint(path, 2, 3, cells);
+	EXPECT_FALSE(loaded.Load(path));
+
+	// The grid is unchanged by the rejected files
+	EXPECT_EQ(8, loaded.GetNumberOfCells());
+	EXPECT_EQ(2, loaded.GetFilledCells());
+	std::remove(path);
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "MultiObjective.h"
+#include "BatchRNG.h"
+
+/* *
+* Test class for the NSGA-II ranking
+*/
+class MultiObjectiveTest : public ::testing::Test {
+protected:
+	MultiObjectiveTest() : rng(2468) {
+
+	}
+
+	virtual ~MultiObjectiveTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	//! Brute force front assignment, peeling off non-dominated sets.
+	std::vector<int> BruteForceFronts(
+			const std::vector<float>& objectives, int m) {
+		int n = objectives.size() / m;
+		std::vector<int> front(n, -1);
+		int assigned = 0;
+		for (int f = 0; assigned < n; ++f) {
+			std::vector<int> current;
+			for (int i = 0; i < n; ++i) {
+				if (front[i] != -1)
+					continue;
+				bool dominated = false;
+				for (int j = 0; j < n && !dominated; ++j) {
+					dominated = (front[j] == -1 || front[j] == f) && j != i &&
+						MultiObjective::Dominates(&objectives[j * m],
+							&objectives[i * m], m);
+				}
+				if (!dominated)
+					current.push_back(i);
+			}
+			for (int i = 0; i < current.size(); ++i)
+				front[current[i]] = f;
+			assigned += current.size();
+		}
+		return front;
+	}
+
+	BatchRNG rng;
+};
+
+TEST_F(MultiObjectiveTest, SmallFrontsTest) {
+	// Two objectives, both maximized
+	float values[] = {
+		1.0f, 5.0f,
+		5.0f, 1.0f,
+		3.0f, 3.0f,
+		2.0f, 2.0f,
+		1.0f, 1.0f,
+		3.0f, 3.0f};
+	std::vector<float> objectives(values, values + 12);
+	std::vector<int> front;
+	MultiObjective::NonDominatedSort(objectives, 2, &front);
+	EXPECT_EQ(0, front[0]);
+	EXPECT_EQ(0, front[1]);
+	EXPECT_EQ(0, front[2]);
+	EXPECT_EQ(1, front[3]);
+	EXPECT_EQ(2, front[4]);
+	EXPECT_EQ(0, front[5]);
+
+	std::vector<float> crowding;
+	MultiObjective::CrowdingDistance(objectives, 2, front, &crowding);
+	const float infinity = std::numeric_limits<float>::infinity();
+	EXPECT_EQ(infinity, crowding[0]);
+	EXPECT_EQ(infinity, crowding[1]);
+	EXPECT_LT(crowding[2], infinity);
+
+	std::vector<float> fitness;
+	MultiObjective::ScalarFitness(front, crowding, &fitness);
+	EXPECT_GT(fitness[0], fitness[2]);
+	EXPECT_GT(fitness[2], fitness[3]);
+	EXPECT_GT(fitness[3], fitness[4]);
+}
+
+TEST_F(MultiObjectiveTest, BruteForceTest) {
+	const int m = 3;
+	const int n = 500;
+	std::vector<float> objectives(n * m);
+	rng.FillUniform(&objectives[0], n * m);
+	// Quantize to get ties and duplicates
+	for (int i = 0; i < n * m; ++i)
+		objectives[i] = static_cast<int>(objectives[i] * 10.0f);
+
+	std::vector<int> front;
+	MultiObjective::NonDominatedSort(objectives, m, &front);
+	std::vector<int> expected = BruteForceFronts(objectives, m);
+	for (int i = 0; i < n; ++i)
+		EXPECT_EQ(expected[i], front[i]);
+}
+
+TEST_F(MultiObjectiveTest, LargePopulationTest) {
+	const int m = 3;
+	const int n = 100000;
+	std::vector<float> objectives(n * m);
+	rng.FillUniform(&objectives[0], n * m);
+
+	std::chrono::high_resolution_clock::time_point start =
+		std::chrono::high_resolution_clock::now();
+	std::vector<int> front;
+	std::vector<float> crowding;
+	MultiObjective::NonDominatedSort(objectives, m, &front);
+	MultiObjective::CrowdingDistance(objectives, m, front, &crowding);
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::high_resolution_clock::now() - start;
+	std::cout << "NSGA-II ranking of " << n << " creatures with " << m <<
+		" objectives: " << elapsed.count() << " ms" << std::endl;
+
+	// Nothing on the Pareto front may be dominated by anything
+	for (int i = 0; i < n; ++i) {
+		if (front[i] != 0)
+			continue;
+		for (int j = 0; j < n; ++j)
+			EXPECT_FALSE(MultiObjective::Dominates(&objectives[j * m],
+				&objectives[i * m], m));
+	}
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "Mutation.h"
+
+/* *
+* Test class for the mutation operators
+*/
+class MutationTest : public ::testing::Test {
+protected:
+	MutationTest() : rng(4321) {
+
+	}
+
+	virtual ~MutationTest() {
+
+	}
+
+	virtual void SetUp() {
+		genome = std::vector<float>(GENOME_SIZE, 0.0f);
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	int CountMutated() {
+		int mutated = 0;
+		for (int i = 0; i < GENOME_SIZE; ++i){
+			if (genome[i] != 0.0f)
+				mutated++;
+		}
+		return mutated;
+	}
+
+	static const int GENOME_SIZE = 100000;
+	BatchRNG rng;
+	std::vector<float> genome;
+};
+
+TEST_F(MutationTest, GeometricSkippingRateTest) {
+	Mutation::Uniform(&genome[0], GENOME_SIZE, 0.2f, 0.1f, rng);
+
+	// Expected 20000 mutated genes, standard deviation ~126
+	int mutated = CountMutated();
+	EXPECT_GT(mutated, 19000);
+	EXPECT_LT(mutated, 21000);
+	for (int i = 0; i < GENOME_SIZE; ++i){
+		EXPECT_LE(std::abs(genome[i]), 0.1f);
+	}
+}
+
+TEST_F(MutationTest, ExtremeRatesTest) {
+	Mutation::Uniform(&genome[0], GENOME_SIZE, 0.0f, 0.1f, rng);
+	EXPECT_EQ(0, CountMutated());
+
+	Mutation::Gaussian(&genome[0], GENOME_SIZE, 1.0f, 0.1f, rng);
+	int all_genes = GENOME_SIZE;
+	EXPECT_EQ(all_genes, CountMutated());
+}
+
+TEST_F(MutationTest, GaussianTest) {
+	std::vector<float> z(GENOME_SIZE);
+	Mutation::FillGaussian(&z[0], GENOME_SIZE, rng);
+
+	double mean = 0.0;
+	double variance = 0.0;
+	for (int i = 0; i < GENOME_SIZE; ++i)
+		mean += z[i];
+	mean /= GENOME_SIZE;
+	for (int i = 0; i < GENOME_SIZE; ++i)
+		variance += (z[i] - mean) * (z[i] - mean);
+	variance /= GENOME_SIZE;
+
+	EXPECT_NEAR(0.0, mean, 0.02);
+	EXPECT_NEAR(1.0, variance, 0.03);
+}
+
+TEST_F(MutationTest, SelfAdaptiveTest) {
+	float sigma = 0.1f;
+	Mutation::SelfAdaptive(&genome[0], GENOME_SIZE, 0.2f, &sigma, rng);
+
+	EXPECT_NE(0.1f, sigma);
+	EXPECT_GE(sigma, Mutation::MIN_SIGMA);
+	EXPECT_LE(sigma, Mutation::MAX_SIGMA);
+	EXPECT_GT(CountMutated(), 19000);
+}
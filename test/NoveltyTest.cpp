@@ -0,0 +1,132 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "KDTree.h"
+#include "NoveltyArchive.h"
+#include "BatchRNG.h"
+
+/* *
+* Test class for the KD-tree and the novelty archive
+*/
+class NoveltyTest : public ::testing::Test {
+protected:
+	NoveltyTest() : rng(1357) {
+
+	}
+
+	virtual ~NoveltyTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	//! Behaviors like the ones of walking creatures. A position on the
+	// ground plane and a height profile that depends on a gait parameter.
+	void FillBehaviors(std::vector<float>* behaviors, int n) {
+		behaviors->resize(n * DIMENSION);
+		float u[4];
+		for (int i = 0; i < n; ++i) {
+			rng.FillUniform(u, 4);
+			float* b = &(*behaviors)[i * DIMENSION];
+			b[0] = 40.0f * u[0] - 20.0f;
+			b[1] = 0.5f * u[1];
+			b[2] = 40.0f * u[2] - 20.0f;
+			for (int j = 3; j < DIMENSION; ++j)
+				b[j] = 0.5f * u[1] + 0.2f * u[3] * ((j % 2) ? 1.0f : -1.0f);
+		}
+	}
+
+	static const int DIMENSION = 11;
+	BatchRNG rng;
+};
+
+TEST_F(NoveltyTest, BruteForceTest) {
+	const int n = 5000;
+	const int k = 10;
+	std::vector<float> points;
+	FillBehaviors(&points, n);
+	// Duplicates must not break the splitting
+	for (int i = 0; i < 100; ++i)
+		points.insert(points.end(), points.begin(), points.begin() + DIMENSION);
+
+	KDTree tree(DIMENSION);
+	for (int i = 0; i < points.size(); i += DIMENSION)
+		tree.Insert(&points[i]);
+	int size = points.size() / DIMENSION;
+	EXPECT_EQ(size, tree.Size());
+
+	std::vector<float> queries;
+	FillBehaviors(&queries, 100);
+	for (int q = 0; q < 100; ++q) {
+		const float* query = &queries[q * DIMENSION];
+		std::vector<float> expected(size);
+		for (int i = 0; i < size; ++i) {
+			float d2 = 0.0f;
+			for (int d = 0; d < DIMENSION; ++d) {
+				float diff = points[i * DIMENSION + d] - query[d];
+				d2 += diff * diff;
+			}
+			expected[i] = d2;
+		}
+		std::sort(expected.begin(), expected.end());
+
+		float distances2[k];
+		int indices[k];
+		EXPECT_EQ(k, tree.Nearest(query, k, distances2, indices));
+		for (int j = 0; j < k; ++j)
+			EXPECT_FLOAT_EQ(expected[j], distances2[j]);
+	}
+}
+
+TEST_F(NoveltyTest, NoveltyTest) {
+	NoveltyArchive archive(1);
+	float archived[] = {10.0f, 11.0f};
+	archive.Add(&archived[0]);
+	archive.Add(&archived[1]);
+	float population[] = {0.0f, 1.0f, 3.0f, 10.5f};
+	archive.SetPopulation(std::vector<float>(population, population + 4));
+
+	// Neighbours of 0 are 1 and 3, the creature itself does not count
+	EXPECT_FLOAT_EQ(2.0f, archive.Novelty(0, 2));
+	// Neighbours of 10.5 are 10 and 11 in the archive
+	EXPECT_FLOAT_EQ(0.5f, archive.Novelty(3, 2));
+}
+
+TEST_F(NoveltyTest, LargeArchiveTest) {
+	const int n = 1000000;
+	const int n_queries = 10000;
+	const int k = 15;
+	std::vector<float> behaviors;
+	FillBehaviors(&behaviors, n + n_queries);
+
+	NoveltyArchive archive(DIMENSION);
+	std::chrono::high_resolution_clock::time_point start =
+		std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < n; ++i)
+		archive.Add(&behaviors[i * DIMENSION]);
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Inserting " << n << " behaviors: " << elapsed.count() <<
+		" ms" << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	archive.SetPopulation(std::vector<float>(
+		behaviors.begin() + n * DIMENSION, behaviors.end()));
+	float sum = 0.0f;
+	for (int i = 0; i < n_queries; ++i)
+		sum += archive.Novelty(i, k);
+	elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Novelty of " << n_queries << " creatures: " <<
+		elapsed.count() << " ms" << std::endl;
+	EXPECT_EQ(n, archive.Size());
+	EXPECT_GT(sum, 0.0f);
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "Selection.h"
+
+/* *
+* Test class for the selection operators
+*/
+class SelectionTest : public ::testing::Test {
+protected:
+	SelectionTest() : rng(1234) {
+
+	}
+
+	virtual ~SelectionTest() {
+
+	}
+
+	virtual void SetUp() {
+		// Fitness equal to the index, the best creature is the last one
+		fitness = std::vector<float>(POPULATION_SIZE);
+		for (int i = 0; i < POPULATION_SIZE; ++i)
+			fitness[i] = static_cast<float>(i);
+		parents = std::vector<int>(POPULATION_SIZE);
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	float MeanParentFitness() {
+		double sum = 0.0;
+		for (int i = 0; i < POPULATION_SIZE; ++i)
+			sum += fitness[parents[i]];
+		return sum / POPULATION_SIZE;
+	}
+
+	static const int POPULATION_SIZE = 100000;
+	BatchRNG rng;
+	Selection selection;
+	std::vector<float> fitness;
+	std::vector<int> parents;
+};
+
+TEST_F(SelectionTest, RankEliteTest) {
+	std::vector<int> ranking;
+	Selection::RankElite(fitness, 10, &ranking);
+	int n = POPULATION_SIZE;
+	for (int i = 0; i < 10; ++i)
+		EXPECT_EQ(n - 1 - i, ranking[i]);
+}
+
+TEST_F(SelectionTest, TruncationTest) {
+	selection.Prepare(TRUNCATION_SELECTION, fitness, 0);
+	selection.SelectMany(POPULATION_SIZE, rng, &parents[0]);
+	float cutoff = POPULATION_SIZE * (1.0f - Selection::TRUNCATION_RATIO);
+	for (int i = 0; i < POPULATION_SIZE; ++i)
+		EXPECT_GE(fitness[parents[i]], cutoff);
+}
+
+TEST_F(SelectionTest, SelectionPressureTest) {
+	// Mean fitness of the parents relative to the population size. Uniform
+	// selection would give 0.5, tournament of size 3 gives 0.75, linear
+	// ranking 2/3 and fitness proportional to the index 2/3.
+	float expected[4] = {0.75f, 2.0f / 3.0f, 2.0f / 3.0f, 0.75f};
+	for (int type = 0; type < 4; ++type) {
+		selection.Prepare(static_cast<SelectionType>(type), fitness, 3);
+		selection.SelectMany(POPULATION_SIZE, rng, &parents[0]);
+		float mean = MeanParentFitness() / POPULATION_SIZE;
+		EXPECT_NEAR(expected[type], mean, 0.01f);
+	}
+}
+
+TEST_F(SelectionTest, StochasticUniversalSpreadTest) {
+	// Every creature is expected once, so every creature is selected once
+	for (int i = 0; i < POPULATION_SIZE; ++i)
+		fitness[i] = 1.0f;
+	selection.Prepare(STOCHASTIC_UNIVERSAL_SAMPLING, fitness, 0);
+	selection.SelectMany(POPULATION_SIZE, rng, &parents[0]);
+	std::vector<int> count(POPULATION_SIZE, 0);
+	for (int i = 0; i < POPULATION_SIZE; ++i)
+		count[parents[i]]++;
+	int not_once = 0;
+	for (int i = 0; i < POPULATION_SIZE; ++i){
+		if (count[i] != 1)
+			not_once++;
+	}
+	// Allow for float rounding of the cumulative sum at a few pointers
+	EXPECT_LT(not_once, 10);
+}
+
+TEST_F(SelectionTest, BenchmarkTest) {
+	const char* names[4] = {"Tournament", "Rank", "SUS", "Truncation"};
+	for (int type = 0; type < 4; ++type) {
+		std::chrono::high_resolution_clock::time_point start =
+			std::chrono::high_resolution_clock::now();
+		std::vector<int> ranking;
+		Selection::RankElite(fitness, POPULATION_SIZE / 5, &ranking);
+		selection.Prepare(static_cast<SelectionType>(type), fitness, 3);
+		selection.SelectMany(POPULATION_SIZE, rng, &parents[0]);
+		std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::high_resolution_clock::now() - start;
+		std::cout << names[type] << " selection of " << POPULATION_SIZE <<
+			" creatures: " << elapsed.count() << " ms" << std::endl;
+	}
+}
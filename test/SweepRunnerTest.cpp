@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "SettingsManager.h"
+#include "SweepRunner.h"
+
+/* *
+* Test class for config files and the expansion of sweeps
+*/
+class SweepRunnerTest : public ::testing::Test {
+protected:
+	SweepRunnerTest() : path("sweep_runner_test.cfg") {
+
+	}
+
+	virtual ~SweepRunnerTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+		std::remove(path.c_str());
+	}
+
+	void WriteFile(const std::string& text) {
+		std::ofstream out(path.c_str());
+		out << text;
+	}
+
+	std::string path;
+};
+
+TEST_F(SweepRunnerTest, ConfigTest) {
+	SettingsManager settings;
+	EXPECT_TRUE(settings.SetValue("population_size", "42"));
+	EXPECT_TRUE(settings.SetValue("mutation_sigma", "0.25"));
+	EXPECT_TRUE(settings.SetValue("fitness_energy", "-1.5"));
+	EXPECT_TRUE(settings.SetValue("record_trajectories", "false"));
+	EXPECT_TRUE(settings.SetValue("target_pos", "1 2 3"));
+	EXPECT_TRUE(settings.SetValue("trajectory_file", "run.cetr"));
+	EXPECT_FALSE(settings.SetValue("population_size", "many"));
+	EXPECT_FALSE(settings.SetValue("no_such_setting", "1"));
+	ASSERT_TRUE(settings.SaveConfig(path));
+
+	// Every setting is written and read back
+	SettingsManager loaded;
+	ASSERT_TRUE(loaded.LoadConfig(path));
+	std::vector<std::string> keys = SettingsManager::GetKeys();
+	for (int i = 0; i < keys.size(); ++i)
+		EXPECT_EQ(settings.GetValue(keys[i]), loaded.GetValue(keys[i])) << keys[i];
+	EXPECT_EQ(42, loaded.GetPopulationSize());
+	EXPECT_FLOAT_EQ(0.25f, loaded.GetMutationSigma());
+	EXPECT_FLOAT_EQ(-1.5f, loaded.GetFitnessEnergy());
+	EXPECT_FALSE(loaded.GetRecordTrajectories());
+	EXPECT_FLOAT_EQ(2.0f, loaded.GetTargetPos().y);
+	EXPECT_EQ("run.cetr", loaded.GetTrajectoryFile());
+
+	// Comments and blank lines are skipped, values are still clamped
+	WriteFile("# comment\n\npopulation_size = 7 # trailing\ncrossover = 3\n");
+	EXPECT_TRUE(loaded.LoadConfig(path));
+	EXPECT_EQ(7, loaded.GetPopulationSize());
+	EXPECT_FLOAT_EQ(1.0f, loaded.GetCrossover());
+	WriteFile("population_size 7\n");
+	EXPECT_FALSE(loaded.LoadConfig(path));
+}
+
+TEST_F(SweepRunnerTest, GridTest) {
+	WriteFile(
+		"max_generations = 5\n"
+		"population_size = 10, 20, 40\n"
+		"mutation_sigma = 0.1 .. 0.3\n"
+		"tournament_size = 2 .. 3\n"
+		"sweep_grid_steps = 3\n"
+		"sweep_repeats = 2\n");
+	SweepRunner runner;
+	ASSERT_TRUE(runner.Load(path));
+	runner.Expand();
+	ASSERT_EQ(3, runner.GetParameters().size());
+	EXPECT_TRUE(runner.GetParameters()[2].integer);
+
+	// 3 population sizes, 3 sigmas, 2 whole tournament sizes, 2 repeats
+	const std::vector<SweepJob>& jobs = runner.GetJobs();
+	ASSERT_EQ(3 * 3 * 2 * 2, jobs.size());
+	EXPECT_EQ("10", jobs[0].values[0]);
+	EXPECT_EQ("0.1", jobs[0].values[1]);
+	EXPECT_EQ("2", jobs[0].values[2]);
+	EXPECT_EQ(jobs[0].values, jobs[1].values);
+	EXPECT_EQ(1, jobs[1].repeat);
+	EXPECT_EQ("3", jobs[2].values[2]);
+	EXPECT_EQ("0.2", jobs[4].values[1]);
+	EXPECT_EQ("40", jobs.back().values[0]);
+	EXPECT_EQ("0.3", jobs.back().values[1]);
+}
+
+TEST_F(SweepRunnerTest, RandomTest) {
+	WriteFile(
+		"sweep_design = random\n"
+		"sweep_samples = 50\n"
+		"creature_type = 0, 1, 2\n"
+		"population_size = 10 .. 100\n"
+		"mutation_sigma = 0.05 .. 0.5\n");
+	SweepRunner runner;
+	ASSERT_TRUE(runner.Load(path));
+	runner.Expand();
+	const std::vector<SweepJob>& jobs = runner.GetJobs();
+	ASSERT_EQ(50, jobs.size());
+	for (int i = 0; i < jobs.size(); ++i) {
+		int creature_type = std::stoi(jobs[i].values[0]);
+		EXPECT_TRUE(creature_type >= 0 && creature_type <= 2);
+		int population_size = std::stoi(jobs[i].values[1]);
+		EXPECT_TRUE(population_size >= 10 && population_size <= 100);
+		EXPECT_EQ(std::string::npos, jobs[i].values[1].find('.'));
+		float sigma = std::stof(jobs[i].values[2]);
+		EXPECT_TRUE(sigma >= 0.05f && sigma <= 0.5f);
+	}
+
+	// Bad settings are found when loading
+	WriteFile("population_size = 10, many\n");
+	EXPECT_FALSE(runner.Load(path));
+	WriteFile("sweep_design = sideways\n");
+	EXPECT_FALSE(runner.Load(path));
+}
+
+TEST_F(SweepRunnerTest, RunJobWithoutContextTest) {
+	// Jobs run without an OpenGL context, nothing may need one
+	WriteFile(
+		"max_generations = 1\n"
+		"population_size = 4\n"
+		"simulation_time = 1\n"
+		"record_trajectories = false\n");
+	std::string result = "sweep_runner_test.csv";
+	ASSERT_TRUE(SweepRunner::RunJob(path, result));
+
+	std::ifstream in(result.c_str());
+	std::string line;
+	std::getline(in, line);
+	EXPECT_EQ("generation,best_fitness,seconds", line);
+	int n_generations = 0;
+	while (std::getline(in, line))
+		n_generations++;
+	EXPECT_EQ(1, n_generations);
+	std::remove(result.c_str());
+}
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "TextureCodec.h"
+
+/* *
+* Test class for reading, mipmapping and compressing textures
+*/
+class TextureCodecTest : public ::testing::Test {
+protected:
+	TextureCodecTest() {
+
+	}
+
+	virtual ~TextureCodecTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	// An uncompressed texture of one colour
+	TextureData SolidTexture(int width, int height, unsigned char value) {
+		TextureData texture;
+		TextureLevel level = {width, height, 0, width * height * 3};
+		texture.levels.push_back(level);
+		texture.data.assign(level.size, value);
+		return texture;
+	}
+};
+
+TEST_F(TextureCodecTest, Dxt1BlockTest) {
+	unsigned char rgb[48];
+	unsigned char block[TextureCodec::DXT1_BLOCK_SIZE];
+	// A red block only needs the first end point
+	for (int p = 0; p < 16; ++p) {
+		rgb[3 * p] = 255;
+		rgb[3 * p + 1] = 0;
+		rgb[3 * p + 2] = 0;
+	}
+	TextureCodec::CompressDxt1Block(rgb, block);
+	EXPECT_EQ(0x00, block[0]);
+	EXPECT_EQ(0xf8, block[1]);
+	EXPECT_EQ(0, block[4] | block[5] | block[6] | block[7]);
+
+	// White top rows pick the first end point, black bottom rows the second
+	for (int p = 0; p < 16; ++p)
+		std::memset(&rgb[3 * p], p < 8 ? 255 : 0, 3);
+	TextureCodec::CompressDxt1Block(rgb, block);
+	EXPECT_EQ(0xff, block[0]);
+	EXPECT_EQ(0xff, block[1]);
+	EXPECT_EQ(0x00, block[2]);
+	EXPECT_EQ(0x00, block[3]);
+	EXPECT_EQ(0x00, block[4]);
+	EXPECT_EQ(0x00, block[5]);
+	EXPECT_EQ(0x55, block[6]);
+	EXPECT_EQ(0x55, block[7]);
+}
+
+TEST_F(TextureCodecTest, MipmapTest) {
+	TextureData texture = SolidTexture(5, 3, 100);
+	texture.data[0] = 0; // Averaged with three other pixels of level 0
+	TextureCodec::GenerateMipmaps(&texture);
+	ASSERT_EQ(3, texture.levels.size());
+	EXPECT_EQ(2, texture.levels[1].width);
+	EXPECT_EQ(1, texture.levels[1].height);
+	EXPECT_EQ(1, texture.levels[2].width);
+	EXPECT_EQ(1, texture.levels[2].height);
+	EXPECT_EQ(texture.data.size(),
+		texture.levels[2].offset + texture.levels[2].size);
+	EXPECT_EQ(75, texture.data[texture.levels[1].offset]);
+	EXPECT_EQ(100, texture.data[texture.levels[1].offset + 1]);
+
+	TextureCodec::CompressDxt1(&texture);
+	EXPECT_TRUE(texture.compressed);
+	EXPECT_EQ(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, texture.internal_format);
+	// Levels smaller than a block still take a whole block
+	EXPECT_EQ(2 * TextureCodec::DXT1_BLOCK_SIZE, texture.levels[0].size);
+	EXPECT_EQ(TextureCodec::DXT1_BLOCK_SIZE, texture.levels[1].size);
+	EXPECT_EQ(TextureCodec::DXT1_BLOCK_SIZE, texture.levels[2].size);
+	EXPECT_EQ(4 * TextureCodec::DXT1_BLOCK_SIZE, texture.data.size());
+}
+
+TEST_F(TextureCodecTest, ReadBitmapTest) {
+	// A 2x2 bitmap, rows of six bytes padded to eight
+	unsigned char file[54 + 16] = {0};
+	file[0] = 'B';
+	file[1] = 'M';
+	file[0x0A] = 54;
+	file[0x12] = 2;
+	file[0x16] = 2;
+	file[0x1C] = 24;
+	const unsigned char pixels[16] = {
+		1, 2, 3, 4, 5, 6, 0, 0,
+		7, 8, 9, 10, 11, 12, 0, 0};
+	std::memcpy(&file[54], pixels, sizeof(pixels));
+	const char* path = "texture_codec_test.bmp";
+	FILE* out = fopen(path, "wb");
+	ASSERT_TRUE(out != NULL);
+	fwrite(file, 1, sizeof(file), out);
+	fclose(out);
+
+	TextureData texture;
+	EXPECT_TRUE(TextureCodec::ReadBitmapFile(path, &texture));
+	std::remove(path);
+	ASSERT_EQ(1, texture.levels.size());
+	EXPECT_FALSE(texture.compressed);
+	ASSERT_EQ(12, texture.data.size());
+	// BGR is turned in to RGB without the padding
+	const unsigned char rgb[12] = {3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10};
+	for (int i = 0; i < 12; ++i)
+		EXPECT_EQ(rgb[i], texture.data[i]);
+
+	EXPECT_FALSE(TextureCodec::ReadBitmapFile("no_such_file.bmp", &texture));
+}
+
+TEST_F(TextureCodecTest, ResizeTest) {
+	// Black on the left and white on the right
+	TextureData texture = SolidTexture(2, 2, 0);
+	std::memset(&texture.data[3], 255, 3);
+	std::memset(&texture.data[9], 255, 3);
+	TextureCodec::Resize(&texture, 3, 1);
+	ASSERT_EQ(1, texture.levels.size());
+	EXPECT_EQ(3, texture.levels[0].width);
+	EXPECT_EQ(1, texture.levels[0].height);
+	ASSERT_EQ(9, texture.data.size());
+	// The corners are kept and the middle is interpolated
+	EXPECT_EQ(0, texture.data[0]);
+	EXPECT_EQ(128, texture.data[3]);
+	EXPECT_EQ(255, texture.data[6]);
+}
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "LzCodec.h"
+#include "TrajectoryFile.h"
+
+/* *
+* Test class for the compressed trajectory file
+*/
+class TrajectoryFileTest : public ::testing::Test {
+protected:
+	TrajectoryFileTest() : path("trajectory_file_test.cetr") {
+
+	}
+
+	virtual ~TrajectoryFileTest() {
+
+	}
+
+	virtual void SetUp() {
+
+	}
+
+	virtual void TearDown() {
+		std::remove(path.c_str());
+	}
+
+	//! Frame f of a creature with two bodies and one joint
+	static void Frame(int creature, int f, float* frame) {
+		float t = 0.033f * f;
+		for (int b = 0; b < 2; ++b) {
+			// The file keeps w positive
+			float angle = 0.5f * t * (b + 1);
+			float sign = std::cos(angle) < 0.0f ? -1.0f : 1.0f;
+			frame[7 * b + 0] = creature + 0.3f * t;
+			frame[7 * b + 1] = 0.5f + 0.1f * std::sin(t);
+			frame[7 * b + 2] = b;
+			frame[7 * b + 3] = 0.0f;
+			frame[7 * b + 4] = sign * std::sin(angle);
+			frame[7 * b + 5] = 0.0f;
+			frame[7 * b + 6] = sign * std::cos(angle);
+		}
+		frame[14] = std::sin(2.0f * t);
+	}
+
+	//! Writes N_CREATURES creatures of N_FRAMES frames in chunks
+	void WriteFile(TrajectoryWriter* writer) {
+		ASSERT_TRUE(writer->Open(path));
+		int first = writer->ReserveCreatures(N_CREATURES);
+		for (int c = 0; c < N_CREATURES; ++c) {
+			TrajectoryChunk chunk;
+			chunk.creature = first + c;
+			chunk.n_bodies = 2;
+			chunk.n_joints = 1;
+			chunk.frame_time = 0.033f;
+			for (int f = 0; f < N_FRAMES; ++f) {
+				chunk.values.resize(chunk.values.size() + chunk.FrameSize());
+				Frame(c, f, &chunk.values[chunk.values.size() - chunk.FrameSize()]);
+				chunk.n_frames++;
+				if (chunk.n_frames == TrajectoryWriter::CHUNK_FRAMES || f == N_FRAMES - 1) {
+					EXPECT_TRUE(writer->Submit(&chunk));
+					chunk.first_frame += chunk.n_frames;
+					chunk.n_frames = 0;
+					chunk.values.clear();
+				}
+			}
+		}
+	}
+
+	float MaxError(const TrajectoryChunk& chunk, int creature) {
+		float frame[15];
+		float max_error = 0.0f;
+		for (int f = 0; f < chunk.n_frames; ++f) {
+			Frame(creature, chunk.first_frame + f, frame);
+			for (int v = 0; v < 15; ++v) {
+				max_error = std::max(max_error,
+					std::abs(frame[v] - chunk.values[f * 15 + v]));
+			}
+		}
+		return max_error;
+	}
+
+	static const int N_CREATURES = 20;
+	static const int N_FRAMES = 300;
+	std::string path;
+};
+
+const int TrajectoryFileTest::N_CREATURES;
+const int TrajectoryFileTest::N_FRAMES;
+
+TEST_F(TrajectoryFileTest, LzCodecTest) {
+	// Repetitive text and random bytes
+	std::vector<char> text;
+	for (int i = 0; i < 10000; ++i)
+		text.push_back("creature evolution "[i % 19] + (i % 1000 == 0));
+	std::vector<char> noise;
+	unsigned int x = 12345;
+	for (int i = 0; i < 10000; ++i) {
+		x = x * 1103515245u + 12345u;
+		noise.push_back(static_cast<char>(x >> 16));
+	}
+
+	std::vector<char> compressed, decompressed;
+	LzCodec::Compress(&text[0], text.size(), &compressed);
+	std::cout << "Text " << text.size() << " -> " << compressed.size() << " bytes" << std::endl;
+	EXPECT_LT(compressed.size(), text.size() / 10);
+	ASSERT_TRUE(LzCodec::Decompress(&compressed[0], compressed.size(), text.size(), &decompressed));
+	EXPECT_TRUE(decompressed == text);
+
+	LzCodec::Compress(&noise[0], noise.size(), &compressed);
+	ASSERT_TRUE(LzCodec::Decompress(&compressed[0], compressed.size(), noise.size(), &decompressed));
+	EXPECT_TRUE(decompressed == noise);
+
+	// Corrupt data is detected
+	EXPECT_FALSE(LzCodec::Decompress(&compressed[0], compressed.size() / 2, noise.size(), &decompressed));
+}
+
+TEST_F(TrajectoryFileTest, SeekTest) {
+	{
+		TrajectoryWriter writer;
+		WriteFile(&writer);
+		writer.Close();
+		EXPECT_EQ(0, writer.GetDroppedChunks());
+	}
+	std::ifstream size_in(path.c_str(), std::ios::binary | std::ios::ate);
+	long long raw_size = N_CREATURES * N_FRAMES * 15 * sizeof(float);
+	std::cout << "File " << size_in.tellg() << " bytes, raw " << raw_size << " bytes" << std::endl;
+	EXPECT_LT(size_in.tellg(), raw_size / 3);
+
+	TrajectoryReader reader;
+	ASSERT_TRUE(reader.Open(path));
+	EXPECT_EQ(N_CREATURES, reader.GetNumberOfCreatures());
+
+	// A whole creature
+	TrajectoryChunk chunk;
+	ASSERT_TRUE(reader.Read(7, 0, N_FRAMES, &chunk));
+	EXPECT_EQ(0, chunk.first_frame);
+	EXPECT_EQ(N_FRAMES, chunk.n_frames);
+	EXPECT_LT(MaxError(chunk, 7), 1e-3f);
+
+	// A window crossing a chunk border
+	ASSERT_TRUE(reader.Read(13, 100, 150, &chunk));
+	EXPECT_EQ(100, chunk.first_frame);
+	EXPECT_EQ(50, chunk.n_frames);
+	EXPECT_LT(MaxError(chunk, 13), 1e-3f);
+
+	EXPECT_FALSE(reader.Read(13, N_FRAMES, N_FRAMES + 10, &chunk));
+	EXPECT_FALSE(reader.Read(N_CREATURES, 0, N_FRAMES, &chunk));
+}
+
+TEST_F(TrajectoryFileTest, RebuildIndexTest) {
+	{
+		TrajectoryWriter writer;
+		WriteFile(&writer);
+		writer.Close();
+	}
+	// Cut the file in the last chunk header like after a crash
+	TrajectoryReader reader;
+	ASSERT_TRUE(reader.Open(path));
+	std::vector<TrajectoryIndexEntry> index = reader.GetIndex();
+	long long cut = index.back().offset + 20;
+	std::vector<char> data(cut);
+	{
+		std::ifstream in(path.c_str(), std::ios::binary);
+		in.read(&data[0], cut);
+	}
+	{
+		std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+		out.write(&data[0], cut);
+	}
+
+	TrajectoryReader rebuilt;
+	ASSERT_TRUE(rebuilt.Open(path));
+	EXPECT_EQ(index.size() - 1, rebuilt.GetIndex().size());
+	TrajectoryChunk chunk;
+	ASSERT_TRUE(rebuilt.Read(3, 0, N_FRAMES, &chunk));
+	EXPECT_EQ(N_FRAMES, chunk.n_frames);
+	EXPECT_LT(MaxError(chunk, 3), 1e-3f);
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "Trajectory.h"
+
+/* *
+* Test class for recording and playing back Trajectories
+*/
+class TrajectoryTest : public ::testing::Test {
+protected:
+	TrajectoryTest() : trajectory(N_BODIES, FRAME_TIME) {
+
+	}
+
+	virtual ~TrajectoryTest() {
+
+	}
+
+	virtual void SetUp() {
+		// Body b moves along x and turns around y, one step per frame
+		btTransform transforms[N_BODIES];
+		for (int f = 0; f < N_FRAMES; ++f) {
+			for (int b = 0; b < N_BODIES; ++b) {
+				transforms[b] = Expected(f, b);
+			}
+			trajectory.AddFrame(transforms);
+		}
+	}
+
+	virtual void TearDown() {
+
+	}
+
+	static btTransform Expected(float frame, int b) {
+		return btTransform(
+			btQuaternion(btVector3(0, 1, 0), 0.05f * frame * (b + 1)),
+			btVector3(b + 0.1f * frame, 1.0f, -2.0f));
+	}
+
+	static const int N_BODIES = 3;
+	static const int N_FRAMES = 50;
+	static const float FRAME_TIME;
+	Trajectory trajectory;
+};
+
+const int TrajectoryTest::N_BODIES;
+const int TrajectoryTest::N_FRAMES;
+const float TrajectoryTest::FRAME_TIME = 1.0f / 30.0f;
+
+TEST_F(TrajectoryTest, QuantizationTest) {
+	EXPECT_EQ(N_FRAMES, trajectory.GetNumberOfFrames());
+	EXPECT_EQ(N_BODIES, trajectory.GetNumberOfBodies());
+	EXPECT_NEAR((N_FRAMES - 1) * FRAME_TIME, trajectory.GetDuration(), 1e-5f);
+
+	float max_position_error = 0.0f;
+	float max_angle_error = 0.0f;
+	for (int f = 0; f < N_FRAMES; ++f) {
+		for (int b = 0; b < N_BODIES; ++b) {
+			btTransform expected = Expected(f, b);
+			btTransform actual = trajectory.GetTransform(f, b);
+			max_position_error = std::max(max_position_error,
+				(expected.getOrigin() - actual.getOrigin()).length());
+			max_angle_error = std::max(max_angle_error,
+				expected.getRotation().angleShortestPath(actual.getRotation()));
+		}
+	}
+	std::cout << "Max position error = " << max_position_error <<
+		", max angle error = " << max_angle_error << std::endl;
+	EXPECT_LT(max_position_error, Trajectory::POSITION_SCALE);
+	EXPECT_LT(max_angle_error, 1e-3f);
+}
+
+TEST_F(TrajectoryTest, InterpolationTest) {
+	// Half way between two frames
+	for (int b = 0; b < N_BODIES; ++b) {
+		btTransform expected = Expected(10.5f, b);
+		btTransform actual = trajectory.Sample(10.5f * FRAME_TIME, b);
+		EXPECT_LT((expected.getOrigin() - actual.getOrigin()).length(), 2e-3f);
+		EXPECT_LT(expected.getRotation().angleShortestPath(actual.getRotation()), 2e-3f);
+	}
+
+	// Clamped outside of the recording
+	btTransform last = trajectory.GetTransform(N_FRAMES - 1, 0);
+	btTransform after = trajectory.Sample(100.0f, 0);
+	EXPECT_FLOAT_EQ(last.getOrigin().getX(), after.getOrigin().getX());
+	btTransform first = trajectory.GetTransform(0, 0);
+	btTransform before = trajectory.Sample(-1.0f, 0);
+	EXPECT_FLOAT_EQ(first.getOrigin().getX(), before.getOrigin().getX());
+}